@@ -0,0 +1,73 @@
+#pragma once
+// 在模拟器上比较生成代码的基准共用的部分：临时文件、要编译执行的程序，以及编译后在模拟器上执行main
+#include "driver.h"
+#include "peephole.h"
+#include "progen.h"
+#include "sim.h"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// 在/tmp下新建一个以suffix结尾的空文件，返回它的路径
+inline std::string temporaryPath(const char* suffix) {
+    std::string path = std::string("/tmp/toyc_bench_XXXXXX") + suffix;
+    std::vector<char> buffer(path.begin(), path.end());
+    buffer.push_back('\0');
+    int fd = mkstemps(buffer.data(), static_cast<int>(std::string(suffix).size()));
+    if (fd < 0) throw std::runtime_error("无法创建临时文件");
+    close(fd);
+    return buffer.data();
+}
+
+// 要编译执行的程序。temporary为true时path是基准自己写出的临时文件，结束时删除
+struct Workload {
+    std::string name;
+    std::string path;
+    bool temporary;
+    bool inlineCalls = true;
+};
+
+// 手写的内核。内核不内联：main用常量实参调用它，内联后整个循环都会被折叠掉
+inline Workload kernelWorkload(const std::string& name, const char* source) {
+    Workload workload{name, temporaryPath(".toyc"), true, false};
+    std::ofstream(workload.path) << source;
+    return workload;
+}
+
+// progen按形状生成的合成程序
+inline Workload generatedWorkload(const char* shape, int size) {
+    GeneratorOptions options;
+    shapeOptions(shape, size, options);
+    Workload workload{std::string(shape) + " " + std::to_string(size), temporaryPath(".toyc"), true};
+    std::ofstream(workload.path) << generateProgram(options);
+    return workload;
+}
+
+inline void removeTemporaries(const std::vector<Workload>& workloads) {
+    for (const Workload& workload : workloads) {
+        if (workload.temporary) std::remove(workload.path.c_str());
+    }
+}
+
+// 按options编译（emitObject决定输出汇编文本还是目标文件），在按model计时的模拟器上执行main，
+// 返回值写进result
+inline SimStats compileAndRun(const Workload& workload, const CompileOptions& options, int32_t& result,
+                              const PipelineModel& model = PipelineModel()) {
+    std::string output = temporaryPath(options.emitObject ? ".o" : ".s");
+    std::ostream quiet(nullptr);
+    PeepholeOptimizer peephole;
+    try {
+        compileFile(workload.path, output, options, quiet, &peephole, nullptr);
+        CodeImage image = loadImage(output);
+        Simulator simulator(image, model);
+        result = simulator.call("main");
+        std::remove(output.c_str());
+        return simulator.stats();
+    } catch (...) {
+        std::remove(output.c_str());
+        throw;
+    }
+}
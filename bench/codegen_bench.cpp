@@ -0,0 +1,161 @@
+// 并行代码生成的扩展性基准：生成有上千个函数的程序，分别用1、2、4、8……个线程跑
+// -O0的AST代码生成和-O1的指令选择，检查输出与单线程逐字节相同
+#include "codegen.h"
+#include "constfold.h"
+#include "emitter.h"
+#include "irgen.h"
+#include "isel.h"
+#include "parser.h"
+#include "passes.h"
+#include "peephole.h"
+#include "semantic.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// 生成functionCount个函数，每个函数带循环、分支和对前面函数的调用
+std::string generateSource(int functionCount) {
+    std::string source;
+    for (int i = 0; i < functionCount; ++i) {
+        std::string id = std::to_string(i);
+        std::string callee = i > 0 ? "f" + std::to_string(i - 1) + "(t, b)" : "a - b";
+        source += "int f" + id + "(int a, int b) {\n"
+                  "    int t = a * " + std::to_string(i % 13 + 2) + " + b;\n"
+                  "    int s = 0;\n"
+                  "    int k = 0;\n"
+                  "    while (k < a && t != b) {\n"
+                  "        if (k % 3 == 0 || t > 1000) {\n"
+                  "            s = s + t / (k + 1) - b;\n"
+                  "        } else {\n"
+                  "            s = s - (t % 7) * " + std::to_string(i % 5 + 1) + ";\n"
+                  "        }\n"
+                  "        t = t - s % 11 + k;\n"
+                  "        k = k + 1;\n"
+                  "    }\n"
+                  "    if (a > 100) {\n"
+                  "        return s + " + callee + ";\n"
+                  "    }\n"
+                  "    return s - t + k;\n"
+                  "}\n\n";
+    }
+    source += "int main() {\n    return f" + std::to_string(functionCount - 1) + "(7, 3);\n}\n";
+    return source;
+}
+
+using Clock = std::chrono::steady_clock;
+
+template <typename F>
+double bestOf(int runs, F&& body) {
+    double best = 1e30;
+    for (int r = 0; r < runs; ++r) {
+        auto start = Clock::now();
+        body();
+        double secs = std::chrono::duration<double>(Clock::now() - start).count();
+        if (secs < best) best = secs;
+    }
+    return best;
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int functionCount = argc > 1 ? std::stoi(argv[1]) : 4000;
+    std::string source = generateSource(functionCount);
+
+    ASTContext context;
+    Parser parser(source, context);
+    auto ast = parser.parse();
+    if (!ast) {
+        std::cerr << "语法分析失败" << std::endl;
+        return 1;
+    }
+    SemanticAnalyzer semantic(context.names);
+    semantic.analyze(ast);
+    ConstantFolder folder(context);
+    folder.optimize(ast);
+
+    char tmpl[] = "/tmp/toyc_codegen_bench_XXXXXX";
+    int fd = mkstemp(tmpl);
+    if (fd < 0) {
+        std::cerr << "无法创建临时文件" << std::endl;
+        return 1;
+    }
+    close(fd);
+    std::string path = tmpl;
+
+    std::vector<unsigned> threadCounts = {1, 2, 4, 8};
+    unsigned hardware = std::thread::hardware_concurrency();
+    if (hardware > 8) threadCounts.push_back(hardware);
+
+    const int runs = 3;
+    std::printf("输入: %d个函数, %.2f MB, 硬件线程数%u, 最好成绩取%d次\n", functionCount,
+                source.size() / (1024.0 * 1024.0), hardware, runs);
+    bool identical = true;
+    for (int optLevel = 0; optLevel <= 1; ++optLevel) {
+        std::string reference;
+        double serial = 0;
+        for (unsigned threads : threadCounts) {
+            ThreadPool pool(threads);
+            double secs = 0;
+            if (optLevel == 0) {
+                secs = bestOf(runs, [&] {
+                    PeepholeOptimizer peephole;
+                    TextEmitter emitter(path);
+                    CodeGenerator codegen(emitter, context.names, &peephole, &pool);
+                    codegen.generate(ast);
+                    emitter.finish();
+                });
+            } else {
+                // 指令选择会原地修改IR，每次重新生成IR，只计指令选择的时间
+                secs = 1e30;
+                for (int r = 0; r < runs; ++r) {
+                    IRGenerator irgen(context.names);
+                    auto module = irgen.generate(ast);
+                    PassManager passes(context.names);
+                    addDefaultPasses(passes);
+                    passes.run(*module);
+                    auto start = Clock::now();
+                    PeepholeOptimizer peephole;
+                    TextEmitter emitter(path);
+                    InstructionSelector isel(emitter, context.names, &peephole, &pool);
+                    isel.generate(*module);
+                    emitter.finish();
+                    secs = std::min(secs, std::chrono::duration<double>(Clock::now() - start).count());
+                }
+            }
+            std::string output = readFile(path);
+            if (threads == 1) {
+                reference = output;
+                serial = secs;
+            } else if (output != reference) {
+                identical = false;
+            }
+            std::printf("-O%d  %2u线程  %8.2f ms  加速比 %.2fx\n", optLevel, threads, secs * 1e3, serial / secs);
+        }
+    }
+    std::remove(path.c_str());
+
+    if (!identical) {
+        std::cerr << "多线程输出与单线程不一致" << std::endl;
+        return 1;
+    }
+    std::printf("各线程数的输出与单线程逐字节相同\n");
+    return 0;
+}
@@ -0,0 +1,281 @@
+// 融合前端基准：比较“语法分析后再单独做语义分析”和“语法分析时同时做语义检查”两种前端的耗时，
+// 程序取自合成程序生成器的四种形状。同时检查两种前端的结果相同：合法程序的变量编号和每个函数的
+// 变量个数必须一致；对合成程序做随机变异（删掉、重复或替换词法单元，插入break、return、声明和调用等）
+// 得到的非法程序报错必须一致，“所有路径都return”的结论还要与控制流图上落出函数体末尾的可达性一致。
+// 有任何不一致时返回1
+#include "cfg.h"
+#include "lexer.h"
+#include "parser.h"
+#include "progen.h"
+#include "semantic.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+template <typename F>
+double bestOf(int runs, F&& body) {
+    double best = 1e30;
+    for (int r = 0; r < runs; ++r) {
+        auto start = Clock::now();
+        body();
+        double secs = std::chrono::duration<double>(Clock::now() - start).count();
+        if (secs < best) best = secs;
+    }
+    return best;
+}
+
+// 跑一遍前端，出错时返回报错，否则返回空串
+std::string frontend(const std::string& source, bool fused, ASTContext& context, ASTNodePtr& ast) {
+    try {
+        if (fused) {
+            FrontendChecker checker(context.names);
+            Parser parser(source, context, &checker);
+            ast = parser.parse();
+        } else {
+            Parser parser(source, context);
+            ast = parser.parse();
+            SemanticAnalyzer semantic(context.names);
+            semantic.analyze(ast);
+        }
+    } catch (const std::exception& e) {
+        return e.what();
+    }
+    return "";
+}
+
+// 按先序记下所有变量编号和每个函数的变量个数
+void collectVars(ASTNodePtr node, std::vector<uint32_t>& out) {
+    if (!node) return;
+    switch (node->kind) {
+    case NodeKind::Program:
+        for (ASTNodePtr f : as<Program>(node)->functions) collectVars(f, out);
+        break;
+    case NodeKind::FunctionDef:
+        out.push_back(as<FunctionDef>(node)->varCount);
+        collectVars(as<FunctionDef>(node)->body, out);
+        break;
+    case NodeKind::Block:
+        for (ASTNodePtr s : as<Block>(node)->stmts) collectVars(s, out);
+        break;
+    case NodeKind::VarDecl:
+        collectVars(as<VarDecl>(node)->initExpr, out);
+        out.push_back(as<VarDecl>(node)->var);
+        break;
+    case NodeKind::Assign:
+        out.push_back(as<Assign>(node)->var);
+        collectVars(as<Assign>(node)->expr, out);
+        break;
+    case NodeKind::IfStmt:
+        collectVars(as<IfStmt>(node)->cond, out);
+        collectVars(as<IfStmt>(node)->thenStmt, out);
+        collectVars(as<IfStmt>(node)->elseStmt, out);
+        break;
+    case NodeKind::WhileStmt:
+        collectVars(as<WhileStmt>(node)->cond, out);
+        collectVars(as<WhileStmt>(node)->body, out);
+        break;
+    case NodeKind::ReturnStmt:
+        collectVars(as<ReturnStmt>(node)->expr, out);
+        break;
+    case NodeKind::ExprStmt:
+        collectVars(as<ExprStmt>(node)->expr, out);
+        break;
+    case NodeKind::BinaryExpr:
+        collectVars(as<BinaryExpr>(node)->lhs, out);
+        collectVars(as<BinaryExpr>(node)->rhs, out);
+        break;
+    case NodeKind::UnaryExpr:
+        collectVars(as<UnaryExpr>(node)->expr, out);
+        break;
+    case NodeKind::VarRef:
+        out.push_back(as<VarRef>(node)->var);
+        break;
+    case NodeKind::FuncCall:
+        for (ASTNodePtr a : as<FuncCall>(node)->args) collectVars(a, out);
+        break;
+    default:
+        break;
+    }
+}
+
+const std::string MissingReturn = "语义错误: int函数所有路径必须return int: ";
+
+// 在控制流图上做“所有路径都return”的检查，返回第一个会落出函数体末尾的int函数的报错
+std::string cfgReturnCheck(ASTNodePtr ast, const StringInterner& names) {
+    for (ASTNodePtr f : as<Program>(ast)->functions) {
+        auto func = as<FunctionDef>(f);
+        if (func->retType == TypeKind::Int && ControlFlowGraph(func).fallsOffEnd()) {
+            return MissingReturn + std::string(names.name(func->name));
+        }
+    }
+    return "";
+}
+
+// 插入到某个词法单元前面的片段，覆盖各种语义错误
+const char* const Insertions[] = {
+    "break; ", "continue; ", "return; ", "return 0; ", "int v0 = 1; ", "int p0; ", "v1 = 2; ",
+    "x = 1; ", "f0(); ", "f1(1); ", "main(); ", "g(); ", "int a = 1 / 0; ", "int b = 3 % (2 - 2); ",
+    "{ int v0; int v0; } ", "while (1) { break; } ", "if (1) return 1; else return 2; ",
+    "void f0() { } ", "int main() { return 0; } ", "void q() { return 1; } ", "int r() { } ",
+    "int s(int a, int a) { return a; } ", "int t() { return t(); } ", "int u = f0() + 1; ",
+    "while (1) { return 1; } ", "if (1) return 0; ", "while (0) { return 1; } ",
+    "while (1 < 2) { if (v0) break; return 2; } ", "if (0 && v0) return 1; else return 2; ",
+    "void w() { } int y() { w(); return w(); } ", "void z() { } int k() { return 1 + z(); } ",
+};
+
+std::vector<TokenView> tokenize(const std::string& source) {
+    std::vector<TokenView> tokens;
+    ViewLexer lexer(source);
+    for (TokenView t = lexer.nextToken(); t.type != TokenType::END_OF_FILE; t = lexer.nextToken()) {
+        tokens.push_back(t);
+    }
+    return tokens;
+}
+
+// 随机改动源码中的一处；source为空程序时原样返回
+std::string mutate(const std::string& source, std::mt19937& rng) {
+    std::vector<TokenView> tokens = tokenize(source);
+    if (tokens.empty()) return source;
+    const TokenView& token = tokens[rng() % tokens.size()];
+    size_t begin = token.offset, end = token.offset + token.text.size();
+    switch (rng() % 8) {
+    case 0: // 删掉
+        return source.substr(0, begin) + source.substr(end);
+    case 1: // 重复
+        return source.substr(0, end) + " " + std::string(token.text) + source.substr(end);
+    case 2: { // 换成另一个词法单元
+        const TokenView& other = tokens[rng() % tokens.size()];
+        return source.substr(0, begin) + std::string(other.text) + source.substr(end);
+    }
+    case 3: { // 把一个标识符换成另一个标识符
+        std::vector<const TokenView*> identifiers;
+        for (const TokenView& t : tokens) {
+            if (t.type == TokenType::IDENTIFIER) identifiers.push_back(&t);
+        }
+        if (identifiers.size() < 2) break;
+        const TokenView* from = identifiers[rng() % identifiers.size()];
+        const TokenView* to = identifiers[rng() % identifiers.size()];
+        return source.substr(0, from->offset) + std::string(to->text) +
+               source.substr(from->offset + from->text.size());
+    }
+    default:
+        break;
+    }
+    // 其余情况在语句边界（';'、'{'、'}'之后）插入一段，多半能通过语法分析，用来覆盖语义错误
+    std::vector<size_t> boundaries;
+    for (const TokenView& t : tokens) {
+        if (t.type == TokenType::SEMICOLON || t.type == TokenType::LBRACE || t.type == TokenType::RBRACE) {
+            boundaries.push_back(t.offset + 1);
+        }
+    }
+    size_t at = boundaries.empty() ? begin : boundaries[rng() % boundaries.size()];
+    const char* insertion = Insertions[rng() % (sizeof(Insertions) / sizeof(Insertions[0]))];
+    return source.substr(0, at) + " " + insertion + source.substr(at);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int runs = 5, mutants = 4000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--runs" && i + 1 < argc) {
+            runs = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--mutants" && i + 1 < argc) {
+            mutants = std::max(0, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "用法: " << argv[0] << " [--runs N] [--mutants N]" << std::endl;
+            return 1;
+        }
+    }
+
+    bool consistent = true;
+    std::printf("%-16s %10s %14s %14s %8s\n", "形状", "词法单元", "分开(ns/单元)", "融合(ns/单元)", "加速");
+    const std::pair<const char*, int> shapes[] = {
+        {"functions", 4000}, {"expr", 200}, {"block", 4000}, {"loops", 64}};
+    for (const auto& [shape, size] : shapes) {
+        GeneratorOptions options;
+        shapeOptions(shape, size, options);
+        std::string source = generateProgram(options);
+        size_t tokens = 0;
+        ViewLexer lexer(source);
+        while (lexer.nextToken().type != TokenType::END_OF_FILE) ++tokens;
+
+        double secs[2];
+        for (int fused = 0; fused <= 1; ++fused) {
+            secs[fused] = bestOf(runs, [&] {
+                ASTContext context;
+                ASTNodePtr ast;
+                if (!frontend(source, fused, context, ast).empty()) consistent = false;
+            });
+        }
+        std::vector<uint32_t> vars[2];
+        for (int fused = 0; fused <= 1; ++fused) {
+            ASTContext context;
+            ASTNodePtr ast;
+            if (frontend(source, fused, context, ast).empty()) collectVars(ast, vars[fused]);
+        }
+        bool same = vars[0] == vars[1];
+        if (!same) consistent = false;
+        std::printf("%-16s %10zu %14.1f %14.1f %7.2fx%s\n", (std::string(shape) + " " + std::to_string(size)).c_str(),
+                    tokens, secs[0] * 1e9 / tokens, secs[1] * 1e9 / tokens, secs[0] / secs[1],
+                    same ? "" : "  变量编号不一致");
+    }
+
+    // 变异测试：小程序变异后大多非法，覆盖各种报错
+    std::mt19937 rng(2024);
+    int invalid = 0, mismatches = 0, cfgChecked = 0, cfgMismatches = 0;
+    for (int i = 0; i < mutants; ++i) {
+        GeneratorOptions options;
+        options.functions = 1 + static_cast<int>(rng() % 4);
+        options.statements = 2 + static_cast<int>(rng() % 6);
+        options.exprDepth = static_cast<int>(rng() % 3);
+        options.loopDepth = static_cast<int>(rng() % 3);
+        options.seed = rng();
+        std::string mutant = mutate(generateProgram(options), rng);
+        if (rng() % 4 == 0) mutant = mutate(mutant, rng);
+
+        std::string diagnostics[2];
+        std::vector<uint32_t> vars[2];
+        for (int fused = 0; fused <= 1; ++fused) {
+            ASTContext context;
+            ASTNodePtr ast;
+            diagnostics[fused] = frontend(mutant, fused, context, ast);
+            if (diagnostics[fused].empty()) collectVars(ast, vars[fused]);
+            // 其余检查都通过时，缺return的报错应当正好是控制流图找到的第一个函数
+            const std::string& message = diagnostics[fused];
+            if (!fused && (message.empty() || message.compare(0, MissingReturn.size(), MissingReturn) == 0)) {
+                ++cfgChecked;
+                std::string expected = cfgReturnCheck(ast, context.names);
+                if (expected != message && ++cfgMismatches <= 5) {
+                    std::cerr << "与控制流图不一致:\n  语义分析: " << message << "\n  控制流图: " << expected
+                              << "\n程序:\n" << mutant << std::endl;
+                }
+            }
+        }
+        if (!diagnostics[0].empty()) ++invalid;
+        if (diagnostics[0] != diagnostics[1] || vars[0] != vars[1]) {
+            if (++mismatches <= 5) {
+                std::cerr << "报错不一致:\n  分开: " << diagnostics[0] << "\n  融合: " << diagnostics[1]
+                          << "\n程序:\n" << mutant << std::endl;
+            }
+        }
+    }
+    std::printf("变异程序%d个（非法%d个），两种前端结果不一致%d个\n", mutants, invalid, mismatches);
+    std::printf("其中%d个与控制流图的return检查对照，不一致%d个\n", cfgChecked, cfgMismatches);
+    if (mismatches > 0 || cfgMismatches > 0) consistent = false;
+    if (!consistent) {
+        std::cerr << "两种前端的结果不一致" << std::endl;
+        return 1;
+    }
+    return 0;
+}
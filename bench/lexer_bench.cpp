@@ -0,0 +1,119 @@
+// 词法分析吞吐量基准：原来的逐字符Lexer（读入+复制源码、每个词法单元一个std::string）
+// 对比 mmap + ViewLexer（string_view词法单元 + 标识符驻留）
+#include "lexer.h"
+#include "source.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+// 生成约targetBytes字节的ToyC源码，函数名各不相同以体现驻留表的作用
+std::string generateSource(size_t targetBytes) {
+    std::string source;
+    source.reserve(targetBytes + 256);
+    for (int i = 0; source.size() < targetBytes; ++i) {
+        std::string id = std::to_string(i);
+        source += "int helper_" + id + "(int a, int b) {\n"
+                  "    int t = a * " + id + " + b; // 注释\n"
+                  "    while (t > 0 && a != b) {\n"
+                  "        t = t - (a % 7) / 2;\n"
+                  "        if (t <= b || !(a >= 3)) { break; } else { continue; }\n"
+                  "    }\n"
+                  "    /* 多行\n       注释 */\n"
+                  "    return t + helper_" + id + "_count;\n"
+                  "}\n\n";
+    }
+    return source;
+}
+
+using Clock = std::chrono::steady_clock;
+
+template <typename F>
+double bestOf(int runs, F&& body) {
+    double best = 1e30;
+    for (int r = 0; r < runs; ++r) {
+        auto start = Clock::now();
+        body();
+        double secs = std::chrono::duration<double>(Clock::now() - start).count();
+        if (secs < best) best = secs;
+    }
+    return best;
+}
+
+void report(const char* name, size_t tokens, size_t bytes, double secs) {
+    std::printf("%-28s %10zu tokens  %8.3f ms  %8.2f Mtok/s  %8.1f MB/s\n", name, tokens,
+                secs * 1e3, tokens / secs / 1e6, bytes / secs / (1024.0 * 1024.0));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t megabytes = 8;
+    std::string path;
+    if (argc > 1) {
+        std::string arg = argv[1];
+        if (arg.find_first_not_of("0123456789") == std::string::npos) {
+            megabytes = std::stoul(arg);
+        } else {
+            path = arg;
+        }
+    }
+
+    bool generated = path.empty();
+    if (generated) {
+        char tmpl[] = "/tmp/toyc_lexer_bench_XXXXXX";
+        int fd = mkstemp(tmpl);
+        if (fd < 0) {
+            std::cerr << "无法创建临时文件" << std::endl;
+            return 1;
+        }
+        close(fd);
+        path = tmpl;
+        std::ofstream out(path, std::ios::binary);
+        out << generateSource(megabytes * 1024 * 1024);
+    }
+
+    const int runs = 5;
+    size_t bytes = 0, legacyTokens = 0, viewTokens = 0, symbols = 0;
+
+    // 传统路径：与原main.cpp的readFile相同地经stringstream读入，再由Lexer复制一份
+    double legacy = bestOf(runs, [&] {
+        std::ifstream file(path);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        std::string source = buffer.str();
+        bytes = source.size();
+        Lexer lexer(source);
+        legacyTokens = 0;
+        while (lexer.nextToken().type != TokenType::END_OF_FILE) ++legacyTokens;
+    });
+
+    // 零拷贝路径：只读映射 + string_view词法单元 + 标识符驻留
+    double view = bestOf(runs, [&] {
+        SourceFile source(path);
+        StringInterner interner;
+        ViewLexer lexer(source.text(), &interner);
+        viewTokens = 0;
+        while (lexer.nextToken().type != TokenType::END_OF_FILE) ++viewTokens;
+        symbols = interner.size();
+    });
+
+    if (generated) std::remove(path.c_str());
+
+    std::printf("输入: %s, %.2f MB, 最好成绩取%d次\n", generated ? "生成的程序" : path.c_str(),
+                bytes / (1024.0 * 1024.0), runs);
+    report("Lexer (复制 + std::string)", legacyTokens, bytes, legacy);
+    report("ViewLexer (mmap + 驻留)", viewTokens, bytes, view);
+    std::printf("不同标识符: %zu, 加速比: %.2fx\n", symbols, legacy / view);
+    if (legacyTokens != viewTokens) {
+        std::cerr << "词法单元数量不一致" << std::endl;
+        return 1;
+    }
+    return 0;
+}
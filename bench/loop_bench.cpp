@@ -0,0 +1,139 @@
+// 循环优化基准：把几个循环内核、test/example.toyc和合成程序按-O1编译，分别关掉全部循环优化、
+// 只打开其中一项（不变量外提、强度削弱、展开）和全部打开，在RV32IM模拟器上执行main，
+// 比较动态指令数和周期估计。各种组合以及-O0的执行结果必须相同，否则返回1
+#include "bench_util.h"
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 循环不变量：每次迭代都重新算的表达式只依赖形参
+const char* const InvariantKernel = R"(
+int kernel(int a, int b, int n) {
+    int s = 0;
+    int i = 0;
+    while (i < n) {
+        s = s + i * (a * b - 3) + (a + b) / 7;
+        if (s > a * 1000) {
+            s = s - (b * b + a);
+        }
+        i = i + 1;
+    }
+    return s;
+}
+int main() { return kernel(13, 29, 2000); }
+)";
+
+// 归纳变量：二维下标式的乘法
+const char* const InductionKernel = R"(
+int kernel(int rows, int cols) {
+    int s = 0;
+    int i = 0;
+    while (i < rows) {
+        int j = 0;
+        while (j < cols) {
+            s = s + i * 96 + j * 12 + (j * 12) % 5;
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+    return s;
+}
+int main() { return kernel(60, 40); }
+)";
+
+// 迭代次数在编译时已知的小循环
+const char* const CountedKernel = R"(
+int kernel(int x) {
+    int s = 0;
+    int k = 0;
+    while (k < 500) {
+        int j = 0;
+        int p = 1;
+        while (j < 6) {
+            p = p * 3 + x;
+            j = j + 1;
+        }
+        s = s + p % 1000 + k;
+        k = k + 1;
+    }
+    return s;
+}
+int main() { return kernel(7); }
+)";
+
+struct Configuration {
+    const char* name;
+    bool licm, strengthReduce, unroll;
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<Workload> workloads;
+    for (int i = 1; i < argc; ++i) workloads.push_back({argv[i], argv[i], false});
+    if (workloads.empty()) {
+        const std::pair<const char*, const char*> kernels[] = {
+            {"invariant", InvariantKernel}, {"induction", InductionKernel}, {"counted", CountedKernel}};
+        for (const auto& [name, source] : kernels) workloads.push_back(kernelWorkload(name, source));
+        workloads.push_back({"example", "test/example.toyc", false});
+        const std::pair<const char*, int> shapes[] = {{"functions", 200}, {"block", 200}, {"loops", 6}};
+        for (const auto& [shape, size] : shapes) workloads.push_back(generatedWorkload(shape, size));
+    }
+
+    const Configuration configurations[] = {
+        {"全关", false, false, false},
+        {"外提", true, false, false},
+        {"强度削弱", false, true, false},
+        {"展开", false, false, true},
+        {"全开", true, true, true},
+    };
+    std::printf("%-16s %-10s %12s %10s %8s %12s %8s\n", "程序", "循环优化", "返回值", "指令", "比例", "周期", "比例");
+    bool consistent = true;
+    for (const Workload& workload : workloads) {
+        int32_t expected = 0;
+        try {
+            CompileOptions options;
+            options.optLevel = 0;
+            compileAndRun(workload, options, expected);
+        } catch (const std::exception& e) {
+            std::cerr << workload.name << " -O0: " << e.what() << std::endl;
+            consistent = false;
+            continue;
+        }
+        SimStats baseline;
+        for (const Configuration& configuration : configurations) {
+            CompileOptions options;
+            options.licm = configuration.licm;
+            options.strengthReduce = configuration.strengthReduce;
+            options.unrollLoops = configuration.unroll;
+            options.inlineCalls = workload.inlineCalls;
+            int32_t result = 0;
+            SimStats stats;
+            try {
+                stats = compileAndRun(workload, options, result);
+            } catch (const std::exception& e) {
+                std::cerr << workload.name << " " << configuration.name << ": " << e.what() << std::endl;
+                consistent = false;
+                break;
+            }
+            if (&configuration == &configurations[0]) baseline = stats;
+            bool same = result == expected;
+            if (!same) consistent = false;
+            std::printf("%-16s %-10s %12d %10llu %7.3f %12llu %7.3f%s\n", workload.name.c_str(), configuration.name,
+                        result, static_cast<unsigned long long>(stats.instructions),
+                        static_cast<double>(stats.instructions) / baseline.instructions,
+                        static_cast<unsigned long long>(stats.cycles),
+                        static_cast<double>(stats.cycles) / baseline.cycles, same ? "" : "  与-O0不一致");
+        }
+    }
+    removeTemporaries(workloads);
+    if (!consistent) {
+        std::cerr << "各种循环优化组合的执行结果不一致" << std::endl;
+        return 1;
+    }
+    std::printf("各种循环优化组合与-O0的执行结果一致\n");
+    return 0;
+}
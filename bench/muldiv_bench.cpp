@@ -0,0 +1,241 @@
+// 乘、除以常量的基准。先在模拟器上逐个核对muldiv.h的序列：对-1100~1100、2的幂及其前后、
+// INT_MIN/INT_MAX和随机常量，拿边界值和随机被除数与div/rem/mul的结果比较，dst与src相同和不同
+// 两种写法都要对，并且不同时不能改掉src。再把几个内核按-O0、-O1编译，比较打开和关闭
+// 常量乘除改写时的周期、指令数和除法条数。任何结果不一致都返回1
+#include "bench_util.h"
+#include "muldiv.h"
+#include <climits>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// print_if_even的x % 2，外加/2和*2
+const char* const ParityKernel = R"(
+int kernel(int n) {
+    int s = 0;
+    int i = 0 - n;
+    while (i < n) {
+        if ((i % 2) == 0) {
+            s = s + i / 2;
+        } else {
+            s = s - i * 2;
+        }
+        i = i + 1;
+    }
+    return s;
+}
+int main() { return kernel(3000); }
+)";
+
+// 十进制数位：被除数有正有负，/10和%10每位各一次
+const char* const DigitsKernel = R"(
+int kernel(int n) {
+    int s = 0;
+    int i = 0 - n;
+    while (i < n) {
+        int x = i * 7919;
+        while (x != 0) {
+            s = s + x % 10;
+            x = x / 10;
+        }
+        i = i + 1;
+    }
+    return s;
+}
+int main() { return kernel(1000); }
+)";
+
+// 各种常量混在一起：能拆成移位的乘法、魔数除法和大除数取余
+const char* const MixedKernel = R"(
+int kernel(int n) {
+    int s = 0;
+    int i = 0 - n;
+    while (i < n) {
+        int x = i * 40503;
+        s = s + x * 10 - x / 7 + x % 12 + (x * 3) / 5 - x % 1000003 + x / 641 + 9 * x;
+        i = i + 1;
+    }
+    return s;
+}
+int main() { return kernel(3000); }
+)";
+
+// 按RV32IM的约定算参考结果，divisor不为0
+int32_t reference(AsmOp op, int32_t x, int32_t c) {
+    if (op == AsmOp::Mul) return static_cast<int32_t>(static_cast<uint32_t>(x) * static_cast<uint32_t>(c));
+    if (x == INT_MIN && c == -1) return op == AsmOp::Div ? INT_MIN : 0;
+    return op == AsmOp::Div ? x / c : x % c;
+}
+
+std::vector<int32_t> testConstants(std::mt19937& random) {
+    std::vector<int32_t> constants;
+    for (int32_t c = -1100; c <= 1100; ++c) constants.push_back(c);
+    for (int k = 11; k < 31; ++k) {
+        int32_t p = 1 << k;
+        for (int32_t c : {p - 1, p, p + 1, p + p / 2, p - p / 4}) {
+            constants.push_back(c);
+            constants.push_back(-c);
+        }
+    }
+    for (int32_t c : {INT_MIN, INT_MIN + 1, INT_MAX, INT_MAX - 1, 1000003, 641, 6700417, -715827883}) {
+        constants.push_back(c);
+    }
+    for (int i = 0; i < 200; ++i) constants.push_back(static_cast<int32_t>(random()));
+    return constants;
+}
+
+std::vector<int32_t> testDividends(std::mt19937& random) {
+    std::vector<int32_t> values = {0, 1, -1, 2, -2, 3, -3, 7, -7, 9, -9, 10, -10, 100, -100, 1000, -1000,
+                                   INT_MIN, INT_MIN + 1, INT_MIN + 2, INT_MAX, INT_MAX - 1, INT_MAX - 2,
+                                   1 << 30, -(1 << 30), (1 << 30) - 1, 1 - (1 << 30), 65535, -65536};
+    for (int i = 0; i < 32; ++i) values.push_back(static_cast<int32_t>(random()));
+    for (int i = 0; i < 8; ++i) values.push_back(static_cast<int32_t>(random() % 20001) - 10000);
+    return values;
+}
+
+// 与常量有关的被除数：它的倍数附近正好落在取整的边界上
+void addMultiples(std::vector<int32_t>& values, int32_t c) {
+    if (c == 0 || c == INT_MIN) return;
+    int64_t magnitude = c < 0 ? -static_cast<int64_t>(c) : c;
+    for (int64_t k : {int64_t(1), int64_t(2), INT_MAX / magnitude, INT_MAX / magnitude - 1}) {
+        int64_t m = k * magnitude;
+        for (int64_t v : {m - 1, m, m + 1, -m - 1, -m, -m + 1}) {
+            if (v >= INT_MIN && v <= INT_MAX) values.push_back(static_cast<int32_t>(v));
+        }
+    }
+}
+
+// 每个常量、每种运算两个函数：*_same在a0上原地算；*_diff把a1的结果写进a0，
+// 再加上a1 - a2（两个实参相同），a1被改掉时结果就不对
+struct Case {
+    AsmOp op;
+    int32_t constant;
+    bool same;
+    std::string name;
+};
+
+std::string buildFunctions(const std::vector<int32_t>& constants, std::vector<Case>& cases) {
+    std::string text;
+    std::vector<AsmInst> code;
+    for (size_t i = 0; i < constants.size(); ++i) {
+        int32_t c = constants[i];
+        for (AsmOp op : {AsmOp::Mul, AsmOp::Div, AsmOp::Rem}) {
+            for (bool same : {true, false}) {
+                code.clear();
+                Register src = same ? Register::A0 : Register::A1;
+                bool lowered = op == AsmOp::Mul ? lowerMultiply(code, Register::A0, src, c, Register::T6)
+                                                : lowerDivide(code, op, Register::A0, src, c, Register::T6,
+                                                              Register::T5);
+                if (!lowered) continue;
+                std::string name = std::string(asmOpName(op)) + (same ? "_same_" : "_diff_") + std::to_string(i);
+                if (!same) {
+                    code.push_back(AsmInst::binary(AsmOp::Sub, Register::A1, Register::A1, Register::A2));
+                    code.push_back(AsmInst::binary(AsmOp::Add, Register::A0, Register::A0, Register::A1));
+                }
+                code.push_back(AsmInst::ret());
+                text += name + ":\n";
+                for (const AsmInst& inst : code) appendAsm(text, inst);
+                cases.push_back({op, c, same, name});
+            }
+        }
+    }
+    return text;
+}
+
+// 返回不一致的个数，比较的次数累加到checks
+int checkSequences(uint64_t& checks, size_t& functionCount) {
+    std::mt19937 random(20240611);
+    std::vector<int32_t> constants = testConstants(random);
+    std::vector<int32_t> dividends = testDividends(random);
+    std::vector<Case> cases;
+    CodeImage image = assembleImage(buildFunctions(constants, cases));
+    functionCount = cases.size();
+    Simulator simulator(image);
+    int mismatches = 0;
+    for (const Case& test : cases) {
+        std::vector<int32_t> values = dividends;
+        addMultiples(values, test.constant);
+        for (int32_t x : values) {
+            int32_t expected = reference(test.op, x, test.constant);
+            int32_t actual = test.same ? simulator.call(test.name, {x}) : simulator.call(test.name, {0, x, x});
+            ++checks;
+            if (actual == expected) continue;
+            if (++mismatches <= 10) {
+                std::fprintf(stderr, "%s %d %s %d: 期望%d, 得到%d\n", asmOpName(test.op), x,
+                             test.same ? "(原地)" : "", test.constant, expected, actual);
+            }
+        }
+    }
+    return mismatches;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    bool consistent = true;
+    uint64_t checks = 0;
+    size_t functionCount = 0;
+    int mismatches = checkSequences(checks, functionCount);
+    std::printf("序列核对: %zu个函数, %llu次比较, %d处不一致\n\n", functionCount,
+                static_cast<unsigned long long>(checks), mismatches);
+    if (mismatches) consistent = false;
+
+    std::vector<Workload> workloads;
+    for (int i = 1; i < argc; ++i) workloads.push_back({argv[i], argv[i], false});
+    if (workloads.empty()) {
+        const std::pair<const char*, const char*> kernels[] = {
+            {"parity", ParityKernel}, {"digits", DigitsKernel}, {"mixed", MixedKernel}};
+        for (const auto& [name, source] : kernels) workloads.push_back(kernelWorkload(name, source));
+        workloads.push_back({"example", "test/example.toyc", false});
+    }
+
+    std::printf("%-10s %-4s %12s %10s %10s %7s %10s %10s %12s %12s\n", "程序", "优化", "返回值", "周期(原)",
+                "周期(改)", "比例", "指令(原)", "指令(改)", "mul(原->改)", "div(原->改)");
+    for (const Workload& workload : workloads) {
+        bool first = true;
+        int32_t expected = 0;
+        for (int optLevel = 0; optLevel <= 1; ++optLevel) {
+            CompileOptions options;
+            options.optLevel = optLevel;
+            options.inlineCalls = workload.inlineCalls;
+            SimStats stats[2];
+            int32_t results[2] = {};
+            try {
+                for (int lowered = 0; lowered < 2; ++lowered) {
+                    options.constantMulDiv = lowered != 0;
+                    stats[lowered] = compileAndRun(workload, options, results[lowered]);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << workload.name << " -O" << optLevel << ": " << e.what() << std::endl;
+                consistent = false;
+                continue;
+            }
+            if (first) expected = results[0];
+            first = false;
+            bool same = results[0] == expected && results[1] == expected;
+            if (!same) consistent = false;
+            std::printf("%-10s -O%-2d %12d %10llu %10llu %6.3f %10llu %10llu %5llu->%-6llu %5llu->%-6llu%s\n",
+                        workload.name.c_str(), optLevel, results[1],
+                        static_cast<unsigned long long>(stats[0].cycles),
+                        static_cast<unsigned long long>(stats[1].cycles),
+                        static_cast<double>(stats[1].cycles) / stats[0].cycles,
+                        static_cast<unsigned long long>(stats[0].instructions),
+                        static_cast<unsigned long long>(stats[1].instructions),
+                        static_cast<unsigned long long>(stats[0].muls),
+                        static_cast<unsigned long long>(stats[1].muls),
+                        static_cast<unsigned long long>(stats[0].divs),
+                        static_cast<unsigned long long>(stats[1].divs), same ? "" : "  结果不一致");
+        }
+    }
+    removeTemporaries(workloads);
+    if (!consistent) {
+        std::cerr << "常量乘除序列与mul/div/rem的结果不一致" << std::endl;
+        return 1;
+    }
+    std::printf("常量乘除序列与mul/div/rem的结果一致，改写前后以及-O0与-O1的执行结果一致\n");
+    return 0;
+}
@@ -0,0 +1,171 @@
+// 各阶段吞吐量与扩展性基准：用合成程序生成器按四种形状（大量函数、深层表达式、长函数体、
+// 深层循环嵌套）各生成一组规模翻倍的程序，分别测词法分析、语法分析、语义分析和-O0代码生成
+// 每个词法单元的耗时，再按最小和最大规模算出各阶段耗时随输入增长的指数。
+// 指数超过上限（默认1.5）说明该阶段出现了超线性的退化，返回1
+#include "codegen.h"
+#include "emitter.h"
+#include "lexer.h"
+#include "parser.h"
+#include "peephole.h"
+#include "progen.h"
+#include "semantic.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+template <typename F>
+double bestOf(int runs, F&& body) {
+    double best = 1e30;
+    for (int r = 0; r < runs; ++r) {
+        auto start = Clock::now();
+        body();
+        double secs = std::chrono::duration<double>(Clock::now() - start).count();
+        if (secs < best) best = secs;
+    }
+    return best;
+}
+
+const char* const PhaseNames[] = {"lex", "parse", "semantic", "codegen"};
+constexpr int PhaseCount = 4;
+
+struct Sample {
+    size_t bytes = 0;
+    size_t tokens = 0;
+    double secs[PhaseCount] = {};
+};
+
+// 各形状的起始规模，之后每次翻倍
+int baseSize(const std::string& shape) {
+    if (shape == "functions") return 250;
+    if (shape == "expr") return 32;
+    if (shape == "block") return 250;
+    return 16;
+}
+
+Sample measure(const GeneratorOptions& options, int runs, const std::string& path) {
+    Sample sample;
+    std::string source = generateProgram(options);
+    sample.bytes = source.size();
+
+    sample.secs[0] = bestOf(runs, [&] {
+        StringInterner interner;
+        ViewLexer lexer(source, &interner);
+        sample.tokens = 0;
+        while (lexer.nextToken().type != TokenType::END_OF_FILE) ++sample.tokens;
+    });
+    // 语法分析边解析边做词法分析，这里的耗时包括词法分析
+    sample.secs[1] = bestOf(runs, [&] {
+        ASTContext context;
+        Parser parser(source, context);
+        parser.parse();
+    });
+
+    ASTContext context;
+    Parser parser(source, context);
+    ASTNodePtr ast = parser.parse();
+    sample.secs[2] = bestOf(runs, [&] {
+        SemanticAnalyzer semantic(context.names);
+        semantic.analyze(ast);
+    });
+    sample.secs[3] = bestOf(runs, [&] {
+        PeepholeOptimizer peephole;
+        TextEmitter emitter(path);
+        CodeGenerator codegen(emitter, context.names, &peephole);
+        codegen.generate(ast);
+        emitter.finish();
+    });
+    return sample;
+}
+
+void printUsage(const char* programName) {
+    std::cerr << "用法: " << programName << " [形状...] [--steps N] [--runs N] [--max-exponent X]" << std::endl;
+    std::cerr << "形状:";
+    for (const std::string& shape : shapeNames()) std::cerr << " " << shape;
+    std::cerr << "（默认全部）" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> shapes;
+    int steps = 4, runs = 3;
+    double maxExponent = 1.5;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        GeneratorOptions unused;
+        if (arg == "--steps" && i + 1 < argc) {
+            steps = std::max(2, std::atoi(argv[++i]));
+        } else if (arg == "--runs" && i + 1 < argc) {
+            runs = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--max-exponent" && i + 1 < argc) {
+            maxExponent = std::atof(argv[++i]);
+        } else if (shapeOptions(arg, 1, unused)) {
+            shapes.push_back(arg);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (shapes.empty()) shapes = shapeNames();
+
+    char tmpl[] = "/tmp/toyc_phase_bench_XXXXXX";
+    int fd = mkstemp(tmpl);
+    if (fd < 0) {
+        std::cerr << "无法创建临时文件" << std::endl;
+        return 1;
+    }
+    close(fd);
+    std::string path = tmpl;
+
+    std::printf("每个规模取%d次中的最好成绩，单位为ns/词法单元；parse包括词法分析，codegen为-O0并做窥孔优化\n", runs);
+    bool regressed = false;
+    for (const std::string& shape : shapes) {
+        std::printf("\n形状 %s\n%8s %10s %10s", shape.c_str(), "规模", "字节", "词法单元");
+        for (const char* name : PhaseNames) std::printf(" %10s", name);
+        std::printf("\n");
+
+        std::vector<Sample> samples;
+        for (int step = 0, size = baseSize(shape); step < steps; ++step, size *= 2) {
+            GeneratorOptions options;
+            shapeOptions(shape, size, options);
+            try {
+                samples.push_back(measure(options, runs, path));
+            } catch (const std::exception& e) {
+                std::remove(path.c_str());
+                std::cerr << "生成的程序(" << shape << ", " << size << ")编译失败: " << e.what() << std::endl;
+                return 1;
+            }
+            const Sample& sample = samples.back();
+            std::printf("%8d %10zu %10zu", size, sample.bytes, sample.tokens);
+            for (double secs : sample.secs) std::printf(" %10.1f", secs * 1e9 / sample.tokens);
+            std::printf("\n");
+        }
+
+        // 耗时 ∝ 词法单元数^指数：线性为1，接近2说明是平方级
+        const Sample& first = samples.front();
+        const Sample& last = samples.back();
+        double growth = std::log(static_cast<double>(last.tokens) / first.tokens);
+        std::printf("%8s %10s %10s", "", "", "增长指数");
+        std::vector<const char*> superlinear;
+        for (int p = 0; p < PhaseCount; ++p) {
+            double exponent = std::log(last.secs[p] / first.secs[p]) / growth;
+            std::printf(" %10.2f", exponent);
+            if (exponent > maxExponent) superlinear.push_back(PhaseNames[p]);
+        }
+        std::printf("\n");
+        for (const char* name : superlinear) {
+            std::printf("警告: %s在形状%s下超线性增长（指数上限%.2f）\n", name, shape.c_str(), maxExponent);
+            regressed = true;
+        }
+    }
+    std::remove(path.c_str());
+    return regressed ? 1 : 0;
+}
@@ -0,0 +1,107 @@
+// 指令调度基准：把几个内核、test/example.toyc和合成程序分别按-O0、-O1编译，对每种核的延迟表
+// 比较不调度和按该核调度时模拟器上的周期数和停顿。调度与否、各种核以及各优化级别的执行结果
+// 必须相同，否则返回1
+#include "bench_util.h"
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 互不相关的乘法：每个乘积都紧接着被累加
+const char* const MultiplyKernel = R"(
+int kernel(int a, int b, int c, int n) {
+    int s = 0;
+    int i = 0;
+    while (i < n) {
+        int x = a * i + b;
+        int y = b * i + c;
+        int z = c * i + a;
+        s = s + x * y + y * z + z * x;
+        i = i + 1;
+    }
+    return s;
+}
+int main() { return kernel(3, 5, 7, 3000); }
+)";
+
+// 变量多于寄存器：溢出到栈上的值读出来马上就用
+const char* const SpillKernel = R"(
+int kernel(int n) {
+    int a = 1; int b = 2; int c = 3; int d = 4; int e = 5; int f = 6; int g = 7; int h = 8;
+    int p = 9; int q = 10; int r = 11; int s = 12; int t = 13; int u = 14; int v = 15; int w = 16;
+    int i = 0;
+    while (i < n) {
+        a = a + b * 3; b = b + c; c = c + d * 5; d = d + e; e = e + f * 7; f = f + g; g = g + h * 9;
+        h = h + p; p = p + q * 3; q = q + r; r = r + s * 5; s = s + t; t = t + u * 7; u = u + v;
+        v = v + w * 9; w = w + a;
+        i = i + 1;
+    }
+    return a + b + c + d + e + f + g + h + p + q + r + s + t + u + v + w;
+}
+int main() { return kernel(2000); }
+)";
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<Workload> workloads;
+    for (int i = 1; i < argc; ++i) workloads.push_back({argv[i], argv[i], false});
+    if (workloads.empty()) {
+        const std::pair<const char*, const char*> kernels[] = {{"multiply", MultiplyKernel}, {"spill", SpillKernel}};
+        for (const auto& [name, source] : kernels) workloads.push_back(kernelWorkload(name, source));
+        workloads.push_back({"example", "test/example.toyc", false});
+        const std::pair<const char*, int> shapes[] = {{"functions", 200}, {"block", 200}, {"loops", 6}};
+        for (const auto& [shape, size] : shapes) workloads.push_back(generatedWorkload(shape, size));
+    }
+
+    std::printf("%-16s %-4s %-9s %12s %10s %10s %7s %10s %10s\n", "程序", "优化", "核", "返回值", "不调度", "调度",
+                "比例", "load停顿", "乘除停顿");
+    bool consistent = true;
+    for (const Workload& workload : workloads) {
+        bool first = true;
+        int32_t expected = 0;
+        for (int optLevel = 0; optLevel <= 1; ++optLevel) {
+            for (const CoreModel& core : coreModels()) {
+                CompileOptions options;
+                options.optLevel = optLevel;
+                options.inlineCalls = workload.inlineCalls;
+                options.core = core.name;
+                SimStats stats[2];
+                int32_t results[2] = {};
+                try {
+                    for (int schedule = 0; schedule < 2; ++schedule) {
+                        options.schedule = schedule != 0;
+                        stats[schedule] = compileAndRun(workload, options, results[schedule], core.model);
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << workload.name << " -O" << optLevel << " " << core.name << ": " << e.what()
+                              << std::endl;
+                    consistent = false;
+                    continue;
+                }
+                if (first) expected = results[0];
+                first = false;
+                bool same = results[0] == expected && results[1] == expected;
+                if (!same) consistent = false;
+                std::printf("%-16s -O%-2d %-9s %12d %10llu %10llu %6.3f %4llu->%-5llu %4llu->%-5llu%s\n",
+                            workload.name.c_str(), optLevel, core.name, results[1],
+                            static_cast<unsigned long long>(stats[0].cycles),
+                            static_cast<unsigned long long>(stats[1].cycles),
+                            static_cast<double>(stats[1].cycles) / stats[0].cycles,
+                            static_cast<unsigned long long>(stats[0].loadUseStalls),
+                            static_cast<unsigned long long>(stats[1].loadUseStalls),
+                            static_cast<unsigned long long>(stats[0].mulDivStalls),
+                            static_cast<unsigned long long>(stats[1].mulDivStalls), same ? "" : "  结果不一致");
+            }
+        }
+    }
+    removeTemporaries(workloads);
+    if (!consistent) {
+        std::cerr << "调度前后或各种核之间的执行结果不一致" << std::endl;
+        return 1;
+    }
+    std::printf("调度前后、各种核以及-O0与-O1的执行结果一致\n");
+    return 0;
+}
@@ -0,0 +1,72 @@
+// 生成代码质量基准：把test/example.toyc和各种形状的合成程序分别按-O0和-O1编译成汇编文本和
+// 目标文件，在RV32IM模拟器上执行main，比较动态指令数、访存次数、跳转成功的分支和周期估计。
+// 同一程序各种编译方式的返回值必须相同，同一优化级别的文本和目标文件统计必须相同，否则返回1
+#include "bench_util.h"
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 编译后执行main；text为false时输出目标文件
+SimStats run(const Workload& workload, int optLevel, bool text, int32_t& result) {
+    CompileOptions options;
+    options.optLevel = optLevel;
+    options.emitObject = !text;
+    return compileAndRun(workload, options, result);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<Workload> workloads;
+    for (int i = 1; i < argc; ++i) workloads.push_back({argv[i], argv[i], false});
+    if (workloads.empty()) {
+        workloads.push_back({"example", "test/example.toyc", false});
+        const std::pair<const char*, int> shapes[] = {{"functions", 200}, {"expr", 24}, {"block", 200}, {"loops", 16}};
+        for (const auto& [shape, size] : shapes) workloads.push_back(generatedWorkload(shape, size));
+    }
+
+    std::printf("%-16s %4s %12s %10s %10s %10s %12s %6s %12s\n", "程序", "优化", "返回值", "指令", "访存",
+                "跳转分支", "周期", "CPI", "指令/周期比");
+    bool consistent = true;
+    for (const Workload& workload : workloads) {
+        SimStats baseline;
+        int32_t expected = 0;
+        for (int optLevel = 0; optLevel <= 1; ++optLevel) {
+            int32_t result = 0, objectResult = 0;
+            SimStats stats, objectStats;
+            try {
+                stats = run(workload, optLevel, true, result);
+                objectStats = run(workload, optLevel, false, objectResult);
+            } catch (const std::exception& e) {
+                std::cerr << workload.name << " -O" << optLevel << ": " << e.what() << std::endl;
+                consistent = false;
+                break;
+            }
+            if (optLevel == 0) {
+                baseline = stats;
+                expected = result;
+            }
+            bool same = result == expected && objectResult == result &&
+                        objectStats.instructions == stats.instructions && objectStats.cycles == stats.cycles;
+            if (!same) consistent = false;
+            std::printf("%-16s  -O%d %12d %10llu %10llu %10llu %12llu %6.2f %5.2f/%5.2f%s\n", workload.name.c_str(),
+                        optLevel, result, static_cast<unsigned long long>(stats.instructions),
+                        static_cast<unsigned long long>(stats.loads + stats.stores),
+                        static_cast<unsigned long long>(stats.takenBranches),
+                        static_cast<unsigned long long>(stats.cycles),
+                        static_cast<double>(stats.cycles) / stats.instructions,
+                        static_cast<double>(stats.instructions) / baseline.instructions,
+                        static_cast<double>(stats.cycles) / baseline.cycles, same ? "" : "  不一致");
+        }
+    }
+    removeTemporaries(workloads);
+    if (!consistent) {
+        std::cerr << "各编译方式的执行结果不一致" << std::endl;
+        return 1;
+    }
+    std::printf("各程序-O0、-O1以及汇编文本、目标文件的执行结果一致\n");
+    return 0;
+}
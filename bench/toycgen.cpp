@@ -0,0 +1,65 @@
+// 合成ToyC程序生成器：按预设形状或各项参数生成合法、一定会结束的程序，输出到标准输出
+#include "progen.h"
+#include <iostream>
+#include <string>
+
+namespace {
+
+void printUsage(const char* programName) {
+    std::cerr << "用法: " << programName << " <形状> <规模> [seed]" << std::endl;
+    std::cerr << "      " << programName
+              << " [--functions N] [--statements N] [--expr-depth N] [--loop-depth N]\n"
+              << "        [--loop-nests N] [--seed N]" << std::endl;
+    std::cerr << "形状:";
+    for (const std::string& shape : shapeNames()) std::cerr << " " << shape;
+    std::cerr << std::endl;
+}
+
+bool parseNumber(const std::string& text, int& value) {
+    if (text.empty() || text.size() > 9 || text.find_first_not_of("0123456789") != std::string::npos) return false;
+    value = std::stoi(text);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    GeneratorOptions options;
+    int size = 0, seed = 1;
+    if (argc >= 3 && argv[1][0] != '-') {
+        if (!parseNumber(argv[2], size) || (argc > 3 && !parseNumber(argv[3], seed)) || argc > 4 ||
+            !shapeOptions(argv[1], size, options)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        options.seed = static_cast<uint32_t>(seed);
+        std::cout << generateProgram(options);
+        return 0;
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        int value = 0;
+        if (i + 1 >= argc || !parseNumber(argv[++i], value)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (arg == "--functions") {
+            options.functions = value;
+        } else if (arg == "--statements") {
+            options.statements = value;
+        } else if (arg == "--expr-depth") {
+            options.exprDepth = value;
+        } else if (arg == "--loop-depth") {
+            options.loopDepth = value;
+        } else if (arg == "--loop-nests") {
+            options.loopNests = value;
+        } else if (arg == "--seed") {
+            options.seed = static_cast<uint32_t>(value);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    std::cout << generateProgram(options);
+    return 0;
+}
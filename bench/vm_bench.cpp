@@ -0,0 +1,188 @@
+// 字节码虚拟机与JIT基准：对递归调用为主（fib）、循环和取余为主（gcd）、算术和短路条件为主的程序
+// 以及合成程序，分别用直接遍历AST的解释器、字节码虚拟机和x86-64 JIT执行，比较用时和每条字节码
+// 指令的耗时；再对一个大的合成程序比较惰性编译和全部预先编译的启动时间。
+// 各种执行方式的返回值必须相同，否则返回1
+#include "bytecode.h"
+#include "constfold.h"
+#include "interp.h"
+#include "jit.h"
+#include "parser.h"
+#include "progen.h"
+#include "semantic.h"
+#include "vm.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+template <typename F>
+double bestOf(int runs, F&& body) {
+    double best = 1e30;
+    for (int r = 0; r < runs; ++r) {
+        auto start = Clock::now();
+        body();
+        double secs = std::chrono::duration<double>(Clock::now() - start).count();
+        if (secs < best) best = secs;
+    }
+    return best;
+}
+
+struct Workload {
+    std::string name;
+    std::string source;
+};
+
+const char* const FibSource = R"(
+int fib(int n) {
+    if (n < 2) return n;
+    return fib(n - 1) + fib(n - 2);
+}
+int main() { return fib(27); }
+)";
+
+const char* const GcdSource = R"(
+int gcd(int a, int b) {
+    while (b != 0) {
+        int t = b;
+        b = a % b;
+        a = t;
+    }
+    return a;
+}
+int main() {
+    int sum = 0;
+    int i = 1;
+    while (i <= 300) {
+        int j = 1;
+        while (j <= 300) {
+            sum = sum + gcd(i, j);
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+    return sum;
+}
+)";
+
+const char* const LoopSource = R"(
+int collatz(int n) {
+    int steps = 0;
+    while (n != 1) {
+        if (n % 2 == 0) n = n / 2;
+        else n = 3 * n + 1;
+        steps = steps + 1;
+    }
+    return steps;
+}
+int main() {
+    int best = 0;
+    int i = 1;
+    while (i < 30000) {
+        int s = collatz(i);
+        if (s > best && (i % 3 != 0 || s > 100)) best = s;
+        i = i + 1;
+    }
+    return best;
+}
+)";
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int runs = 3;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--runs" && i + 1 < argc) {
+            runs = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "用法: " << argv[0] << " [--runs N]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Workload> workloads = {{"fib(27)", FibSource}, {"gcd 300x300", GcdSource}, {"collatz", LoopSource}};
+    GeneratorOptions generated;
+    shapeOptions("functions", 200, generated);
+    workloads.push_back({"functions 200", generateProgram(generated)});
+
+    std::printf("%-16s %12s %12s %12s %12s %8s %10s %10s %8s\n", "程序", "返回值", "字节码指令", "AST解释(ms)",
+                "虚拟机(ms)", "加速比", "ns/指令", "JIT(ms)", "加速比");
+    bool consistent = true;
+    for (const Workload& workload : workloads) {
+        ASTContext context;
+        Parser parser(workload.source, context);
+        auto ast = parser.parse();
+        if (!ast) {
+            std::cerr << workload.name << ": 语法分析失败" << std::endl;
+            return 1;
+        }
+        SemanticAnalyzer semantic(context.names);
+        semantic.analyze(ast);
+        ConstantFolder folder(context);
+        folder.optimize(ast);
+
+        BcModule module = compileBytecode(ast, context.names);
+        VM vm(module);
+        JIT jit(module);
+        ASTInterpreter interpreter(ast, context.names);
+        int32_t vmResult = 0, astResult = 0, jitResult = 0;
+        double astSecs = bestOf(runs, [&] { astResult = interpreter.call("main"); });
+        uint64_t before = vm.instructions();
+        double vmSecs = bestOf(runs, [&] { vmResult = vm.call("main"); });
+        uint64_t executed = (vm.instructions() - before) / runs;
+        double jitSecs = bestOf(runs, [&] { jitResult = jit.call("main"); });
+
+        bool same = vmResult == astResult && jitResult == astResult;
+        if (!same) consistent = false;
+        // 函数都编译过以后，包括递归调用在内的所有调用点都应该直接调用机器码
+        if (jit.compiledFunctions() == module.functions.size() && jit.stubCallSites() != 0) {
+            std::cerr << workload.name << ": " << jit.stubCallSites() << "个调用点仍然经过桩" << std::endl;
+            consistent = false;
+        }
+        std::printf("%-16s %12d %12llu %12.2f %12.2f %7.1fx %10.2f %10.2f %7.1fx%s\n", workload.name.c_str(),
+                    vmResult, static_cast<unsigned long long>(executed), astSecs * 1000, vmSecs * 1000,
+                    astSecs / vmSecs, vmSecs * 1e9 / executed, jitSecs * 1000, vmSecs / jitSecs,
+                    same ? "" : "  不一致");
+    }
+
+    // 启动时间：从字节码构造JIT到main返回
+    GeneratorOptions large;
+    shapeOptions("functions", 5000, large);
+    ASTContext context;
+    std::string largeSource = generateProgram(large);
+    Parser parser(largeSource, context);
+    auto ast = parser.parse();
+    SemanticAnalyzer semantic(context.names);
+    semantic.analyze(ast);
+    BcModule module = compileBytecode(ast, context.names);
+    std::printf("\n%-16s %12s %12s %12s\n", "functions 5000", "编译函数", "代码(字节)", "启动(ms)");
+    int32_t startupResults[2] = {};
+    for (int eager = 0; eager <= 1; ++eager) {
+        size_t functions = 0, bytes = 0, stubSites = 0;
+        double secs = bestOf(runs, [&] {
+            JIT jit(module, !eager);
+            startupResults[eager] = jit.call("main");
+            functions = jit.compiledFunctions();
+            bytes = jit.codeSize();
+            stubSites = jit.stubCallSites();
+        });
+        if (eager && stubSites != 0) {
+            std::cerr << "预先编译后仍有" << stubSites << "个调用点经过桩" << std::endl;
+            consistent = false;
+        }
+        std::printf("%-16s %12zu %12zu %12.2f\n", eager ? "全部预先编译" : "惰性编译", functions, bytes, secs * 1000);
+    }
+    if (startupResults[0] != startupResults[1]) consistent = false;
+
+    if (!consistent) {
+        std::cerr << "各种执行方式的结果不一致" << std::endl;
+        return 1;
+    }
+    std::printf("AST解释器、虚拟机与JIT的结果一致\n");
+    return 0;
+}
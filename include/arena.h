@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// 简单的bump分配器：节点只追加分配，编译结束时整体释放
+class Arena {
+public:
+    explicit Arena(size_t chunkSize = 64 * 1024) : chunkSize(chunkSize) {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t align) {
+        size_t aligned = (used + align - 1) & ~(align - 1);
+        if (chunks.empty() || aligned + size > capacity) {
+            newChunk(size + align);
+            aligned = 0;
+        }
+        used = aligned + size;
+        bytes += size;
+        return chunks.back().get() + aligned;
+    }
+
+    void release() {
+        chunks.clear();
+        used = capacity = bytes = 0;
+    }
+
+    size_t bytesAllocated() const { return bytes; }
+
+private:
+    std::vector<std::unique_ptr<char[]>> chunks;
+    size_t chunkSize;
+    size_t used = 0;
+    size_t capacity = 0;
+    size_t bytes = 0;
+
+    void newChunk(size_t minSize) {
+        capacity = minSize > chunkSize ? minSize : chunkSize;
+        chunks.emplace_back(new char[capacity]);
+        used = 0;
+    }
+};
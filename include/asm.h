@@ -0,0 +1,93 @@
+#pragma once
+#include "riscv.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 汇编行的操作码：RV32IM指令、生成器用到的伪指令（li、mv、neg、seqz、snez、beqz、bnez、
+// j、call、tail、ret），以及标签、注释、伪操作这些非指令行
+enum class AsmOp : uint8_t {
+    Add, Sub, Mul, Mulh, Div, Rem, Xor, Slt,
+    Addi, Andi, Xori, Slti, Slli, Srli, Srai,
+    Lw, Sw,
+    Li, Mv, Neg, Seqz, Snez,
+    Beq, Bne, Blt, Bge, Beqz, Bnez,
+    J, Call, Tail, Ret,
+    Label, Comment, Directive,
+    Nop, // 已被删除的行，输出时跳过
+};
+
+// 操作数的书写格式
+enum class AsmFormat : uint8_t {
+    R,          // op rd, rs1, rs2
+    I,          // op rd, rs1, imm
+    Load,       // op rd, imm(rs1)
+    Store,      // op rs2, imm(rs1)
+    LoadImm,    // li rd, imm
+    Unary,      // op rd, rs1
+    Branch,     // op rs1, rs2, 标签
+    BranchZero, // op rs1, 标签
+    Jump,       // op 标签或函数名（j、call、tail）
+    None,       // ret
+    Label,
+    Comment,
+    Directive,
+    Nop,
+};
+
+// 一行汇编。寄存器和立即数按RISC-V的字段命名，store的数据寄存器在rs2、基址在rs1
+struct AsmInst {
+    AsmOp op = AsmOp::Nop;
+    Register rd = Register::ZERO;
+    Register rs1 = Register::ZERO;
+    Register rs2 = Register::ZERO;
+    int32_t imm = 0;
+    std::string text; // 跳转目标、被调函数、标签名、注释或伪操作
+
+    static AsmInst binary(AsmOp op, Register rd, Register rs1, Register rs2);
+    static AsmInst immediate(AsmOp op, Register rd, Register rs1, int32_t imm);
+    // lw reg, offset(base) / sw reg, offset(base)
+    static AsmInst memory(AsmOp op, Register reg, int32_t offset, Register base);
+    static AsmInst loadImm(Register rd, int32_t imm);
+    static AsmInst unary(AsmOp op, Register rd, Register rs);
+    static AsmInst branch(AsmOp op, Register rs1, Register rs2, std::string target);
+    static AsmInst branchZero(AsmOp op, Register rs, std::string target);
+    static AsmInst jump(AsmOp op, std::string target);
+    static AsmInst ret();
+    static AsmInst label(std::string name);
+    static AsmInst comment(std::string text);
+    static AsmInst directive(std::string text);
+};
+
+const char* asmOpName(AsmOp op);
+AsmFormat asmFormat(AsmOp op);
+
+// 是不是真正的指令（标签、注释、伪操作和已删除的行都不算）
+inline bool isInstruction(const AsmInst& inst) {
+    return inst.op < AsmOp::Label;
+}
+
+inline bool isBranch(AsmOp op) {
+    return op >= AsmOp::Beq && op <= AsmOp::Bnez;
+}
+
+// 条件取反后的分支，如beq与bne、blt与bge
+AsmOp invertBranch(AsmOp op);
+
+// 寄存器集合，按硬件编号置位
+inline uint32_t regMask(Register reg) {
+    return reg == Register::ZERO ? 0 : 1u << static_cast<int>(reg);
+}
+
+// 指令读/写的寄存器。call/tail/ret按调用约定计：实参寄存器、sp、ra和被调用者保存寄存器
+// 都算读，call写所有调用者保存寄存器
+uint32_t regsRead(const AsmInst& inst);
+uint32_t regsWritten(const AsmInst& inst);
+
+// 把一行汇编的文本追加到out末尾
+void appendAsm(std::string& out, const AsmInst& inst);
+
+// appendAsm的逆过程：把汇编文本解析成指令表，另外接受xN寄存器名、fp和行尾的#注释。
+// 格式不对时抛出带行号的异常
+std::vector<AsmInst> parseAsm(std::string_view text);
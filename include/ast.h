@@ -1,103 +1,228 @@
 #pragma once
-#include <string>
+#include "arena.h"
+#include "interner.h"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include <vector>
-#include <memory>
+
+// 节点类型标签：访问者按kind做switch分发，不再依赖RTTI
+enum class NodeKind : uint8_t {
+    Program, FunctionDef, Block, VarDecl, Assign, IfStmt, WhileStmt,
+    BreakStmt, ContinueStmt, ReturnStmt, ExprStmt,
+    BinaryExpr, UnaryExpr, IntLiteral, VarRef, FuncCall
+};
+
+enum class TypeKind : uint8_t { Int, Void };
+
+enum class BinOp : uint8_t {
+    Add, Sub, Mul, Div, Mod,
+    Lt, Le, Gt, Ge, Eq, Ne,
+    And, Or
+};
+
+enum class UnOp : uint8_t { Plus, Neg, Not };
+
+const char* nodeKindName(NodeKind kind);
+const char* typeName(TypeKind type);
+const char* binOpSpelling(BinOp op);
+const char* unOpSpelling(UnOp op);
+
+// 存放在arena中的定长数组（子节点列表、形参列表）
+template <typename T>
+struct ArenaList {
+    T* data = nullptr;
+    uint32_t count = 0;
+
+    T* begin() const { return data; }
+    T* end() const { return data + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T& operator[](size_t i) const { return data[i]; }
+};
 
 struct ASTNode {
-    virtual ~ASTNode() = default;
+    const NodeKind kind;
+protected:
+    explicit ASTNode(NodeKind kind) : kind(kind) {}
 };
 
-using ASTNodePtr = std::shared_ptr<ASTNode>;
+using ASTNodePtr = ASTNode*;
+
+// 按标签安全下转型，类型不符时返回nullptr
+template <typename T>
+T* as(ASTNode* node) {
+    return node && node->kind == T::Kind ? static_cast<T*>(node) : nullptr;
+}
+
+template <typename T>
+const T* as(const ASTNode* node) {
+    return node && node->kind == T::Kind ? static_cast<const T*>(node) : nullptr;
+}
+
+// 变量编号：语义分析按函数给形参（按顺序从0开始）和局部变量（按源码顺序接在后面）编号，
+// 写进声明和引用它的节点，之后各阶段按编号索引，不再按名字查作用域。
+// 跳过检查的函数体（增量编译缓存命中）里保持NoVar
+constexpr uint32_t NoVar = ~0u;
+
+struct Param {
+    TypeKind type;
+    SymbolId name;
+};
 
 struct Program : ASTNode {
-    std::vector<ASTNodePtr> functions;
+    static constexpr NodeKind Kind = NodeKind::Program;
+    ArenaList<ASTNodePtr> functions;
+    explicit Program(ArenaList<ASTNodePtr> functions) : ASTNode(Kind), functions(functions) {}
 };
 
 struct FunctionDef : ASTNode {
-    std::string retType;
-    std::string name;
-    std::vector<std::pair<std::string, std::string>> params; // (type, name)
+    static constexpr NodeKind Kind = NodeKind::FunctionDef;
+    TypeKind retType;
+    SymbolId name;
+    ArenaList<Param> params;
     ASTNodePtr body;
-    FunctionDef() = default;
-    FunctionDef(const std::string& retType,
-                const std::string& name,
-                const std::vector<std::pair<std::string, std::string>>& params,
-                ASTNodePtr body)
-        : retType(retType), name(name), params(params), body(body) {}
+    uint32_t varCount = 0; // 形参和局部变量的总数
+    FunctionDef(TypeKind retType, SymbolId name, ArenaList<Param> params, ASTNodePtr body)
+        : ASTNode(Kind), retType(retType), name(name), params(params), body(body) {}
 };
 
 struct Block : ASTNode {
-    std::vector<ASTNodePtr> stmts;
-    Block(const std::vector<ASTNodePtr>& stmts) : stmts(stmts) {}
+    static constexpr NodeKind Kind = NodeKind::Block;
+    ArenaList<ASTNodePtr> stmts;
+    explicit Block(ArenaList<ASTNodePtr> stmts) : ASTNode(Kind), stmts(stmts) {}
 };
 
 struct VarDecl : ASTNode {
-    std::string type;
-    std::string name;
+    static constexpr NodeKind Kind = NodeKind::VarDecl;
+    TypeKind type;
+    SymbolId name;
     ASTNodePtr initExpr;
-    VarDecl(const std::string& type, const std::string& name, ASTNodePtr initExpr)
-        : type(type), name(name), initExpr(initExpr) {}
+    uint32_t var = NoVar;
+    VarDecl(TypeKind type, SymbolId name, ASTNodePtr initExpr)
+        : ASTNode(Kind), type(type), name(name), initExpr(initExpr) {}
 };
 
 struct Assign : ASTNode {
-    std::string name;
+    static constexpr NodeKind Kind = NodeKind::Assign;
+    SymbolId name;
     ASTNodePtr expr;
-    Assign(const std::string& name, ASTNodePtr expr) : name(name), expr(expr) {}
+    uint32_t var = NoVar;
+    Assign(SymbolId name, ASTNodePtr expr) : ASTNode(Kind), name(name), expr(expr) {}
 };
 
 struct IfStmt : ASTNode {
+    static constexpr NodeKind Kind = NodeKind::IfStmt;
     ASTNodePtr cond;
     ASTNodePtr thenStmt;
     ASTNodePtr elseStmt;
     IfStmt(ASTNodePtr cond, ASTNodePtr thenStmt, ASTNodePtr elseStmt)
-        : cond(cond), thenStmt(thenStmt), elseStmt(elseStmt) {}
+        : ASTNode(Kind), cond(cond), thenStmt(thenStmt), elseStmt(elseStmt) {}
 };
 
 struct WhileStmt : ASTNode {
+    static constexpr NodeKind Kind = NodeKind::WhileStmt;
     ASTNodePtr cond;
     ASTNodePtr body;
-    WhileStmt(ASTNodePtr cond, ASTNodePtr body) : cond(cond), body(body) {}
+    WhileStmt(ASTNodePtr cond, ASTNodePtr body) : ASTNode(Kind), cond(cond), body(body) {}
+};
+
+struct BreakStmt : ASTNode {
+    static constexpr NodeKind Kind = NodeKind::BreakStmt;
+    BreakStmt() : ASTNode(Kind) {}
 };
 
-struct BreakStmt : ASTNode {};
-struct ContinueStmt : ASTNode {};
+struct ContinueStmt : ASTNode {
+    static constexpr NodeKind Kind = NodeKind::ContinueStmt;
+    ContinueStmt() : ASTNode(Kind) {}
+};
 
 struct ReturnStmt : ASTNode {
+    static constexpr NodeKind Kind = NodeKind::ReturnStmt;
     ASTNodePtr expr; // 可为nullptr，表示return;
-    ReturnStmt(ASTNodePtr expr = nullptr) : expr(expr) {}
+    explicit ReturnStmt(ASTNodePtr expr = nullptr) : ASTNode(Kind), expr(expr) {}
 };
 
 struct ExprStmt : ASTNode {
-    ASTNodePtr expr;
-    ExprStmt(ASTNodePtr expr) : expr(expr) {}
+    static constexpr NodeKind Kind = NodeKind::ExprStmt;
+    ASTNodePtr expr; // 可为nullptr，表示空语句
+    explicit ExprStmt(ASTNodePtr expr) : ASTNode(Kind), expr(expr) {}
 };
 
 struct BinaryExpr : ASTNode {
-    std::string op;
+    static constexpr NodeKind Kind = NodeKind::BinaryExpr;
+    BinOp op;
     ASTNodePtr lhs, rhs;
-    BinaryExpr(const std::string& op, ASTNodePtr lhs, ASTNodePtr rhs)
-        : op(op), lhs(lhs), rhs(rhs) {}
+    BinaryExpr(BinOp op, ASTNodePtr lhs, ASTNodePtr rhs)
+        : ASTNode(Kind), op(op), lhs(lhs), rhs(rhs) {}
 };
 
 struct UnaryExpr : ASTNode {
-    std::string op;
+    static constexpr NodeKind Kind = NodeKind::UnaryExpr;
+    UnOp op;
     ASTNodePtr expr;
-    UnaryExpr(const std::string& op, ASTNodePtr expr) : op(op), expr(expr) {}
+    UnaryExpr(UnOp op, ASTNodePtr expr) : ASTNode(Kind), op(op), expr(expr) {}
 };
 
 struct IntLiteral : ASTNode {
+    static constexpr NodeKind Kind = NodeKind::IntLiteral;
     int value;
-    IntLiteral(int value) : value(value) {}
+    explicit IntLiteral(int value) : ASTNode(Kind), value(value) {}
 };
 
 struct VarRef : ASTNode {
-    std::string name;
-    VarRef(const std::string& name) : name(name) {}
+    static constexpr NodeKind Kind = NodeKind::VarRef;
+    SymbolId name;
+    uint32_t var = NoVar;
+    explicit VarRef(SymbolId name) : ASTNode(Kind), name(name) {}
 };
 
 struct FuncCall : ASTNode {
-    std::string name;
-    std::vector<ASTNodePtr> args;
-    FuncCall(const std::string& name, const std::vector<ASTNodePtr>& args)
-        : name(name), args(args) {}
+    static constexpr NodeKind Kind = NodeKind::FuncCall;
+    SymbolId name;
+    ArenaList<ASTNodePtr> args;
+    FuncCall(SymbolId name, ArenaList<ASTNodePtr> args)
+        : ASTNode(Kind), name(name), args(args) {}
+};
+
+// 表达式是否含有函数调用（ToyC没有全局变量，只有调用会产生副作用）
+bool hasCall(const ASTNode* node);
+
+// AST的所有者：节点和子节点列表都分配在同一个arena里，
+// 析构时一次性释放整棵树
+class ASTContext {
+public:
+    ASTContext() = default;
+    ASTContext(const ASTContext&) = delete;
+    ASTContext& operator=(const ASTContext&) = delete;
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        static_assert(std::is_trivially_destructible_v<T>, "AST节点必须可平凡析构");
+        void* mem = arena.allocate(sizeof(T), alignof(T));
+        ++nodeCount;
+        return new (mem) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    ArenaList<T> list(const std::vector<T>& items) {
+        ArenaList<T> result;
+        if (items.empty()) return result;
+        result.data = static_cast<T*>(arena.allocate(sizeof(T) * items.size(), alignof(T)));
+        result.count = static_cast<uint32_t>(items.size());
+        for (size_t i = 0; i < items.size(); ++i) new (&result.data[i]) T(items[i]);
+        return result;
+    }
+
+    // 标识符驻留表：AST中的名字都是它分配的稠密整数ID
+    StringInterner names;
+
+    size_t nodes() const { return nodeCount; }
+    size_t bytesAllocated() const { return arena.bytesAllocated(); }
+
+private:
+    Arena arena;
+    size_t nodeCount = 0;
 };
@@ -0,0 +1,68 @@
+#pragma once
+#include "ast.h"
+#include <climits>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 寄存器式字节码。每个函数的寄存器从0编号，形参在前（实参由调用者直接放进被调函数的寄存器窗口），
+// 之后是局部变量和临时值。跳转目标是函数内的指令下标，调用目标是函数下标，运行时不再按名字查找
+enum class BcOp : uint8_t {
+    LoadK,                        // a = k
+    Move,                         // a = b
+    Add, Sub, Mul, Div, Mod,      // a = b op c
+    Lt, Le, Eq, Ne,               // a = b op c，结果为0或1
+    AddK,                         // a = b + k
+    Neg, Not,                     // a = -b / !b
+    Jump,                         // 跳到k
+    JumpIfZero, JumpIfNonZero,    // a为0/非0时跳到k
+    JumpIfLt, JumpIfLe,           // a < b / a <= b时跳到k
+    JumpIfEq, JumpIfNe,           // a == b / a != b时跳到k
+    Call,                         // 调用函数k，实参在b起的c个寄存器，返回值放到a
+    Return,                       // 返回a
+    ReturnVoid,
+};
+
+struct BcInst {
+    BcOp op;
+    uint16_t a = 0;
+    uint16_t b = 0;
+    uint16_t c = 0;
+    int32_t k = 0;
+};
+
+struct BcFunction {
+    std::string name;
+    int params = 0;
+    int registers = 0; // 帧大小
+    bool returnsValue = true;
+    std::vector<BcInst> code;
+};
+
+// 一个程序的字节码，函数按源码顺序编号
+struct BcModule {
+    std::vector<BcFunction> functions;
+
+    // 找不到时返回-1
+    int find(const std::string& name) const;
+};
+
+// 把通过语义检查的AST编译成字节码。一个函数的寄存器超过65535个时抛出异常
+BcModule compileBytecode(const ASTNodePtr& root, const StringInterner& names);
+
+void printBytecode(std::ostream& out, const BcModule& module);
+
+// 运行时的除法和取余按RV32IM的语义，与生成的代码结果相同：
+// 除以0时商为-1、余数为被除数；INT_MIN/-1的商为INT_MIN、余数为0
+inline int32_t runtimeDiv(int32_t lhs, int32_t rhs) {
+    if (rhs == 0) return -1;
+    if (lhs == INT32_MIN && rhs == -1) return lhs;
+    return lhs / rhs;
+}
+
+inline int32_t runtimeRem(int32_t lhs, int32_t rhs) {
+    if (rhs == 0) return lhs;
+    if (lhs == INT32_MIN && rhs == -1) return 0;
+    return lhs % rhs;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "ast.h"
+#include <ostream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// 只由字面量组成的条件按运行时的语义求值（&&、||按短路规则）；含变量、调用或除以0时返回false
+bool constantCondition(const ASTNode* expr, int& value);
+
+// 函数的语句级控制流图：基本块里按执行顺序放简单语句（变量声明、赋值、表达式语句、return），
+// 以条件分支结尾的块记着条件。块Entry是函数体的开头，块Exit是虚拟出口，return和落出函数体末尾
+// 都连到Exit。条件为常量的分支只连会走的一边，因此可达性和“所有路径都return”是精确的。
+// 按变量编号做分析，需要在语义分析之后构造
+struct CFGBlock {
+    int id;
+    std::vector<const ASTNode*> stmts;
+    const ASTNode* cond = nullptr; // 块末尾求值的条件，常量条件不记
+    std::vector<int> succs;
+    std::vector<int> preds;
+};
+
+class ControlFlowGraph {
+public:
+    static constexpr int Entry = 0;
+    static constexpr int Exit = 1;
+
+    explicit ControlFlowGraph(const FunctionDef* func);
+
+    const FunctionDef* function() const { return func; }
+    const std::vector<CFGBlock>& blocks() const { return graph; }
+    bool reachable(int block) const { return live[block]; }
+
+    // 语句开始处是否可达；不是本函数语句的节点按可达处理
+    bool reachable(const ASTNode* stmt) const;
+    // 语句执行完能否顺序走到下一条语句（没有在所有路径上return、break或continue）
+    bool completes(const ASTNode* stmt) const;
+    // 执行能否落出函数体末尾：int函数这时没有返回值
+    bool fallsOffEnd() const { return live[fallthrough]; }
+
+    // 直接支配者，入口为自身，不可达块为-1
+    std::vector<int> dominators() const;
+    // 直接后支配者，出口为自身，走不到出口的块（只能在死循环里）为-1
+    std::vector<int> postDominators() const;
+
+    // 死存储：写入的值在任何路径上都不会被读到、右边没有调用的赋值和变量初值（变量声明本身保留）。
+    // 删掉一个死存储后它用到的变量可能也变成死的，迭代到不动点
+    std::unordered_set<const ASTNode*> deadStores() const;
+
+    // Graphviz格式：每个块一个节点，标出语句、条件和支配者，不可达块用虚线
+    void printDot(std::ostream& out, const StringInterner& names) const;
+
+private:
+    struct Loop {
+        int header;
+        int exit;
+    };
+
+    const FunctionDef* func;
+    std::vector<CFGBlock> graph;
+    std::vector<bool> live;
+    // 语句开始处和执行完时所在的块
+    std::unordered_map<const ASTNode*, std::pair<int, int>> stmtBlocks;
+    std::vector<Loop> loops;
+    int current = Entry;
+    int fallthrough = Entry;
+
+    int newBlock();
+    void addEdge(int from, int to);
+    void build(const ASTNode* stmt);
+    // 按逆后序求直接支配者：forward为false时在反向图上从Exit出发
+    std::vector<int> immediateDominators(bool forward) const;
+};
+
+// 把每个函数的控制流图写成一个Graphviz有向图，函数各占一个子图
+void printCFG(std::ostream& out, const ASTNodePtr& root, const StringInterner& names);
@@ -1,61 +1,114 @@
 #pragma once
+#include "asm.h"
 #include "ast.h"
+#include "cfg.h"
+#include "riscv.h"
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
-#include <fstream>
-
-// RISC-V寄存器
-enum class Register {
-    ZERO, RA, SP, GP, TP, T0, T1, T2, S0, S1,
-    A0, A1, A2, A3, A4, A5, A6, A7,
-    S2, S3, S4, S5, S6, S7, S8, S9, S10, S11,
-    T3, T4, T5, T6
-};
 
-// 符号表项
+// 符号表项（局部变量或形参）
 struct Symbol {
     std::string name;
-    std::string type;
-    int offset;  // 相对于栈帧的偏移
+    int offset;  // 溢出到栈上时相对于进入函数时的sp的偏移
     bool isParam;
-    
-    Symbol(const std::string& name, const std::string& type, int offset, bool isParam = false)
-        : name(name), type(type), offset(offset), isParam(isParam) {}
+    Register reg; // 线性扫描分配到的寄存器，ZERO表示在栈上
+    bool read;    // 声明之后有没有被读到；从不被读的变量既不占寄存器也不占栈槽，写入直接丢掉
+
+    Symbol(const std::string& name, int offset, bool isParam = false)
+        : name(name), offset(offset), isParam(isParam), reg(Register::ZERO), read(true) {}
 };
 
 // 函数信息
 struct FunctionInfo {
     std::string name;
     std::vector<std::string> paramNames;
-    std::vector<std::string> paramTypes;
-    std::string returnType;
     int localVarCount;
     int stackSize;
-    
-    FunctionInfo(const std::string& name) : name(name), localVarCount(0), stackSize(0) {}
+    SymbolId symbol = InvalidSymbol;
+    bool saveRA = true;              // 有非尾调用时才需要保存ra
+    std::vector<Register> savedRegs; // 序言中保存的被调用者保存寄存器
+    int tempSlotBase;                // 表达式临时值溢出区（相对进入函数时的sp）
+
+    FunctionInfo(const std::string& name)
+        : name(name), localVarCount(0), stackSize(0), tempSlotBase(0) {}
 };
 
+// 表达式求值结果：temp>=0时是临时值栈中的编号（寄存器可能已被溢出），
+// 否则reg就是结果所在的寄存器（变量寄存器、zero或调用方指定的目标寄存器）
+struct Operand {
+    Register reg = Register::ZERO;
+    int temp = -1;
+};
+
+class AsmEmitter;
+class InstructionScheduler;
+class PeepholeOptimizer;
+class ThreadPool;
+struct CachedFunctions;
+
 class CodeGenerator {
 public:
-    CodeGenerator(const std::string& outputFile);
-    ~CodeGenerator();
-    
+    // 每个函数生成完后交给emitter输出；names用于把符号ID还原成汇编中的标签名；
+    // peephole非空时输出前先做窥孔优化；pool非空时各函数在线程池上并行生成
+    CodeGenerator(AsmEmitter& emitter, const StringInterner& names,
+                  PeepholeOptimizer* peephole = nullptr, ThreadPool* pool = nullptr);
+
+    // 命中缓存的函数直接输出缓存的指令表，其余的生成后存入缓存
+    void setCache(CachedFunctions* cached) { this->cached = cached; }
+    // scheduler非空时每个函数在窥孔优化之后做指令调度
+    void setScheduler(const InstructionScheduler* scheduler) { this->scheduler = scheduler; }
+    // 为true时乘、除以常量用移位和乘高位序列代替mul/div/rem
+    void setConstantMulDiv(bool enabled) { constantMulDiv = enabled; }
+
     void generate(const ASTNodePtr& node);
-    
+
 private:
-    std::ofstream output;
-    std::unordered_map<std::string, Symbol> symbolTable;
-    std::unordered_map<std::string, FunctionInfo> functions;
+    // 表达式临时值：占用一个临时寄存器，寄存器紧张或跨调用时溢出到栈槽
+    struct TempValue {
+        Register reg;
+        bool spilled;
+    };
+
+    AsmEmitter& emitter;
+    const StringInterner& names;
+    PeepholeOptimizer* peephole;
+    ThreadPool* pool;
+    CachedFunctions* cached = nullptr;
+    const InstructionScheduler* scheduler = nullptr;
+    bool constantMulDiv = true;
+    std::vector<AsmInst> code; // 尚未输出的指令
+    std::unordered_map<SymbolId, FunctionInfo> functions;
     FunctionInfo* currentFunction;
-    int labelCounter;
-    int tempVarCounter;
-    
+    int labelCounter; // 每个函数从0开始，标签带函数名前缀
+
+    // 当前函数的变量，按语义分析写进AST的变量编号索引（形参在前）
+    std::vector<Symbol> locals;
+
+    // 当前函数的控制流图：不可达的语句不生成代码，死存储只保留有调用的右边
+    const ControlFlowGraph* cfg = nullptr;
+    std::unordered_set<const ASTNode*> deadStores;
+
+    std::vector<TempValue> temps;
+    std::vector<Register> freeTemps;
+
+    // 当前所在循环的continue/break目标
+    std::vector<std::pair<std::string, std::string>> loopLabels;
+
+    // 序言中接收形参处的标签，自尾递归跳到这里
+    std::string tailEntryLabel;
+    // 所有return共用的尾声；函数体最后一条return直接落进去
+    std::string epilogueLabel;
+    const ReturnStmt* finalReturn = nullptr;
+
     // 访问者模式实现
     void visit(const ASTNodePtr& node);
     void visitProgram(const Program* node);
     void visitFunctionDef(const FunctionDef* node);
+    // 生成一个函数并做窥孔优化，返回它的指令表；只读写本对象的状态
+    std::vector<AsmInst> generateFunction(const FunctionDef* node);
     void visitBlock(const Block* node);
     void visitVarDecl(const VarDecl* node);
     void visitAssign(const Assign* node);
@@ -65,43 +118,66 @@ private:
     void visitContinueStmt(const ContinueStmt* node);
     void visitReturnStmt(const ReturnStmt* node);
     void visitExprStmt(const ExprStmt* node);
-    void visitBinaryExpr(const BinaryExpr* node);
-    void visitUnaryExpr(const UnaryExpr* node);
-    void visitIntLiteral(const IntLiteral* node);
-    void visitVarRef(const VarRef* node);
-    void visitFuncCall(const FuncCall* node);
-    
+    // 求值后丢掉结果，调用不必把返回值搬进临时寄存器
+    void discardExpr(const ASTNodePtr& expr);
+
+    // 条件跳转：cond的真值等于jumpIf时跳到target，否则顺序执行。
+    // 比较直接编成比较跳转指令，&&和||按短路跳转展开，不物化布尔值
+    void visitCondition(const ASTNodePtr& cond, bool jumpIf, const std::string& target);
+
+    // 表达式访问：hint非ZERO时尽量把结果直接算进hint寄存器
+    Operand visitExpr(const ASTNodePtr& node, Register hint = Register::ZERO);
+    Operand visitBinaryExpr(const BinaryExpr* node, Register hint);
+    Operand visitLogicalExpr(const BinaryExpr* node);
+    // 乘、除以常量value或对它取余，用muldiv.h的序列代替mul/div/rem
+    Operand visitConstantOp(BinOp op, const ASTNodePtr& operand, int value, Register hint);
+    Operand visitUnaryExpr(const UnaryExpr* node, Register hint);
+    Operand visitIntLiteral(const IntLiteral* node, Register hint);
+    Operand visitVarRef(const VarRef* node, Register hint);
+    Operand visitFuncCall(const FuncCall* node, Register hint, bool wantResult = true);
+    // return f(...)：自递归跳回函数入口，其他调用复用调用者的栈帧；不适用时返回false
+    bool visitTailCall(const FuncCall* node);
+    // 计算实参放入a0~a7，第9个及以后的放到sp+stackBase起的传参区
+    void passArguments(const FuncCall* node, int stackBase);
+
     // 代码生成辅助函数
-    void emit(const std::string& instruction);
+    void emit(AsmInst inst);
     void emitLabel(const std::string& label);
     void emitComment(const std::string& comment);
-    
-    std::string allocateRegister();
-    void freeRegister(const std::string& reg);
-    
+    void emitDirective(const std::string& directive);
+    // 窥孔优化后输出缓冲的指令
+    void flush();
+    void emitMemory(AsmOp op, Register reg, int offset, Register base);
+    // 按相对进入函数时的sp的偏移访问栈帧
+    void emitFrameMemory(AsmOp op, Register reg, int offset);
+    void emitAddImmediate(Register dst, Register src, int imm);
+    void emitParallelMove(std::vector<std::pair<Register, Register>> moves);
+
+    // 临时值栈管理
+    Operand allocateRegister();
+    void freeRegister(const Operand& operand);
+    Register use(const Operand& operand);
+    Operand resultOperand(Register hint, Operand& lhs, Operand* rhs = nullptr);
+    void spillTemps(size_t below);
+    void restoreTemps(const std::vector<TempValue>& snapshot, const std::vector<Register>& freeSnapshot);
+    int tempSlot(int index) const;
+
     std::string generateLabel(const std::string& prefix);
-    std::string generateTempVar();
-    
-    void loadVariable(const std::string& name, const std::string& reg);
-    void storeVariable(const std::string& name, const std::string& reg);
-    
+
+    void loadVariable(int var, Register reg);
+    void storeVariable(int var, Register reg);
+
+    void allocateFunction(const FunctionDef* node);
     void generateFunctionPrologue(const FunctionDef* node);
     void generateFunctionEpilogue(const FunctionDef* node);
-    
-    void generateArithmeticOp(const std::string& op, const std::string& result, 
-                             const std::string& lhs, const std::string& rhs);
-    void generateComparisonOp(const std::string& op, const std::string& result,
-                             const std::string& lhs, const std::string& rhs);
-    void generateLogicalOp(const std::string& op, const std::string& result,
-                          const std::string& lhs, const std::string& rhs);
-    
-    void generateFunctionCall(const std::string& funcName, 
-                             const std::vector<ASTNodePtr>& args,
-                             const std::string& resultReg);
-    
+    // 恢复被调用者保存寄存器、ra、s0并释放栈帧
+    void restoreFrame();
+    int savedRegSlot(size_t index) const;
+
+    void generateArithmeticOp(BinOp op, Register result, Register lhs, Register rhs);
+    void generateComparisonOp(BinOp op, Register result, Register lhs, Register rhs);
+    void generateCompareBranch(BinOp op, Register lhs, Register rhs, const std::string& target);
+
     // 栈管理
-    void enterScope();
-    void exitScope();
     int allocateStackSpace(int size);
-    void deallocateStackSpace(int size);
-}; 
\ No newline at end of file
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include "ast.h"
+#include <vector>
+
+// 按RV32IM的语义对二元运算求值：加减乘回绕，INT_MIN/-1的商为INT_MIN、余数为0；
+// 除数为0时返回false（留到运行时）
+bool evaluateBinOp(BinOp op, int lhs, int rhs, int& result);
+
+// AST级常量折叠与常量传播：在语义分析之后、代码生成之前原地改写AST。
+// 常量子树按32位补码回绕语义折叠；已知为常量的局部变量沿直线代码和分支条件传播；
+// 条件为常量的if/while被剪成对应的分支。
+class ConstantFolder {
+public:
+    explicit ConstantFolder(ASTContext& context) : context(context) {}
+    void optimize(const ASTNodePtr& root);
+
+    // 折叠掉的表达式节点数和剪掉的分支数
+    size_t foldedExprs() const { return folded; }
+    size_t prunedBranches() const { return pruned; }
+
+private:
+    // 变量在当前程序点的值：known为false表示不是常量
+    struct Value {
+        bool known = false;
+        int value = 0;
+    };
+    using Env = std::vector<Value>;
+
+    ASTContext& context;
+    Env env;               // 按语义分析的变量编号索引，大小为函数的varCount
+    bool reachable = true; // 当前程序点是否可达（return/break/continue之后为false）
+    size_t folded = 0;
+    size_t pruned = 0;
+
+    void foldFunction(FunctionDef* func);
+    ASTNodePtr foldStmt(ASTNodePtr node);
+    ASTNodePtr foldExpr(ASTNodePtr node);
+    ASTNodePtr foldBinary(BinaryExpr* node);
+    ASTNodePtr foldUnary(UnaryExpr* node);
+
+    ASTNodePtr foldIf(IfStmt* node);
+    ASTNodePtr foldWhile(WhileStmt* node);
+
+    void collectAssigned(const ASTNode* node, std::vector<uint32_t>& vars) const;
+    void refine(const ASTNode* cond, bool taken);
+    void merge(const Env& other);
+
+    ASTNodePtr literal(int value);
+    ASTNodePtr emptyStmt();
+};
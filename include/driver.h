@@ -0,0 +1,39 @@
+#pragma once
+#include <ostream>
+#include <string>
+
+class CompileStats;
+class FunctionCache;
+class PeepholeOptimizer;
+class ThreadPool;
+
+// 编译选项（命令行上除输入文件以外的部分）
+struct CompileOptions {
+    int optLevel = 1;
+    bool dumpIR = false;
+    bool dumpCFG = false;
+    bool verifyIR = false;
+    bool inlineCalls = true;
+    bool licm = true;           // 以下三项为-O1的循环优化
+    bool strengthReduce = true;
+    bool unrollLoops = true;
+    bool peephole = true;
+    bool constantMulDiv = true;   // 乘、除以常量改成移位和乘高位序列，见muldiv.h
+    bool schedule = true;         // 窥孔优化之后做基本块内的指令调度
+    std::string core = "generic"; // 指令调度用的延迟表，见coreModels
+    bool emitObject = false;
+    bool verifyObject = false;
+    bool comments = true;
+    bool fusedFrontend = false; // 语法分析时同时做语义检查，不再单独遍历AST
+};
+
+// 输出文件名：outputDir非空时放进该目录，nextToInput时放在输入文件旁边，否则放在当前目录
+std::string outputPathFor(const std::string& inputFile, const CompileOptions& options,
+                          const std::string& outputDir, bool nextToInput);
+
+// 编译一个文件，各阶段的进度写到log，出错时抛出异常。peephole非空时用它做窥孔优化并累计统计
+// （options.peephole为false时忽略）；pool非空时各函数在线程池上并行生成；
+// cache非空时没有改动的函数从缓存中取出，其余函数编译后存入缓存；stats非空时记录各阶段耗时和计数
+void compileFile(const std::string& inputFile, const std::string& outputFile, const CompileOptions& options,
+                 std::ostream& log, PeepholeOptimizer* peephole, ThreadPool* pool, FunctionCache* cache = nullptr,
+                 CompileStats* stats = nullptr);
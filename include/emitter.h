@@ -0,0 +1,66 @@
+#pragma once
+#include "asm.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+// 汇编输出后端：代码生成器把窥孔优化和调度后的指令表按段交过来（文件头和每个函数各一段），
+// 全部生成完后由finish写出文件
+class AsmEmitter {
+public:
+    virtual ~AsmEmitter() = default;
+
+    virtual void emit(const std::vector<AsmInst>& code) = 0;
+    virtual void finish() = 0;
+    // 为false时生成器不必产生注释
+    virtual bool wantsComments() const { return true; }
+
+    // 收到的指令行（伪指令算一条）和标签数，finish写出的字节数
+    size_t instructions() const { return instructionLines; }
+    size_t labels() const { return labelLines; }
+    size_t bytesWritten() const { return written; }
+
+protected:
+    void countLines(const std::vector<AsmInst>& code);
+
+    size_t instructionLines = 0;
+    size_t labelLines = 0;
+    size_t written = 0;
+};
+
+// 文本汇编：整个文件在内存中拼好，finish时一次写出
+class TextEmitter : public AsmEmitter {
+public:
+    TextEmitter(const std::string& outputFile, bool comments = true);
+
+    void emit(const std::vector<AsmInst>& code) override;
+    void finish() override;
+    bool wantsComments() const override { return comments; }
+
+private:
+    std::ofstream output;
+    std::string buffer;
+    bool comments;
+};
+
+// 直接编码RV32IM指令，输出ELF32可重定位目标文件（.text、符号表和重定位），不经过外部汇编器。
+// 每段的第一个标签是函数入口；跳转和调用在文件内解析，同时保留分支和R_RISCV_CALL_PLT重定位
+class ObjectEmitter : public AsmEmitter {
+public:
+    // verify为真时把编码出的每个字反汇编回来，与编码前的机器指令逐条比对
+    ObjectEmitter(const std::string& outputFile, bool verify = false);
+
+    void emit(const std::vector<AsmInst>& code) override;
+    void finish() override;
+    bool wantsComments() const override { return false; }
+
+    // 已编码的指令条数
+    size_t instructionCount() const { return encodedCount; }
+
+private:
+    std::ofstream output;
+    bool verify;
+    std::vector<AsmInst> code;
+    std::vector<size_t> functionStarts; // 各函数入口标签在code中的位置
+    size_t encodedCount = 0;
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include "asm.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// RV32IM的机器指令（伪指令展开之后）
+enum class RvOp : uint8_t {
+    Add, Sub, Mul, Mulh, Div, Rem, Xor, Slt, Sltu,
+    Addi, Andi, Xori, Slti, Sltiu, Slli, Srli, Srai,
+    Lw, Sw,
+    Beq, Bne, Blt, Bge,
+    Lui, Auipc, Jal, Jalr,
+};
+
+// 分支和jal的imm是相对本条指令的字节偏移，lui/auipc的imm是高20位
+struct MachineInst {
+    RvOp op;
+    Register rd = Register::ZERO;
+    Register rs1 = Register::ZERO;
+    Register rs2 = Register::ZERO;
+    int32_t imm = 0;
+};
+
+// 汇编指令展开成几个字节：li按立即数大小是1~2条，call/tail是auipc+jalr，
+// 超出±4KiB的条件分支改成反向分支跳过一条jal
+int encodedSize(const AsmInst& inst, bool longBranch);
+
+// 把汇编指令展开成机器指令；offset是跳转目标相对本条指令起点的偏移
+void lowerAsmInst(const AsmInst& inst, int32_t offset, bool longBranch, std::vector<MachineInst>& out);
+
+uint32_t encode(const MachineInst& inst);
+
+// 按objdump的写法输出机器指令（不用伪指令别名，跳转写相对偏移），用于和反汇编结果对照
+std::string formatMachineInst(const MachineInst& inst);
+
+// 独立于编码器的解码，用不到的字段清零；不认识的编码返回false
+bool decode(uint32_t word, MachineInst& inst);
+
+// 反汇编，格式同formatMachineInst；不认识的编码返回空串
+std::string disassemble(uint32_t word);
+
+// 指令表的布局：先全部按短分支排，超出±4KiB的分支改成长分支后重排，直到不再变化
+struct CodeLayout {
+    std::vector<uint32_t> offsets;                    // 各行的字节偏移，最后多一项为总长度
+    std::vector<bool> longBranch;
+    std::unordered_map<std::string, uint32_t> labels; // 标签 -> 字节偏移
+
+    // 跳转目标标签的偏移，未定义时抛出异常
+    uint32_t target(const AsmInst& inst) const;
+};
+
+CodeLayout layoutCode(const std::vector<AsmInst>& code);
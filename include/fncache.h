@@ -0,0 +1,60 @@
+#pragma once
+#include "asm.h"
+#include "ast.h"
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 函数粒度的增量编译缓存。每个函数生成的指令表（窥孔优化之后）按缓存键存成目录下的一个文件，
+// 源码没变的函数下次直接取出拼进输出，不再做语义检查和代码生成。
+// 命中时更新文件的修改时间，超过大小上限时按修改时间从旧到新淘汰。
+// 多个线程、多个进程可以同时使用同一个目录：条目先写临时文件再改名
+class FunctionCache {
+public:
+    // directory不存在时创建；maxBytes为所有条目的总大小上限
+    FunctionCache(std::string directory, uint64_t maxBytes);
+
+    // 命中时把指令表写进code并返回true；条目损坏时当作未命中
+    bool lookup(const std::string& key, std::vector<AsmInst>& code);
+    void store(const std::string& key, const std::vector<AsmInst>& code);
+    // 删掉最久未用的条目，直到总大小不超过上限
+    void evict();
+
+    void printStats(std::ostream& out) const;
+
+private:
+    std::string directory;
+    uint64_t maxBytes;
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> stores{0};
+    std::atomic<uint64_t> evictedEntries{0};
+    std::atomic<uint64_t> evictedBytes{0};
+    uint64_t totalBytes = 0; // 上次evict之后的缓存大小
+
+    std::string pathOf(const std::string& key) const;
+};
+
+// 一个文件中各函数（按源码顺序）的缓存键和查找结果，交给语义分析和代码生成
+struct CachedFunctions {
+    FunctionCache* cache = nullptr;
+    std::vector<SymbolId> names;
+    std::vector<std::string> keys;
+    std::vector<bool> hit;
+    std::vector<std::vector<AsmInst>> code; // 命中的函数的指令表
+
+    size_t hitCount() const;
+};
+
+// 计算各函数的缓存键：函数自身的词法单元序列、所调用函数的签名（返回类型、形参个数、
+// 是否声明在前），以及编译器本身和影响输出的选项configuration。calleeBodies为true时
+// （-O1会内联）还包括调用闭包中所有函数的词法单元。源码切分出的函数与program对不上时返回空表
+std::vector<std::string> functionCacheKeys(std::string_view source, const Program* program,
+                                           const StringInterner& names, const std::string& configuration,
+                                           bool calleeBodies);
+
+// roots中的函数以及它们直接、间接调用的所有函数
+std::vector<bool> callClosure(const Program* program, const std::vector<bool>& roots);
@@ -0,0 +1,45 @@
+#pragma once
+#include "emitter.h"
+#include "fncache.h"
+#include "peephole.h"
+#include "threadpool.h"
+#include <memory>
+#include <vector>
+
+class InstructionScheduler;
+class StringInterner;
+
+// CodeGenerator和InstructionSelector共用的按函数生成的驱动。count个函数互不依赖，分给线程池
+// 并行生成（pool为空时串行）；每个线程第一次用到时建一个自己的Generator，带上调度器和常量乘除
+// 的设置，窥孔统计各自记录、最后并回peephole。命中缓存的函数直接取缓存的指令表，其余的生成后
+// 存入缓存。结果按下标顺序交给emitter，输出与串行时逐字节相同。generate(worker, i)生成第i个函数
+template <typename Generator, typename Generate>
+void generateFunctions(size_t count, AsmEmitter& emitter, const StringInterner& names, PeepholeOptimizer* peephole,
+                       ThreadPool* pool, CachedFunctions* cached, const InstructionScheduler* scheduler,
+                       bool constantMulDiv, Generate generate) {
+    unsigned threads = pool ? pool->size() : 1;
+    std::vector<std::vector<AsmInst>> outputs(count);
+    std::vector<std::unique_ptr<Generator>> workers(threads);
+    std::vector<PeepholeOptimizer> peepholes;
+    if (peephole) peepholes.assign(threads, peephole->fork());
+    auto generateOne = [&](size_t i, unsigned worker) {
+        if (cached && cached->hit[i]) {
+            outputs[i] = std::move(cached->code[i]);
+            return;
+        }
+        if (!workers[worker]) {
+            workers[worker] = std::make_unique<Generator>(emitter, names, peephole ? &peepholes[worker] : nullptr);
+            workers[worker]->setScheduler(scheduler);
+            workers[worker]->setConstantMulDiv(constantMulDiv);
+        }
+        outputs[i] = generate(*workers[worker], i);
+        if (cached) cached->cache->store(cached->keys[i], outputs[i]);
+    };
+    if (pool) {
+        pool->parallelFor(count, generateOne);
+    } else {
+        for (size_t i = 0; i < count; ++i) generateOne(i, 0);
+    }
+    for (const PeepholeOptimizer& stats : peepholes) peephole->merge(stats);
+    for (const auto& output : outputs) emitter.emit(output);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "ir.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// 内联的代价模型参数
+struct InlineOptions {
+    int threshold = 16;        // 被调函数的净代价不超过此值时内联
+    int maxRecursionDepth = 1; // 调用环上的函数最多展开几层
+    int maxFunctionSize = 500; // 调用者内联后的指令数上限
+};
+
+// 模块级的函数内联：按调用图自底向上（被调函数先于调用者）处理，
+// 在Call处复制被调函数的基本块，形参换成实参，各个ret改为跳到调用点之后的块，
+// 返回值经φ汇合。内联后由pass流水线再做折叠和化简。
+class Inliner {
+public:
+    explicit Inliner(InlineOptions options = {}) : options(options) {}
+
+    // 返回内联的调用点数
+    int run(IRModule& module);
+
+private:
+    InlineOptions options;
+    std::unordered_map<SymbolId, IRFunction*> functions;
+    std::unordered_set<SymbolId> recursive;         // 处在调用图的环上的函数
+    std::unordered_map<const IRInst*, int> depthOf; // 内联复制出来的调用所在的展开层数
+
+    std::vector<std::vector<IRFunction*>> callGraphSCCs(IRModule& module);
+    int inlineDepth(const IRInst* call) const;
+    bool shouldInline(const IRInst* call, int callerSize) const;
+    // 返回复制进调用者的调用指令
+    std::vector<IRInst*> inlineCall(IRFunction& caller, IRInst* call, const IRFunction& callee);
+};
+
+// 指令数（不计常量、形参和φ），用于代价估计
+int functionSize(const IRFunction& func);
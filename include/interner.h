@@ -0,0 +1,33 @@
+#pragma once
+#include "arena.h"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// 驻留后的标识符ID，按首次出现顺序从0开始稠密分配
+using SymbolId = uint32_t;
+constexpr SymbolId InvalidSymbol = ~0u;
+
+// 标识符驻留表：相同的名字只保存一份，之后各阶段只比较整数ID
+class StringInterner {
+public:
+    StringInterner();
+    StringInterner(const StringInterner&) = delete;
+    StringInterner& operator=(const StringInterner&) = delete;
+
+    SymbolId intern(std::string_view str);
+    // 只查找不插入，不存在时返回InvalidSymbol
+    SymbolId find(std::string_view str) const;
+    std::string_view name(SymbolId id) const { return strings[id]; }
+    size_t size() const { return strings.size(); }
+
+private:
+    Arena storage;
+    std::vector<std::string_view> strings;
+    std::vector<uint32_t> hashes;
+    std::vector<SymbolId> slots; // 开放寻址表，容量为2的幂
+
+    static uint32_t hash(std::string_view str);
+    size_t probe(std::string_view str, uint32_t h) const;
+    void grow();
+};
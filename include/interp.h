@@ -0,0 +1,29 @@
+#pragma once
+#include "ast.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 直接遍历AST的解释器，作为字节码虚拟机的对照：每次调用按名字查找函数，
+// 变量放在逐层的哈希表里，控制流靠返回值逐层传递。语义与生成的代码相同
+class ASTInterpreter {
+public:
+    ASTInterpreter(const ASTNodePtr& root, const StringInterner& names, size_t maxDepth = 10000);
+
+    // 调用深度超过maxDepth、实参个数不对时抛出异常
+    int32_t call(const std::string& name, const std::vector<int32_t>& args = {});
+
+private:
+    enum class Flow { Normal, Break, Continue, Return };
+    using Scopes = std::vector<std::unordered_map<SymbolId, int32_t>>;
+
+    const StringInterner& names;
+    std::unordered_map<std::string, const FunctionDef*> functions;
+    size_t maxDepth;
+    size_t depth = 0;
+
+    Flow exec(const ASTNode* node, Scopes& scopes, int32_t& result);
+    int32_t eval(const ASTNode* node, Scopes& scopes);
+    int32_t& variable(SymbolId name, Scopes& scopes);
+};
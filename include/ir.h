@@ -0,0 +1,112 @@
+#pragma once
+#include "interner.h"
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// SSA形式的中间表示：函数由基本块组成，每个基本块以一条终结指令结尾，
+// 指令本身就是它定义的值（%id），φ节点总是排在基本块开头。
+
+enum class IROp : uint8_t {
+    Const, Param,
+    Add, Sub, Mul, Div, Rem,
+    Lt, Le, Gt, Ge, Eq, Ne,
+    Call, Phi,
+    Jump, Branch, Ret
+};
+
+const char* irOpName(IROp op);
+
+inline bool isTerminator(IROp op) {
+    return op == IROp::Jump || op == IROp::Branch || op == IROp::Ret;
+}
+
+inline bool isComparison(IROp op) {
+    return op >= IROp::Lt && op <= IROp::Ne;
+}
+
+inline bool isBinary(IROp op) {
+    return op >= IROp::Add && op <= IROp::Ne;
+}
+
+struct IRBlock;
+
+struct IRInst {
+    IROp op;
+    int id;                          // 值编号，函数内唯一
+    IRBlock* block = nullptr;
+    std::vector<IRInst*> operands;
+    // Phi: 与operands一一对应的前驱块；Jump: {目标}；Branch: {真目标, 假目标}
+    std::vector<IRBlock*> targets;
+    int imm = 0;                     // Const的值，Param的序号
+    SymbolId callee = InvalidSymbol; // Call的被调函数
+    bool hasValue = true;            // void函数调用和终结指令没有结果值
+
+    IRInst(IROp op, int id) : op(op), id(id) {}
+};
+
+struct IRBlock {
+    int id;
+    std::vector<IRInst*> insts;
+    std::vector<IRBlock*> preds;
+
+    explicit IRBlock(int id) : id(id) {}
+
+    IRInst* terminator() const {
+        return !insts.empty() && isTerminator(insts.back()->op) ? insts.back() : nullptr;
+    }
+    const std::vector<IRBlock*>& succs() const;
+};
+
+class IRFunction {
+public:
+    IRFunction(SymbolId name, int paramCount, bool returnsValue)
+        : name(name), paramCount(paramCount), returnsValue(returnsValue) {}
+
+    SymbolId name;
+    int paramCount;
+    bool returnsValue;
+    std::vector<IRBlock*> blocks; // blocks[0]是入口块，其余按布局顺序
+
+    IRBlock* entry() const { return blocks.front(); }
+    IRBlock* createBlock();
+    IRInst* createInst(IROp op);
+    // 取值为value的常量，没有时在入口块开头新建
+    IRInst* constant(int value);
+    int valueCount() const { return nextValue; }
+
+    // 按映射表把所有操作数替换成对应的新值（沿映射链追到底）
+    void replaceUses(const std::unordered_map<IRInst*, IRInst*>& replacements);
+    // 重新计算所有块的前驱表（按块顺序；Branch两个目标相同时记两次）
+    void recomputePreds();
+    // 消除只有一个不同入值的φ（没有入值时替换为常量0），返回是否有修改
+    bool removeTrivialPhis();
+    // 删除block开头各φ节点中来自pred的入边
+    static void removePhiIncoming(IRBlock* block, IRBlock* pred);
+
+    // 结构检查，失败时抛出异常
+    void verify(const StringInterner& names) const;
+
+private:
+    std::vector<std::unique_ptr<IRBlock>> blockPool;
+    std::vector<std::unique_ptr<IRInst>> instPool;
+    int nextValue = 0;
+    int nextBlock = 0;
+};
+
+struct IRModule {
+    std::vector<std::unique_ptr<IRFunction>> functions;
+};
+
+// 逆后序（从入口可达的块）
+std::vector<IRBlock*> reversePostOrder(const IRFunction& func);
+
+// 直接支配者：idom[block->id]，入口块的idom是它自己，不可达块为nullptr
+std::vector<IRBlock*> computeDominators(const IRFunction& func);
+
+// 文本形式输出，供--dump-ir检查
+void printIR(std::ostream& out, const IRModule& module, const StringInterner& names);
+void printIR(std::ostream& out, const IRFunction& func, const StringInterner& names);
@@ -0,0 +1,56 @@
+#pragma once
+#include "ast.h"
+#include "ir.h"
+#include <unordered_map>
+#include <vector>
+
+// AST -> SSA形式的IR。
+// 采用Braun等人的即时构造算法（"Simple and Efficient Construction of SSA Form"）：
+// 局部变量的每次读写直接映射为SSA值，需要时在汇合点插入φ节点，
+// 循环头在回边全部确定之前保持未封闭；平凡的φ在构造结束后统一消除。
+class IRGenerator {
+public:
+    explicit IRGenerator(const StringInterner& names) : names(names) {}
+
+    std::unique_ptr<IRModule> generate(const ASTNodePtr& root);
+
+private:
+    const StringInterner& names;
+    std::unordered_map<SymbolId, bool> returnsValue; // 函数名 -> 是否返回int
+
+    // 当前函数的构造状态
+    IRFunction* func = nullptr;
+    IRBlock* current = nullptr;
+    std::vector<std::vector<std::pair<SymbolId, int>>> scopes; // 名字 -> 变量编号
+    int varCount = 0;
+    std::vector<std::unordered_map<IRBlock*, IRInst*>> currentDef; // [变量][块] -> 值
+    std::unordered_map<IRBlock*, std::vector<std::pair<int, IRInst*>>> incompletePhis;
+    std::vector<bool> sealed;                                   // 按块编号
+    std::vector<std::pair<IRBlock*, IRBlock*>> loops;           // (continue目标, break目标)
+
+    void lowerFunction(const FunctionDef* node);
+    void lowerStmt(const ASTNode* node);
+    IRInst* lowerExpr(const ASTNode* node);
+    // 按短路语义把条件直接翻译成到两个目标块的分支
+    void lowerCond(const ASTNode* node, IRBlock* trueBlock, IRBlock* falseBlock);
+
+    IRBlock* newBlock();
+    IRInst* append(IROp op, std::vector<IRInst*> operands = {});
+    IRInst* constant(int value);
+    void jump(IRBlock* target);
+    void branch(IRInst* cond, IRBlock* trueBlock, IRBlock* falseBlock);
+    void startBlock(IRBlock* block);
+    bool terminated() const;
+
+    // 变量作用域
+    int declare(SymbolId name);
+    int resolve(SymbolId name) const;
+
+    // SSA构造
+    void writeVariable(int var, IRBlock* block, IRInst* value);
+    IRInst* readVariable(int var, IRBlock* block);
+    IRInst* readVariableRecursive(int var, IRBlock* block);
+    IRInst* newPhi(IRBlock* block);
+    void addPhiOperands(int var, IRInst* phi);
+    void sealBlock(IRBlock* block);
+};
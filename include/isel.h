@@ -0,0 +1,107 @@
+#pragma once
+#include "asm.h"
+#include "ir.h"
+#include "riscv.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+// 从SSA形式的IR生成RISC-V汇编：拆分关键边并把φ翻译成前驱末尾的并行传送，
+// 在线性化的指令序列上做活跃分析和线性扫描寄存器分配，再逐条选择指令。
+class AsmEmitter;
+class InstructionScheduler;
+class PeepholeOptimizer;
+class ThreadPool;
+struct CachedFunctions;
+
+class InstructionSelector {
+public:
+    // 每个函数生成完后交给emitter输出；peephole非空时输出前先做窥孔优化，
+    // pool非空时各函数在线程池上并行生成
+    InstructionSelector(AsmEmitter& emitter, const StringInterner& names,
+                        PeepholeOptimizer* peephole = nullptr, ThreadPool* pool = nullptr);
+
+    // 命中缓存的函数直接输出缓存的指令表，其余的生成后存入缓存。设置后按cached中的函数顺序输出，
+    // module里只需要有未命中的函数
+    void setCache(CachedFunctions* cached) { this->cached = cached; }
+    // scheduler非空时每个函数在窥孔优化之后做指令调度
+    void setScheduler(const InstructionScheduler* scheduler) { this->scheduler = scheduler; }
+    // 为true时乘、除以常量用移位和乘高位序列代替mul/div/rem
+    void setConstantMulDiv(bool enabled) { constantMulDiv = enabled; }
+
+    void generate(IRModule& module);
+
+private:
+    // 值或传送目标的位置：寄存器、相对s0的栈槽或立即数
+    struct Location {
+        enum Kind : uint8_t { Reg, Slot, Imm } kind = Reg;
+        Register reg = Register::ZERO;
+        int value = 0; // Slot相对进入函数时的sp的偏移，或Imm的值
+
+        bool operator==(const Location& other) const {
+            return kind == other.kind && (kind == Reg ? reg == other.reg : value == other.value);
+        }
+    };
+    using Move = std::pair<Location, Location>; // (目标, 源)
+
+    AsmEmitter& emitter;
+    const StringInterner& names;
+    PeepholeOptimizer* peephole;
+    ThreadPool* pool;
+    CachedFunctions* cached = nullptr;
+    const InstructionScheduler* scheduler = nullptr;
+    bool constantMulDiv = true;
+    std::vector<AsmInst> code; // 当前函数尚未输出的指令
+
+    // 当前函数的状态
+    IRFunction* func = nullptr;
+    std::string funcName;
+    std::vector<Location> locations;     // 按值编号
+    std::vector<bool> fused;             // 按值编号：与后面的分支融合的比较
+    std::vector<bool> hoisted;           // 按块编号：φ传送已提到前驱分支之前的边块
+    std::vector<Register> savedRegs;     // 序言中保存的被调用者保存寄存器
+    bool saveRA = false;                 // 有非尾调用时才保存ra
+    int frameSize = 0;
+
+    // 为一个函数选择指令并做窥孔优化，返回它的指令表；只读写本对象和该函数的状态
+    std::vector<AsmInst> generateFunction(IRFunction& function);
+    void splitCriticalEdges();
+    void fuseBranches();
+    void allocateRegisters();
+
+    void emitPrologue();
+    void emitEpilogue();
+    // 恢复被调用者保存寄存器、ra、s0并释放栈帧
+    void restoreFrame();
+    int savedRegSlot(size_t index) const;
+    void emitBlock(IRBlock* block, IRBlock* next);
+    void emitBinary(IRInst* inst);
+    void emitBranch(IRInst* inst, IRBlock* next);
+    void emitCall(IRInst* inst);
+    // 块以“调用后直接返回调用结果”结尾时复用调用者的栈帧
+    bool isTailCall(const IRBlock* block, const IRInst* call) const;
+    void emitTailCall(IRInst* inst);
+    void emitPhiMoves(IRBlock* from, IRBlock* to);
+
+    Location locationOf(const IRInst* value) const;
+    // 取操作数所在的寄存器，常量或溢出的值装入scratch
+    Register operand(const IRInst* value, Register scratch);
+    // 结果写入的寄存器：溢出的值先算进scratch，再由storeResult写回栈槽
+    Register resultRegister(const IRInst* value, Register scratch);
+    void storeResult(const IRInst* value, Register reg);
+
+    std::string blockLabel(const IRBlock* block) const;
+    std::string epilogueLabel() const;
+    void emit(AsmInst inst);
+    void emitLabel(const std::string& label);
+    void emitComment(const std::string& comment);
+    void emitDirective(const std::string& directive);
+    // 窥孔优化后输出缓冲的指令
+    void flush();
+    void emitMemory(AsmOp op, Register reg, int offset, Register base);
+    // 按相对进入函数时的sp的偏移访问栈帧
+    void emitFrameMemory(AsmOp op, Register reg, int offset);
+    void emitAddImmediate(Register dst, Register src, int imm);
+    void emitMove(const Location& dst, const Location& src);
+    void emitParallelMove(std::vector<Move> moves);
+};
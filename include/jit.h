@@ -0,0 +1,56 @@
+#pragma once
+#include "bytecode.h"
+#include <csetjmp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// x86-64 JIT：把字节码逐条翻译成机器码，放在mmap得到的可执行内存里。字节码寄存器是栈帧里的
+// 4字节槽位。编译后的函数的签名是int32_t f(const int32_t* args)，实参按顺序存放；调用者把
+// 实参写进自己帧里连续的槽位，直接传槽位的地址。
+// 惰性编译时每个函数先只有一小段桩代码，第一次被调用时才编译，编译后桩改成跳到机器码，
+// 已经指向桩的调用点也改成直接调用机器码。代码区平时只读可执行，写入时才临时改成可读写。
+// 每个函数的序言检查栈顶，经call调用时递归太深报栈溢出。只支持x86-64 Linux，其余平台构造时抛出异常
+class JIT {
+public:
+    using Function = int32_t (*)(const int32_t* args);
+
+    // lazy为false时构造时就编译全部函数。codeBytes为保留的代码区大小（按需提交物理页）
+    explicit JIT(BcModule module, bool lazy = true, size_t codeBytes = 64u << 20);
+    ~JIT();
+    JIT(const JIT&) = delete;
+    JIT& operator=(const JIT&) = delete;
+
+    // 函数的入口（还没编译时是它的桩），找不到时返回nullptr
+    Function lookup(const std::string& name) const;
+
+    // 以args为实参调用函数，实参个数不对或栈溢出时抛出异常。经lookup直接调用时不检查栈
+    int32_t call(const std::string& name, const std::vector<int32_t>& args = {});
+
+    size_t compiledFunctions() const { return compiled; }
+    size_t codeSize() const { return used; }
+    // 已编译的代码里还经过桩的调用点个数：只有被调函数还没编译时才应该有
+    size_t stubCallSites() const;
+
+private:
+    BcModule module;
+    uint8_t* code = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+    size_t pageSize = 0;
+    bool writable = true;                       // 代码区当前是否可读写（构造期间）
+    uint8_t* overflowExit = nullptr;            // 序言发现栈不够时跳到这里
+    uintptr_t stackLimit = 0;                   // 栈顶不能低于的地址，只在call执行期间设置
+    std::jmp_buf overflow;
+    std::vector<uint8_t*> entries;              // 已编译函数的机器码，未编译时为nullptr
+    std::vector<uint8_t*> stubs;
+    std::vector<std::vector<uint8_t*>> callers; // 各函数还指向桩的调用点（rel32的位置）
+    std::vector<std::pair<uint8_t*, int>> callSites; // 已编译代码中的全部调用点（rel32的位置, 被调函数）
+    size_t compiled = 0;
+
+    uint8_t* compile(int function);
+    static uint8_t* lazyCompile(JIT* jit, int function);
+    [[noreturn]] static void stackOverflow(JIT* jit);
+    // 把[at, at+bytes)所在的页改成可读写或只读可执行
+    void setWritable(uint8_t* at, size_t bytes, bool writable);
+};
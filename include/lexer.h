@@ -2,6 +2,9 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <string_view>
+#include <cstdint>
+#include "interner.h"
 
 enum class TokenType {
     // 关键字
@@ -22,6 +25,42 @@ enum class TokenType {
     END_OF_FILE, ERROR
 };
 
+// 零拷贝词法单元：text指向源缓冲区（通常是mmap映射的文件），
+// 标识符额外携带驻留后的整数ID
+struct TokenView {
+    TokenType type;
+    std::string_view text;
+    uint32_t offset;
+    int line;
+    int column;
+    SymbolId symbol;
+};
+
+// 直接在只读源缓冲区上扫描，不复制源码，也不为每个词法单元分配字符串
+class ViewLexer {
+public:
+    // interner为nullptr时不驻留标识符，symbol恒为InvalidSymbol
+    explicit ViewLexer(std::string_view source, StringInterner* interner = nullptr);
+    TokenView nextToken();
+    TokenView peekToken();
+    void reset();
+    
+private:
+    std::string_view source;
+    StringInterner* interner;
+    size_t position;
+    size_t lineStart;
+    int line;
+    
+    void skipWhitespace();
+    TokenView makeToken(TokenType type, size_t start, size_t length);
+    TokenView readNumber();
+    TokenView readIdentifier();
+    TokenView readOperator();
+    
+    static TokenType keywordType(std::string_view word);
+};
+
 struct Token {
     TokenType type;
     std::string value;
@@ -32,6 +71,8 @@ struct Token {
         : type(type), value(value), line(line), column(column) {}
 };
 
+// 传统接口：持有源码副本，逐字符扫描并返回带std::string的词法单元。
+// 编译器已改用ViewLexer，这里保留原来的扫描器作为lexer_bench的对照
 class Lexer {
 public:
     explicit Lexer(const std::string& source);
@@ -57,4 +98,4 @@ private:
     
     bool isKeyword(const std::string& word);
     TokenType getKeywordType(const std::string& word);
-}; 
\ No newline at end of file
+};
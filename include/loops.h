@@ -0,0 +1,43 @@
+#pragma once
+#include "passes.h"
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+// 自然循环：目标支配源的边是回边，回边的目标是循环头，循环体是不经过循环头能走到回边源的块。
+// 指向同一个循环头的回边合成一个循环
+struct IRLoop {
+    IRBlock* header;
+    std::vector<IRBlock*> latches;       // 回边的源
+    std::unordered_set<IRBlock*> blocks; // 含循环头
+    IRLoop* parent = nullptr;            // 直接外层循环
+
+    bool contains(const IRBlock* block) const { return blocks.count(const_cast<IRBlock*>(block)) != 0; }
+};
+
+// 函数中所有的自然循环，内层循环排在外层之前
+std::vector<std::unique_ptr<IRLoop>> findLoops(const IRFunction& func);
+
+// 循环优化的开关和展开的规模上限，各项可以单独关闭
+struct LoopOptions {
+    bool licm = true;           // 循环不变量外提
+    bool strengthReduce = true; // 归纳变量强度削弱
+    bool unroll = true;         // 完全展开小的计数循环
+    bool constantMultiply = true; // 后端把乘常量改成移位加减，强度削弱按序列长度估计乘法的代价
+    int maxUnrollTrips = 16;    // 展开的循环最多迭代几次
+    int maxUnrolledSize = 96;   // 展开后循环体的指令总数上限（不计φ和终结指令）
+    int maxLivePressure = 24;   // 外提后循环头入口处活跃的值的个数上限（可分配的寄存器数）
+};
+
+// 把操作数都不在循环中定义的纯运算移到循环前置块，必要时新建前置块。
+// 二元运算没有副作用、按RV32IM语义也不会陷入，即使原来在条件分支里也可以提前算；
+// 循环头入口处活跃的值（按块的排列顺序估计）已经达到上限时不再外提，免得外提的值长期占着寄存器引起溢出
+std::unique_ptr<IRPass> createLICMPass(const LoopOptions& options = {});
+// 基本归纳变量i（循环头的φ，每次迭代加或减一个常量）与循环不变量k的乘积改为新的归纳变量，
+// 进入循环时取初值乘k，每次迭代加上步长乘k。乘常量本来就只要一条移位时不替换
+std::unique_ptr<IRPass> createStrengthReductionPass(const LoopOptions& options = {});
+// 只有一个块的循环，迭代次数能在编译时算出且不超过上限时完全展开成直线代码
+std::unique_ptr<IRPass> createLoopUnrollPass(const LoopOptions& options = {});
+
+// 按options加入打开的循环pass
+void addLoopPasses(PassManager& manager, const LoopOptions& options);
@@ -0,0 +1,30 @@
+#pragma once
+#include "asm.h"
+#include <cstdint>
+#include <vector>
+
+// 乘、除以常量的指令序列，两条代码生成路径共用。mul要先把常量装进寄存器并等乘法器出结果，
+// div/rem在单发射核上要几十个周期；改成移位、加减和乘高位（mulh）后只要几条单周期指令
+
+// 有符号除以常量d（|d|>=2且不是2的幂）的魔数：q = ((mulh(x, multiplier) ± x) >> shift) + 符号位，
+// 乘数为负而d为正时加x，乘数为正而d为负时减x（Hacker's Delight第10章）
+struct DivisionMagic {
+    int32_t multiplier;
+    int shift;
+};
+DivisionMagic divisionMagic(int32_t divisor);
+
+// 乘以factor的移位加减序列的指令数，序列不比li加mul短时返回0
+int shiftMultiplyLength(int32_t factor);
+// 乘以factor总共要几条指令：能用移位加减时是序列长度，否则是li加mul
+int multiplyCost(int32_t factor);
+
+// dst = src * factor。能用移位加减时追加序列返回true，否则不追加返回false（调用者照常用mul）。
+// dst可以与src相同，scratch与两者都不同
+bool lowerMultiply(std::vector<AsmInst>& out, Register dst, Register src, int32_t factor, Register scratch);
+
+// dst = src / divisor（op为Div）或 src % divisor（op为Rem），按C语义向零取整，
+// INT_MIN / -1和取余的结果与div/rem相同。除数为0时不追加并返回false，保留div/rem的约定。
+// dst可以与src相同，scratch与两者都不同；取余、dst与src相同并且不是2的幂时还要用到spare（与src、scratch不同）
+bool lowerDivide(std::vector<AsmInst>& out, AsmOp op, Register dst, Register src, int32_t divisor,
+                 Register scratch, Register spare);
@@ -4,14 +4,27 @@
 #include <memory>
 #include <vector>
 
+class FrontendChecker;
+
 class Parser {
 public:
-    explicit Parser(const std::string& source);
+    // 所有节点都分配在context中，context需比返回的AST活得更久；
+    // 源缓冲区只在解析期间被引用。checker非空时为融合前端：边解析边做语义检查并给变量编号，
+    // 解析完后不需要再做SemanticAnalyzer::analyze
+    Parser(std::string_view source, ASTContext& context, FrontendChecker* checker = nullptr);
     ASTNodePtr parse();
     
 private:
-    Lexer lexer;
-    Token currentToken;
+    ViewLexer lexer;
+    TokenView currentToken;
+    ASTContext& context;
+    FrontendChecker* checker;
+    // 当前程序点是否可达、各层循环是否有可达的break，与控制流图的可达性一致（常量条件只走一边），
+    // 函数体解析完时可达说明int函数有不return的路径
+    bool reachable = true;
+    std::vector<bool> loopBreaks;
+    const ASTNode* lastCall = nullptr; // 最近解析完的调用和它待定的void调用错误
+    int lastCallPending = -1;
     
     void advance();
     bool match(TokenType type);
@@ -43,6 +56,8 @@ private:
     ASTNodePtr parseFuncCall();
     
     // 辅助函数
-    std::vector<std::pair<std::string, std::string>> parseParams();
+    TypeKind parseType();
+    SymbolId parseIdentifier(const std::string& message);
+    std::vector<Param> parseParams();
     std::vector<ASTNodePtr> parseArgs();
 }; 
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+#include "ir.h"
+#include <memory>
+#include <vector>
+
+// 按RV32IM的语义对二元IR运算求值，除数为0时返回false
+bool evaluateIROp(IROp op, int lhs, int rhs, int& result);
+
+// IR上的函数级优化pass
+class IRPass {
+public:
+    virtual ~IRPass() = default;
+    virtual const char* name() const = 0;
+    // 返回是否修改了函数
+    virtual bool run(IRFunction& func) = 0;
+};
+
+// 按顺序对每个函数运行pass，整条流水线重复执行直到没有pass再做修改（最多maxRounds轮）
+class PassManager {
+public:
+    explicit PassManager(const StringInterner& names, int maxRounds = 4)
+        : names(names), maxRounds(maxRounds) {}
+
+    void add(std::unique_ptr<IRPass> pass);
+    void run(IRModule& module);
+
+    // 每个pass之后做一次IR结构检查
+    void setVerify(bool enabled) { verify = enabled; }
+
+private:
+    const StringInterner& names;
+    int maxRounds;
+    bool verify = false;
+    std::vector<std::unique_ptr<IRPass>> passes;
+};
+
+// 条件为常量的分支改为跳转，删除不可达块，合并直线相连的块，消除平凡φ
+std::unique_ptr<IRPass> createSimplifyCFGPass();
+// 操作数都是常量的指令就地求值，并做简单的代数化简
+std::unique_ptr<IRPass> createConstantFoldPass();
+// 沿支配树的公共子表达式消除
+std::unique_ptr<IRPass> createCSEPass();
+// 删除结果未被使用且没有副作用的指令
+std::unique_ptr<IRPass> createDCEPass();
+// 自尾递归改写成跳回函数开头的循环，形参变成循环头的φ
+std::unique_ptr<IRPass> createTailRecursionPass();
+
+// -O1的默认流水线
+void addDefaultPasses(PassManager& manager);
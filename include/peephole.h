@@ -0,0 +1,32 @@
+#pragma once
+#include "asm.h"
+#include <ostream>
+#include <vector>
+
+struct PeepholeOptions {
+    int window = 4;    // 规则从匹配点向后最多查看的指令条数
+    int maxPasses = 8; // 规则表反复扫描直到不再命中，最多扫这么多遍
+};
+
+// 窥孔优化：在一个函数的结构化指令表上按规则表逐条匹配，删除或改写冗余的指令序列。
+// 规则只在基本块内推理，标签、跳转和调用都会截断窗口；每条规则记录命中次数和删掉的指令数
+class PeepholeOptimizer {
+public:
+    explicit PeepholeOptimizer(PeepholeOptions options = {});
+
+    // 原地优化一段指令表；第一个标签视为函数入口，不会被删除
+    void run(std::vector<AsmInst>& code);
+
+    // 选项相同、统计清零的副本，给并行生成时的各个工作线程用
+    PeepholeOptimizer fork() const { return PeepholeOptimizer(options); }
+    // 把另一个优化器的统计累加进来
+    void merge(const PeepholeOptimizer& other);
+
+    // 按规则输出命中次数和删掉的指令数
+    void printStats(std::ostream& out) const;
+
+private:
+    PeepholeOptions options;
+    std::vector<int> hits;
+    std::vector<int> removed;
+};
@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// 单发射顺序流水线的延迟模型：结果在发射后第几个周期可用。紧跟着使用还没算好的结果时停顿；
+// 除法器不流水，前一条除法算完之前下一条除法不能发射；跳转成功的分支和jal/jalr冲刷流水线
+struct PipelineModel {
+    int loadLatency = 2;
+    int mulLatency = 3;
+    int divLatency = 34;
+    int branchPenalty = 2;
+};
+
+// 有名字的核的延迟表：toycc按它调度指令，toysim按它估计周期
+struct CoreModel {
+    const char* name;
+    const char* description;
+    PipelineModel model;
+};
+
+// 所有内置的延迟表，第一项是默认的generic
+const std::vector<CoreModel>& coreModels();
+// 按名字查延迟表，没有这个名字时抛出异常
+const PipelineModel& findCoreModel(const std::string& name);
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 合成ToyC程序的规模和形状。生成的程序总能通过语义检查，并且一定会结束：
+// 每个函数只在函数体顶层调用一次前面的函数，所有循环共用一个递减的fuel计数，
+// 除数和模数恒为正，运行结果只取决于seed
+struct GeneratorOptions {
+    int functions = 16;  // 除main以外的函数个数
+    int statements = 12; // 每个函数体顶层的语句数
+    int exprDepth = 3;   // 表达式的嵌套深度（每层一对括号）
+    int loopDepth = 1;   // 循环语句中while的嵌套层数，0表示不生成循环
+    int loopNests = 0;   // 每个函数体开头固定生成的循环语句个数（其余语句中也会随机出现循环）
+    uint32_t seed = 1;
+};
+
+// 预设的形状，size按形状解释为函数个数、表达式深度、块长度或循环嵌套层数：
+// functions（大量小函数）、expr（深层嵌套的表达式）、block（很长的函数体）、loops（深层循环嵌套）。
+// 形状名未知时返回false
+bool shapeOptions(const std::string& shape, int size, GeneratorOptions& options);
+const std::vector<std::string>& shapeNames();
+
+std::string generateProgram(const GeneratorOptions& options);
@@ -0,0 +1,33 @@
+#pragma once
+#include "riscv.h"
+#include <vector>
+
+// 一个变量的活跃区间，位置是函数内线性化后的程序点
+struct LiveInterval {
+    int var;                        // 变量编号
+    int start;
+    int end;
+    bool crossesCall = false;       // 区间内有函数调用，只能放在被调用者保存寄存器中
+    Register reg = Register::ZERO;  // 分配结果，ZERO表示溢出到栈
+    Register hint = Register::ZERO; // 偏好的寄存器（如形参所在的参数寄存器），空闲时优先使用
+};
+
+// 线性扫描寄存器分配（Poletto & Sarkar）。
+// 不跨调用的区间优先使用调用者保存寄存器（无需在序言中保存），
+// 跨调用的区间只能使用被调用者保存寄存器；寄存器不够时溢出结束位置最远的区间。
+class LinearScanAllocator {
+public:
+    LinearScanAllocator(std::vector<Register> callerSaved, std::vector<Register> calleeSaved);
+
+    void allocate(std::vector<LiveInterval>& intervals);
+
+    // 本次分配用到的被调用者保存寄存器，需要在序言/尾声中保存恢复
+    const std::vector<Register>& usedCalleeSaved() const { return usedCallee; }
+    int spillCount() const { return spills; }
+
+private:
+    std::vector<Register> callerSaved;
+    std::vector<Register> calleeSaved;
+    std::vector<Register> usedCallee;
+    int spills = 0;
+};
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+
+// RISC-V寄存器，枚举值即硬件编号x0~x31
+enum class Register : uint8_t {
+    ZERO, RA, SP, GP, TP, T0, T1, T2, S0, S1,
+    A0, A1, A2, A3, A4, A5, A6, A7,
+    S2, S3, S4, S5, S6, S7, S8, S9, S10, S11,
+    T3, T4, T5, T6
+};
+
+const char* regName(Register reg);
+
+// 被调用者保存寄存器（s0~s11），其余通用寄存器由调用者保存
+inline bool isCalleeSaved(Register reg) {
+    return reg == Register::S0 || reg == Register::S1 ||
+           (reg >= Register::S2 && reg <= Register::S11);
+}
+
+// 参数寄存器a0~a7
+inline Register argRegister(int index) {
+    return static_cast<Register>(static_cast<int>(Register::A0) + index);
+}
+
+// 能否放进I型指令的12位有符号立即数
+inline bool fitsImm12(int64_t value) {
+    return value >= -2048 && value <= 2047;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "asm.h"
+#include "pipeline.h"
+#include <vector>
+
+struct SchedulerOptions {
+    int maxRegion = 64; // 一个调度区域最多的指令条数，更长的直线代码分段调度
+};
+
+// 基本块内的表调度：按延迟模型在依赖图上重排指令，把load、乘除法和使用它们结果的指令拉开，
+// 让中间填上无关的指令，减少单发射顺序核上的停顿。
+// 寄存器的写后读、读后写、写后写和可能重叠的访存都是依赖边；同一基址寄存器（期间没有被改写）
+// 偏移不同的两个字访问不重叠，其余访存按原顺序。标签、分支、跳转、调用、返回和伪操作是区域边界，
+// 保持原位；注释跟着它后面的指令走。按模型估计重排后不比原来快的区域保持原样
+class InstructionScheduler {
+public:
+    explicit InstructionScheduler(PipelineModel model = PipelineModel(), SchedulerOptions options = {});
+
+    // 原地重排一个函数的指令表。不修改自身，并行生成时各线程可以共用一个调度器
+    void run(std::vector<AsmInst>& code) const;
+
+private:
+    PipelineModel model;
+    SchedulerOptions options;
+};
@@ -1,12 +1,77 @@
 #pragma once
 #include "ast.h"
+#include "symtab.h"
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 class SemanticAnalyzer {
 public:
-    void analyze(const ASTNodePtr& root);
+    // names用于把符号ID还原成诊断信息中的名字
+    explicit SemanticAnalyzer(const StringInterner& names) : names(names) {}
+    // 检查的同时把变量编号写进VarDecl、VarRef、Assign和FunctionDef::varCount。
+    // skipBodies非空时不检查其中标为true的函数（按源码顺序）的函数体，用于从缓存取出的函数；
+    // 函数名、main等全局的检查照常进行
+    void analyze(const ASTNodePtr& root, const std::vector<bool>* skipBodies = nullptr);
 private:
-    std::unordered_map<std::string, std::string> symbolTable;
-    void visit(const ASTNodePtr& node);
-}; 
\ No newline at end of file
+    const StringInterner& names;
+};
+
+// 融合前端的语义检查：语法分析器每建好一个节点就调用对应的检查，与analyze做同样的检查、
+// 同样给变量编号，不再另外遍历AST。语义错误先记下来，解析完后由finish按analyze报告的顺序抛出
+// （函数签名的错误、main的个数、然后是函数体中按遍历顺序的第一个错误），因此诊断与先解析
+// 再analyze完全相同；语法错误照常在解析时立即抛出，也与原来一样优先
+class FrontendChecker {
+public:
+    explicit FrontendChecker(const StringInterner& names) : names(names) {}
+
+    // 函数头解析完：检查函数名和main，进入形参的作用域并给形参编号
+    void beginFunction(TypeKind retType, SymbolId name, const std::vector<Param>& params);
+    // 函数体解析完：fallsOffEnd为函数体末尾是否可达（有不return的路径），返回变量总数
+    uint32_t endFunction(bool fallsOffEnd);
+
+    void enterScope() { symbols.enterScope(); }
+    void leaveScope() { symbols.leaveScope(); }
+    void enterLoop() { ++loopDepth; }
+    void leaveLoop() { --loopDepth; }
+
+    // 变量名解析完、初值解析之前检查重复声明；初值解析完再声明，返回变量编号
+    void checkRedeclaration(SymbolId name);
+    uint32_t declareVar(SymbolId name);
+    // 引用或赋值的变量的编号，未声明时记下错误并返回NoVar
+    uint32_t resolveVar(SymbolId name);
+    void checkReturn(bool hasValue);
+    void checkBreak();
+    void checkDivisor(const BinaryExpr* node);
+    // 函数名解析完、实参解析之前检查调用。调用void函数时先记下待定的错误并返回它的编号，
+    // 这个调用正好是整条表达式语句时用allowVoidCall撤销；其余情况返回-1
+    int checkCall(SymbolId name);
+    // 实参解析完检查个数；函数还没声明时由checkCall记下的错误为准
+    void checkArgumentCount(SymbolId name, size_t count);
+    void allowVoidCall(int pending);
+
+    // 整个程序解析完，有语义错误时抛出
+    void finish();
+
+private:
+    struct Diagnostic {
+        std::string message;
+        SymbolId unknownCall = InvalidSymbol; // 调用还没声明的函数：解析完才知道是未声明还是在声明前调用
+        bool withdrawn = false;
+    };
+
+    const StringInterner& names;
+    ScopedSymbolTable symbols;
+    std::vector<TypeKind> functionTypes; // 按声明顺序
+    std::vector<size_t> paramCounts;     // 按声明顺序
+    TypeKind curRetType = TypeKind::Int;
+    SymbolId curFunc = InvalidSymbol;
+    uint32_t varCount = 0;
+    int loopDepth = 0;
+    int mainCount = 0;
+    std::string signatureError;
+    std::vector<Diagnostic> diagnostics; // 函数体中的错误，只记到第一个确定的为止
+    bool confirmed = false;
+
+    std::string str(SymbolId id) const { return std::string(names.name(id)); }
+    int report(const std::string& message, SymbolId unknownCall = InvalidSymbol, bool pending = false);
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include "encoder.h"
+#include "pipeline.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 可执行的代码映像：.text的机器字和各函数入口（相对.text起点的字节偏移）
+struct CodeImage {
+    std::vector<uint32_t> text;
+    std::unordered_map<std::string, uint32_t> symbols;
+};
+
+// 读入toycc的输出：.o按ELF可重定位文件读.text和符号表，其余按汇编文本汇编。格式不对时抛出异常
+CodeImage loadImage(const std::string& path);
+CodeImage assembleImage(std::string_view assembly);
+CodeImage readObjectImage(std::string_view bytes);
+
+struct SimStats {
+    uint64_t instructions = 0;
+    uint64_t loads = 0;
+    uint64_t stores = 0;
+    uint64_t branches = 0;      // 条件分支
+    uint64_t takenBranches = 0;
+    uint64_t jumps = 0;         // jal、jalr（含调用和返回）
+    uint64_t calls = 0;         // 写ra的jal、jalr
+    uint64_t muls = 0;
+    uint64_t divs = 0;          // div、rem
+    uint64_t cycles = 0;
+    uint64_t loadUseStalls = 0; // 等待load结果的停顿周期
+    uint64_t mulDivStalls = 0;  // 等待乘除结果或除法器的停顿周期
+    uint64_t flushCycles = 0;   // 跳转冲刷流水线的周期
+
+    void print(std::ostream& out) const;
+};
+
+// RV32IM指令集模拟器。代码放在0x10000起，栈从0x80000000向下；返回地址为0，
+// 被调函数返回到0即停止。访问栈以外的内存、不对齐的访问和不认识的指令都抛出异常
+class Simulator {
+public:
+    static constexpr uint32_t TextBase = 0x10000;
+    static constexpr uint32_t StackTop = 0x80000000;
+
+    explicit Simulator(const CodeImage& image, PipelineModel model = PipelineModel(),
+                       uint32_t stackBytes = 8u << 20);
+
+    // 以args为a0~a7调用entry直到它返回，返回a0。执行超过maxInstructions条时抛出异常。
+    // 统计在多次调用之间累加
+    int32_t call(const std::string& entry, const std::vector<int32_t>& args = {},
+                 uint64_t maxInstructions = 1000000000);
+
+    const SimStats& stats() const { return counters; }
+
+private:
+    const CodeImage& image;
+    PipelineModel model;
+    std::vector<MachineInst> decoded;
+    std::vector<bool> valid;
+    std::vector<uint32_t> stack; // 按字存放，stack[0]对应最低地址
+    uint32_t stackBase;
+    SimStats counters;
+
+    uint32_t& word(uint32_t address);
+};
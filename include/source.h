@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+// 只读方式映射的源文件。映射失败（如空文件、管道）时退化为一次性读入内存。
+// 词法单元中的string_view直接指向这块内存，因此它必须比词法/语法分析活得更久。
+class SourceFile {
+public:
+    explicit SourceFile(const std::string& path);
+    ~SourceFile();
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    std::string_view text() const { return std::string_view(data, length); }
+    bool isMapped() const { return mapped; }
+
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::string fallback;
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include "ast.h"
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 编译统计：各阶段的墙钟时间、CPU时间和阶段结束时的进程峰值RSS，以及词法单元、AST节点、
+// 指令、写出字节等计数。按文本表格（-ftime-report、-fstats）或JSON输出
+class CompileStats {
+public:
+    struct Phase {
+        std::string name;
+        double wallMs = 0;
+        double cpuMs = 0;
+        long peakRssKb = 0;
+    };
+
+    // 同名的阶段和计数累加（批量编译时合并各文件）
+    void addPhase(const std::string& name, double wallMs, double cpuMs, long peakRssKb);
+    void add(const std::string& counter, uint64_t value);
+    void merge(const CompileStats& other);
+
+    // 各类AST节点的个数，计数名为ast.<节点类型>
+    void countNodes(const ASTNode* root);
+
+    const std::vector<Phase>& phases() const { return phaseList; }
+    uint64_t counter(const std::string& name) const;
+
+    void printTimeReport(std::ostream& out) const;
+    void printCounters(std::ostream& out) const;
+    void printJSON(std::ostream& out, bool times, bool counters) const;
+
+private:
+    std::vector<Phase> phaseList;
+    std::vector<std::pair<std::string, uint64_t>> counterList; // 按第一次出现的顺序
+};
+
+// 依次相接的阶段计时：next结束当前阶段并开始下一个，stop或析构时结束当前阶段。
+// stats为nullptr时什么都不做。CPU时间和峰值RSS取自整个进程（包括线程池中的线程）
+class PhaseTimer {
+public:
+    PhaseTimer(CompileStats* stats, const char* first);
+    ~PhaseTimer() { stop(); }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    void next(const char* name);
+    void stop();
+
+private:
+    CompileStats* stats;
+    const char* current = nullptr;
+    std::chrono::steady_clock::time_point wallStart;
+    double cpuStart = 0;
+
+    void start(const char* name);
+};
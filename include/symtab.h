@@ -0,0 +1,49 @@
+#pragma once
+#include "ast.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// 按驻留ID直接索引的作用域符号表：每个名字一个表项，记着它当前最内层的变量绑定和同名的函数。
+// 声明变量时把旧绑定记进撤销日志，离开作用域时按日志恢复，查找与嵌套深度无关
+class ScopedSymbolTable {
+public:
+    // 清空并按驻留表的大小分配表项
+    void reset(size_t symbolCount);
+    // 边解析边检查时驻留表还在增长，用到新的ID前先扩充表项
+    void ensure(SymbolId name) {
+        if (name >= entries.size()) entries.resize(std::max<size_t>(name + 1, entries.size() * 2));
+    }
+
+    void enterScope() { marks.push_back(log.size()); }
+    void leaveScope();
+
+    // 在当前作用域声明变量，当前作用域已有同名变量时返回false
+    bool declareVar(SymbolId name, uint32_t var);
+    // 最内层的同名变量，没有时返回NoVar
+    uint32_t lookupVar(SymbolId name) const { return entries[name].var; }
+    bool declaredInCurrentScope(SymbolId name) const {
+        return entries[name].var != NoVar && entries[name].depth == marks.size();
+    }
+
+    // 函数的名字空间与变量分开，不随作用域变化；order为声明顺序，重名时返回false
+    bool declareFunction(SymbolId name, int order);
+    // 没有该函数时返回-1
+    int lookupFunction(SymbolId name) const { return entries[name].function; }
+
+private:
+    struct Entry {
+        uint32_t var = NoVar;
+        uint32_t depth = 0; // 绑定所在作用域的层数
+        int function = -1;
+    };
+    struct Undo {
+        SymbolId name;
+        uint32_t var;
+        uint32_t depth;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<Undo> log;
+    std::vector<size_t> marks; // 各层作用域开始时日志的长度
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 工作窃取线程池。每个线程有自己的任务队列：parallelFor把任务放进调用线程的队列，
+// 线程从自己队列的尾部取任务，空了就从别的队列头部偷。等待一批任务完成时调用线程也执行任务，
+// 所以任务内部可以再调用parallelFor（批量编译时各文件内部再按函数并行）。
+// 结果由调用方按编号存放，因此输出顺序与线程数无关
+class ThreadPool {
+public:
+    // threads为0时取硬件线程数
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(queues.size()); }
+
+    // 对[0, count)的每个编号执行task(index, worker)，worker是执行线程的编号（小于size()，
+    // 池外的调用线程算0号）。同一线程同一时刻只执行一个task，可以按worker分配线程私有的状态。
+    // 全部完成后返回；有任务抛出异常时重新抛出编号最小的那个
+    void parallelFor(size_t count, const std::function<void(size_t, unsigned)>& task);
+
+private:
+    struct Batch {
+        const std::function<void(size_t, unsigned)>* task;
+        std::atomic<size_t> remaining;
+        std::mutex mutex;
+        size_t errorIndex;
+        std::exception_ptr error;
+    };
+    struct Task {
+        Batch* batch;
+        size_t index;
+    };
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues; // 按线程编号
+    std::vector<std::thread> threads;           // 1号及以后的线程；0号是调用线程
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<size_t> queued{0}; // 所有队列中尚未取走的任务数
+    bool stopping = false;
+
+    unsigned currentWorker() const;
+    // 取一个任务执行：先取自己队列的尾部，再偷别的队列的头部；没有任务时返回false
+    bool runOne(unsigned worker);
+    void workerLoop(unsigned worker);
+};
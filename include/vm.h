@@ -0,0 +1,35 @@
+#pragma once
+#include "bytecode.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 字节码虚拟机。所有帧的寄存器在一块连续的int32数组里：被调函数的寄存器窗口从调用者放实参的
+// 寄存器开始，调用时不复制实参；帧栈只记返回地址、调用者的窗口和返回值寄存器。
+// GCC/Clang下用computed goto逐条分派，其余编译器退回switch
+class VM {
+public:
+    explicit VM(const BcModule& module, size_t stackRegisters = 1u << 20, size_t maxFrames = 1u << 20);
+
+    // 以args为实参调用函数，返回它的返回值（void函数返回0）。
+    // 寄存器或帧栈用完、实参个数不对时抛出异常
+    int32_t call(int function, const std::vector<int32_t>& args = {});
+    int32_t call(const std::string& name, const std::vector<int32_t>& args = {});
+
+    // 执行的字节码指令数，在多次调用之间累加
+    uint64_t instructions() const { return executed; }
+
+private:
+    struct Frame {
+        const BcInst* code; // 调用者的第一条指令，跳转目标相对于它
+        const BcInst* returnPc;
+        int32_t* base;
+        uint16_t dest;
+    };
+
+    const BcModule& module;
+    std::vector<int32_t> registers;
+    std::vector<Frame> frames;
+    size_t maxFrames;
+    uint64_t executed = 0;
+};
@@ -0,0 +1,399 @@
+#include "asm.h"
+#include <cctype>
+#include <initializer_list>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+struct AsmOpInfo {
+    const char* name;
+    AsmFormat format;
+};
+
+const AsmOpInfo OP_INFO[] = {
+    {"add", AsmFormat::R},   {"sub", AsmFormat::R},   {"mul", AsmFormat::R},   {"mulh", AsmFormat::R},
+    {"div", AsmFormat::R},   {"rem", AsmFormat::R},   {"xor", AsmFormat::R},   {"slt", AsmFormat::R},
+    {"addi", AsmFormat::I},  {"andi", AsmFormat::I},  {"xori", AsmFormat::I},  {"slti", AsmFormat::I},
+    {"slli", AsmFormat::I},  {"srli", AsmFormat::I},  {"srai", AsmFormat::I},
+    {"lw", AsmFormat::Load}, {"sw", AsmFormat::Store},
+    {"li", AsmFormat::LoadImm},
+    {"mv", AsmFormat::Unary}, {"neg", AsmFormat::Unary}, {"seqz", AsmFormat::Unary}, {"snez", AsmFormat::Unary},
+    {"beq", AsmFormat::Branch}, {"bne", AsmFormat::Branch}, {"blt", AsmFormat::Branch}, {"bge", AsmFormat::Branch},
+    {"beqz", AsmFormat::BranchZero}, {"bnez", AsmFormat::BranchZero},
+    {"j", AsmFormat::Jump}, {"call", AsmFormat::Jump}, {"tail", AsmFormat::Jump},
+    {"ret", AsmFormat::None},
+    {"", AsmFormat::Label}, {"", AsmFormat::Comment}, {"", AsmFormat::Directive},
+    {"", AsmFormat::Nop},
+};
+
+uint32_t rangeMask(Register first, Register last) {
+    uint32_t mask = 0;
+    for (int r = static_cast<int>(first); r <= static_cast<int>(last); ++r) mask |= 1u << r;
+    return mask;
+}
+
+const uint32_t ARG_REGS = rangeMask(Register::A0, Register::A7);
+const uint32_t CALLER_SAVED = regMask(Register::RA) | rangeMask(Register::T0, Register::T2) |
+                              ARG_REGS | rangeMask(Register::T3, Register::T6);
+// 调用者在call之后还要用的寄存器：sp、gp、tp和s0~s11
+const uint32_t PRESERVED = regMask(Register::SP) | regMask(Register::GP) | regMask(Register::TP) |
+                           rangeMask(Register::S0, Register::S1) | rangeMask(Register::S2, Register::S11);
+
+std::string_view trim(std::string_view text) {
+    size_t begin = 0, end = text.size();
+    while (begin < end && std::isspace(static_cast<unsigned char>(text[begin]))) ++begin;
+    while (end > begin && std::isspace(static_cast<unsigned char>(text[end - 1]))) --end;
+    return text.substr(begin, end - begin);
+}
+
+// 逐行解析汇编文本，出错时带上行号抛出异常
+class AsmParser {
+public:
+    explicit AsmParser(int lineNumber) : lineNumber(lineNumber) {}
+
+    AsmInst parseInstruction(std::string_view line) {
+        size_t space = line.find_first_of(" \t");
+        std::string_view mnemonic = line.substr(0, space);
+        if (space != std::string_view::npos) splitOperands(trim(line.substr(space)));
+        AsmInst inst;
+        inst.op = opcode(mnemonic);
+        switch (asmFormat(inst.op)) {
+            case AsmFormat::R:
+                expectCount(3);
+                return AsmInst::binary(inst.op, reg(0), reg(1), reg(2));
+            case AsmFormat::I:
+                expectCount(3);
+                return AsmInst::immediate(inst.op, reg(0), reg(1), imm(operands[2]));
+            case AsmFormat::Load:
+            case AsmFormat::Store: {
+                expectCount(2);
+                // imm(base)
+                std::string_view address = operands[1];
+                size_t open = address.find('(');
+                if (open == std::string_view::npos || address.back() != ')') fail("期望imm(寄存器)形式的地址");
+                int32_t offset = open == 0 ? 0 : imm(address.substr(0, open));
+                Register base = regNamed(address.substr(open + 1, address.size() - open - 2));
+                return AsmInst::memory(inst.op, reg(0), offset, base);
+            }
+            case AsmFormat::LoadImm:
+                expectCount(2);
+                return AsmInst::loadImm(reg(0), imm(operands[1]));
+            case AsmFormat::Unary:
+                expectCount(2);
+                return AsmInst::unary(inst.op, reg(0), reg(1));
+            case AsmFormat::Branch:
+                expectCount(3);
+                return AsmInst::branch(inst.op, reg(0), reg(1), std::string(operands[2]));
+            case AsmFormat::BranchZero:
+                expectCount(2);
+                return AsmInst::branchZero(inst.op, reg(0), std::string(operands[1]));
+            case AsmFormat::Jump:
+                expectCount(1);
+                return AsmInst::jump(inst.op, std::string(operands[0]));
+            case AsmFormat::None:
+                expectCount(0);
+                return AsmInst::ret();
+            default:
+                fail("不认识的指令 " + std::string(mnemonic));
+        }
+    }
+
+private:
+    int lineNumber;
+    std::vector<std::string_view> operands;
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::runtime_error("汇编第" + std::to_string(lineNumber) + "行: " + message);
+    }
+
+    void splitOperands(std::string_view text) {
+        while (!text.empty()) {
+            size_t comma = text.find(',');
+            operands.push_back(trim(text.substr(0, comma)));
+            if (comma == std::string_view::npos) break;
+            text = text.substr(comma + 1);
+        }
+    }
+
+    void expectCount(size_t count) const {
+        if (operands.size() != count) fail("操作数个数应为" + std::to_string(count));
+    }
+
+    AsmOp opcode(std::string_view mnemonic) const {
+        for (int op = 0; op < static_cast<int>(AsmOp::Label); ++op) {
+            if (mnemonic == OP_INFO[op].name) return static_cast<AsmOp>(op);
+        }
+        fail("不认识的指令 " + std::string(mnemonic));
+    }
+
+    Register regNamed(std::string_view name) const {
+        for (int r = 0; r < 32; ++r) {
+            if (name == regName(static_cast<Register>(r))) return static_cast<Register>(r);
+        }
+        if (name == "fp") return Register::S0;
+        if (name.size() >= 2 && name.size() <= 3 && name[0] == 'x' &&
+            name.find_first_not_of("0123456789", 1) == std::string_view::npos) {
+            int number = std::stoi(std::string(name.substr(1)));
+            if (number < 32) return static_cast<Register>(number);
+        }
+        fail("不认识的寄存器 " + std::string(name));
+    }
+
+    Register reg(size_t index) const { return regNamed(operands[index]); }
+
+    int32_t imm(std::string_view text) const {
+        std::string digits(text);
+        size_t used = 0;
+        long long value = 0;
+        try {
+            value = std::stoll(digits, &used, 0);
+        } catch (const std::exception&) {
+            used = 0;
+        }
+        if (used == 0 || used != digits.size() || value < INT32_MIN || value > UINT32_MAX) {
+            fail("不合法的立即数 " + digits);
+        }
+        return static_cast<int32_t>(static_cast<uint32_t>(value));
+    }
+};
+
+} // namespace
+
+AsmInst AsmInst::binary(AsmOp op, Register rd, Register rs1, Register rs2) {
+    AsmInst inst;
+    inst.op = op;
+    inst.rd = rd;
+    inst.rs1 = rs1;
+    inst.rs2 = rs2;
+    return inst;
+}
+
+AsmInst AsmInst::immediate(AsmOp op, Register rd, Register rs1, int32_t imm) {
+    AsmInst inst;
+    inst.op = op;
+    inst.rd = rd;
+    inst.rs1 = rs1;
+    inst.imm = imm;
+    return inst;
+}
+
+AsmInst AsmInst::memory(AsmOp op, Register reg, int32_t offset, Register base) {
+    AsmInst inst;
+    inst.op = op;
+    (op == AsmOp::Sw ? inst.rs2 : inst.rd) = reg;
+    inst.rs1 = base;
+    inst.imm = offset;
+    return inst;
+}
+
+AsmInst AsmInst::loadImm(Register rd, int32_t imm) {
+    AsmInst inst;
+    inst.op = AsmOp::Li;
+    inst.rd = rd;
+    inst.imm = imm;
+    return inst;
+}
+
+AsmInst AsmInst::unary(AsmOp op, Register rd, Register rs) {
+    AsmInst inst;
+    inst.op = op;
+    inst.rd = rd;
+    inst.rs1 = rs;
+    return inst;
+}
+
+AsmInst AsmInst::branch(AsmOp op, Register rs1, Register rs2, std::string target) {
+    AsmInst inst;
+    inst.op = op;
+    inst.rs1 = rs1;
+    inst.rs2 = rs2;
+    inst.text = std::move(target);
+    return inst;
+}
+
+AsmInst AsmInst::branchZero(AsmOp op, Register rs, std::string target) {
+    AsmInst inst;
+    inst.op = op;
+    inst.rs1 = rs;
+    inst.text = std::move(target);
+    return inst;
+}
+
+AsmInst AsmInst::jump(AsmOp op, std::string target) {
+    AsmInst inst;
+    inst.op = op;
+    inst.text = std::move(target);
+    return inst;
+}
+
+AsmInst AsmInst::ret() {
+    AsmInst inst;
+    inst.op = AsmOp::Ret;
+    return inst;
+}
+
+AsmInst AsmInst::label(std::string name) {
+    AsmInst inst;
+    inst.op = AsmOp::Label;
+    inst.text = std::move(name);
+    return inst;
+}
+
+AsmInst AsmInst::comment(std::string text) {
+    AsmInst inst;
+    inst.op = AsmOp::Comment;
+    inst.text = std::move(text);
+    return inst;
+}
+
+AsmInst AsmInst::directive(std::string text) {
+    AsmInst inst;
+    inst.op = AsmOp::Directive;
+    inst.text = std::move(text);
+    return inst;
+}
+
+const char* asmOpName(AsmOp op) {
+    return OP_INFO[static_cast<int>(op)].name;
+}
+
+AsmFormat asmFormat(AsmOp op) {
+    return OP_INFO[static_cast<int>(op)].format;
+}
+
+AsmOp invertBranch(AsmOp op) {
+    switch (op) {
+        case AsmOp::Beq: return AsmOp::Bne;
+        case AsmOp::Bne: return AsmOp::Beq;
+        case AsmOp::Blt: return AsmOp::Bge;
+        case AsmOp::Bge: return AsmOp::Blt;
+        case AsmOp::Beqz: return AsmOp::Bnez;
+        case AsmOp::Bnez: return AsmOp::Beqz;
+        default: return op;
+    }
+}
+
+uint32_t regsRead(const AsmInst& inst) {
+    switch (asmFormat(inst.op)) {
+        case AsmFormat::R:
+        case AsmFormat::Store:
+        case AsmFormat::Branch:
+            return regMask(inst.rs1) | regMask(inst.rs2);
+        case AsmFormat::I:
+        case AsmFormat::Load:
+        case AsmFormat::Unary:
+        case AsmFormat::BranchZero:
+            return regMask(inst.rs1);
+        case AsmFormat::Jump:
+            if (inst.op == AsmOp::Call) return ARG_REGS | regMask(Register::SP);
+            if (inst.op == AsmOp::Tail) return ARG_REGS | regMask(Register::RA) | PRESERVED;
+            return 0;
+        case AsmFormat::None:
+            return regMask(Register::A0) | regMask(Register::A1) | regMask(Register::RA) | PRESERVED;
+        default:
+            return 0;
+    }
+}
+
+uint32_t regsWritten(const AsmInst& inst) {
+    switch (asmFormat(inst.op)) {
+        case AsmFormat::R:
+        case AsmFormat::I:
+        case AsmFormat::Load:
+        case AsmFormat::LoadImm:
+        case AsmFormat::Unary:
+            return regMask(inst.rd);
+        case AsmFormat::Jump:
+            return inst.op == AsmOp::Call ? CALLER_SAVED : 0;
+        default:
+            return 0;
+    }
+}
+
+void appendAsm(std::string& out, const AsmInst& inst) {
+    const char* name = asmOpName(inst.op);
+    auto line = [&](std::initializer_list<std::string_view> parts) {
+        out += "    ";
+        out += name;
+        for (std::string_view part : parts) out += part;
+        out += '\n';
+    };
+    auto reg = [](Register r) { return std::string_view(regName(r)); };
+    switch (asmFormat(inst.op)) {
+        case AsmFormat::R:
+            line({" ", reg(inst.rd), ", ", reg(inst.rs1), ", ", reg(inst.rs2)});
+            break;
+        case AsmFormat::I:
+            line({" ", reg(inst.rd), ", ", reg(inst.rs1), ", ", std::to_string(inst.imm)});
+            break;
+        case AsmFormat::Load:
+            line({" ", reg(inst.rd), ", ", std::to_string(inst.imm), "(", reg(inst.rs1), ")"});
+            break;
+        case AsmFormat::Store:
+            line({" ", reg(inst.rs2), ", ", std::to_string(inst.imm), "(", reg(inst.rs1), ")"});
+            break;
+        case AsmFormat::LoadImm:
+            line({" ", reg(inst.rd), ", ", std::to_string(inst.imm)});
+            break;
+        case AsmFormat::Unary:
+            line({" ", reg(inst.rd), ", ", reg(inst.rs1)});
+            break;
+        case AsmFormat::Branch:
+            line({" ", reg(inst.rs1), ", ", reg(inst.rs2), ", ", inst.text});
+            break;
+        case AsmFormat::BranchZero:
+            line({" ", reg(inst.rs1), ", ", inst.text});
+            break;
+        case AsmFormat::Jump:
+            line({" ", inst.text});
+            break;
+        case AsmFormat::None:
+            line({});
+            break;
+        case AsmFormat::Label:
+            out += inst.text;
+            out += ":\n";
+            break;
+        case AsmFormat::Comment:
+            out += "    # ";
+            out += inst.text;
+            out += '\n';
+            break;
+        case AsmFormat::Directive:
+            out += "    ";
+            out += inst.text;
+            out += '\n';
+            break;
+        case AsmFormat::Nop:
+            break;
+    }
+}
+
+std::vector<AsmInst> parseAsm(std::string_view text) {
+    std::vector<AsmInst> code;
+    int lineNumber = 0;
+    while (!text.empty()) {
+        size_t newline = text.find('\n');
+        std::string_view line = text.substr(0, newline);
+        text = newline == std::string_view::npos ? std::string_view() : text.substr(newline + 1);
+        ++lineNumber;
+
+        line = trim(line);
+        if (line.empty()) continue;
+        if (line[0] == '#') {
+            code.push_back(AsmInst::comment(std::string(trim(line.substr(1)))));
+            continue;
+        }
+        // 行尾注释
+        line = trim(line.substr(0, line.find('#')));
+        if (line.back() == ':') {
+            code.push_back(AsmInst::label(std::string(trim(line.substr(0, line.size() - 1)))));
+        } else if (line[0] == '.') {
+            code.push_back(AsmInst::directive(std::string(line)));
+        } else {
+            code.push_back(AsmParser(lineNumber).parseInstruction(line));
+        }
+    }
+    return code;
+}
@@ -1,2 +1,71 @@
 #include "ast.h"
-// TODO
\ No newline at end of file
+
+const char* nodeKindName(NodeKind kind) {
+    switch (kind) {
+        case NodeKind::Program: return "Program";
+        case NodeKind::FunctionDef: return "FunctionDef";
+        case NodeKind::Block: return "Block";
+        case NodeKind::VarDecl: return "VarDecl";
+        case NodeKind::Assign: return "Assign";
+        case NodeKind::IfStmt: return "IfStmt";
+        case NodeKind::WhileStmt: return "WhileStmt";
+        case NodeKind::BreakStmt: return "BreakStmt";
+        case NodeKind::ContinueStmt: return "ContinueStmt";
+        case NodeKind::ReturnStmt: return "ReturnStmt";
+        case NodeKind::ExprStmt: return "ExprStmt";
+        case NodeKind::BinaryExpr: return "BinaryExpr";
+        case NodeKind::UnaryExpr: return "UnaryExpr";
+        case NodeKind::IntLiteral: return "IntLiteral";
+        case NodeKind::VarRef: return "VarRef";
+        case NodeKind::FuncCall: return "FuncCall";
+    }
+    return "?";
+}
+
+const char* typeName(TypeKind type) {
+    switch (type) {
+        case TypeKind::Int: return "int";
+        case TypeKind::Void: return "void";
+    }
+    return "?";
+}
+
+const char* binOpSpelling(BinOp op) {
+    switch (op) {
+        case BinOp::Add: return "+";
+        case BinOp::Sub: return "-";
+        case BinOp::Mul: return "*";
+        case BinOp::Div: return "/";
+        case BinOp::Mod: return "%";
+        case BinOp::Lt: return "<";
+        case BinOp::Le: return "<=";
+        case BinOp::Gt: return ">";
+        case BinOp::Ge: return ">=";
+        case BinOp::Eq: return "==";
+        case BinOp::Ne: return "!=";
+        case BinOp::And: return "&&";
+        case BinOp::Or: return "||";
+    }
+    return "?";
+}
+
+const char* unOpSpelling(UnOp op) {
+    switch (op) {
+        case UnOp::Plus: return "+";
+        case UnOp::Neg: return "-";
+        case UnOp::Not: return "!";
+    }
+    return "?";
+}
+
+bool hasCall(const ASTNode* node) {
+    switch (node->kind) {
+        case NodeKind::FuncCall: return true;
+        case NodeKind::BinaryExpr: {
+            auto bin = static_cast<const BinaryExpr*>(node);
+            return hasCall(bin->lhs) || hasCall(bin->rhs);
+        }
+        case NodeKind::UnaryExpr: return hasCall(static_cast<const UnaryExpr*>(node)->expr);
+        default: return false;
+    }
+}
@@ -0,0 +1,368 @@
+#include "bytecode.h"
+#include <iomanip>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+// 一个函数的字节码生成。寄存器按栈的方式分配：进入块时记下栈顶，离开时退回；
+// 表达式的临时值在栈顶之上，求完值就释放
+class FunctionCompiler {
+public:
+    FunctionCompiler(BcFunction& function, const std::unordered_map<SymbolId, int>& functionIndex)
+        : function(function), functionIndex(functionIndex) {}
+
+    void compile(const FunctionDef* func) {
+        function.params = static_cast<int>(func->params.size());
+        function.returnsValue = func->retType == TypeKind::Int;
+        varRegister.assign(func->varCount, 0);
+        for (size_t i = 0; i < func->params.size(); ++i) varRegister[i] = allocate();
+        statement(func->body);
+        // int函数按语义检查不会走到这里
+        emit({BcOp::ReturnVoid});
+    }
+
+private:
+    struct Loop {
+        std::vector<size_t> breaks;
+        std::vector<size_t> continues;
+    };
+
+    BcFunction& function;
+    const std::unordered_map<SymbolId, int>& functionIndex;
+    std::vector<uint16_t> varRegister; // 按语义分析给的变量编号索引
+    int top = 0;                       // 下一个空闲寄存器
+    std::vector<Loop> loops;
+
+    uint16_t allocate() {
+        if (top > UINT16_MAX) throw std::runtime_error("字节码: 函数" + function.name + "的寄存器超过65535个");
+        function.registers = std::max(function.registers, top + 1);
+        return static_cast<uint16_t>(top++);
+    }
+
+    size_t emit(BcInst inst) {
+        function.code.push_back(inst);
+        return function.code.size() - 1;
+    }
+
+    size_t here() const { return function.code.size(); }
+
+    void patch(const std::vector<size_t>& jumps, size_t target) {
+        for (size_t jump : jumps) function.code[jump].k = static_cast<int32_t>(target);
+    }
+
+    void statement(const ASTNode* node) {
+        if (!node) return;
+        switch (node->kind) {
+            case NodeKind::Block: {
+                int saved = top;
+                for (auto stmt : static_cast<const Block*>(node)->stmts) statement(stmt);
+                top = saved;
+                break;
+            }
+            case NodeKind::VarDecl: {
+                auto decl = static_cast<const VarDecl*>(node);
+                uint16_t reg = allocate();
+                if (decl->initExpr) {
+                    valueInto(decl->initExpr, reg);
+                } else {
+                    emit({BcOp::LoadK, reg});
+                }
+                varRegister[decl->var] = reg;
+                break;
+            }
+            case NodeKind::Assign: {
+                auto assign = static_cast<const Assign*>(node);
+                valueInto(assign->expr, varRegister[assign->var]);
+                break;
+            }
+            case NodeKind::IfStmt: {
+                auto ifs = static_cast<const IfStmt*>(node);
+                std::vector<size_t> elseJumps;
+                condition(ifs->cond, false, elseJumps);
+                statement(ifs->thenStmt);
+                if (ifs->elseStmt) {
+                    size_t end = emit({BcOp::Jump});
+                    patch(elseJumps, here());
+                    statement(ifs->elseStmt);
+                    patch({end}, here());
+                } else {
+                    patch(elseJumps, here());
+                }
+                break;
+            }
+            case NodeKind::WhileStmt: {
+                // 条件放在循环体后面，每次迭代只执行一条条件跳转
+                auto wh = static_cast<const WhileStmt*>(node);
+                size_t entry = emit({BcOp::Jump});
+                size_t body = here();
+                loops.emplace_back();
+                statement(wh->body);
+                size_t test = here();
+                patch({entry}, test);
+                std::vector<size_t> again;
+                condition(wh->cond, true, again);
+                patch(again, body);
+                patch(loops.back().continues, test);
+                patch(loops.back().breaks, here());
+                loops.pop_back();
+                break;
+            }
+            case NodeKind::BreakStmt:
+                loops.back().breaks.push_back(emit({BcOp::Jump}));
+                break;
+            case NodeKind::ContinueStmt:
+                loops.back().continues.push_back(emit({BcOp::Jump}));
+                break;
+            case NodeKind::ReturnStmt: {
+                auto ret = static_cast<const ReturnStmt*>(node);
+                if (!ret->expr) {
+                    emit({BcOp::ReturnVoid});
+                    break;
+                }
+                int saved = top;
+                emit({BcOp::Return, value(ret->expr)});
+                top = saved;
+                break;
+            }
+            case NodeKind::ExprStmt: {
+                auto expr = static_cast<const ExprStmt*>(node)->expr;
+                if (!expr) break;
+                int saved = top;
+                // 只为副作用求值，void函数的调用也走这里
+                if (auto call = as<FuncCall>(expr)) {
+                    callInto(call, allocate());
+                } else {
+                    value(expr);
+                }
+                top = saved;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // 表达式的值所在的寄存器：变量直接用它自己的寄存器，其余放进新的临时寄存器
+    uint16_t value(const ASTNode* node) {
+        if (auto ref = as<VarRef>(node)) return varRegister[ref->var];
+        uint16_t reg = allocate();
+        valueInto(node, reg);
+        return reg;
+    }
+
+    void valueInto(const ASTNode* node, uint16_t dest) {
+        int saved = top;
+        switch (node->kind) {
+            case NodeKind::IntLiteral:
+                emit({BcOp::LoadK, dest, 0, 0, static_cast<const IntLiteral*>(node)->value});
+                break;
+            case NodeKind::VarRef: {
+                uint16_t reg = varRegister[static_cast<const VarRef*>(node)->var];
+                if (reg != dest) emit({BcOp::Move, dest, reg});
+                break;
+            }
+            case NodeKind::UnaryExpr: {
+                auto un = static_cast<const UnaryExpr*>(node);
+                if (un->op == UnOp::Plus) {
+                    valueInto(un->expr, dest);
+                    break;
+                }
+                uint16_t operand = value(un->expr);
+                emit({un->op == UnOp::Neg ? BcOp::Neg : BcOp::Not, dest, operand});
+                break;
+            }
+            case NodeKind::BinaryExpr:
+                binaryInto(static_cast<const BinaryExpr*>(node), dest);
+                break;
+            case NodeKind::FuncCall:
+                callInto(static_cast<const FuncCall*>(node), dest);
+                break;
+            default:
+                throw std::runtime_error("字节码: 不是表达式");
+        }
+        top = saved;
+    }
+
+    void binaryInto(const BinaryExpr* bin, uint16_t dest) {
+        if (bin->op == BinOp::And || bin->op == BinOp::Or) {
+            std::vector<size_t> falseJumps;
+            condition(bin, false, falseJumps);
+            emit({BcOp::LoadK, dest, 0, 0, 1});
+            size_t end = emit({BcOp::Jump});
+            patch(falseJumps, here());
+            emit({BcOp::LoadK, dest, 0, 0, 0});
+            patch({end}, here());
+            return;
+        }
+        // x + 常量、x - 常量不占寄存器
+        auto literal = as<IntLiteral>(bin->rhs);
+        if (literal && (bin->op == BinOp::Add || bin->op == BinOp::Sub)) {
+            uint32_t k = static_cast<uint32_t>(literal->value);
+            if (bin->op == BinOp::Sub) k = 0u - k;
+            emit({BcOp::AddK, dest, value(bin->lhs), 0, static_cast<int32_t>(k)});
+            return;
+        }
+        uint16_t lhs = value(bin->lhs);
+        uint16_t rhs = value(bin->rhs);
+        switch (bin->op) {
+            case BinOp::Add: emit({BcOp::Add, dest, lhs, rhs}); break;
+            case BinOp::Sub: emit({BcOp::Sub, dest, lhs, rhs}); break;
+            case BinOp::Mul: emit({BcOp::Mul, dest, lhs, rhs}); break;
+            case BinOp::Div: emit({BcOp::Div, dest, lhs, rhs}); break;
+            case BinOp::Mod: emit({BcOp::Mod, dest, lhs, rhs}); break;
+            case BinOp::Lt: emit({BcOp::Lt, dest, lhs, rhs}); break;
+            case BinOp::Le: emit({BcOp::Le, dest, lhs, rhs}); break;
+            case BinOp::Gt: emit({BcOp::Lt, dest, rhs, lhs}); break;
+            case BinOp::Ge: emit({BcOp::Le, dest, rhs, lhs}); break;
+            case BinOp::Eq: emit({BcOp::Eq, dest, lhs, rhs}); break;
+            case BinOp::Ne: emit({BcOp::Ne, dest, lhs, rhs}); break;
+            default: break;
+        }
+    }
+
+    // 实参依次放进栈顶的连续寄存器，这些寄存器就是被调函数的形参
+    void callInto(const FuncCall* call, uint16_t dest) {
+        int saved = top;
+        uint16_t base = static_cast<uint16_t>(top);
+        for (auto arg : call->args) valueInto(arg, allocate());
+        emit({BcOp::Call, dest, base, static_cast<uint16_t>(call->args.size()), functionIndex.at(call->name)});
+        top = saved;
+    }
+
+    // cond的真值等于jumpIf时跳转，跳转指令记在jumps里等待回填；比较直接编成比较跳转，&&和||短路
+    void condition(const ASTNode* cond, bool jumpIf, std::vector<size_t>& jumps) {
+        int saved = top;
+        if (auto literal = as<IntLiteral>(cond)) {
+            if ((literal->value != 0) == jumpIf) jumps.push_back(emit({BcOp::Jump}));
+            return;
+        }
+        if (auto un = as<UnaryExpr>(cond); un && un->op == UnOp::Not) {
+            condition(un->expr, !jumpIf, jumps);
+            return;
+        }
+        if (auto bin = as<BinaryExpr>(cond)) {
+            if (bin->op == BinOp::And || bin->op == BinOp::Or) {
+                // a && b为假、a || b为真时只看一边就能跳
+                bool shortCircuit = bin->op == BinOp::Or;
+                if (jumpIf == shortCircuit) {
+                    condition(bin->lhs, jumpIf, jumps);
+                    condition(bin->rhs, jumpIf, jumps);
+                } else {
+                    std::vector<size_t> skip;
+                    condition(bin->lhs, !jumpIf, skip);
+                    condition(bin->rhs, jumpIf, jumps);
+                    patch(skip, here());
+                }
+                return;
+            }
+            BinOp op = bin->op;
+            bool compare = op == BinOp::Lt || op == BinOp::Le || op == BinOp::Gt || op == BinOp::Ge ||
+                           op == BinOp::Eq || op == BinOp::Ne;
+            if (compare) {
+                // 与0比较相等或不等时用一条jz/jnz
+                bool equality = op == BinOp::Eq || op == BinOp::Ne;
+                auto rhsLiteral = as<IntLiteral>(bin->rhs);
+                if (equality && rhsLiteral && rhsLiteral->value == 0) {
+                    uint16_t reg = value(bin->lhs);
+                    top = saved;
+                    bool zero = (op == BinOp::Eq) == jumpIf;
+                    jumps.push_back(emit({zero ? BcOp::JumpIfZero : BcOp::JumpIfNonZero, reg}));
+                    return;
+                }
+                uint16_t lhs = value(bin->lhs);
+                uint16_t rhs = value(bin->rhs);
+                top = saved;
+                if (!jumpIf) {
+                    // 取反：a < b为假即b <= a
+                    switch (op) {
+                        case BinOp::Lt: op = BinOp::Ge; break;
+                        case BinOp::Le: op = BinOp::Gt; break;
+                        case BinOp::Gt: op = BinOp::Le; break;
+                        case BinOp::Ge: op = BinOp::Lt; break;
+                        case BinOp::Eq: op = BinOp::Ne; break;
+                        default: op = BinOp::Eq; break;
+                    }
+                }
+                switch (op) {
+                    case BinOp::Lt: jumps.push_back(emit({BcOp::JumpIfLt, lhs, rhs})); break;
+                    case BinOp::Le: jumps.push_back(emit({BcOp::JumpIfLe, lhs, rhs})); break;
+                    case BinOp::Gt: jumps.push_back(emit({BcOp::JumpIfLt, rhs, lhs})); break;
+                    case BinOp::Ge: jumps.push_back(emit({BcOp::JumpIfLe, rhs, lhs})); break;
+                    case BinOp::Eq: jumps.push_back(emit({BcOp::JumpIfEq, lhs, rhs})); break;
+                    default: jumps.push_back(emit({BcOp::JumpIfNe, lhs, rhs})); break;
+                }
+                return;
+            }
+        }
+        uint16_t reg = value(cond);
+        top = saved;
+        jumps.push_back(emit({jumpIf ? BcOp::JumpIfNonZero : BcOp::JumpIfZero, reg}));
+    }
+};
+
+const char* opName(BcOp op) {
+    static const char* const names[] = {
+        "loadk", "move", "add", "sub", "mul", "div", "mod", "lt", "le", "eq", "ne", "addk", "neg", "not",
+        "jump", "jz", "jnz", "jlt", "jle", "jeq", "jne", "call", "ret", "retvoid",
+    };
+    return names[static_cast<int>(op)];
+}
+
+} // namespace
+
+int BcModule::find(const std::string& name) const {
+    for (size_t i = 0; i < functions.size(); ++i) {
+        if (functions[i].name == name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+BcModule compileBytecode(const ASTNodePtr& root, const StringInterner& names) {
+    auto program = as<Program>(root);
+    if (!program) throw std::runtime_error("字节码: AST根节点不是Program");
+    BcModule module;
+    std::unordered_map<SymbolId, int> functionIndex;
+    for (auto f : program->functions) {
+        auto func = static_cast<const FunctionDef*>(f);
+        functionIndex[func->name] = static_cast<int>(module.functions.size());
+        module.functions.emplace_back();
+        module.functions.back().name = std::string(names.name(func->name));
+    }
+    for (size_t i = 0; i < program->functions.size(); ++i) {
+        FunctionCompiler compiler(module.functions[i], functionIndex);
+        compiler.compile(static_cast<const FunctionDef*>(program->functions[i]));
+    }
+    return module;
+}
+
+void printBytecode(std::ostream& out, const BcModule& module) {
+    for (size_t f = 0; f < module.functions.size(); ++f) {
+        const BcFunction& function = module.functions[f];
+        out << "function " << f << " " << function.name << " (形参" << function.params << "个, 寄存器"
+            << function.registers << "个)\n";
+        for (size_t i = 0; i < function.code.size(); ++i) {
+            const BcInst& inst = function.code[i];
+            out << "  " << std::setw(5) << i << "  " << std::left << std::setw(8) << opName(inst.op) << std::right;
+            auto r = [](uint16_t reg) { return "r" + std::to_string(reg); };
+            switch (inst.op) {
+                case BcOp::LoadK: out << r(inst.a) << ", " << inst.k; break;
+                case BcOp::Move: case BcOp::Neg: case BcOp::Not: out << r(inst.a) << ", " << r(inst.b); break;
+                case BcOp::AddK: out << r(inst.a) << ", " << r(inst.b) << ", " << inst.k; break;
+                case BcOp::Jump: out << inst.k; break;
+                case BcOp::JumpIfZero: case BcOp::JumpIfNonZero: out << r(inst.a) << ", " << inst.k; break;
+                case BcOp::JumpIfLt: case BcOp::JumpIfLe: case BcOp::JumpIfEq: case BcOp::JumpIfNe:
+                    out << r(inst.a) << ", " << r(inst.b) << ", " << inst.k;
+                    break;
+                case BcOp::Call:
+                    out << r(inst.a) << ", " << module.functions[inst.k].name << "(" << r(inst.b) << ".."
+                        << inst.c << "个)";
+                    break;
+                case BcOp::Return: out << r(inst.a); break;
+                case BcOp::ReturnVoid: break;
+                default: out << r(inst.a) << ", " << r(inst.b) << ", " << r(inst.c); break;
+            }
+            out << "\n";
+        }
+    }
+}
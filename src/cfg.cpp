@@ -0,0 +1,526 @@
+#include "cfg.h"
+#include "constfold.h"
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+
+namespace {
+
+using Bits = std::vector<uint64_t>;
+
+void addUses(const ASTNode* node, Bits& live) {
+    if (!node) return;
+    switch (node->kind) {
+        case NodeKind::VarRef: {
+            uint32_t var = static_cast<const VarRef*>(node)->var;
+            if (var != NoVar) live[var / 64] |= uint64_t(1) << (var % 64);
+            break;
+        }
+        case NodeKind::BinaryExpr: {
+            auto bin = static_cast<const BinaryExpr*>(node);
+            addUses(bin->lhs, live);
+            addUses(bin->rhs, live);
+            break;
+        }
+        case NodeKind::UnaryExpr:
+            addUses(static_cast<const UnaryExpr*>(node)->expr, live);
+            break;
+        case NodeKind::FuncCall:
+            for (auto arg : static_cast<const FuncCall*>(node)->args) addUses(arg, live);
+            break;
+        default:
+            break;
+    }
+}
+
+// 按求值顺序列出表达式读到的变量
+void collectUses(const ASTNode* node, std::vector<uint32_t>& out) {
+    if (!node) return;
+    switch (node->kind) {
+        case NodeKind::VarRef: {
+            uint32_t var = static_cast<const VarRef*>(node)->var;
+            if (var != NoVar) out.push_back(var);
+            break;
+        }
+        case NodeKind::BinaryExpr: {
+            auto bin = static_cast<const BinaryExpr*>(node);
+            collectUses(bin->lhs, out);
+            collectUses(bin->rhs, out);
+            break;
+        }
+        case NodeKind::UnaryExpr:
+            collectUses(static_cast<const UnaryExpr*>(node)->expr, out);
+            break;
+        case NodeKind::FuncCall:
+            for (auto arg : static_cast<const FuncCall*>(node)->args) collectUses(arg, out);
+            break;
+        default:
+            break;
+    }
+}
+
+// 赋值和带初值的声明写入的变量编号和右边的表达式；其他语句返回false
+bool storeOf(const ASTNode* stmt, uint32_t& var, const ASTNode*& value) {
+    if (auto assign = as<Assign>(stmt)) {
+        var = assign->var;
+        value = assign->expr;
+        return var != NoVar;
+    }
+    if (auto decl = as<VarDecl>(stmt); decl && decl->initExpr) {
+        var = decl->var;
+        value = decl->initExpr;
+        return var != NoVar;
+    }
+    return false;
+}
+
+void printExpr(std::ostream& out, const ASTNode* node, const StringInterner& names) {
+    switch (node->kind) {
+        case NodeKind::IntLiteral: out << static_cast<const IntLiteral*>(node)->value; break;
+        case NodeKind::VarRef: out << names.name(static_cast<const VarRef*>(node)->name); break;
+        case NodeKind::UnaryExpr: {
+            auto un = static_cast<const UnaryExpr*>(node);
+            out << unOpSpelling(un->op);
+            printExpr(out, un->expr, names);
+            break;
+        }
+        case NodeKind::BinaryExpr: {
+            auto bin = static_cast<const BinaryExpr*>(node);
+            out << "(";
+            printExpr(out, bin->lhs, names);
+            out << " " << binOpSpelling(bin->op) << " ";
+            printExpr(out, bin->rhs, names);
+            out << ")";
+            break;
+        }
+        case NodeKind::FuncCall: {
+            auto call = static_cast<const FuncCall*>(node);
+            out << names.name(call->name) << "(";
+            for (size_t i = 0; i < call->args.size(); ++i) {
+                if (i) out << ", ";
+                printExpr(out, call->args[i], names);
+            }
+            out << ")";
+            break;
+        }
+        default:
+            out << nodeKindName(node->kind);
+            break;
+    }
+}
+
+void printStmt(std::ostream& out, const ASTNode* stmt, const StringInterner& names) {
+    switch (stmt->kind) {
+        case NodeKind::VarDecl: {
+            auto decl = static_cast<const VarDecl*>(stmt);
+            out << "int " << names.name(decl->name);
+            if (decl->initExpr) {
+                out << " = ";
+                printExpr(out, decl->initExpr, names);
+            }
+            break;
+        }
+        case NodeKind::Assign: {
+            auto assign = static_cast<const Assign*>(stmt);
+            out << names.name(assign->name) << " = ";
+            printExpr(out, assign->expr, names);
+            break;
+        }
+        case NodeKind::ReturnStmt: {
+            auto ret = static_cast<const ReturnStmt*>(stmt);
+            out << "return";
+            if (ret->expr) {
+                out << " ";
+                printExpr(out, ret->expr, names);
+            }
+            break;
+        }
+        case NodeKind::ExprStmt:
+            if (auto expr = static_cast<const ExprStmt*>(stmt)->expr) printExpr(out, expr, names);
+            break;
+        default:
+            out << nodeKindName(stmt->kind);
+            break;
+    }
+}
+
+// DOT标签中的引号和反斜杠需要转义
+std::string escapeLabel(const std::string& text) {
+    std::string result;
+    for (char c : text) {
+        if (c == '"' || c == '\\') result += '\\';
+        result += c;
+    }
+    return result;
+}
+
+} // namespace
+
+bool constantCondition(const ASTNode* expr, int& value) {
+    switch (expr->kind) {
+        case NodeKind::IntLiteral:
+            value = static_cast<const IntLiteral*>(expr)->value;
+            return true;
+        case NodeKind::UnaryExpr: {
+            auto un = static_cast<const UnaryExpr*>(expr);
+            int operand;
+            if (!constantCondition(un->expr, operand)) return false;
+            if (un->op == UnOp::Neg) value = static_cast<int>(0u - static_cast<uint32_t>(operand));
+            else if (un->op == UnOp::Not) value = !operand;
+            else value = operand;
+            return true;
+        }
+        case NodeKind::BinaryExpr: {
+            auto bin = static_cast<const BinaryExpr*>(expr);
+            int lhs, rhs;
+            if (!constantCondition(bin->lhs, lhs)) return false;
+            if (bin->op == BinOp::And || bin->op == BinOp::Or) {
+                // 左操作数已经决定结果时右操作数不求值
+                bool isAnd = bin->op == BinOp::And;
+                if ((lhs != 0) != isAnd) {
+                    value = isAnd ? 0 : 1;
+                    return true;
+                }
+                if (!constantCondition(bin->rhs, rhs)) return false;
+                value = rhs != 0;
+                return true;
+            }
+            return constantCondition(bin->rhs, rhs) && evaluateBinOp(bin->op, lhs, rhs, value);
+        }
+        default:
+            return false;
+    }
+}
+
+ControlFlowGraph::ControlFlowGraph(const FunctionDef* func) : func(func) {
+    newBlock(); // Entry
+    newBlock(); // Exit
+    build(func->body);
+    fallthrough = current;
+    addEdge(current, Exit);
+
+    live.assign(graph.size(), false);
+    std::vector<int> stack{Entry};
+    live[Entry] = true;
+    while (!stack.empty()) {
+        int block = stack.back();
+        stack.pop_back();
+        for (int succ : graph[block].succs) {
+            if (!live[succ]) {
+                live[succ] = true;
+                stack.push_back(succ);
+            }
+        }
+    }
+}
+
+int ControlFlowGraph::newBlock() {
+    int id = static_cast<int>(graph.size());
+    graph.push_back(CFGBlock{id, {}, nullptr, {}, {}});
+    return id;
+}
+
+void ControlFlowGraph::addEdge(int from, int to) {
+    graph[from].succs.push_back(to);
+    graph[to].preds.push_back(from);
+}
+
+void ControlFlowGraph::build(const ASTNode* stmt) {
+    if (!stmt) return;
+    int entry = current;
+    switch (stmt->kind) {
+        case NodeKind::Block:
+            for (auto child : static_cast<const Block*>(stmt)->stmts) build(child);
+            break;
+        case NodeKind::ReturnStmt:
+            graph[current].stmts.push_back(stmt);
+            addEdge(current, Exit);
+            current = newBlock();
+            break;
+        case NodeKind::BreakStmt:
+        case NodeKind::ContinueStmt:
+            // 语义分析保证只出现在循环里
+            if (!loops.empty()) {
+                addEdge(current, stmt->kind == NodeKind::BreakStmt ? loops.back().exit : loops.back().header);
+            }
+            current = newBlock();
+            break;
+        case NodeKind::IfStmt: {
+            auto ifs = static_cast<const IfStmt*>(stmt);
+            int value = 0;
+            bool constant = constantCondition(ifs->cond, value);
+            if (!constant) graph[current].cond = ifs->cond;
+            int head = current;
+            int thenBlock = newBlock();
+            int elseBlock = ifs->elseStmt ? newBlock() : -1;
+            int join = newBlock();
+            if (!constant || value) addEdge(head, thenBlock);
+            if (!constant || !value) addEdge(head, ifs->elseStmt ? elseBlock : join);
+            current = thenBlock;
+            build(ifs->thenStmt);
+            addEdge(current, join);
+            if (ifs->elseStmt) {
+                current = elseBlock;
+                build(ifs->elseStmt);
+                addEdge(current, join);
+            }
+            current = join;
+            break;
+        }
+        case NodeKind::WhileStmt: {
+            auto wh = static_cast<const WhileStmt*>(stmt);
+            int value = 0;
+            bool constant = constantCondition(wh->cond, value);
+            int header = newBlock();
+            int body = newBlock();
+            int exit = newBlock();
+            addEdge(current, header);
+            if (!constant) graph[header].cond = wh->cond;
+            if (!constant || value) addEdge(header, body);
+            if (!constant || !value) addEdge(header, exit);
+            loops.push_back(Loop{header, exit});
+            current = body;
+            build(wh->body);
+            addEdge(current, header);
+            loops.pop_back();
+            current = exit;
+            break;
+        }
+        default:
+            graph[current].stmts.push_back(stmt);
+            break;
+    }
+    stmtBlocks[stmt] = {entry, current};
+}
+
+bool ControlFlowGraph::reachable(const ASTNode* stmt) const {
+    auto it = stmtBlocks.find(stmt);
+    return it == stmtBlocks.end() || live[it->second.first];
+}
+
+bool ControlFlowGraph::completes(const ASTNode* stmt) const {
+    auto it = stmtBlocks.find(stmt);
+    return it == stmtBlocks.end() || live[it->second.second];
+}
+
+std::vector<int> ControlFlowGraph::immediateDominators(bool forward) const {
+    int count = static_cast<int>(graph.size());
+    int root = forward ? Entry : Exit;
+    auto next = [&](int block) -> const std::vector<int>& { return forward ? graph[block].succs : graph[block].preds; };
+    auto prev = [&](int block) -> const std::vector<int>& { return forward ? graph[block].preds : graph[block].succs; };
+
+    // 非递归DFS求后序，只走可达块
+    std::vector<int> postOrder, postIndex(count, -1);
+    std::vector<bool> visited(count, false);
+    std::vector<std::pair<int, size_t>> stack{{root, 0}};
+    visited[root] = true;
+    while (!stack.empty()) {
+        int block = stack.back().first;
+        size_t i = stack.back().second;
+        if (i < next(block).size()) {
+            ++stack.back().second;
+            int succ = next(block)[i];
+            if (live[succ] && !visited[succ]) {
+                visited[succ] = true;
+                stack.push_back({succ, 0});
+            }
+        } else {
+            postIndex[block] = static_cast<int>(postOrder.size());
+            postOrder.push_back(block);
+            stack.pop_back();
+        }
+    }
+
+    // Cooper、Harvey、Kennedy的迭代算法
+    std::vector<int> idom(count, -1);
+    idom[root] = root;
+    auto intersect = [&](int a, int b) {
+        while (a != b) {
+            while (postIndex[a] < postIndex[b]) a = idom[a];
+            while (postIndex[b] < postIndex[a]) b = idom[b];
+        }
+        return a;
+    };
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto it = postOrder.rbegin(); it != postOrder.rend(); ++it) {
+            int block = *it;
+            if (block == root) continue;
+            int newIdom = -1;
+            for (int pred : prev(block)) {
+                if (idom[pred] < 0 || postIndex[pred] < 0) continue;
+                newIdom = newIdom < 0 ? pred : intersect(pred, newIdom);
+            }
+            if (newIdom != idom[block]) {
+                idom[block] = newIdom;
+                changed = true;
+            }
+        }
+    }
+    return idom;
+}
+
+std::vector<int> ControlFlowGraph::dominators() const {
+    return immediateDominators(true);
+}
+
+std::vector<int> ControlFlowGraph::postDominators() const {
+    return immediateDominators(false);
+}
+
+std::unordered_set<const ASTNode*> ControlFlowGraph::deadStores() const {
+    std::unordered_set<const ASTNode*> dead;
+    uint32_t vars = func->varCount;
+    if (vars == 0 || vars == NoVar) return dead;
+    size_t words = (vars + 63) / 64;
+    size_t count = graph.size();
+
+    // 按变量稀疏地求活跃性：从每个向上暴露的使用沿前驱倒着走，遇到写它的块为止。
+    // 总代价是各变量活跃范围的大小之和，不会像按块迭代位向量那样随循环嵌套层数反复扫描
+    std::vector<Bits> liveOut(count);
+    std::vector<std::vector<int>> useBlocks(vars), defBlocks(vars);
+    std::vector<int> localDef(vars), defStamp(count), inStamp(count);
+    std::vector<uint32_t> uses;
+    std::vector<int> stack;
+    bool marked = true;
+    while (marked) {
+        for (auto& blocks : useBlocks) blocks.clear();
+        for (auto& blocks : defBlocks) blocks.clear();
+        std::fill(localDef.begin(), localDef.end(), -1);
+        std::fill(defStamp.begin(), defStamp.end(), -1);
+        std::fill(inStamp.begin(), inStamp.end(), -1);
+
+        // 每个块里向上暴露的使用（块内在它之前没有写）和写过的变量
+        for (const CFGBlock& block : graph) {
+            if (!live[block.id]) continue;
+            liveOut[block.id].assign(words, 0);
+            auto useAll = [&](const ASTNode* expr) {
+                uses.clear();
+                collectUses(expr, uses);
+                for (uint32_t var : uses) {
+                    if (localDef[var] == block.id) continue;
+                    if (useBlocks[var].empty() || useBlocks[var].back() != block.id) useBlocks[var].push_back(block.id);
+                }
+            };
+            for (const ASTNode* stmt : block.stmts) {
+                uint32_t var;
+                const ASTNode* value;
+                if (storeOf(stmt, var, value)) {
+                    if (dead.count(stmt)) continue;
+                    useAll(value);
+                    if (localDef[var] != block.id) {
+                        localDef[var] = block.id;
+                        defBlocks[var].push_back(block.id);
+                    }
+                } else if (auto ret = as<ReturnStmt>(stmt)) {
+                    useAll(ret->expr);
+                } else if (auto expr = as<ExprStmt>(stmt)) {
+                    useAll(expr->expr);
+                }
+            }
+            useAll(block.cond);
+        }
+
+        for (uint32_t var = 0; var < vars; ++var) {
+            for (int block : defBlocks[var]) defStamp[block] = static_cast<int>(var);
+            stack = useBlocks[var];
+            for (int block : stack) inStamp[block] = static_cast<int>(var);
+            uint64_t bit = uint64_t(1) << (var % 64);
+            while (!stack.empty()) {
+                int block = stack.back();
+                stack.pop_back();
+                for (int pred : graph[block].preds) {
+                    if (!live[pred] || (liveOut[pred][var / 64] & bit)) continue;
+                    liveOut[pred][var / 64] |= bit;
+                    if (defStamp[pred] != static_cast<int>(var) && inStamp[pred] != static_cast<int>(var)) {
+                        inStamp[pred] = static_cast<int>(var);
+                        stack.push_back(pred);
+                    }
+                }
+            }
+        }
+
+        // 从块出口倒着走，写入后不活跃、右边没有调用的存储是死的；删掉它可能让别的存储也变死，再来一轮
+        marked = false;
+        for (const CFGBlock& block : graph) {
+            if (!live[block.id]) continue;
+            Bits bits = liveOut[block.id];
+            addUses(block.cond, bits);
+            for (auto it = block.stmts.rbegin(); it != block.stmts.rend(); ++it) {
+                const ASTNode* stmt = *it;
+                uint32_t var;
+                const ASTNode* value;
+                if (storeOf(stmt, var, value)) {
+                    if (dead.count(stmt)) continue;
+                    uint64_t bit = uint64_t(1) << (var % 64);
+                    if (!(bits[var / 64] & bit) && !hasCall(value)) {
+                        dead.insert(stmt);
+                        marked = true;
+                        continue;
+                    }
+                    bits[var / 64] &= ~bit;
+                    addUses(value, bits);
+                } else if (auto ret = as<ReturnStmt>(stmt)) {
+                    addUses(ret->expr, bits);
+                } else if (auto expr = as<ExprStmt>(stmt)) {
+                    addUses(expr->expr, bits);
+                }
+            }
+        }
+    }
+    return dead;
+}
+
+void ControlFlowGraph::printDot(std::ostream& out, const StringInterner& names) const {
+    std::string name(names.name(func->name));
+    std::vector<int> idom = dominators();
+    std::vector<int> ipdom = postDominators();
+    std::unordered_set<const ASTNode*> dead = deadStores();
+    auto node = [&](int block) { return "\"" + name + ".B" + std::to_string(block) + "\""; };
+
+    out << "  subgraph \"cluster_" << name << "\" {\n";
+    out << "    label=\"" << name << "\";\n";
+    out << "    node [shape=box, fontname=monospace];\n";
+    for (const CFGBlock& block : graph) {
+        std::ostringstream label;
+        if (block.id == Entry) label << "entry ";
+        else if (block.id == Exit) label << "exit ";
+        label << "B" << block.id;
+        if (idom[block.id] >= 0) label << "  idom=B" << idom[block.id];
+        if (ipdom[block.id] >= 0) label << "  ipdom=B" << ipdom[block.id];
+        label << "\\l";
+        for (const ASTNode* stmt : block.stmts) {
+            std::ostringstream text;
+            printStmt(text, stmt, names);
+            label << escapeLabel(text.str()) << (dead.count(stmt) ? "   (dead)" : "") << "\\l";
+        }
+        if (block.cond) {
+            std::ostringstream text;
+            printExpr(text, block.cond, names);
+            label << "if " << escapeLabel(text.str()) << "\\l";
+        }
+        out << "    " << node(block.id) << " [label=\"" << label.str() << "\"";
+        if (!live[block.id]) out << ", style=dashed, color=gray";
+        out << "];\n";
+    }
+    for (const CFGBlock& block : graph) {
+        for (size_t i = 0; i < block.succs.size(); ++i) {
+            out << "    " << node(block.id) << " -> " << node(block.succs[i]);
+            if (block.cond) out << " [label=\"" << (i == 0 ? "T" : "F") << "\"]";
+            out << ";\n";
+        }
+    }
+    out << "  }\n";
+}
+
+void printCFG(std::ostream& out, const ASTNodePtr& root, const StringInterner& names) {
+    out << "digraph cfg {\n";
+    if (auto program = as<Program>(root)) {
+        for (auto f : program->functions) {
+            ControlFlowGraph cfg(static_cast<const FunctionDef*>(f));
+            cfg.printDot(out, names);
+        }
+    }
+    out << "}\n";
+}
@@ -1,339 +1,1106 @@
 #include "codegen.h"
+#include "emitter.h"
+#include "fncache.h"
+#include "funcgen.h"
+#include "muldiv.h"
+#include "peephole.h"
+#include "regalloc.h"
+#include "scheduler.h"
+#include "threadpool.h"
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
-CodeGenerator::CodeGenerator(const std::string& outputFile) 
-    : currentFunction(nullptr), labelCounter(0), tempVarCounter(0) {
-    output.open(outputFile);
-    if (!output.is_open()) {
-        throw std::runtime_error("无法创建输出文件: " + outputFile);
-    }
-    
-    // 输出汇编文件头部
-    emitComment("RISC-V 32位汇编代码");
-    emitComment("由ToyC编译器生成");
-    emit("");
-    emit(".text");
-    emit(".globl main");
-    emit("");
+namespace {
+
+// 表达式临时值使用的寄存器
+const Register TEMP_REGISTERS[] = {
+    Register::T0, Register::T1, Register::T2, Register::T3, Register::T4
+};
+
+// 变量可用的调用者保存寄存器（只分给不跨调用的区间）
+const std::vector<Register> VAR_CALLER_SAVED = {
+    Register::T5, Register::A1, Register::A2, Register::A3,
+    Register::A4, Register::A5, Register::A6, Register::A7
+};
+
+// 栈帧大小在编译期确定，全部按sp寻址，s0也作为普通的被调用者保存寄存器分配
+const std::vector<Register> VAR_CALLEE_SAVED = {
+    Register::S1, Register::S2, Register::S3, Register::S4, Register::S5, Register::S6,
+    Register::S7, Register::S8, Register::S9, Register::S10, Register::S11, Register::S0
+};
+
+// 大偏移量、并行传送破环使用的保留寄存器
+const Register SCRATCH = Register::T6;
+
+// return f(...)能否编成尾调用：自递归总是可以；调用别的函数时栈上传参区属于调用者的栈帧，
+// 大小未必够用，只处理实参都在寄存器里的情况
+bool isTailCallable(const FuncCall* call, SymbolId self) {
+    return call->name == self || call->args.size() <= 8;
 }
 
-CodeGenerator::~CodeGenerator() {
-    if (output.is_open()) {
-        output.close();
+// 比较取反：a<b为假即a>=b
+BinOp invertComparison(BinOp op) {
+    switch (op) {
+        case BinOp::Lt: return BinOp::Ge;
+        case BinOp::Ge: return BinOp::Lt;
+        case BinOp::Gt: return BinOp::Le;
+        case BinOp::Le: return BinOp::Gt;
+        case BinOp::Eq: return BinOp::Ne;
+        default: return BinOp::Eq;
     }
 }
 
+// 按代码生成的遍历顺序给语句和表达式编号，收集每个变量（按语义分析写进AST的变量编号）的活跃区间、
+// 调用点、临时值栈最大深度、最多的栈传参个数，以及是否有需要返回到本函数的调用。
+// 与代码生成一样跳过不可达的语句和死存储
+class LivenessBuilder {
+public:
+    LivenessBuilder(const ControlFlowGraph& cfg, const std::unordered_set<const ASTNode*>& deadStores)
+        : cfg(cfg), deadStores(deadStores) {}
+
+    std::vector<LiveInterval> intervals;
+    std::vector<SymbolId> varNames;
+    std::vector<bool> read; // 按变量编号：有没有被读过
+    int maxTempDepth = 0;
+    int maxStackArgs = 0;
+    bool hasCalls = false; // 尾调用不算
+
+    void build(const FunctionDef* func) {
+        self = func->name;
+        intervals.resize(func->varCount);
+        varNames.resize(func->varCount);
+        read.assign(func->varCount, false);
+        declPosition.resize(func->varCount);
+        for (size_t i = 0; i < func->params.size(); ++i) {
+            newVar(static_cast<int>(i), func->params[i].name);
+            touch(static_cast<int>(i), 0);
+            // 形参留在传进来的参数寄存器里时序言不用搬
+            if (i < 8) intervals[i].hint = argRegister(static_cast<int>(i));
+        }
+        scanStmt(func->body);
+        for (auto& interval : intervals) {
+            for (int call : callPositions) {
+                if (interval.start < call && call < interval.end) {
+                    interval.crossesCall = true;
+                    break;
+                }
+            }
+        }
+    }
+
+private:
+    struct Loop {
+        int start;
+        std::vector<int> vars; // 循环内引用、但在循环外声明的变量
+    };
+
+    const ControlFlowGraph& cfg;
+    const std::unordered_set<const ASTNode*>& deadStores;
+    std::vector<int> declPosition;
+    std::vector<int> callPositions;
+    std::vector<Loop> loops;
+    int pos = 0;
+    SymbolId self = InvalidSymbol;
+    const FuncCall* tailCall = nullptr; // 正在扫描的return所返回的调用
+
+    void newVar(int var, SymbolId name) {
+        intervals[var] = LiveInterval{var, pos, pos};
+        varNames[var] = name;
+        declPosition[var] = pos;
+    }
+
+    void touch(int var, int at) {
+        if (var < 0) return;
+        intervals[var].start = std::min(intervals[var].start, at);
+        intervals[var].end = std::max(intervals[var].end, at);
+        // 只记在变量声明之后开始的最外层循环里：它的回边已经覆盖了内层循环。
+        // 记到每一层的话，内层循环结束时的touch会让外层的列表逐层翻倍
+        for (auto& loop : loops) {
+            if (declPosition[var] < loop.start) {
+                loop.vars.push_back(var);
+                break;
+            }
+        }
+    }
+
+    // 直接作为操作数的变量一直活跃到使用它的那条指令。一元加号与visitUnaryExpr一样透明，
+    // +(x)的值就是x所在的寄存器
+    void useOperand(const ASTNode* child, int at) {
+        while (auto un = as<UnaryExpr>(child)) {
+            if (un->op != UnOp::Plus) return;
+            child = un->expr;
+        }
+        if (auto ref = as<VarRef>(child)) touch(static_cast<int>(ref->var), at);
+    }
+
+    void scanStmt(const ASTNode* node) {
+        if (!node || !cfg.reachable(node)) return;
+        switch (node->kind) {
+            case NodeKind::Block:
+                for (auto stmt : static_cast<const Block*>(node)->stmts) scanStmt(stmt);
+                break;
+            case NodeKind::VarDecl: {
+                auto decl = static_cast<const VarDecl*>(node);
+                if (!deadStores.count(decl)) {
+                    scanTop(decl->initExpr);
+                    ++pos;
+                    useOperand(decl->initExpr, pos);
+                }
+                newVar(static_cast<int>(decl->var), decl->name);
+                break;
+            }
+            case NodeKind::Assign: {
+                auto assign = static_cast<const Assign*>(node);
+                if (deadStores.count(assign)) break;
+                scanTop(assign->expr);
+                ++pos;
+                useOperand(assign->expr, pos);
+                touch(static_cast<int>(assign->var), pos);
+                break;
+            }
+            case NodeKind::ReturnStmt: {
+                auto expr = static_cast<const ReturnStmt*>(node)->expr;
+                auto call = as<FuncCall>(expr);
+                tailCall = call && isTailCallable(call, self) ? call : nullptr;
+                scanTop(expr);
+                tailCall = nullptr;
+                useOperand(expr, ++pos);
+                break;
+            }
+            case NodeKind::ExprStmt:
+                scanTop(static_cast<const ExprStmt*>(node)->expr);
+                useOperand(static_cast<const ExprStmt*>(node)->expr, ++pos);
+                break;
+            case NodeKind::IfStmt: {
+                auto ifs = static_cast<const IfStmt*>(node);
+                scanTop(ifs->cond);
+                useOperand(ifs->cond, ++pos);
+                scanStmt(ifs->thenStmt);
+                scanStmt(ifs->elseStmt);
+                break;
+            }
+            case NodeKind::WhileStmt: {
+                auto wh = static_cast<const WhileStmt*>(node);
+                loops.push_back(Loop{++pos, {}});
+                scanTop(wh->cond);
+                useOperand(wh->cond, ++pos);
+                scanStmt(wh->body);
+                int end = ++pos;
+                // 回边使循环外声明、循环内引用的变量在整个循环期间保持活跃
+                Loop loop = std::move(loops.back());
+                loops.pop_back();
+                for (int var : loop.vars) {
+                    intervals[var].end = std::max(intervals[var].end, end);
+                    touch(var, end);
+                }
+                break;
+            }
+            default:
+                ++pos;
+                break;
+        }
+    }
+
+    void scanTop(const ASTNode* expr) {
+        if (expr) maxTempDepth = std::max(maxTempDepth, scanExpr(expr));
+    }
+
+    // 返回求值该表达式时临时值栈深度的上界
+    int scanExpr(const ASTNode* node) {
+        switch (node->kind) {
+            case NodeKind::IntLiteral:
+                ++pos;
+                return 1;
+            case NodeKind::VarRef: {
+                int var = static_cast<int>(static_cast<const VarRef*>(node)->var);
+                if (var >= 0) read[var] = true;
+                touch(var, ++pos);
+                return 1;
+            }
+            case NodeKind::UnaryExpr: {
+                auto un = static_cast<const UnaryExpr*>(node);
+                int depth = scanExpr(un->expr);
+                useOperand(un->expr, ++pos);
+                return std::max(depth, 1);
+            }
+            case NodeKind::BinaryExpr: {
+                auto bin = static_cast<const BinaryExpr*>(node);
+                bool logical = bin->op == BinOp::And || bin->op == BinOp::Or;
+                int lhs = scanExpr(bin->lhs);
+                // 短路运算在求右操作数之前就用完了左操作数
+                if (logical) useOperand(bin->lhs, ++pos);
+                int rhs = scanExpr(bin->rhs);
+                ++pos;
+                if (!logical) useOperand(bin->lhs, pos);
+                useOperand(bin->rhs, pos);
+                return std::max(lhs, 1 + rhs);
+            }
+            case NodeKind::FuncCall: {
+                auto call = static_cast<const FuncCall*>(node);
+                int depth = 1;
+                for (size_t i = 0; i < call->args.size(); ++i) {
+                    depth = std::max(depth, static_cast<int>(i) + scanExpr(call->args[i]));
+                }
+                // 实参在call指令之前读取，调用点编号排在所有实参之后
+                int at = ++pos;
+                callPositions.push_back(at);
+                for (auto arg : call->args) useOperand(arg, at);
+                maxStackArgs = std::max(maxStackArgs, static_cast<int>(call->args.size()) - 8);
+                if (call != tailCall) hasCalls = true;
+                ++pos;
+                return depth;
+            }
+            default:
+                ++pos;
+                return 1;
+        }
+    }
+};
+
+} // namespace
+
+CodeGenerator::CodeGenerator(AsmEmitter& emitter, const StringInterner& names,
+                             PeepholeOptimizer* peephole, ThreadPool* pool)
+    : emitter(emitter), names(names), peephole(peephole), pool(pool), currentFunction(nullptr),
+      labelCounter(0) {}
+
 void CodeGenerator::generate(const ASTNodePtr& node) {
+    // 输出汇编文件头部
+    emitComment("RISC-V 32位汇编代码");
+    emitComment("由ToyC编译器生成");
+    emitDirective("");
+    emitDirective(".text");
+    emitDirective(".globl main");
+    emitDirective("");
     visit(node);
+    flush();
 }
 
 void CodeGenerator::visit(const ASTNodePtr& node) {
-    if (!node) return;
-    
-    // 根据节点类型分发到相应的处理函数
-    if (auto program = std::dynamic_pointer_cast<Program>(node)) {
-        visitProgram(program.get());
-    } else if (auto funcDef = std::dynamic_pointer_cast<FunctionDef>(node)) {
-        visitFunctionDef(funcDef.get());
-    } else if (auto block = std::dynamic_pointer_cast<Block>(node)) {
-        visitBlock(block.get());
-    } else if (auto varDecl = std::dynamic_pointer_cast<VarDecl>(node)) {
-        visitVarDecl(varDecl.get());
-    } else if (auto assign = std::dynamic_pointer_cast<Assign>(node)) {
-        visitAssign(assign.get());
-    } else if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(node)) {
-        visitIfStmt(ifStmt.get());
-    } else if (auto whileStmt = std::dynamic_pointer_cast<WhileStmt>(node)) {
-        visitWhileStmt(whileStmt.get());
-    } else if (auto breakStmt = std::dynamic_pointer_cast<BreakStmt>(node)) {
-        visitBreakStmt(breakStmt.get());
-    } else if (auto continueStmt = std::dynamic_pointer_cast<ContinueStmt>(node)) {
-        visitContinueStmt(continueStmt.get());
-    } else if (auto returnStmt = std::dynamic_pointer_cast<ReturnStmt>(node)) {
-        visitReturnStmt(returnStmt.get());
-    } else if (auto exprStmt = std::dynamic_pointer_cast<ExprStmt>(node)) {
-        visitExprStmt(exprStmt.get());
-    } else if (auto binaryExpr = std::dynamic_pointer_cast<BinaryExpr>(node)) {
-        visitBinaryExpr(binaryExpr.get());
-    } else if (auto unaryExpr = std::dynamic_pointer_cast<UnaryExpr>(node)) {
-        visitUnaryExpr(unaryExpr.get());
-    } else if (auto intLiteral = std::dynamic_pointer_cast<IntLiteral>(node)) {
-        visitIntLiteral(intLiteral.get());
-    } else if (auto varRef = std::dynamic_pointer_cast<VarRef>(node)) {
-        visitVarRef(varRef.get());
-    } else if (auto funcCall = std::dynamic_pointer_cast<FuncCall>(node)) {
-        visitFuncCall(funcCall.get());
+    // return、break、continue之后和常量条件走不到的语句不生成代码
+    if (!node || (cfg && !cfg->reachable(node))) return;
+
+    // 根据节点标签分发到相应的处理函数
+    switch (node->kind) {
+        case NodeKind::Program: visitProgram(static_cast<const Program*>(node)); break;
+        case NodeKind::FunctionDef: visitFunctionDef(static_cast<const FunctionDef*>(node)); break;
+        case NodeKind::Block: visitBlock(static_cast<const Block*>(node)); break;
+        case NodeKind::VarDecl: visitVarDecl(static_cast<const VarDecl*>(node)); break;
+        case NodeKind::Assign: visitAssign(static_cast<const Assign*>(node)); break;
+        case NodeKind::IfStmt: visitIfStmt(static_cast<const IfStmt*>(node)); break;
+        case NodeKind::WhileStmt: visitWhileStmt(static_cast<const WhileStmt*>(node)); break;
+        case NodeKind::BreakStmt: visitBreakStmt(static_cast<const BreakStmt*>(node)); break;
+        case NodeKind::ContinueStmt: visitContinueStmt(static_cast<const ContinueStmt*>(node)); break;
+        case NodeKind::ReturnStmt: visitReturnStmt(static_cast<const ReturnStmt*>(node)); break;
+        case NodeKind::ExprStmt: visitExprStmt(static_cast<const ExprStmt*>(node)); break;
+        default:
+            // 表达式出现在语句位置时求值后丢弃结果
+            freeRegister(visitExpr(node));
+            break;
+    }
+}
+
+Operand CodeGenerator::visitExpr(const ASTNodePtr& node, Register hint) {
+    switch (node->kind) {
+        case NodeKind::BinaryExpr: return visitBinaryExpr(static_cast<const BinaryExpr*>(node), hint);
+        case NodeKind::UnaryExpr: return visitUnaryExpr(static_cast<const UnaryExpr*>(node), hint);
+        case NodeKind::IntLiteral: return visitIntLiteral(static_cast<const IntLiteral*>(node), hint);
+        case NodeKind::VarRef: return visitVarRef(static_cast<const VarRef*>(node), hint);
+        case NodeKind::FuncCall: return visitFuncCall(static_cast<const FuncCall*>(node), hint);
+        default:
+            throw std::runtime_error("代码生成: 非法的表达式节点");
     }
 }
 
 void CodeGenerator::visitProgram(const Program* node) {
     emitComment("程序开始");
-    for (const auto& func : node->functions) {
-        visit(func);
-    }
+    flush();
+
+    // 各函数并行生成，标签按函数名分命名空间
+    auto generate = [&](CodeGenerator& worker, size_t i) {
+        return worker.generateFunction(static_cast<const FunctionDef*>(node->functions[i]));
+    };
+    generateFunctions<CodeGenerator>(node->functions.size(), emitter, names, peephole, pool, cached, scheduler,
+                                     constantMulDiv, generate);
+
     emitComment("程序结束");
 }
 
+std::vector<AsmInst> CodeGenerator::generateFunction(const FunctionDef* node) {
+    visitFunctionDef(node);
+    if (peephole) peephole->run(code);
+    if (scheduler) scheduler->run(code);
+    std::vector<AsmInst> result;
+    result.swap(code);
+    return result;
+}
+
 void CodeGenerator::visitFunctionDef(const FunctionDef* node) {
-    emit("");
-    emitComment("函数定义: " + node->name);
-    
+    std::string name(names.name(node->name));
+    emitDirective("");
+    emitComment("函数定义: " + name);
+
     // 创建函数信息
-    FunctionInfo funcInfo(node->name);
-    funcInfo.returnType = node->retType;
+    FunctionInfo funcInfo(name);
+    funcInfo.symbol = node->name;
     for (const auto& param : node->params) {
-        funcInfo.paramNames.push_back(param.second);
-        funcInfo.paramTypes.push_back(param.first);
+        funcInfo.paramNames.emplace_back(names.name(param.name));
     }
-    functions[node->name] = funcInfo;
-    currentFunction = &functions[node->name];
-    
+    currentFunction = &functions.insert_or_assign(node->name, funcInfo).first->second;
+    labelCounter = 0;
+
+    // 控制流图：标出不可达的语句和死存储
+    ControlFlowGraph graph(node);
+    cfg = &graph;
+    deadStores = graph.deadStores();
+
+    // 活跃区间分析 + 线性扫描寄存器分配，确定栈帧布局
+    allocateFunction(node);
+
     // 生成函数标签
-    emitLabel(node->name);
-    
+    emitLabel(name);
+
     // 生成函数序言
     generateFunctionPrologue(node);
-    
-    // 生成函数体
+
+    // 生成函数体；末尾的return直接落到尾声，不用跳转
+    epilogueLabel = generateLabel("epilogue");
+    auto body = as<Block>(node->body);
+    finalReturn = body && !body->stmts.empty() ? as<ReturnStmt>(body->stmts[body->stmts.size() - 1]) : nullptr;
     visit(node->body);
-    
-    // 生成函数尾声
+
+    // 生成函数尾声，所有return共用
+    emitLabel(epilogueLabel);
     generateFunctionEpilogue(node);
-    
+
     currentFunction = nullptr;
+    cfg = nullptr;
+}
+
+void CodeGenerator::allocateFunction(const FunctionDef* node) {
+    locals.clear();
+    temps.clear();
+    freeTemps.assign(std::rbegin(TEMP_REGISTERS), std::rend(TEMP_REGISTERS));
+
+    LivenessBuilder liveness(*cfg, deadStores);
+    liveness.build(node);
+    // 只给被读到的变量分配：没用到的形参、只有死存储或只写不读的局部变量不占寄存器和栈槽
+    std::vector<LiveInterval> readIntervals;
+    for (const LiveInterval& interval : liveness.intervals) {
+        if (liveness.read[interval.var]) readIntervals.push_back(interval);
+    }
+    LinearScanAllocator allocator(VAR_CALLER_SAVED, VAR_CALLEE_SAVED);
+    allocator.allocate(readIntervals);
+    for (const LiveInterval& interval : readIntervals) liveness.intervals[interval.var].reg = interval.reg;
+
+    // 栈帧布局（偏移相对进入函数时的sp）：
+    //   非叶子函数在-4保存ra，之后依次是被调用者保存寄存器、溢出的变量、临时值溢出槽；
+    //   栈底0(sp)起是超过8个实参时的传参区。全部用到的空间按16字节对齐，一个都不用时不分配栈帧
+    currentFunction->saveRA = liveness.hasCalls;
+    currentFunction->savedRegs = allocator.usedCalleeSaved();
+    currentFunction->stackSize = (currentFunction->saveRA ? 4 : 0) +
+                                 4 * static_cast<int>(currentFunction->savedRegs.size());
+    size_t paramCount = node->params.size();
+    for (size_t var = 0; var < liveness.intervals.size(); ++var) {
+        bool isParam = var < paramCount;
+        Symbol symbol(std::string(names.name(liveness.varNames[var])), 0, isParam);
+        symbol.reg = liveness.intervals[var].reg;
+        symbol.read = liveness.read[var];
+        if (symbol.read && symbol.reg == Register::ZERO) {
+            // 第9个及以后的形参本来就在调用者的栈上
+            symbol.offset = isParam && var >= 8 ? static_cast<int>(var - 8) * 4 : allocateStackSpace(4);
+        }
+        locals.push_back(symbol);
+    }
+    currentFunction->localVarCount = static_cast<int>(locals.size() - paramCount);
+    currentFunction->tempSlotBase = -currentFunction->stackSize;
+    // 临时值只在调用前或临时寄存器不够时才溢出
+    int tempRegisters = static_cast<int>(std::size(TEMP_REGISTERS));
+    if (liveness.hasCalls || liveness.maxTempDepth > tempRegisters) {
+        currentFunction->stackSize += 4 * liveness.maxTempDepth;
+    }
+    currentFunction->stackSize += 4 * std::max(liveness.maxStackArgs, 0);
+    currentFunction->stackSize = (currentFunction->stackSize + 15) & ~15;
 }
 
 void CodeGenerator::visitBlock(const Block* node) {
-    enterScope();
     for (const auto& stmt : node->stmts) {
         visit(stmt);
     }
-    exitScope();
 }
 
 void CodeGenerator::visitVarDecl(const VarDecl* node) {
-    emitComment("变量声明: " + node->name);
-    
-    // 分配栈空间
-    int offset = allocateStackSpace(4); // int类型占4字节
-    symbolTable[node->name] = Symbol(node->name, node->type, offset);
-    
-    // 如果有初始值，生成赋值代码
-    if (node->initExpr) {
-        visit(node->initExpr);
-        // 这里需要将表达式结果存储到变量位置
-        // 简化实现，假设表达式结果在a0寄存器中
-        emit("sw a0, " + std::to_string(offset) + "(sp)");
+    emitComment("变量声明: " + std::string(names.name(node->name)));
+
+    // 如果有初始值，直接算进变量所在的寄存器或栈槽（之后不会被读到的初值不算）
+    if (node->initExpr && !deadStores.count(node)) {
+        int var = static_cast<int>(node->var);
+        if (!locals[var].read) {
+            discardExpr(node->initExpr);
+            return;
+        }
+        Operand value = visitExpr(node->initExpr, locals[var].reg);
+        storeVariable(var, use(value));
+        freeRegister(value);
     }
 }
 
 void CodeGenerator::visitAssign(const Assign* node) {
-    emitComment("赋值: " + node->name);
-    
-    // 计算表达式值
-    visit(node->expr);
-    
-    // 存储到变量
-    auto it = symbolTable.find(node->name);
-    if (it != symbolTable.end()) {
-        emit("sw a0, " + std::to_string(it->second.offset) + "(sp)");
+    if (deadStores.count(node)) return;
+    emitComment("赋值: " + std::string(names.name(node->name)));
+
+    // 计算表达式值并存储到变量
+    int var = static_cast<int>(node->var);
+    if (!locals[var].read) {
+        discardExpr(node->expr);
+        return;
     }
+    Operand value = visitExpr(node->expr, locals[var].reg);
+    storeVariable(var, use(value));
+    freeRegister(value);
 }
 
 void CodeGenerator::visitIfStmt(const IfStmt* node) {
     std::string elseLabel = generateLabel("else");
     std::string endLabel = generateLabel("endif");
-    
+
     emitComment("if语句开始");
-    
-    // 计算条件表达式
-    visit(node->cond);
-    
-    // 如果条件为假，跳转到else分支
-    emit("beqz a0, " + elseLabel);
-    
+
+    // 条件为假时跳转到else分支
+    visitCondition(node->cond, false, elseLabel);
+
     // then分支
     visit(node->thenStmt);
-    emit("j " + endLabel);
-    
-    // else分支
-    emitLabel(elseLabel);
-    if (node->elseStmt) {
+
+    // else分支：then分支已经return、break或continue时不用跳过else，也不需要endif标签；
+    // 走不到的else分支（常量条件）不生成
+    if (node->elseStmt && cfg->reachable(node->elseStmt)) {
+        bool thenCompletes = cfg->completes(node->thenStmt);
+        if (thenCompletes) emit(AsmInst::jump(AsmOp::J, endLabel));
+        emitLabel(elseLabel);
         visit(node->elseStmt);
+        if (thenCompletes) emitLabel(endLabel);
+    } else {
+        emitLabel(elseLabel);
     }
-    
-    emitLabel(endLabel);
     emitComment("if语句结束");
 }
 
 void CodeGenerator::visitWhileStmt(const WhileStmt* node) {
-    std::string loopLabel = generateLabel("while");
+    std::string bodyLabel = generateLabel("while");
+    std::string condLabel = generateLabel("while_cond");
     std::string endLabel = generateLabel("endwhile");
-    
+
+    // 条件放在循环体后面，每次迭代只在回边上做一次比较跳转
     emitComment("while循环开始");
-    emitLabel(loopLabel);
-    
-    // 计算条件表达式
-    visit(node->cond);
-    
-    // 如果条件为假，跳出循环
-    emit("beqz a0, " + endLabel);
-    
-    // 循环体
+    emit(AsmInst::jump(AsmOp::J, condLabel));
+    emitLabel(bodyLabel);
+
+    loopLabels.emplace_back(condLabel, endLabel);
     visit(node->body);
-    
-    // 跳回循环开始
-    emit("j " + loopLabel);
-    
+    loopLabels.pop_back();
+
+    // 条件为真时回到循环体
+    emitLabel(condLabel);
+    visitCondition(node->cond, true, bodyLabel);
+
     emitLabel(endLabel);
     emitComment("while循环结束");
 }
 
-void CodeGenerator::visitBreakStmt(const BreakStmt* node) {
+void CodeGenerator::visitBreakStmt(const BreakStmt*) {
     emitComment("break语句");
-    // 这里需要跳转到循环结束标签
-    // 简化实现，暂时注释掉
-    // emit("j " + currentLoopEndLabel);
+    emit(AsmInst::jump(AsmOp::J, loopLabels.back().second));
 }
 
-void CodeGenerator::visitContinueStmt(const ContinueStmt* node) {
+void CodeGenerator::visitContinueStmt(const ContinueStmt*) {
     emitComment("continue语句");
-    // 这里需要跳转到循环开始标签
-    // 简化实现，暂时注释掉
-    // emit("j " + currentLoopStartLabel);
+    emit(AsmInst::jump(AsmOp::J, loopLabels.back().first));
 }
 
 void CodeGenerator::visitReturnStmt(const ReturnStmt* node) {
     emitComment("return语句");
-    
+
+    // return f(...)：尾调用不再返回到本函数
+    if (auto call = as<FuncCall>(node->expr)) {
+        if (visitTailCall(call)) return;
+    }
+
     if (node->expr) {
-        visit(node->expr);
-        // 返回值已经在a0寄存器中
+        Operand value = visitExpr(node->expr, Register::A0);
+        Register reg = use(value);
+        if (reg != Register::A0) {
+            emit(AsmInst::unary(AsmOp::Mv, Register::A0, reg));
+        }
+        freeRegister(value);
     }
-    
-    generateFunctionEpilogue(nullptr);
+
+    if (node == finalReturn) return;
+    // 没有栈帧时尾声只有一条ret，直接返回比跳过去更省
+    emit(currentFunction->stackSize == 0 ? AsmInst::ret() : AsmInst::jump(AsmOp::J, epilogueLabel));
 }
 
 void CodeGenerator::visitExprStmt(const ExprStmt* node) {
-    visit(node->expr);
     // 表达式语句的结果被忽略
+    if (node->expr) discardExpr(node->expr);
+}
+
+void CodeGenerator::discardExpr(const ASTNodePtr& expr) {
+    if (auto call = as<FuncCall>(expr)) {
+        visitFuncCall(call, Register::ZERO, false);
+        return;
+    }
+    freeRegister(visitExpr(expr));
 }
 
-void CodeGenerator::visitBinaryExpr(const BinaryExpr* node) {
-    emitComment("二元表达式: " + node->op);
-    
+Operand CodeGenerator::visitBinaryExpr(const BinaryExpr* node, Register hint) {
+    if (node->op == BinOp::And || node->op == BinOp::Or) {
+        return visitLogicalExpr(node);
+    }
+    emitComment(std::string("二元表达式: ") + binOpSpelling(node->op));
+
+    // 乘、除以非零常量不用mul/div/rem；常量在左边的乘法交换操作数（常量没有副作用）
+    if (constantMulDiv) {
+        auto rhsLit = as<IntLiteral>(node->rhs);
+        auto lhsLit = node->op == BinOp::Mul ? as<IntLiteral>(node->lhs) : nullptr;
+        switch (node->op) {
+            case BinOp::Mul:
+                if (rhsLit && shiftMultiplyLength(rhsLit->value)) {
+                    return visitConstantOp(node->op, node->lhs, rhsLit->value, hint);
+                }
+                if (lhsLit && shiftMultiplyLength(lhsLit->value)) {
+                    return visitConstantOp(node->op, node->rhs, lhsLit->value, hint);
+                }
+                break;
+            case BinOp::Div:
+            case BinOp::Mod:
+                if (rhsLit && rhsLit->value != 0) return visitConstantOp(node->op, node->lhs, rhsLit->value, hint);
+                break;
+            default:
+                break;
+        }
+    }
+
     // 计算左操作数
-    visit(node->lhs);
-    emit("mv t0, a0");  // 保存左操作数
-    
+    Operand lhs = visitExpr(node->lhs);
+
+    // 右操作数是小常量时直接使用立即数指令
+    if (auto lit = as<IntLiteral>(node->rhs)) {
+        int64_t imm = node->op == BinOp::Sub ? -static_cast<int64_t>(lit->value) : lit->value;
+        if ((node->op == BinOp::Add || node->op == BinOp::Sub || node->op == BinOp::Lt) && fitsImm12(imm)) {
+            Register lhsReg = use(lhs);
+            Operand result = resultOperand(hint, lhs);
+            emit(AsmInst::immediate(node->op == BinOp::Lt ? AsmOp::Slti : AsmOp::Addi, result.reg, lhsReg,
+                                    static_cast<int32_t>(imm)));
+            return result;
+        }
+    }
+
     // 计算右操作数
-    visit(node->rhs);
-    emit("mv t1, a0");  // 保存右操作数
-    
+    Operand rhs = visitExpr(node->rhs);
+    Register rhsReg = use(rhs);
+    Register lhsReg = use(lhs);
+
     // 执行运算
-    generateArithmeticOp(node->op, "a0", "t0", "t1");
+    Operand result = resultOperand(hint, lhs, &rhs);
+    switch (node->op) {
+        case BinOp::Add: case BinOp::Sub: case BinOp::Mul: case BinOp::Div: case BinOp::Mod:
+            generateArithmeticOp(node->op, result.reg, lhsReg, rhsReg);
+            break;
+        default:
+            generateComparisonOp(node->op, result.reg, lhsReg, rhsReg);
+            break;
+    }
+    return result;
 }
 
-void CodeGenerator::visitUnaryExpr(const UnaryExpr* node) {
-    emitComment("一元表达式: " + node->op);
-    
-    visit(node->expr);
-    
-    if (node->op == "-") {
-        emit("neg a0, a0");
-    } else if (node->op == "!") {
-        emit("seqz a0, a0");
+Operand CodeGenerator::visitConstantOp(BinOp op, const ASTNodePtr& operand, int value, Register hint) {
+    Operand lhs = visitExpr(operand);
+    Register lhsReg = use(lhs);
+    Operand result = resultOperand(hint, lhs);
+    if (op == BinOp::Mul) {
+        lowerMultiply(code, result.reg, lhsReg, value, SCRATCH);
+        return result;
+    }
+    // 取余的结果写回被除数的寄存器时，商要另占一个临时寄存器；没有空闲的就照常用rem，免得溢出
+    Operand spare;
+    if (op == BinOp::Mod && result.reg == lhsReg) {
+        if (freeTemps.empty()) {
+            emit(AsmInst::loadImm(SCRATCH, value));
+            emit(AsmInst::binary(AsmOp::Rem, result.reg, lhsReg, SCRATCH));
+            return result;
+        }
+        spare = allocateRegister();
+    }
+    lowerDivide(code, op == BinOp::Div ? AsmOp::Div : AsmOp::Rem, result.reg, lhsReg, value, SCRATCH, spare.reg);
+    freeRegister(spare);
+    return result;
+}
+
+void CodeGenerator::visitCondition(const ASTNodePtr& cond, bool jumpIf, const std::string& target) {
+    // 常量条件：要么无条件跳转，要么直接顺序执行
+    if (auto lit = as<IntLiteral>(cond)) {
+        if ((lit->value != 0) == jumpIf) emit(AsmInst::jump(AsmOp::J, target));
+        return;
+    }
+    if (auto un = as<UnaryExpr>(cond); un && un->op == UnOp::Not) {
+        visitCondition(un->expr, !jumpIf, target);
+        return;
+    }
+    auto bin = as<BinaryExpr>(cond);
+    if (bin && (bin->op == BinOp::And || bin->op == BinOp::Or)) {
+        bool isAnd = bin->op == BinOp::And;
+        if (isAnd != jumpIf) {
+            // a&&b为假、a||b为真：任一操作数满足就跳走
+            visitCondition(bin->lhs, jumpIf, target);
+            visitCondition(bin->rhs, jumpIf, target);
+        } else {
+            // a&&b为真、a||b为假：左操作数不满足时跳过右操作数
+            std::string skipLabel = generateLabel(isAnd ? "and_skip" : "or_skip");
+            visitCondition(bin->lhs, !jumpIf, skipLabel);
+            visitCondition(bin->rhs, jumpIf, target);
+            emitLabel(skipLabel);
+        }
+        return;
+    }
+    if (bin && bin->op >= BinOp::Lt && bin->op <= BinOp::Ne) {
+        emitComment(std::string("条件: ") + binOpSpelling(bin->op));
+        Operand lhs = visitExpr(bin->lhs);
+        Operand rhs = visitExpr(bin->rhs);
+        Register rhsReg = use(rhs);
+        Register lhsReg = use(lhs);
+        freeRegister(rhs);
+        freeRegister(lhs);
+        generateCompareBranch(jumpIf ? bin->op : invertComparison(bin->op), lhsReg, rhsReg, target);
+        return;
     }
+
+    Operand value = visitExpr(cond);
+    Register reg = use(value);
+    freeRegister(value);
+    emit(AsmInst::branchZero(jumpIf ? AsmOp::Bnez : AsmOp::Beqz, reg, target));
 }
 
-void CodeGenerator::visitIntLiteral(const IntLiteral* node) {
-    emitComment("整数字面量: " + std::to_string(node->value));
-    emit("li a0, " + std::to_string(node->value));
+Operand CodeGenerator::visitLogicalExpr(const BinaryExpr* node) {
+    emitComment(std::string("逻辑表达式: ") + binOpSpelling(node->op));
+
+    // 短路求值：结果先取左操作数的真值，需要时再由右操作数覆盖
+    Operand lhs = visitExpr(node->lhs);
+    Register lhsReg = use(lhs);
+    Operand result = resultOperand(Register::ZERO, lhs);
+    emit(AsmInst::unary(AsmOp::Snez, result.reg, lhsReg));
+
+    std::string endLabel = generateLabel(node->op == BinOp::And ? "and_end" : "or_end");
+    emit(AsmInst::branchZero(node->op == BinOp::And ? AsmOp::Beqz : AsmOp::Bnez, result.reg, endLabel));
+
+    // 两条路径汇合时，外层临时值必须回到分支前的位置
+    std::vector<TempValue> snapshot = temps;
+    std::vector<Register> freeSnapshot = freeTemps;
+    Operand rhs = visitExpr(node->rhs);
+    Register rhsReg = use(rhs);
+    if (!temps[result.temp].spilled && temps[result.temp].reg == result.reg) {
+        emit(AsmInst::unary(AsmOp::Snez, result.reg, rhsReg));
+        freeRegister(rhs);
+        restoreTemps(snapshot, freeSnapshot);
+    } else {
+        emit(AsmInst::unary(AsmOp::Snez, SCRATCH, rhsReg));
+        freeRegister(rhs);
+        restoreTemps(snapshot, freeSnapshot);
+        emit(AsmInst::unary(AsmOp::Mv, result.reg, SCRATCH));
+    }
+
+    emitLabel(endLabel);
+    return result;
 }
 
-void CodeGenerator::visitVarRef(const VarRef* node) {
-    emitComment("变量引用: " + node->name);
-    
-    auto it = symbolTable.find(node->name);
-    if (it != symbolTable.end()) {
-        emit("lw a0, " + std::to_string(it->second.offset) + "(sp)");
+Operand CodeGenerator::visitUnaryExpr(const UnaryExpr* node, Register hint) {
+    if (node->op == UnOp::Plus) {
+        return visitExpr(node->expr, hint);
+    }
+    emitComment(std::string("一元表达式: ") + unOpSpelling(node->op));
+
+    Operand value = visitExpr(node->expr);
+    Register valueReg = use(value);
+    Operand result = resultOperand(hint, value);
+
+    if (node->op == UnOp::Neg) {
+        emit(AsmInst::unary(AsmOp::Neg, result.reg, valueReg));
+    } else {
+        emit(AsmInst::unary(AsmOp::Seqz, result.reg, valueReg));
     }
+    return result;
 }
 
-void CodeGenerator::visitFuncCall(const FuncCall* node) {
-    emitComment("函数调用: " + node->name);
-    
-    // 计算参数并压栈
-    for (size_t i = 0; i < node->args.size(); ++i) {
-        visit(node->args[i]);
-        // 将参数保存到临时位置
-        emit("sw a0, " + std::to_string(-(i + 1) * 4) + "(sp)");
+Operand CodeGenerator::visitIntLiteral(const IntLiteral* node, Register hint) {
+    if (node->value == 0 && hint == Register::ZERO) {
+        return Operand{Register::ZERO, -1};
     }
-    
-    // 将参数加载到参数寄存器
-    for (size_t i = 0; i < node->args.size() && i < 8; ++i) {
-        emit("lw a" + std::to_string(i) + ", " + std::to_string(-(i + 1) * 4) + "(sp)");
+    Operand result = hint != Register::ZERO ? Operand{hint, -1} : allocateRegister();
+    emit(AsmInst::loadImm(result.reg, node->value));
+    return result;
+}
+
+Operand CodeGenerator::visitVarRef(const VarRef* node, Register hint) {
+    int var = static_cast<int>(node->var);
+    const Symbol& symbol = locals[var];
+
+    // 在寄存器中的变量直接作为操作数使用
+    if (symbol.reg != Register::ZERO) {
+        if (hint == Register::ZERO || hint == symbol.reg) return Operand{symbol.reg, -1};
+        emit(AsmInst::unary(AsmOp::Mv, hint, symbol.reg));
+        return Operand{hint, -1};
     }
-    
+
+    emitComment("变量引用: " + symbol.name);
+    Operand result = hint != Register::ZERO ? Operand{hint, -1} : allocateRegister();
+    loadVariable(var, result.reg);
+    return result;
+}
+
+Operand CodeGenerator::visitFuncCall(const FuncCall* node, Register hint, bool wantResult) {
+    std::string name(names.name(node->name));
+    emitComment("函数调用: " + name);
+
+    passArguments(node, 0);
+
     // 调用函数
-    emit("call " + node->name);
+    emit(AsmInst::jump(AsmOp::Call, name));
+
+    if (!wantResult) return Operand{};
+    Operand result = hint != Register::ZERO ? Operand{hint, -1} : allocateRegister();
+    if (result.reg != Register::A0) {
+        emit(AsmInst::unary(AsmOp::Mv, result.reg, Register::A0));
+    }
+    return result;
+}
+
+bool CodeGenerator::visitTailCall(const FuncCall* node) {
+    if (!isTailCallable(node, currentFunction->symbol)) return false;
+    std::string name(names.name(node->name));
+    bool selfCall = node->name == currentFunction->symbol;
+
+    emitComment((selfCall ? "尾递归: " : "尾调用: ") + name);
+
+    // 第9个及以后的实参直接覆盖本函数自己的栈上形参
+    passArguments(node, currentFunction->stackSize);
+
+    if (selfCall) {
+        // 实参已在a0~a7中，回到序言里接收形参的位置，复用当前栈帧
+        emit(AsmInst::jump(AsmOp::J, tailEntryLabel));
+    } else {
+        // 先拆掉本函数的栈帧，被调函数直接返回到我们的调用者
+        restoreFrame();
+        emit(AsmInst::jump(AsmOp::Tail, name));
+    }
+    return true;
+}
+
+void CodeGenerator::passArguments(const FuncCall* node, int stackBase) {
+    // 依次计算实参
+    size_t base = temps.size();
+    std::vector<Operand> args;
+    for (const auto& arg : node->args) {
+        args.push_back(visitExpr(arg));
+    }
+
+    // 第9个及以后的实参放到传参区
+    for (size_t i = 8; i < args.size(); ++i) {
+        emitMemory(AsmOp::Sw, use(args[i]), stackBase + static_cast<int>(i - 8) * 4, Register::SP);
+    }
+
+    // 外层表达式的临时值都在调用者保存寄存器里，调用前溢出到栈上
+    spillTemps(base);
+
+    // 把实参并行传送到a0~a7；被溢出的实参最后直接从栈槽加载
+    std::vector<std::pair<Register, Register>> moves;
+    std::vector<std::pair<Register, int>> loads;
+    for (size_t i = 0; i < args.size() && i < 8; ++i) {
+        Register arg = argRegister(static_cast<int>(i));
+        if (args[i].temp >= 0 && temps[args[i].temp].spilled) {
+            loads.emplace_back(arg, tempSlot(args[i].temp));
+        } else {
+            moves.emplace_back(arg, args[i].temp >= 0 ? temps[args[i].temp].reg : args[i].reg);
+        }
+    }
+    emitParallelMove(moves);
+    for (auto& load : loads) {
+        emitFrameMemory(AsmOp::Lw, load.first, load.second);
+    }
+    for (auto it = args.rbegin(); it != args.rend(); ++it) {
+        freeRegister(*it);
+    }
 }
 
 // 辅助函数实现
-void CodeGenerator::emit(const std::string& instruction) {
-    output << "    " << instruction << std::endl;
+void CodeGenerator::emit(AsmInst inst) {
+    code.push_back(std::move(inst));
 }
 
 void CodeGenerator::emitLabel(const std::string& label) {
-    output << label << ":" << std::endl;
+    code.push_back(AsmInst::label(label));
 }
 
 void CodeGenerator::emitComment(const std::string& comment) {
-    output << "    # " << comment << std::endl;
+    if (emitter.wantsComments()) code.push_back(AsmInst::comment(comment));
+}
+
+void CodeGenerator::emitDirective(const std::string& directive) {
+    code.push_back(AsmInst::directive(directive));
+}
+
+void CodeGenerator::flush() {
+    if (peephole) peephole->run(code);
+    emitter.emit(code);
+    code.clear();
+}
+
+void CodeGenerator::emitMemory(AsmOp op, Register reg, int offset, Register base) {
+    if (fitsImm12(offset)) {
+        emit(AsmInst::memory(op, reg, offset, base));
+        return;
+    }
+    // 偏移超出12位立即数范围时先算出地址
+    emit(AsmInst::loadImm(SCRATCH, offset));
+    emit(AsmInst::binary(AsmOp::Add, SCRATCH, SCRATCH, base));
+    emit(AsmInst::memory(op, reg, 0, SCRATCH));
+}
+
+void CodeGenerator::emitFrameMemory(AsmOp op, Register reg, int offset) {
+    emitMemory(op, reg, currentFunction->stackSize + offset, Register::SP);
+}
+
+void CodeGenerator::emitAddImmediate(Register dst, Register src, int imm) {
+    if (fitsImm12(imm)) {
+        emit(AsmInst::immediate(AsmOp::Addi, dst, src, imm));
+        return;
+    }
+    emit(AsmInst::loadImm(SCRATCH, imm));
+    emit(AsmInst::binary(AsmOp::Add, dst, src, SCRATCH));
+}
+
+void CodeGenerator::emitParallelMove(std::vector<std::pair<Register, Register>> moves) {
+    moves.erase(std::remove_if(moves.begin(), moves.end(),
+                               [](const auto& move) { return move.first == move.second; }),
+                moves.end());
+    while (!moves.empty()) {
+        // 先发出目标寄存器不再被其他传送读取的传送
+        bool progressed = false;
+        for (size_t i = 0; i < moves.size(); ++i) {
+            Register dst = moves[i].first;
+            bool blocked = std::any_of(moves.begin(), moves.end(),
+                                       [&](const auto& move) { return move.second == dst; });
+            if (!blocked) {
+                emit(AsmInst::unary(AsmOp::Mv, dst, moves[i].second));
+                moves.erase(moves.begin() + i);
+                progressed = true;
+                break;
+            }
+        }
+        if (progressed) continue;
+        // 剩下的传送都在环上：借助保留寄存器打破一个环
+        Register src = moves.front().second;
+        emit(AsmInst::unary(AsmOp::Mv, SCRATCH, src));
+        for (auto& move : moves) {
+            if (move.second == src) move.second = SCRATCH;
+        }
+    }
+}
+
+Operand CodeGenerator::allocateRegister() {
+    if (freeTemps.empty()) {
+        // 寄存器紧张：溢出最早分配（离使用最远）的临时值
+        spillTemps(1 + std::distance(temps.begin(),
+                                     std::find_if(temps.begin(), temps.end(),
+                                                  [](const TempValue& value) { return !value.spilled; })));
+    }
+    Register reg = freeTemps.back();
+    freeTemps.pop_back();
+    temps.push_back(TempValue{reg, false});
+    return Operand{reg, static_cast<int>(temps.size() - 1)};
+}
+
+void CodeGenerator::freeRegister(const Operand& operand) {
+    if (operand.temp < 0) return;
+    // 临时值严格按栈的顺序释放
+    if (!temps.back().spilled) freeTemps.push_back(temps.back().reg);
+    temps.pop_back();
+}
+
+Register CodeGenerator::use(const Operand& operand) {
+    if (operand.temp < 0) return operand.reg;
+    if (temps[operand.temp].spilled) {
+        // 重新装入寄存器
+        Operand reloaded = allocateRegister();
+        temps.pop_back();
+        temps[operand.temp] = TempValue{reloaded.reg, false};
+        emitFrameMemory(AsmOp::Lw, reloaded.reg, tempSlot(operand.temp));
+    }
+    return temps[operand.temp].reg;
+}
+
+Operand CodeGenerator::resultOperand(Register hint, Operand& lhs, Operand* rhs) {
+    // 优先写入调用方指定的寄存器，否则复用编号最小的临时值并释放其余的
+    if (hint != Register::ZERO) {
+        if (rhs) freeRegister(*rhs);
+        freeRegister(lhs);
+        return Operand{hint, -1};
+    }
+    if (lhs.temp >= 0) {
+        if (rhs) freeRegister(*rhs);
+        return Operand{temps[lhs.temp].reg, lhs.temp};
+    }
+    if (rhs && rhs->temp >= 0) {
+        return Operand{temps[rhs->temp].reg, rhs->temp};
+    }
+    return allocateRegister();
+}
+
+void CodeGenerator::spillTemps(size_t below) {
+    for (size_t i = 0; i < below && i < temps.size(); ++i) {
+        if (temps[i].spilled) continue;
+        emitFrameMemory(AsmOp::Sw, temps[i].reg, tempSlot(static_cast<int>(i)));
+        temps[i].spilled = true;
+        freeTemps.push_back(temps[i].reg);
+    }
+}
+
+void CodeGenerator::restoreTemps(const std::vector<TempValue>& snapshot, const std::vector<Register>& freeSnapshot) {
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        if (!snapshot[i].spilled && temps[i].spilled) {
+            emitFrameMemory(AsmOp::Lw, snapshot[i].reg, tempSlot(static_cast<int>(i)));
+        }
+    }
+    temps = snapshot;
+    freeTemps = freeSnapshot;
+}
+
+int CodeGenerator::tempSlot(int index) const {
+    return currentFunction->tempSlotBase - 4 * (index + 1);
 }
 
 std::string CodeGenerator::generateLabel(const std::string& prefix) {
-    return prefix + "_" + std::to_string(labelCounter++);
+    return ".L" + currentFunction->name + "_" + prefix + "_" + std::to_string(labelCounter++);
+}
+
+void CodeGenerator::loadVariable(int var, Register reg) {
+    const Symbol& symbol = locals[var];
+    if (symbol.reg != Register::ZERO) {
+        if (symbol.reg != reg) emit(AsmInst::unary(AsmOp::Mv, reg, symbol.reg));
+        return;
+    }
+    emitFrameMemory(AsmOp::Lw, reg, symbol.offset);
+}
+
+void CodeGenerator::storeVariable(int var, Register reg) {
+    const Symbol& symbol = locals[var];
+    if (symbol.reg != Register::ZERO) {
+        if (symbol.reg != reg) emit(AsmInst::unary(AsmOp::Mv, symbol.reg, reg));
+        return;
+    }
+    emitFrameMemory(AsmOp::Sw, reg, symbol.offset);
 }
 
 void CodeGenerator::generateFunctionPrologue(const FunctionDef* node) {
+    int frame = currentFunction->stackSize;
     emitComment("函数序言");
-    emit("addi sp, sp, -16");  // 分配栈空间
-    emit("sw ra, 12(sp)");     // 保存返回地址
-    emit("sw s0, 8(sp)");      // 保存帧指针
-    emit("addi s0, sp, 16");   // 设置新的帧指针
+    if (frame > 0) emitAddImmediate(Register::SP, Register::SP, -frame); // 分配栈空间
+    if (currentFunction->saveRA) emitFrameMemory(AsmOp::Sw, Register::RA, -4);  // 保存返回地址
+    for (size_t i = 0; i < currentFunction->savedRegs.size(); ++i) {
+        emitFrameMemory(AsmOp::Sw, currentFunction->savedRegs[i], savedRegSlot(i));
+    }
+
+    // 形参从a0~a7（以及调用者栈上）移动到分配的位置；尾递归跳回这里
+    tailEntryLabel = generateLabel("tailentry");
+    emitLabel(tailEntryLabel);
+    std::vector<std::pair<Register, Register>> moves;
+    for (size_t i = 0; i < node->params.size() && i < 8; ++i) {
+        Register arg = argRegister(static_cast<int>(i));
+        if (!locals[i].read) continue;
+        if (locals[i].reg == Register::ZERO) {
+            emitFrameMemory(AsmOp::Sw, arg, locals[i].offset);
+        } else {
+            moves.emplace_back(locals[i].reg, arg);
+        }
+    }
+    emitParallelMove(moves);
+    for (size_t i = 8; i < node->params.size(); ++i) {
+        if (locals[i].reg != Register::ZERO) {
+            emitFrameMemory(AsmOp::Lw, locals[i].reg, static_cast<int>(i - 8) * 4);
+        }
+    }
 }
 
-void CodeGenerator::generateFunctionEpilogue(const FunctionDef* node) {
+void CodeGenerator::generateFunctionEpilogue(const FunctionDef*) {
     emitComment("函数尾声");
-    emit("lw ra, 12(sp)");     // 恢复返回地址
-    emit("lw s0, 8(sp)");      // 恢复帧指针
-    emit("addi sp, sp, 16");   // 恢复栈指针
-    emit("ret");               // 返回
+    restoreFrame();
+    emit(AsmInst::ret());
 }
 
-void CodeGenerator::generateArithmeticOp(const std::string& op, const std::string& result, 
-                                        const std::string& lhs, const std::string& rhs) {
-    if (op == "+") {
-        emit("add " + result + ", " + lhs + ", " + rhs);
-    } else if (op == "-") {
-        emit("sub " + result + ", " + lhs + ", " + rhs);
-    } else if (op == "*") {
-        emit("mul " + result + ", " + lhs + ", " + rhs);
-    } else if (op == "/") {
-        emit("div " + result + ", " + lhs + ", " + rhs);
-    } else if (op == "%") {
-        emit("rem " + result + ", " + lhs + ", " + rhs);
+void CodeGenerator::restoreFrame() {
+    int frame = currentFunction->stackSize;
+    for (size_t i = 0; i < currentFunction->savedRegs.size(); ++i) {
+        emitFrameMemory(AsmOp::Lw, currentFunction->savedRegs[i], savedRegSlot(i));
     }
+    if (currentFunction->saveRA) emitFrameMemory(AsmOp::Lw, Register::RA, -4); // 恢复返回地址
+    if (frame > 0) emitAddImmediate(Register::SP, Register::SP, frame);  // 恢复栈指针
 }
 
-void CodeGenerator::enterScope() {
-    // 简化实现，暂时不处理作用域
+int CodeGenerator::savedRegSlot(size_t index) const {
+    return (currentFunction->saveRA ? -8 : -4) - 4 * static_cast<int>(index);
 }
 
-void CodeGenerator::exitScope() {
-    // 简化实现，暂时不处理作用域
+void CodeGenerator::generateArithmeticOp(BinOp op, Register result, Register lhs, Register rhs) {
+    switch (op) {
+        case BinOp::Add: emit(AsmInst::binary(AsmOp::Add, result, lhs, rhs)); break;
+        case BinOp::Sub: emit(AsmInst::binary(AsmOp::Sub, result, lhs, rhs)); break;
+        case BinOp::Mul: emit(AsmInst::binary(AsmOp::Mul, result, lhs, rhs)); break;
+        case BinOp::Div: emit(AsmInst::binary(AsmOp::Div, result, lhs, rhs)); break;
+        case BinOp::Mod: emit(AsmInst::binary(AsmOp::Rem, result, lhs, rhs)); break;
+        default: break;
+    }
+}
+
+void CodeGenerator::generateComparisonOp(BinOp op, Register result, Register lhs, Register rhs) {
+    switch (op) {
+        case BinOp::Lt:
+            emit(AsmInst::binary(AsmOp::Slt, result, lhs, rhs));
+            break;
+        case BinOp::Gt:
+            emit(AsmInst::binary(AsmOp::Slt, result, rhs, lhs));
+            break;
+        case BinOp::Le:
+            emit(AsmInst::binary(AsmOp::Slt, result, rhs, lhs));
+            emit(AsmInst::immediate(AsmOp::Xori, result, result, 1));
+            break;
+        case BinOp::Ge:
+            emit(AsmInst::binary(AsmOp::Slt, result, lhs, rhs));
+            emit(AsmInst::immediate(AsmOp::Xori, result, result, 1));
+            break;
+        case BinOp::Eq:
+            emit(AsmInst::binary(AsmOp::Xor, result, lhs, rhs));
+            emit(AsmInst::unary(AsmOp::Seqz, result, result));
+            break;
+        case BinOp::Ne:
+            emit(AsmInst::binary(AsmOp::Xor, result, lhs, rhs));
+            emit(AsmInst::unary(AsmOp::Snez, result, result));
+            break;
+        default:
+            break;
+    }
+}
+
+void CodeGenerator::generateCompareBranch(BinOp op, Register lhs, Register rhs, const std::string& target) {
+    switch (op) {
+        case BinOp::Lt: emit(AsmInst::branch(AsmOp::Blt, lhs, rhs, target)); break;
+        case BinOp::Ge: emit(AsmInst::branch(AsmOp::Bge, lhs, rhs, target)); break;
+        // >和<=交换操作数
+        case BinOp::Gt: emit(AsmInst::branch(AsmOp::Blt, rhs, lhs, target)); break;
+        case BinOp::Le: emit(AsmInst::branch(AsmOp::Bge, rhs, lhs, target)); break;
+        case BinOp::Eq: emit(AsmInst::branch(AsmOp::Beq, lhs, rhs, target)); break;
+        case BinOp::Ne: emit(AsmInst::branch(AsmOp::Bne, lhs, rhs, target)); break;
+        default: break;
+    }
 }
 
 int CodeGenerator::allocateStackSpace(int size) {
@@ -342,4 +1109,4 @@ int CodeGenerator::allocateStackSpace(int size) {
         return -currentFunction->stackSize;
     }
     return 0;
-} 
\ No newline at end of file
+}
@@ -0,0 +1,333 @@
+#include "constfold.h"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+
+namespace {
+
+// 结果只可能是0或1的表达式
+bool isBoolean(const ASTNode* node) {
+    if (auto bin = as<BinaryExpr>(node)) return bin->op >= BinOp::Lt;
+    if (auto un = as<UnaryExpr>(node)) return un->op == UnOp::Not;
+    return false;
+}
+
+} // namespace
+
+bool evaluateBinOp(BinOp op, int lhs, int rhs, int& result) {
+    uint32_t a = static_cast<uint32_t>(lhs);
+    uint32_t b = static_cast<uint32_t>(rhs);
+    switch (op) {
+        case BinOp::Add: result = static_cast<int>(a + b); return true;
+        case BinOp::Sub: result = static_cast<int>(a - b); return true;
+        case BinOp::Mul: result = static_cast<int>(a * b); return true;
+        case BinOp::Div:
+        case BinOp::Mod:
+            if (rhs == 0) return false;
+            if (lhs == INT_MIN && rhs == -1) {
+                result = op == BinOp::Div ? INT_MIN : 0;
+            } else {
+                result = op == BinOp::Div ? lhs / rhs : lhs % rhs;
+            }
+            return true;
+        case BinOp::Lt: result = lhs < rhs; return true;
+        case BinOp::Le: result = lhs <= rhs; return true;
+        case BinOp::Gt: result = lhs > rhs; return true;
+        case BinOp::Ge: result = lhs >= rhs; return true;
+        case BinOp::Eq: result = lhs == rhs; return true;
+        case BinOp::Ne: result = lhs != rhs; return true;
+        case BinOp::And: result = lhs && rhs; return true;
+        case BinOp::Or: result = lhs || rhs; return true;
+    }
+    return false;
+}
+
+void ConstantFolder::optimize(const ASTNodePtr& root) {
+    auto prog = as<Program>(root);
+    if (!prog) return;
+    for (auto func : prog->functions) {
+        foldFunction(static_cast<FunctionDef*>(func));
+    }
+}
+
+void ConstantFolder::foldFunction(FunctionDef* func) {
+    // 语义分析已经给每个变量编了号，形参是0~n-1，一开始都不是常量
+    env.assign(func->varCount, Value{});
+    reachable = true;
+    func->body = foldStmt(func->body);
+}
+
+ASTNodePtr ConstantFolder::foldStmt(ASTNodePtr node) {
+    if (!node) return node;
+    switch (node->kind) {
+        case NodeKind::Block: {
+            auto block = static_cast<Block*>(node);
+            for (auto& stmt : block->stmts) {
+                stmt = foldStmt(stmt);
+            }
+            return node;
+        }
+        case NodeKind::VarDecl: {
+            auto decl = static_cast<VarDecl*>(node);
+            if (decl->initExpr) decl->initExpr = foldExpr(decl->initExpr);
+            // 循环体里的声明每次执行都重新开始
+            auto lit = as<IntLiteral>(decl->initExpr);
+            env[decl->var] = lit ? Value{true, lit->value} : Value{};
+            return node;
+        }
+        case NodeKind::Assign: {
+            auto assign = static_cast<Assign*>(node);
+            assign->expr = foldExpr(assign->expr);
+            auto lit = as<IntLiteral>(assign->expr);
+            env[assign->var] = lit ? Value{true, lit->value} : Value{};
+            return node;
+        }
+        case NodeKind::ExprStmt: {
+            auto stmt = static_cast<ExprStmt*>(node);
+            if (!stmt->expr) return node;
+            stmt->expr = foldExpr(stmt->expr);
+            // 不含调用的表达式语句没有任何效果
+            if (!hasCall(stmt->expr)) stmt->expr = nullptr;
+            return node;
+        }
+        case NodeKind::ReturnStmt: {
+            auto ret = static_cast<ReturnStmt*>(node);
+            if (ret->expr) ret->expr = foldExpr(ret->expr);
+            reachable = false;
+            return node;
+        }
+        case NodeKind::BreakStmt:
+        case NodeKind::ContinueStmt:
+            // 跳转路径上的状态由所在循环统一处理
+            reachable = false;
+            return node;
+        case NodeKind::IfStmt: return foldIf(static_cast<IfStmt*>(node));
+        case NodeKind::WhileStmt: return foldWhile(static_cast<WhileStmt*>(node));
+        default:
+            return foldExpr(node);
+    }
+}
+
+ASTNodePtr ConstantFolder::foldIf(IfStmt* node) {
+    node->cond = foldExpr(node->cond);
+
+    // 条件为常量：只保留会执行的分支
+    if (auto lit = as<IntLiteral>(node->cond)) {
+        ++pruned;
+        ASTNodePtr arm = lit->value ? node->thenStmt : node->elseStmt;
+        if (!arm) return emptyStmt();
+        // 单独的声明语句按语义分析的规则声明在外层作用域，直接换上来即可
+        return foldStmt(arm);
+    }
+
+    Env before = env;
+    bool reachableBefore = reachable;
+    refine(node->cond, true);
+    node->thenStmt = foldStmt(node->thenStmt);
+    Env thenEnv = std::move(env);
+    bool thenReachable = reachable;
+
+    env = std::move(before);
+    reachable = reachableBefore;
+    refine(node->cond, false);
+    if (node->elseStmt) node->elseStmt = foldStmt(node->elseStmt);
+
+    // 汇合点：只保留两条可达路径上取值一致的常量
+    if (!thenReachable) return node;
+    if (!reachable) {
+        env = std::move(thenEnv);
+        reachable = true;
+        return node;
+    }
+    merge(thenEnv);
+    return node;
+}
+
+ASTNodePtr ConstantFolder::foldWhile(WhileStmt* node) {
+    // 循环体中被赋值的变量在循环头处不再是常量
+    std::vector<uint32_t> assigned;
+    collectAssigned(node->body, assigned);
+    for (uint32_t var : assigned) env[var] = Value{};
+
+    node->cond = foldExpr(node->cond);
+    if (auto lit = as<IntLiteral>(node->cond)) {
+        if (!lit->value) {
+            ++pruned;
+            return emptyStmt();
+        }
+    }
+
+    Env head = env;
+    refine(node->cond, true);
+    node->body = foldStmt(node->body);
+
+    // 循环出口（条件为假或break）只可能改变循环体中赋值过的变量
+    env = std::move(head);
+    reachable = true;
+    return node;
+}
+
+ASTNodePtr ConstantFolder::foldExpr(ASTNodePtr node) {
+    switch (node->kind) {
+        case NodeKind::BinaryExpr: return foldBinary(static_cast<BinaryExpr*>(node));
+        case NodeKind::UnaryExpr: return foldUnary(static_cast<UnaryExpr*>(node));
+        case NodeKind::VarRef: {
+            uint32_t var = static_cast<VarRef*>(node)->var;
+            if (env[var].known) {
+                ++folded;
+                return literal(env[var].value);
+            }
+            return node;
+        }
+        case NodeKind::FuncCall: {
+            for (auto& arg : static_cast<FuncCall*>(node)->args) {
+                arg = foldExpr(arg);
+            }
+            return node;
+        }
+        default:
+            return node;
+    }
+}
+
+ASTNodePtr ConstantFolder::foldBinary(BinaryExpr* node) {
+    node->lhs = foldExpr(node->lhs);
+    node->rhs = foldExpr(node->rhs);
+    auto lhs = as<IntLiteral>(node->lhs);
+    auto rhs = as<IntLiteral>(node->rhs);
+
+    int result;
+    if (lhs && rhs && evaluateBinOp(node->op, lhs->value, rhs->value, result)) {
+        ++folded;
+        return literal(result);
+    }
+
+    if (node->op == BinOp::And || node->op == BinOp::Or) {
+        bool isAnd = node->op == BinOp::And;
+        // 左操作数为常量：要么短路，要么结果就是右操作数的真值
+        if (lhs) {
+            ++folded;
+            if (isAnd != (lhs->value != 0)) return literal(isAnd ? 0 : 1);
+            if (isBoolean(node->rhs)) return node->rhs;
+            return context.create<BinaryExpr>(BinOp::Ne, node->rhs, literal(0));
+        }
+        // 右操作数为常量：左操作数总会求值，无调用时才能整体丢弃
+        if (rhs) {
+            if (isAnd == (rhs->value != 0)) {
+                ++folded;
+                if (isBoolean(node->lhs)) return node->lhs;
+                return context.create<BinaryExpr>(BinOp::Ne, node->lhs, literal(0));
+            }
+            if (!hasCall(node->lhs)) {
+                ++folded;
+                return literal(isAnd ? 0 : 1);
+            }
+        }
+        return node;
+    }
+
+    // 常量放到右边，代码生成可以直接使用立即数
+    if (lhs && !rhs && (node->op == BinOp::Add || node->op == BinOp::Mul ||
+                        node->op == BinOp::Eq || node->op == BinOp::Ne)) {
+        std::swap(node->lhs, node->rhs);
+        std::swap(lhs, rhs);
+    }
+
+    // 代数恒等式
+    if (rhs) {
+        int value = rhs->value;
+        if (((node->op == BinOp::Add || node->op == BinOp::Sub) && value == 0) ||
+            ((node->op == BinOp::Mul || node->op == BinOp::Div) && value == 1)) {
+            ++folded;
+            return node->lhs;
+        }
+        if (node->op == BinOp::Mul && value == 0 && !hasCall(node->lhs)) {
+            ++folded;
+            return literal(0);
+        }
+        if (node->op == BinOp::Mod && (value == 1 || value == -1) && !hasCall(node->lhs)) {
+            ++folded;
+            return literal(0);
+        }
+    }
+    return node;
+}
+
+ASTNodePtr ConstantFolder::foldUnary(UnaryExpr* node) {
+    node->expr = foldExpr(node->expr);
+    if (node->op == UnOp::Plus) return node->expr;
+    if (auto lit = as<IntLiteral>(node->expr)) {
+        ++folded;
+        if (node->op == UnOp::Neg) return literal(static_cast<int>(0u - static_cast<uint32_t>(lit->value)));
+        return literal(!lit->value);
+    }
+    // --x => x
+    if (auto inner = as<UnaryExpr>(node->expr)) {
+        if (node->op == UnOp::Neg && inner->op == UnOp::Neg) {
+            ++folded;
+            return inner->expr;
+        }
+    }
+    return node;
+}
+
+void ConstantFolder::collectAssigned(const ASTNode* node, std::vector<uint32_t>& vars) const {
+    if (!node) return;
+    switch (node->kind) {
+        case NodeKind::Block:
+            for (auto stmt : static_cast<const Block*>(node)->stmts) collectAssigned(stmt, vars);
+            break;
+        case NodeKind::Assign:
+            vars.push_back(static_cast<const Assign*>(node)->var);
+            break;
+        case NodeKind::IfStmt: {
+            auto ifs = static_cast<const IfStmt*>(node);
+            collectAssigned(ifs->thenStmt, vars);
+            collectAssigned(ifs->elseStmt, vars);
+            break;
+        }
+        case NodeKind::WhileStmt:
+            collectAssigned(static_cast<const WhileStmt*>(node)->body, vars);
+            break;
+        default:
+            break;
+    }
+}
+
+void ConstantFolder::refine(const ASTNode* cond, bool taken) {
+    // 分支条件蕴含的等式：if (x == c) 的then分支、if (x != c) 的else分支里x就是c
+    if (auto bin = as<BinaryExpr>(cond)) {
+        if ((bin->op == BinOp::And && taken) || (bin->op == BinOp::Or && !taken)) {
+            refine(bin->lhs, taken);
+            refine(bin->rhs, taken);
+            return;
+        }
+        if ((bin->op == BinOp::Eq && taken) || (bin->op == BinOp::Ne && !taken)) {
+            auto ref = as<VarRef>(bin->lhs);
+            auto lit = as<IntLiteral>(bin->rhs);
+            if (ref && lit) env[ref->var] = Value{true, lit->value};
+        }
+        return;
+    }
+    if (auto un = as<UnaryExpr>(cond)) {
+        if (un->op == UnOp::Not) refine(un->expr, !taken);
+        return;
+    }
+    if (auto ref = as<VarRef>(cond)) {
+        if (!taken) env[ref->var] = Value{true, 0};
+    }
+}
+
+void ConstantFolder::merge(const Env& other) {
+    for (size_t i = 0; i < env.size(); ++i) {
+        if (env[i].known && (!other[i].known || other[i].value != env[i].value)) env[i] = Value{};
+    }
+}
+
+ASTNodePtr ConstantFolder::literal(int value) {
+    return context.create<IntLiteral>(value);
+}
+
+ASTNodePtr ConstantFolder::emptyStmt() {
+    return context.create<ExprStmt>(nullptr);
+}
@@ -0,0 +1,238 @@
+#include "driver.h"
+#include "cfg.h"
+#include "codegen.h"
+#include "constfold.h"
+#include "emitter.h"
+#include "fncache.h"
+#include "inliner.h"
+#include "irgen.h"
+#include "isel.h"
+#include "lexer.h"
+#include "loops.h"
+#include "parser.h"
+#include "passes.h"
+#include "peephole.h"
+#include "scheduler.h"
+#include "semantic.h"
+#include "source.h"
+#include "stats.h"
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+
+// 影响生成代码的选项，作为函数缓存键的一部分
+std::string cacheConfiguration(const CompileOptions& options) {
+    std::string configuration = "O" + std::to_string(options.optLevel);
+    if (options.optLevel > 0 && options.inlineCalls) configuration += " inline";
+    if (options.optLevel > 0 && options.licm) configuration += " licm";
+    if (options.optLevel > 0 && options.strengthReduce) configuration += " strength-reduce";
+    if (options.optLevel > 0 && options.unrollLoops) configuration += " unroll";
+    if (options.peephole) configuration += " peephole";
+    if (options.constantMulDiv) configuration += " const-muldiv";
+    if (options.schedule) configuration += " schedule=" + options.core;
+    if (options.comments && !options.emitObject) configuration += " comments";
+    return configuration;
+}
+
+} // namespace
+
+std::string outputPathFor(const std::string& inputFile, const CompileOptions& options,
+                          const std::string& outputDir, bool nextToInput) {
+    std::filesystem::path input(inputFile);
+    std::string name = input.stem().string() + (options.emitObject ? ".o" : ".s");
+    if (!outputDir.empty()) return (std::filesystem::path(outputDir) / name).string();
+    if (nextToInput) return (input.parent_path() / name).string();
+    return name;
+}
+
+void compileFile(const std::string& inputFile, const std::string& outputFile, const CompileOptions& options,
+                 std::ostream& log, PeepholeOptimizer* peephole, ThreadPool* pool, FunctionCache* cache,
+                 CompileStats* stats) {
+    PhaseTimer phase(stats, "read");
+    // 以只读方式映射源文件，词法单元直接引用映射内存
+    SourceFile source(inputFile);
+    log << "正在编译文件: " << inputFile << "\n";
+
+    // 语法分析时边解析边做词法分析，统计时单独扫描一遍，得到词法分析的耗时和词法单元数
+    if (stats) {
+        phase.next("lex");
+        ViewLexer lexer(source.text());
+        uint64_t tokens = 0;
+        while (lexer.nextToken().type != TokenType::END_OF_FILE) ++tokens;
+        stats->add("bytes_read", source.text().size());
+        stats->add("tokens", tokens);
+    }
+
+    phase.next(options.fusedFrontend ? "parse+semantic" : "parse");
+    // 语法分析（边解析边做词法分析；AST节点全部分配在context中，编译结束时一次性释放）。
+    // 融合前端在建节点的同时做语义检查，报错与单独的语义分析相同
+    ASTContext context;
+    FrontendChecker checker(context.names);
+    Parser parser(source.text(), context, options.fusedFrontend ? &checker : nullptr);
+    auto ast = parser.parse();
+    if (!ast) throw std::runtime_error("语法分析失败");
+    log << (options.fusedFrontend ? "语法和语义分析完成\n" : "语法分析完成\n");
+    if (stats) {
+        stats->add("symbols", context.names.size());
+        stats->countNodes(ast);
+    }
+
+    // 按函数查缓存：命中的函数跳过函数体的语义检查和代码生成，输出时直接拼入缓存的指令
+    auto program = as<Program>(ast);
+    CachedFunctions cached;
+    if (cache) {
+        phase.next("cache");
+        bool inlining = options.optLevel > 0 && options.inlineCalls;
+        cached.keys = functionCacheKeys(source.text(), program, context.names, cacheConfiguration(options), inlining);
+    }
+    bool caching = !cached.keys.empty();
+    if (caching) {
+        size_t count = program->functions.size();
+        cached.cache = cache;
+        cached.hit.assign(count, false);
+        cached.code.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            cached.names.push_back(static_cast<const FunctionDef*>(program->functions[i])->name);
+            cached.hit[i] = cache->lookup(cached.keys[i], cached.code[i]);
+        }
+        log << "函数缓存: 命中" << cached.hitCount() << "个, 重新编译" << count - cached.hitCount() << "个\n";
+        if (stats) stats->add("cache_hits", cached.hitCount());
+    }
+
+    // 中端只处理需要重新编译的函数和它们会内联的函数（要输出IR时处理全部函数），
+    // 这些函数都要经过语义分析编好变量号，其余命中的函数跳过
+    std::vector<bool> needed;
+    if (caching) {
+        std::vector<bool> misses(cached.hit.size());
+        for (size_t i = 0; i < misses.size(); ++i) misses[i] = !cached.hit[i];
+        if (options.optLevel == 0) {
+            needed = std::move(misses);
+        } else if (options.dumpIR) {
+            needed.assign(misses.size(), true);
+        } else {
+            needed = callClosure(program, misses);
+        }
+    }
+
+    // 语义分析
+    if (!options.fusedFrontend) {
+        phase.next("semantic");
+        SemanticAnalyzer semanticAnalyzer(context.names);
+        std::vector<bool> skipBodies(needed.size());
+        for (size_t i = 0; i < needed.size(); ++i) skipBodies[i] = !needed[i];
+        semanticAnalyzer.analyze(ast, caching ? &skipBodies : nullptr);
+        log << "语义分析完成\n";
+    }
+
+    // 输出文件的创建、调度器和控制流图的输出单独计时，不算进语义分析或代码生成
+    phase.next("setup");
+    if (options.dumpCFG) {
+        std::string dotFile = outputFile.substr(0, outputFile.size() - 2) + ".dot";
+        std::ofstream dotOut(dotFile);
+        printCFG(dotOut, ast, context.names);
+        log << "控制流图已输出到: " << dotFile << "\n";
+    }
+
+    // 两条路径生成的每个函数在输出前都经过窥孔优化，再按选定核的延迟表做指令调度
+    PeepholeOptimizer* peepholePass = options.peephole ? peephole : nullptr;
+    std::unique_ptr<InstructionScheduler> scheduler;
+    if (options.schedule) scheduler = std::make_unique<InstructionScheduler>(findCoreModel(options.core));
+    // 输出后端：文本汇编或直接编码的目标文件
+    std::unique_ptr<AsmEmitter> emitter;
+    if (options.emitObject) {
+        emitter = std::make_unique<ObjectEmitter>(outputFile, options.verifyObject);
+    } else {
+        emitter = std::make_unique<TextEmitter>(outputFile, options.comments);
+    }
+    if (options.optLevel == 0) {
+        // 代码生成
+        phase.next("codegen");
+        CodeGenerator codegen(*emitter, context.names, peepholePass, pool);
+        if (caching) codegen.setCache(&cached);
+        codegen.setScheduler(scheduler.get());
+        codegen.setConstantMulDiv(options.constantMulDiv);
+        codegen.generate(ast);
+        log << "代码生成完成\n";
+    } else {
+        if (caching && !options.dumpIR) {
+            std::vector<ASTNodePtr> functions;
+            for (size_t i = 0; i < needed.size(); ++i) {
+                if (needed[i]) functions.push_back(program->functions[i]);
+            }
+            ast = context.create<Program>(context.list(functions));
+        }
+
+        // 常量折叠与常量传播
+        phase.next("constfold");
+        ConstantFolder folder(context);
+        folder.optimize(ast);
+        log << "常量折叠完成\n";
+
+        // 生成SSA形式的IR并优化
+        phase.next("irgen");
+        IRGenerator irgen(context.names);
+        auto module = irgen.generate(ast);
+        phase.next("optimize");
+        PassManager passes(context.names);
+        addDefaultPasses(passes);
+        LoopOptions loops;
+        loops.licm = options.licm;
+        loops.strengthReduce = options.strengthReduce;
+        loops.unroll = options.unrollLoops;
+        loops.constantMultiply = options.constantMulDiv;
+        addLoopPasses(passes, loops);
+        passes.setVerify(options.verifyIR);
+        passes.run(*module);
+        // 被调函数先各自化简再按代价内联，内联后重新跑一遍流水线折叠实参。
+        // 不管有没有内联都重跑，每个函数的结果只取决于它的调用闭包，与文件中的其他函数无关
+        if (options.inlineCalls) {
+            phase.next("inline");
+            Inliner inliner;
+            int inlined = inliner.run(*module);
+            passes.run(*module);
+            log << "函数内联完成: " << inlined << "处调用\n";
+        }
+        log << "IR优化完成\n";
+        if (stats) {
+            uint64_t blocks = 0, insts = 0;
+            for (auto& func : module->functions) {
+                blocks += func->blocks.size();
+                for (IRBlock* block : func->blocks) insts += block->insts.size();
+            }
+            stats->add("ir_blocks", blocks);
+            stats->add("ir_instructions", insts);
+        }
+        if (options.dumpIR) {
+            std::string irFile = outputFile.substr(0, outputFile.size() - 2) + ".ir";
+            std::ofstream irOut(irFile);
+            printIR(irOut, *module, context.names);
+            log << "IR已输出到: " << irFile << "\n";
+        }
+
+        // 指令选择与寄存器分配
+        phase.next("codegen");
+        InstructionSelector isel(*emitter, context.names, peepholePass, pool);
+        if (caching) isel.setCache(&cached);
+        isel.setScheduler(scheduler.get());
+        isel.setConstantMulDiv(options.constantMulDiv);
+        isel.generate(*module);
+        log << "代码生成完成\n";
+    }
+
+    phase.next("write");
+    emitter->finish();
+    phase.stop();
+    if (options.emitObject && options.verifyObject) {
+        auto count = static_cast<ObjectEmitter&>(*emitter).instructionCount();
+        log << "目标文件校验通过: " << count << "条指令\n";
+    }
+    if (stats) {
+        stats->add("functions", program->functions.size());
+        stats->add("labels", emitter->labels());
+        stats->add("instructions", emitter->instructions());
+        stats->add("bytes_written", emitter->bytesWritten());
+    }
+}
@@ -0,0 +1,301 @@
+#include "emitter.h"
+#include "encoder.h"
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+void AsmEmitter::countLines(const std::vector<AsmInst>& code) {
+    for (const AsmInst& inst : code) {
+        switch (inst.op) {
+            case AsmOp::Label: ++labelLines; break;
+            case AsmOp::Comment: case AsmOp::Directive: case AsmOp::Nop: break;
+            default: ++instructionLines; break;
+        }
+    }
+}
+
+TextEmitter::TextEmitter(const std::string& outputFile, bool comments)
+    : output(outputFile, std::ios::binary), comments(comments) {
+    if (!output.is_open()) {
+        throw std::runtime_error("无法创建输出文件: " + outputFile);
+    }
+}
+
+void TextEmitter::emit(const std::vector<AsmInst>& code) {
+    countLines(code);
+    for (const AsmInst& inst : code) {
+        if (inst.op == AsmOp::Comment && !comments) continue;
+        appendAsm(buffer, inst);
+    }
+}
+
+void TextEmitter::finish() {
+    output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    output.close();
+    written = buffer.size();
+    buffer.clear();
+}
+
+namespace {
+
+// ELF32常量（只用到可重定位文件需要的部分）
+constexpr uint16_t ET_REL = 1;
+constexpr uint16_t EM_RISCV = 243;
+constexpr uint32_t SHT_PROGBITS = 1, SHT_SYMTAB = 2, SHT_STRTAB = 3, SHT_RELA = 4;
+constexpr uint32_t SHF_ALLOC = 0x2, SHF_EXECINSTR = 0x4, SHF_INFO_LINK = 0x40;
+constexpr uint8_t STB_LOCAL = 0, STB_GLOBAL = 1;
+constexpr uint8_t STT_NOTYPE = 0, STT_FUNC = 2, STT_SECTION = 3;
+constexpr uint32_t R_RISCV_BRANCH = 16, R_RISCV_JAL = 17, R_RISCV_CALL_PLT = 19;
+constexpr uint32_t EHDR_SIZE = 52, SHDR_SIZE = 40, SYM_SIZE = 16, RELA_SIZE = 12;
+
+// 节的下标
+enum : uint16_t { SEC_NULL, SEC_TEXT, SEC_RELA, SEC_SYMTAB, SEC_STRTAB, SEC_SHSTRTAB, SEC_COUNT };
+
+class ByteWriter {
+public:
+    std::string bytes;
+
+    void u8(uint8_t value) { bytes += static_cast<char>(value); }
+    void u16(uint16_t value) {
+        u8(value & 0xff);
+        u8(value >> 8);
+    }
+    void u32(uint32_t value) {
+        u16(value & 0xffff);
+        u16(value >> 16);
+    }
+    void align(size_t alignment) {
+        while (bytes.size() % alignment) u8(0);
+    }
+};
+
+class StringTable {
+public:
+    std::string data = std::string(1, '\0');
+
+    uint32_t add(const std::string& name) {
+        uint32_t offset = static_cast<uint32_t>(data.size());
+        data += name;
+        data += '\0';
+        return offset;
+    }
+};
+
+struct ElfSymbol {
+    uint32_t name;
+    uint32_t value;
+    uint32_t size;
+    uint8_t info;
+    uint16_t shndx;
+};
+
+struct ElfReloc {
+    uint32_t offset;
+    uint32_t symbol;
+    uint32_t type;
+    int32_t addend;
+};
+
+} // namespace
+
+ObjectEmitter::ObjectEmitter(const std::string& outputFile, bool verify)
+    : output(outputFile, std::ios::binary), verify(verify) {
+    if (!output.is_open()) {
+        throw std::runtime_error("无法创建输出文件: " + outputFile);
+    }
+}
+
+void ObjectEmitter::emit(const std::vector<AsmInst>& chunk) {
+    countLines(chunk);
+    bool entry = true;
+    for (const AsmInst& inst : chunk) {
+        if (inst.op == AsmOp::Comment || inst.op == AsmOp::Nop) continue;
+        // 每段的第一个标签是函数入口
+        if (inst.op == AsmOp::Label && entry) {
+            functionStarts.push_back(code.size());
+            entry = false;
+        }
+        code.push_back(inst);
+    }
+}
+
+void ObjectEmitter::finish() {
+    // 布局：先全部按短分支排，超出范围的分支改成长分支后重排，直到不再变化
+    CodeLayout layout = layoutCode(code);
+    const std::vector<uint32_t>& offsets = layout.offsets;
+    const std::vector<bool>& longBranch = layout.longBranch;
+    const std::unordered_map<std::string, uint32_t>& labels = layout.labels;
+
+    // 符号表：空符号、.text节符号、局部函数，然后是全局函数和外部函数
+    std::unordered_set<std::string> globals;
+    for (const AsmInst& inst : code) {
+        if (inst.op == AsmOp::Directive && inst.text.compare(0, 7, ".globl ") == 0) {
+            globals.insert(inst.text.substr(7));
+        }
+    }
+    StringTable strtab;
+    std::vector<ElfSymbol> symbols = {{0, 0, 0, 0, 0}, {0, 0, 0, STT_SECTION, SEC_TEXT}};
+    std::vector<ElfSymbol> globalSymbols;
+    std::vector<std::string> globalNames;
+    std::unordered_map<std::string, uint32_t> functionSymbols; // 函数名 -> 在globalSymbols/symbols中的位置
+    for (size_t f = 0; f < functionStarts.size(); ++f) {
+        const std::string& name = code[functionStarts[f]].text;
+        uint32_t start = offsets[functionStarts[f]];
+        uint32_t end = f + 1 < functionStarts.size() ? offsets[functionStarts[f + 1]] : offsets[code.size()];
+        bool global = globals.count(name) > 0;
+        ElfSymbol symbol{strtab.add(name), start, end - start,
+                         static_cast<uint8_t>((global ? STB_GLOBAL : STB_LOCAL) << 4 | STT_FUNC), SEC_TEXT};
+        if (global) {
+            globalNames.push_back(name);
+            globalSymbols.push_back(symbol);
+        } else {
+            functionSymbols[name] = static_cast<uint32_t>(symbols.size());
+            symbols.push_back(symbol);
+        }
+    }
+    uint32_t firstGlobal = static_cast<uint32_t>(symbols.size());
+    for (size_t g = 0; g < globalSymbols.size(); ++g) {
+        functionSymbols[globalNames[g]] = static_cast<uint32_t>(symbols.size());
+        symbols.push_back(globalSymbols[g]);
+    }
+    auto functionSymbol = [&](const std::string& name) {
+        auto it = functionSymbols.find(name);
+        if (it != functionSymbols.end()) return it->second;
+        // 本文件没有定义的函数作为未定义的全局符号
+        uint32_t index = static_cast<uint32_t>(symbols.size());
+        symbols.push_back({strtab.add(name), 0, 0, STB_GLOBAL << 4 | STT_NOTYPE, 0});
+        functionSymbols[name] = index;
+        return index;
+    };
+
+    // 编码。文件内的跳转和调用直接填好偏移，不链接也能按位置无关代码运行；同时照常生成重定位
+    // （分支对.text节符号加偏移量，调用对函数符号），链接器重定位后结果不变
+    ByteWriter text;
+    std::vector<ElfReloc> relocs;
+    std::vector<MachineInst> machine;
+    for (size_t i = 0; i < code.size(); ++i) {
+        const AsmInst& inst = code[i];
+        if (!isInstruction(inst)) {
+            if (inst.op == AsmOp::Directive && !inst.text.empty() && inst.text != ".text" &&
+                inst.text.compare(0, 7, ".globl ") != 0) {
+                throw std::runtime_error("目标文件: 不支持的伪操作 " + inst.text);
+            }
+            continue;
+        }
+        int32_t offset = 0;
+        if (inst.op == AsmOp::Call || inst.op == AsmOp::Tail) {
+            relocs.push_back({offsets[i], functionSymbol(inst.text), R_RISCV_CALL_PLT, 0});
+            auto it = labels.find(inst.text);
+            if (it != labels.end()) offset = static_cast<int32_t>(it->second - offsets[i]);
+        } else if (isBranch(inst.op) || inst.op == AsmOp::J) {
+            uint32_t target = layout.target(inst);
+            offset = static_cast<int32_t>(target - offsets[i]);
+            bool jal = inst.op == AsmOp::J || longBranch[i];
+            uint32_t at = offsets[i] + (inst.op != AsmOp::J && longBranch[i] ? 4 : 0);
+            relocs.push_back({at, 1, jal ? R_RISCV_JAL : R_RISCV_BRANCH, static_cast<int32_t>(target)});
+        }
+        machine.clear();
+        lowerAsmInst(inst, offset, longBranch[i], machine);
+        for (const MachineInst& m : machine) {
+            uint32_t word = encode(m);
+            if (verify) {
+                std::string expected = formatMachineInst(m);
+                std::string decoded = disassemble(word);
+                if (decoded != expected) {
+                    throw std::runtime_error("目标文件校验失败: " + expected + " 编码后反汇编为 " +
+                                             (decoded.empty() ? "<未知指令>" : decoded));
+                }
+            }
+            text.u32(word);
+            ++encodedCount;
+        }
+    }
+    if (text.bytes.size() != offsets[code.size()]) {
+        throw std::runtime_error("目标文件: 指令布局与编码长度不一致");
+    }
+
+    ByteWriter rela;
+    for (const ElfReloc& reloc : relocs) {
+        rela.u32(reloc.offset);
+        rela.u32(reloc.symbol << 8 | reloc.type);
+        rela.u32(static_cast<uint32_t>(reloc.addend));
+    }
+    ByteWriter symtab;
+    for (const ElfSymbol& symbol : symbols) {
+        symtab.u32(symbol.name);
+        symtab.u32(symbol.value);
+        symtab.u32(symbol.size);
+        symtab.u8(symbol.info);
+        symtab.u8(0);
+        symtab.u16(symbol.shndx);
+    }
+    StringTable shstrtab;
+    uint32_t sectionNames[SEC_COUNT] = {0, shstrtab.add(".text"), shstrtab.add(".rela.text"),
+                                        shstrtab.add(".symtab"), shstrtab.add(".strtab"),
+                                        shstrtab.add(".shstrtab")};
+
+    // 文件布局：ELF头、各节内容、节头表
+    ByteWriter file;
+    file.bytes.resize(EHDR_SIZE);
+    uint32_t sectionOffsets[SEC_COUNT] = {};
+    uint32_t sectionSizes[SEC_COUNT] = {};
+    const std::string* contents[SEC_COUNT] = {nullptr, &text.bytes, &rela.bytes, &symtab.bytes,
+                                              &strtab.data, &shstrtab.data};
+    for (int s = SEC_TEXT; s < SEC_COUNT; ++s) {
+        file.align(4);
+        sectionOffsets[s] = static_cast<uint32_t>(file.bytes.size());
+        sectionSizes[s] = static_cast<uint32_t>(contents[s]->size());
+        file.bytes += *contents[s];
+    }
+    file.align(4);
+    uint32_t sectionHeaders = static_cast<uint32_t>(file.bytes.size());
+
+    struct SectionHeader {
+        uint32_t type, flags, link, info, align, entsize;
+    };
+    const SectionHeader headers[SEC_COUNT] = {
+        {0, 0, 0, 0, 0, 0},
+        {SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, 0, 0, 4, 0},
+        {SHT_RELA, SHF_INFO_LINK, SEC_SYMTAB, SEC_TEXT, 4, RELA_SIZE},
+        {SHT_SYMTAB, 0, SEC_STRTAB, firstGlobal, 4, SYM_SIZE},
+        {SHT_STRTAB, 0, 0, 0, 1, 0},
+        {SHT_STRTAB, 0, 0, 0, 1, 0},
+    };
+    for (int s = 0; s < SEC_COUNT; ++s) {
+        const SectionHeader& h = headers[s];
+        file.u32(sectionNames[s]);
+        file.u32(h.type);
+        file.u32(h.flags);
+        file.u32(0); // sh_addr
+        file.u32(sectionOffsets[s]);
+        file.u32(sectionSizes[s]);
+        file.u32(h.link);
+        file.u32(h.info);
+        file.u32(h.align);
+        file.u32(h.entsize);
+    }
+
+    ByteWriter header;
+    const uint8_t ident[16] = {0x7f, 'E', 'L', 'F', 1 /* ELFCLASS32 */, 1 /* 小端 */, 1 /* EV_CURRENT */};
+    for (uint8_t byte : ident) header.u8(byte);
+    header.u16(ET_REL);
+    header.u16(EM_RISCV);
+    header.u32(1);  // e_version
+    header.u32(0);  // e_entry
+    header.u32(0);  // e_phoff
+    header.u32(sectionHeaders);
+    header.u32(0);  // e_flags：软浮点ABI，无压缩指令
+    header.u16(EHDR_SIZE);
+    header.u16(0);  // e_phentsize
+    header.u16(0);  // e_phnum
+    header.u16(SHDR_SIZE);
+    header.u16(SEC_COUNT);
+    header.u16(SEC_SHSTRTAB);
+    file.bytes.replace(0, EHDR_SIZE, header.bytes);
+
+    output.write(file.bytes.data(), static_cast<std::streamsize>(file.bytes.size()));
+    output.close();
+    written = file.bytes.size();
+    code.clear();
+    functionStarts.clear();
+}
@@ -0,0 +1,344 @@
+#include "encoder.h"
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+// Shift是立即数移位：I型编码，imm的高7位是funct7（srai为0x20），低5位是移位量
+enum class RvFormat : uint8_t { R, I, Shift, Load, Store, B, U, J };
+
+struct RvOpInfo {
+    const char* name;
+    RvFormat format;
+    uint32_t opcode;
+    uint32_t funct3;
+    uint32_t funct7;
+};
+
+// 按RvOp的顺序排列
+const RvOpInfo RV_OPS[] = {
+    {"add", RvFormat::R, 0x33, 0, 0x00},   {"sub", RvFormat::R, 0x33, 0, 0x20},
+    {"mul", RvFormat::R, 0x33, 0, 0x01},   {"mulh", RvFormat::R, 0x33, 1, 0x01},
+    {"div", RvFormat::R, 0x33, 4, 0x01},   {"rem", RvFormat::R, 0x33, 6, 0x01},
+    {"xor", RvFormat::R, 0x33, 4, 0x00},   {"slt", RvFormat::R, 0x33, 2, 0x00},
+    {"sltu", RvFormat::R, 0x33, 3, 0x00},
+    {"addi", RvFormat::I, 0x13, 0, 0},     {"andi", RvFormat::I, 0x13, 7, 0},
+    {"xori", RvFormat::I, 0x13, 4, 0},     {"slti", RvFormat::I, 0x13, 2, 0},
+    {"sltiu", RvFormat::I, 0x13, 3, 0},    {"slli", RvFormat::Shift, 0x13, 1, 0x00},
+    {"srli", RvFormat::Shift, 0x13, 5, 0x00}, {"srai", RvFormat::Shift, 0x13, 5, 0x20},
+    {"lw", RvFormat::Load, 0x03, 2, 0},    {"sw", RvFormat::Store, 0x23, 2, 0},
+    {"beq", RvFormat::B, 0x63, 0, 0},      {"bne", RvFormat::B, 0x63, 1, 0},
+    {"blt", RvFormat::B, 0x63, 4, 0},      {"bge", RvFormat::B, 0x63, 5, 0},
+    {"lui", RvFormat::U, 0x37, 0, 0},      {"auipc", RvFormat::U, 0x17, 0, 0},
+    {"jal", RvFormat::J, 0x6f, 0, 0},      {"jalr", RvFormat::Load, 0x67, 0, 0},
+};
+
+const RvOpInfo& info(RvOp op) {
+    return RV_OPS[static_cast<int>(op)];
+}
+
+uint32_t reg(Register r) {
+    return static_cast<uint32_t>(r);
+}
+
+int32_t signExtend(uint32_t value, int bits) {
+    uint32_t sign = 1u << (bits - 1);
+    return static_cast<int32_t>((value ^ sign) - sign);
+}
+
+bool fitsSigned(int32_t value, int bits) {
+    return value >= -(1 << (bits - 1)) && value < (1 << (bits - 1));
+}
+
+void checkRange(const MachineInst& inst, int bits, bool even) {
+    if (!fitsSigned(inst.imm, bits) || (even && (inst.imm & 1))) {
+        throw std::runtime_error("指令编码: " + std::string(info(inst.op).name) + "的立即数" +
+                                 std::to_string(inst.imm) + "超出范围");
+    }
+}
+
+// 大立即数拆成高20位和低12位，低12位按有符号数算
+void splitImmediate(int32_t value, int32_t& hi, int32_t& lo) {
+    uint32_t upper = (static_cast<uint32_t>(value) + 0x800) >> 12;
+    hi = static_cast<int32_t>(upper & 0xfffff);
+    lo = static_cast<int32_t>(static_cast<uint32_t>(value) - (upper << 12));
+}
+
+RvOp rvOpOf(AsmOp op) {
+    switch (op) {
+        case AsmOp::Add: return RvOp::Add;
+        case AsmOp::Sub: return RvOp::Sub;
+        case AsmOp::Mul: return RvOp::Mul;
+        case AsmOp::Mulh: return RvOp::Mulh;
+        case AsmOp::Div: return RvOp::Div;
+        case AsmOp::Rem: return RvOp::Rem;
+        case AsmOp::Xor: return RvOp::Xor;
+        case AsmOp::Slt: return RvOp::Slt;
+        case AsmOp::Addi: return RvOp::Addi;
+        case AsmOp::Andi: return RvOp::Andi;
+        case AsmOp::Xori: return RvOp::Xori;
+        case AsmOp::Slti: return RvOp::Slti;
+        case AsmOp::Slli: return RvOp::Slli;
+        case AsmOp::Srli: return RvOp::Srli;
+        case AsmOp::Srai: return RvOp::Srai;
+        case AsmOp::Lw: return RvOp::Lw;
+        case AsmOp::Sw: return RvOp::Sw;
+        case AsmOp::Beq: case AsmOp::Beqz: return RvOp::Beq;
+        case AsmOp::Bne: case AsmOp::Bnez: return RvOp::Bne;
+        case AsmOp::Blt: return RvOp::Blt;
+        case AsmOp::Bge: return RvOp::Bge;
+        default: throw std::runtime_error("指令编码: " + std::string(asmOpName(op)) + "不是机器指令");
+    }
+}
+
+RvOp invert(RvOp op) {
+    switch (op) {
+        case RvOp::Beq: return RvOp::Bne;
+        case RvOp::Bne: return RvOp::Beq;
+        case RvOp::Blt: return RvOp::Bge;
+        default: return RvOp::Blt;
+    }
+}
+
+} // namespace
+
+int encodedSize(const AsmInst& inst, bool longBranch) {
+    if (!isInstruction(inst)) return 0;
+    switch (inst.op) {
+        case AsmOp::Li: {
+            if (fitsImm12(inst.imm)) return 4;
+            int32_t hi, lo;
+            splitImmediate(inst.imm, hi, lo);
+            return lo == 0 ? 4 : 8;
+        }
+        case AsmOp::Call:
+        case AsmOp::Tail:
+            return 8;
+        default:
+            return isBranch(inst.op) && longBranch ? 8 : 4;
+    }
+}
+
+void lowerAsmInst(const AsmInst& inst, int32_t offset, bool longBranch, std::vector<MachineInst>& out) {
+    auto add = [&](RvOp op, Register rd, Register rs1, Register rs2, int32_t imm) {
+        out.push_back(MachineInst{op, rd, rs1, rs2, imm});
+    };
+    const Register zero = Register::ZERO;
+    switch (inst.op) {
+        case AsmOp::Add: case AsmOp::Sub: case AsmOp::Mul: case AsmOp::Mulh: case AsmOp::Div:
+        case AsmOp::Rem: case AsmOp::Xor: case AsmOp::Slt:
+            add(rvOpOf(inst.op), inst.rd, inst.rs1, inst.rs2, 0);
+            break;
+        case AsmOp::Addi: case AsmOp::Andi: case AsmOp::Xori: case AsmOp::Slti: case AsmOp::Slli:
+        case AsmOp::Srli: case AsmOp::Srai: case AsmOp::Lw:
+            add(rvOpOf(inst.op), inst.rd, inst.rs1, zero, inst.imm);
+            break;
+        case AsmOp::Sw:
+            add(RvOp::Sw, zero, inst.rs1, inst.rs2, inst.imm);
+            break;
+        case AsmOp::Li: {
+            if (fitsImm12(inst.imm)) {
+                add(RvOp::Addi, inst.rd, zero, zero, inst.imm);
+                break;
+            }
+            int32_t hi, lo;
+            splitImmediate(inst.imm, hi, lo);
+            add(RvOp::Lui, inst.rd, zero, zero, hi);
+            if (lo != 0) add(RvOp::Addi, inst.rd, inst.rd, zero, lo);
+            break;
+        }
+        case AsmOp::Mv: add(RvOp::Addi, inst.rd, inst.rs1, zero, 0); break;
+        case AsmOp::Neg: add(RvOp::Sub, inst.rd, zero, inst.rs1, 0); break;
+        case AsmOp::Seqz: add(RvOp::Sltiu, inst.rd, inst.rs1, zero, 1); break;
+        case AsmOp::Snez: add(RvOp::Sltu, inst.rd, zero, inst.rs1, 0); break;
+        case AsmOp::Beq: case AsmOp::Bne: case AsmOp::Blt: case AsmOp::Bge:
+        case AsmOp::Beqz: case AsmOp::Bnez: {
+            RvOp op = rvOpOf(inst.op);
+            if (longBranch) {
+                // 反向分支跳过紧跟的jal
+                add(invert(op), zero, inst.rs1, inst.rs2, 8);
+                add(RvOp::Jal, zero, zero, zero, offset - 4);
+            } else {
+                add(op, zero, inst.rs1, inst.rs2, offset);
+            }
+            break;
+        }
+        case AsmOp::J: add(RvOp::Jal, zero, zero, zero, offset); break;
+        case AsmOp::Call:
+        case AsmOp::Tail: {
+            int32_t hi, lo;
+            splitImmediate(offset, hi, lo);
+            Register link = inst.op == AsmOp::Call ? Register::RA : Register::T1;
+            add(RvOp::Auipc, link, zero, zero, hi);
+            add(RvOp::Jalr, inst.op == AsmOp::Call ? Register::RA : zero, link, zero, lo);
+            break;
+        }
+        case AsmOp::Ret: add(RvOp::Jalr, zero, Register::RA, zero, 0); break;
+        default: break;
+    }
+}
+
+uint32_t encode(const MachineInst& inst) {
+    const RvOpInfo& op = info(inst.op);
+    uint32_t imm = static_cast<uint32_t>(inst.imm);
+    uint32_t fields = reg(inst.rs1) << 15 | op.funct3 << 12 | op.opcode;
+    switch (op.format) {
+        case RvFormat::R:
+            return op.funct7 << 25 | reg(inst.rs2) << 20 | fields | reg(inst.rd) << 7;
+        case RvFormat::I:
+        case RvFormat::Load:
+            checkRange(inst, 12, false);
+            return (imm & 0xfff) << 20 | fields | reg(inst.rd) << 7;
+        case RvFormat::Shift:
+            if (inst.imm < 0 || inst.imm > 31) {
+                throw std::runtime_error("指令编码: " + std::string(op.name) + "的移位量" +
+                                         std::to_string(inst.imm) + "超出范围");
+            }
+            return op.funct7 << 25 | imm << 20 | fields | reg(inst.rd) << 7;
+        case RvFormat::Store:
+            checkRange(inst, 12, false);
+            return (imm >> 5 & 0x7f) << 25 | reg(inst.rs2) << 20 | fields | (imm & 0x1f) << 7;
+        case RvFormat::B:
+            checkRange(inst, 13, true);
+            return (imm >> 12 & 1) << 31 | (imm >> 5 & 0x3f) << 25 | reg(inst.rs2) << 20 | fields |
+                   (imm >> 1 & 0xf) << 8 | (imm >> 11 & 1) << 7;
+        case RvFormat::U:
+            return (imm & 0xfffff) << 12 | reg(inst.rd) << 7 | op.opcode;
+        case RvFormat::J:
+            checkRange(inst, 21, true);
+            return (imm >> 20 & 1) << 31 | (imm >> 1 & 0x3ff) << 21 | (imm >> 11 & 1) << 20 |
+                   (imm >> 12 & 0xff) << 12 | reg(inst.rd) << 7 | op.opcode;
+    }
+    return 0;
+}
+
+std::string formatMachineInst(const MachineInst& inst) {
+    const RvOpInfo& op = info(inst.op);
+    std::string text = std::string(op.name) + " ";
+    std::string imm = std::to_string(inst.imm);
+    switch (op.format) {
+        case RvFormat::R:
+            return text + regName(inst.rd) + ", " + regName(inst.rs1) + ", " + regName(inst.rs2);
+        case RvFormat::I:
+        case RvFormat::Shift:
+            return text + regName(inst.rd) + ", " + regName(inst.rs1) + ", " + imm;
+        case RvFormat::Load:
+            return text + regName(inst.rd) + ", " + imm + "(" + regName(inst.rs1) + ")";
+        case RvFormat::Store:
+            return text + regName(inst.rs2) + ", " + imm + "(" + regName(inst.rs1) + ")";
+        case RvFormat::B:
+            return text + regName(inst.rs1) + ", " + regName(inst.rs2) + ", " + imm;
+        case RvFormat::U:
+            return text + regName(inst.rd) + ", " + std::to_string(inst.imm & 0xfffff);
+        case RvFormat::J:
+            return text + regName(inst.rd) + ", " + imm;
+    }
+    return text;
+}
+
+bool decode(uint32_t word, MachineInst& inst) {
+    uint32_t opcode = word & 0x7f;
+    uint32_t funct3 = word >> 12 & 7;
+    uint32_t funct7 = word >> 25;
+    inst = MachineInst{RvOp::Add};
+    inst.rd = static_cast<Register>(word >> 7 & 31);
+    inst.rs1 = static_cast<Register>(word >> 15 & 31);
+    inst.rs2 = static_cast<Register>(word >> 20 & 31);
+    int32_t immI = signExtend(word >> 20, 12);
+    auto find = [&](RvFormat format, bool matchFunct7) {
+        for (size_t i = 0; i < std::size(RV_OPS); ++i) {
+            const RvOpInfo& op = RV_OPS[i];
+            if (op.opcode != opcode || op.format != format) continue;
+            if (format != RvFormat::U && format != RvFormat::J && op.funct3 != funct3) continue;
+            if (matchFunct7 && op.funct7 != funct7) continue;
+            inst.op = static_cast<RvOp>(i);
+            return true;
+        }
+        return false;
+    };
+    switch (opcode) {
+        case 0x33:
+            if (!find(RvFormat::R, true)) return false;
+            inst.imm = 0;
+            break;
+        case 0x13:
+            if (funct3 == 1 || funct3 == 5) {
+                if (!find(RvFormat::Shift, true)) return false;
+                inst.imm = static_cast<int32_t>(word >> 20 & 31);
+            } else {
+                if (!find(RvFormat::I, false)) return false;
+                inst.imm = immI;
+            }
+            break;
+        case 0x03:
+        case 0x67:
+            if (!find(RvFormat::Load, false)) return false;
+            inst.imm = immI;
+            break;
+        case 0x23:
+            if (!find(RvFormat::Store, false)) return false;
+            inst.imm = signExtend((word >> 25) << 5 | (word >> 7 & 0x1f), 12);
+            break;
+        case 0x63:
+            if (!find(RvFormat::B, false)) return false;
+            inst.imm = signExtend((word >> 31) << 12 | (word >> 7 & 1) << 11 | (word >> 25 & 0x3f) << 5 |
+                                  (word >> 8 & 0xf) << 1, 13);
+            break;
+        case 0x37:
+        case 0x17:
+            if (!find(RvFormat::U, false)) return false;
+            inst.imm = static_cast<int32_t>(word >> 12);
+            break;
+        case 0x6f:
+            if (!find(RvFormat::J, false)) return false;
+            inst.imm = signExtend((word >> 31) << 20 | (word >> 12 & 0xff) << 12 | (word >> 20 & 1) << 11 |
+                                  (word >> 21 & 0x3ff) << 1, 21);
+            break;
+        default:
+            return false;
+    }
+    // 格式里用不到的字段按编码器的约定清零，两边才能逐字比较
+    switch (info(inst.op).format) {
+        case RvFormat::I: case RvFormat::Shift: case RvFormat::Load: inst.rs2 = Register::ZERO; break;
+        case RvFormat::Store: case RvFormat::B: inst.rd = Register::ZERO; break;
+        case RvFormat::U: case RvFormat::J: inst.rs1 = inst.rs2 = Register::ZERO; break;
+        default: break;
+    }
+    return true;
+}
+
+std::string disassemble(uint32_t word) {
+    MachineInst inst{RvOp::Add};
+    return decode(word, inst) ? formatMachineInst(inst) : "";
+}
+
+CodeLayout layoutCode(const std::vector<AsmInst>& code) {
+    CodeLayout layout;
+    layout.longBranch.assign(code.size(), false);
+    layout.offsets.resize(code.size() + 1);
+    for (bool changed = true; changed;) {
+        layout.labels.clear();
+        uint32_t pc = 0;
+        for (size_t i = 0; i < code.size(); ++i) {
+            layout.offsets[i] = pc;
+            if (code[i].op == AsmOp::Label && !layout.labels.emplace(code[i].text, pc).second) {
+                throw std::runtime_error("指令布局: 重复定义的标签 " + code[i].text);
+            }
+            pc += encodedSize(code[i], layout.longBranch[i]);
+        }
+        layout.offsets[code.size()] = pc;
+        changed = false;
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (!isBranch(code[i].op) || layout.longBranch[i]) continue;
+            int32_t offset = static_cast<int32_t>(layout.target(code[i]) - layout.offsets[i]);
+            if (offset < -4096 || offset >= 4096) layout.longBranch[i] = changed = true;
+        }
+    }
+    return layout;
+}
+
+uint32_t CodeLayout::target(const AsmInst& inst) const {
+    auto it = labels.find(inst.text);
+    if (it == labels.end()) throw std::runtime_error("指令布局: 未定义的标签 " + inst.text);
+    return it->second;
+}
@@ -0,0 +1,365 @@
+#include "fncache.h"
+#include "lexer.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char ENTRY_MAGIC[8] = {'T', 'O', 'Y', 'C', 'F', 'N', '0', '2'};
+const char* const ENTRY_SUFFIX = ".fn";
+
+// 128位散列：两路独立的64位散列，键冲突的概率可以忽略
+class Hasher {
+public:
+    void bytes(const void* data, size_t size) {
+        auto p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            a = (a ^ p[i]) * 0x100000001b3ULL;
+            b = ((b << 5 | b >> 59) ^ p[i]) * 0x9e3779b97f4a7c15ULL;
+        }
+    }
+    void string(std::string_view text) {
+        uint32_t size = static_cast<uint32_t>(text.size());
+        bytes(&size, sizeof(size));
+        bytes(text.data(), text.size());
+    }
+    void number(uint64_t value) { bytes(&value, sizeof(value)); }
+
+    std::string hex() const {
+        std::ostringstream out;
+        out << std::hex << std::setfill('0') << std::setw(16) << mix(a) << std::setw(16) << mix(b ^ a);
+        return out.str();
+    }
+    uint64_t value() const { return mix(a) ^ mix(b) * 31; }
+
+private:
+    uint64_t a = 0xcbf29ce484222325ULL;
+    uint64_t b = 0x84222325cbf29ce4ULL;
+
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+};
+
+// 编译器本身的散列：编译器换了版本，缓存的代码一律作废
+const std::string& compilerFingerprint() {
+    static const std::string fingerprint = [] {
+        Hasher hasher;
+        std::ifstream exe("/proc/self/exe", std::ios::binary);
+        if (exe) {
+            std::string content((std::istreambuf_iterator<char>(exe)), std::istreambuf_iterator<char>());
+            hasher.string(content);
+        } else {
+            hasher.string(__DATE__ " " __TIME__);
+        }
+        return hasher.hex();
+    }();
+    return fingerprint;
+}
+
+// 收集函数体中调用到的函数名
+void collectCallees(const ASTNode* node, std::set<SymbolId>& callees) {
+    if (!node) return;
+    switch (node->kind) {
+        case NodeKind::Block:
+            for (auto stmt : static_cast<const Block*>(node)->stmts) collectCallees(stmt, callees);
+            break;
+        case NodeKind::VarDecl: collectCallees(static_cast<const VarDecl*>(node)->initExpr, callees); break;
+        case NodeKind::Assign: collectCallees(static_cast<const Assign*>(node)->expr, callees); break;
+        case NodeKind::IfStmt: {
+            auto stmt = static_cast<const IfStmt*>(node);
+            collectCallees(stmt->cond, callees);
+            collectCallees(stmt->thenStmt, callees);
+            collectCallees(stmt->elseStmt, callees);
+            break;
+        }
+        case NodeKind::WhileStmt: {
+            auto stmt = static_cast<const WhileStmt*>(node);
+            collectCallees(stmt->cond, callees);
+            collectCallees(stmt->body, callees);
+            break;
+        }
+        case NodeKind::ReturnStmt: collectCallees(static_cast<const ReturnStmt*>(node)->expr, callees); break;
+        case NodeKind::ExprStmt: collectCallees(static_cast<const ExprStmt*>(node)->expr, callees); break;
+        case NodeKind::BinaryExpr: {
+            auto expr = static_cast<const BinaryExpr*>(node);
+            collectCallees(expr->lhs, callees);
+            collectCallees(expr->rhs, callees);
+            break;
+        }
+        case NodeKind::UnaryExpr: collectCallees(static_cast<const UnaryExpr*>(node)->expr, callees); break;
+        case NodeKind::FuncCall: {
+            auto call = static_cast<const FuncCall*>(node);
+            callees.insert(call->name);
+            for (auto arg : call->args) collectCallees(arg, callees);
+            break;
+        }
+        default: break;
+    }
+}
+
+// 按顶层花括号把源码切成各个函数，返回每个函数的词法单元散列和函数名；有词法错误时返回false
+bool hashFunctionTokens(std::string_view source, std::vector<uint64_t>& hashes,
+                        std::vector<std::string_view>& functionNames) {
+    ViewLexer lexer(source);
+    Hasher hasher;
+    int depth = 0;
+    size_t tokensInFunction = 0;
+    bool hasBody = false;
+    for (TokenView token = lexer.nextToken(); token.type != TokenType::END_OF_FILE; token = lexer.nextToken()) {
+        if (token.type == TokenType::ERROR) return false;
+        if (tokensInFunction++ == 1) functionNames.push_back(token.text);
+        hasher.number(static_cast<uint64_t>(token.type));
+        hasher.string(token.text);
+        if (token.type == TokenType::LBRACE) {
+            ++depth;
+            hasBody = true;
+        } else if (token.type == TokenType::RBRACE && --depth == 0 && hasBody) {
+            hashes.push_back(hasher.value());
+            hasher = Hasher();
+            tokensInFunction = 0;
+            hasBody = false;
+        }
+    }
+    return tokensInFunction == 0 && hashes.size() == functionNames.size();
+}
+
+} // namespace
+
+FunctionCache::FunctionCache(std::string directory, uint64_t maxBytes)
+    : directory(std::move(directory)), maxBytes(maxBytes) {
+    std::error_code error;
+    fs::create_directories(this->directory, error);
+    if (error) throw std::runtime_error("无法创建缓存目录" + this->directory + ": " + error.message());
+}
+
+std::string FunctionCache::pathOf(const std::string& key) const {
+    return (fs::path(directory) / (key + ENTRY_SUFFIX)).string();
+}
+
+bool FunctionCache::lookup(const std::string& key, std::vector<AsmInst>& code) {
+    std::string path = pathOf(key);
+    std::ifstream in(path, std::ios::binary);
+    std::string data;
+    if (in) data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+    // 格式：魔数、指令条数，每条指令为操作码、rd、rs1、rs2各1字节，imm 4字节，文本长度4字节和文本
+    size_t pos = 0;
+    auto read = [&](void* out, size_t size) {
+        if (data.size() - pos < size) return false;
+        std::memcpy(out, data.data() + pos, size);
+        pos += size;
+        return true;
+    };
+    char magic[sizeof(ENTRY_MAGIC)];
+    uint32_t count = 0;
+    bool valid = read(magic, sizeof(magic)) && std::memcmp(magic, ENTRY_MAGIC, sizeof(magic)) == 0 &&
+                 read(&count, sizeof(count));
+    std::vector<AsmInst> entry;
+    for (uint32_t i = 0; valid && i < count; ++i) {
+        uint8_t fields[4];
+        uint32_t length = 0;
+        AsmInst inst;
+        valid = read(fields, sizeof(fields)) && read(&inst.imm, sizeof(inst.imm)) && read(&length, sizeof(length)) &&
+                fields[0] <= static_cast<uint8_t>(AsmOp::Nop) && fields[1] < 32 && fields[2] < 32 && fields[3] < 32 &&
+                data.size() - pos >= length;
+        if (!valid) break;
+        inst.op = static_cast<AsmOp>(fields[0]);
+        inst.rd = static_cast<Register>(fields[1]);
+        inst.rs1 = static_cast<Register>(fields[2]);
+        inst.rs2 = static_cast<Register>(fields[3]);
+        inst.text.assign(data, pos, length);
+        pos += length;
+        entry.push_back(std::move(inst));
+    }
+    if (!valid || pos != data.size()) {
+        ++misses;
+        return false;
+    }
+
+    // 修改时间即最近使用时间，淘汰时先删最旧的
+    std::error_code error;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+    code = std::move(entry);
+    ++hits;
+    return true;
+}
+
+void FunctionCache::store(const std::string& key, const std::vector<AsmInst>& code) {
+    std::string data(ENTRY_MAGIC, sizeof(ENTRY_MAGIC));
+    auto write = [&](const void* value, size_t size) { data.append(static_cast<const char*>(value), size); };
+    uint32_t count = static_cast<uint32_t>(code.size());
+    write(&count, sizeof(count));
+    for (const AsmInst& inst : code) {
+        uint8_t fields[4] = {static_cast<uint8_t>(inst.op), static_cast<uint8_t>(inst.rd),
+                             static_cast<uint8_t>(inst.rs1), static_cast<uint8_t>(inst.rs2)};
+        uint32_t length = static_cast<uint32_t>(inst.text.size());
+        write(fields, sizeof(fields));
+        write(&inst.imm, sizeof(inst.imm));
+        write(&length, sizeof(length));
+        data += inst.text;
+    }
+
+    // 写完临时文件再改名，别的线程或进程不会读到写了一半的条目
+    static std::atomic<uint64_t> serial{0};
+    std::string path = pathOf(key);
+    std::string temp = path + ".tmp" + std::to_string(getpid()) + "_" + std::to_string(serial++);
+    {
+        std::ofstream out(temp, std::ios::binary);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!out) {
+            std::error_code error;
+            fs::remove(temp, error);
+            return;
+        }
+    }
+    std::error_code error;
+    fs::rename(temp, path, error);
+    if (error) {
+        fs::remove(temp, error);
+        return;
+    }
+    ++stores;
+}
+
+void FunctionCache::evict() {
+    struct Entry {
+        fs::file_time_type time;
+        uint64_t size;
+        fs::path path;
+    };
+    std::vector<Entry> entries;
+    totalBytes = 0;
+    std::error_code error;
+    for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        if (it->path().extension() != ENTRY_SUFFIX) continue;
+        std::error_code statError;
+        uint64_t size = it->file_size(statError);
+        auto time = it->last_write_time(statError);
+        if (statError) continue;
+        entries.push_back({time, size, it->path()});
+        totalBytes += size;
+    }
+    if (totalBytes <= maxBytes) return;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+    for (const Entry& entry : entries) {
+        if (totalBytes <= maxBytes) break;
+        // 别的进程可能已经删掉了，照样从总大小中扣除
+        fs::remove(entry.path, error);
+        totalBytes -= entry.size;
+        ++evictedEntries;
+        evictedBytes += entry.size;
+    }
+}
+
+void FunctionCache::printStats(std::ostream& out) const {
+    uint64_t lookups = hits + misses;
+    out << "函数缓存统计（" << directory << "）:\n";
+    out << "  命中              " << std::setw(8) << hits << "\n";
+    out << "  未命中            " << std::setw(8) << misses << "\n";
+    out << "  命中率            " << std::setw(7) << std::fixed << std::setprecision(1)
+        << (lookups ? 100.0 * hits / lookups : 0.0) << "%\n";
+    out << "  写入              " << std::setw(8) << stores << "\n";
+    out << "  淘汰              " << std::setw(8) << evictedEntries << "条, " << evictedBytes << "字节\n";
+    out << "  当前大小          " << std::setw(8) << totalBytes << "字节（上限" << maxBytes << "字节）\n";
+}
+
+size_t CachedFunctions::hitCount() const {
+    return static_cast<size_t>(std::count(hit.begin(), hit.end(), true));
+}
+
+std::vector<std::string> functionCacheKeys(std::string_view source, const Program* program,
+                                           const StringInterner& names, const std::string& configuration,
+                                           bool calleeBodies) {
+    std::vector<uint64_t> tokenHashes;
+    std::vector<std::string_view> tokenNames;
+    if (!hashFunctionTokens(source, tokenHashes, tokenNames) || tokenHashes.size() != program->functions.size()) {
+        return {};
+    }
+
+    size_t count = program->functions.size();
+    std::map<SymbolId, size_t> indexOf;
+    std::vector<std::set<SymbolId>> callees(count);
+    for (size_t i = 0; i < count; ++i) {
+        auto func = static_cast<const FunctionDef*>(program->functions[i]);
+        if (names.name(func->name) != tokenNames[i]) return {};
+        indexOf.emplace(func->name, i);
+        collectCallees(func->body, callees[i]);
+    }
+
+    std::vector<std::string> keys(count);
+    for (size_t i = 0; i < count; ++i) {
+        Hasher hasher;
+        hasher.string(compilerFingerprint());
+        hasher.string(configuration);
+        hasher.number(tokenHashes[i]);
+        // 被调函数的签名；声明在后或不存在的函数也记下来，这样的调用不会从缓存中漏过语义检查
+        for (SymbolId callee : callees[i]) {
+            hasher.string(names.name(callee));
+            auto it = indexOf.find(callee);
+            if (it == indexOf.end()) {
+                hasher.string("?");
+                continue;
+            }
+            auto def = static_cast<const FunctionDef*>(program->functions[it->second]);
+            hasher.number(static_cast<uint64_t>(def->retType));
+            hasher.number(def->params.size());
+            hasher.number(it->second <= i);
+        }
+        // 内联后函数的代码取决于整个调用闭包的函数体
+        if (calleeBodies) {
+            std::set<size_t> closure;
+            std::vector<size_t> worklist{i};
+            while (!worklist.empty()) {
+                size_t f = worklist.back();
+                worklist.pop_back();
+                for (SymbolId callee : callees[f]) {
+                    auto it = indexOf.find(callee);
+                    if (it != indexOf.end() && closure.insert(it->second).second) worklist.push_back(it->second);
+                }
+            }
+            for (size_t f : closure) hasher.number(tokenHashes[f]);
+        }
+        keys[i] = hasher.hex();
+    }
+    return keys;
+}
+
+std::vector<bool> callClosure(const Program* program, const std::vector<bool>& roots) {
+    size_t count = program->functions.size();
+    std::map<SymbolId, size_t> indexOf;
+    for (size_t i = 0; i < count; ++i) indexOf.emplace(static_cast<const FunctionDef*>(program->functions[i])->name, i);
+    std::vector<bool> reached = roots;
+    std::vector<size_t> worklist;
+    for (size_t i = 0; i < count; ++i) {
+        if (roots[i]) worklist.push_back(i);
+    }
+    while (!worklist.empty()) {
+        std::set<SymbolId> callees;
+        collectCallees(static_cast<const FunctionDef*>(program->functions[worklist.back()])->body, callees);
+        worklist.pop_back();
+        for (SymbolId callee : callees) {
+            auto it = indexOf.find(callee);
+            if (it == indexOf.end() || reached[it->second]) continue;
+            reached[it->second] = true;
+            worklist.push_back(it->second);
+        }
+    }
+    return reached;
+}
@@ -0,0 +1,222 @@
+#include "inliner.h"
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+// 一次调用本身的开销：传参、call和被调函数的序言尾声，内联后都省掉了
+const int CALL_COST = 4;
+// 常量实参让内联后的代码可以继续折叠
+const int CONSTANT_ARG_BONUS = 2;
+// 叶子函数内联后不会带来新的调用
+const int LEAF_BONUS = 4;
+
+bool hasCalls(const IRFunction& func) {
+    for (IRBlock* block : func.blocks) {
+        for (IRInst* inst : block->insts) {
+            if (inst->op == IROp::Call) return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+int functionSize(const IRFunction& func) {
+    int size = 0;
+    for (IRBlock* block : func.blocks) {
+        for (IRInst* inst : block->insts) {
+            if (inst->op != IROp::Const && inst->op != IROp::Param && inst->op != IROp::Phi) ++size;
+        }
+    }
+    return size;
+}
+
+std::vector<std::vector<IRFunction*>> Inliner::callGraphSCCs(IRModule& module) {
+    // Tarjan算法，强连通分量按被调者在前的顺序产生
+    std::unordered_map<IRFunction*, int> index, lowlink;
+    std::vector<IRFunction*> stack;
+    std::unordered_map<IRFunction*, bool> onStack;
+    std::vector<std::vector<IRFunction*>> sccs;
+    int counter = 0;
+
+    std::function<void(IRFunction*)> visit = [&](IRFunction* func) {
+        index[func] = lowlink[func] = counter++;
+        stack.push_back(func);
+        onStack[func] = true;
+        for (IRBlock* block : func->blocks) {
+            for (IRInst* inst : block->insts) {
+                if (inst->op != IROp::Call) continue;
+                IRFunction* callee = functions.at(inst->callee);
+                if (callee == func) recursive.insert(func->name);
+                if (!index.count(callee)) {
+                    visit(callee);
+                    lowlink[func] = std::min(lowlink[func], lowlink[callee]);
+                } else if (onStack[callee]) {
+                    lowlink[func] = std::min(lowlink[func], index[callee]);
+                }
+            }
+        }
+        if (lowlink[func] != index[func]) return;
+        std::vector<IRFunction*> scc;
+        IRFunction* member;
+        do {
+            member = stack.back();
+            stack.pop_back();
+            onStack[member] = false;
+            scc.push_back(member);
+        } while (member != func);
+        if (scc.size() > 1) {
+            for (IRFunction* f : scc) recursive.insert(f->name);
+        }
+        sccs.push_back(std::move(scc));
+    };
+    for (auto& func : module.functions) {
+        if (!index.count(func.get())) visit(func.get());
+    }
+    return sccs;
+}
+
+int Inliner::run(IRModule& module) {
+    functions.clear();
+    recursive.clear();
+    depthOf.clear();
+    for (auto& func : module.functions) functions[func->name] = func.get();
+
+    int inlined = 0;
+    for (auto& scc : callGraphSCCs(module)) {
+        for (IRFunction* func : scc) {
+            int size = functionSize(*func);
+            std::vector<IRInst*> worklist;
+            for (IRBlock* block : func->blocks) {
+                for (IRInst* inst : block->insts) {
+                    if (inst->op == IROp::Call) worklist.push_back(inst);
+                }
+            }
+            // 内联进来的调用追加到工作表末尾，同样参与决策
+            for (size_t i = 0; i < worklist.size(); ++i) {
+                IRInst* call = worklist[i];
+                if (!shouldInline(call, size)) continue;
+                const IRFunction& callee = *functions.at(call->callee);
+                size += functionSize(callee);
+                auto cloned = inlineCall(*func, call, callee);
+                worklist.insert(worklist.end(), cloned.begin(), cloned.end());
+                ++inlined;
+            }
+        }
+    }
+    return inlined;
+}
+
+int Inliner::inlineDepth(const IRInst* call) const {
+    auto it = depthOf.find(call);
+    return it == depthOf.end() ? 0 : it->second;
+}
+
+bool Inliner::shouldInline(const IRInst* call, int callerSize) const {
+    const IRFunction& callee = *functions.at(call->callee);
+    // 实参个数不对的调用没法把形参一一换成实参（语义分析已经报错，这里再防一道）
+    if (static_cast<int>(call->operands.size()) != callee.paramCount) return false;
+    if (recursive.count(callee.name) && inlineDepth(call) >= options.maxRecursionDepth) return false;
+    int size = functionSize(callee);
+    if (callerSize + size > options.maxFunctionSize) return false;
+
+    int cost = size - CALL_COST;
+    for (const IRInst* arg : call->operands) {
+        if (arg->op == IROp::Const) cost -= CONSTANT_ARG_BONUS;
+    }
+    if (!hasCalls(callee)) cost -= LEAF_BONUS;
+    return cost <= options.threshold;
+}
+
+std::vector<IRInst*> Inliner::inlineCall(IRFunction& caller, IRInst* call, const IRFunction& callee) {
+    // 先按被调函数当前的样子复制（被调函数可能就是调用者自己）
+    std::vector<IRBlock*> sources = callee.blocks;
+    std::unordered_map<const IRBlock*, IRBlock*> blockMap;
+    std::unordered_map<const IRInst*, IRInst*> valueMap;
+    std::vector<std::pair<const IRInst*, IRInst*>> copies;
+    for (IRBlock* source : sources) blockMap[source] = caller.createBlock();
+    for (IRBlock* source : sources) {
+        std::vector<IRInst*> insts = source->insts;
+        for (IRInst* inst : insts) {
+            if (inst->op == IROp::Const) {
+                valueMap[inst] = caller.constant(inst->imm);
+            } else if (inst->op == IROp::Param) {
+                valueMap[inst] = call->operands[inst->imm];
+            } else {
+                IRInst* copy = caller.createInst(inst->op);
+                copy->imm = inst->imm;
+                copy->callee = inst->callee;
+                copy->hasValue = inst->hasValue;
+                copy->block = blockMap.at(source);
+                copy->block->insts.push_back(copy);
+                valueMap[inst] = copy;
+                copies.emplace_back(inst, copy);
+            }
+        }
+    }
+    for (auto& [inst, copy] : copies) {
+        for (IRInst* operand : inst->operands) copy->operands.push_back(valueMap.at(operand));
+        for (IRBlock* target : inst->targets) copy->targets.push_back(blockMap.at(target));
+    }
+
+    // 调用点所在的块在call处一分为二，后半段成为各个ret的汇合点
+    IRBlock* block = call->block;
+    IRBlock* cont = caller.createBlock();
+    auto pos = std::find(block->insts.begin(), block->insts.end(), call);
+    for (auto it = pos + 1; it != block->insts.end(); ++it) {
+        (*it)->block = cont;
+        cont->insts.push_back(*it);
+    }
+    block->insts.erase(pos, block->insts.end());
+    for (IRBlock* succ : cont->succs()) {
+        for (IRInst* phi : succ->insts) {
+            if (phi->op != IROp::Phi) break;
+            std::replace(phi->targets.begin(), phi->targets.end(), block, cont);
+        }
+    }
+    IRInst* enter = caller.createInst(IROp::Jump);
+    enter->hasValue = false;
+    enter->block = block;
+    enter->targets.push_back(blockMap.at(callee.entry()));
+    block->insts.push_back(enter);
+
+    // 复制出来的块和汇合块接在调用点之后
+    auto at = std::find(caller.blocks.begin(), caller.blocks.end(), block) + 1;
+    std::vector<IRBlock*> layout;
+    for (IRBlock* source : sources) layout.push_back(blockMap.at(source));
+    layout.push_back(cont);
+    caller.blocks.insert(at, layout.begin(), layout.end());
+
+    // ret改为跳到汇合块，返回值经φ汇合
+    std::vector<IRInst*> cloned;
+    std::vector<IRInst*> results;
+    std::vector<IRBlock*> exits;
+    for (auto& [inst, copy] : copies) {
+        if (copy->op == IROp::Call) {
+            // 被调函数里的调用本身也可能是内联进去的，展开层数累加
+            depthOf[copy] = inlineDepth(call) + 1 + inlineDepth(inst);
+            cloned.push_back(copy);
+        }
+        if (copy->op != IROp::Ret) continue;
+        results.push_back(copy->operands.empty() ? caller.constant(0) : copy->operands[0]);
+        exits.push_back(copy->block);
+        copy->op = IROp::Jump;
+        copy->operands.clear();
+        copy->targets.push_back(cont);
+    }
+    if (call->hasValue) {
+        // 被调函数不会返回时汇合块不可达，结果随便取一个常量
+        IRInst* value = results.empty() ? caller.constant(0) : results.front();
+        if (results.size() > 1) {
+            value = caller.createInst(IROp::Phi);
+            value->block = cont;
+            value->operands = results;
+            value->targets = exits;
+            cont->insts.insert(cont->insts.begin(), value);
+        }
+        caller.replaceUses({{call, value}});
+    }
+    caller.recomputePreds();
+    return cloned;
+}
@@ -0,0 +1,54 @@
+#include "interner.h"
+
+StringInterner::StringInterner() : storage(16 * 1024), slots(256, InvalidSymbol) {}
+
+uint32_t StringInterner::hash(std::string_view str) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (unsigned char c : str) {
+        h ^= c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+size_t StringInterner::probe(std::string_view str, uint32_t h) const {
+    size_t mask = slots.size() - 1;
+    size_t i = h & mask;
+    while (slots[i] != InvalidSymbol) {
+        SymbolId id = slots[i];
+        if (hashes[id] == h && strings[id] == str) break;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+SymbolId StringInterner::find(std::string_view str) const {
+    return slots[probe(str, hash(str))];
+}
+
+SymbolId StringInterner::intern(std::string_view str) {
+    uint32_t h = hash(str);
+    size_t slot = probe(str, h);
+    if (slots[slot] != InvalidSymbol) return slots[slot];
+
+    char* mem = static_cast<char*>(storage.allocate(str.size(), 1));
+    str.copy(mem, str.size());
+    SymbolId id = static_cast<SymbolId>(strings.size());
+    strings.emplace_back(mem, str.size());
+    hashes.push_back(h);
+    slots[slot] = id;
+    // 装载因子超过1/2时扩容
+    if (strings.size() * 2 > slots.size()) grow();
+    return id;
+}
+
+void StringInterner::grow() {
+    slots.assign(slots.size() * 2, InvalidSymbol);
+    size_t mask = slots.size() - 1;
+    for (SymbolId id = 0; id < strings.size(); ++id) {
+        size_t i = hashes[id] & mask;
+        while (slots[i] != InvalidSymbol) i = (i + 1) & mask;
+        slots[i] = id;
+    }
+}
@@ -0,0 +1,147 @@
+#include "interp.h"
+#include "bytecode.h"
+#include <stdexcept>
+
+ASTInterpreter::ASTInterpreter(const ASTNodePtr& root, const StringInterner& names, size_t maxDepth)
+    : names(names), maxDepth(maxDepth) {
+    auto program = as<Program>(root);
+    if (!program) throw std::runtime_error("解释器: AST根节点不是Program");
+    for (auto f : program->functions) {
+        auto func = static_cast<const FunctionDef*>(f);
+        functions[std::string(names.name(func->name))] = func;
+    }
+}
+
+int32_t ASTInterpreter::call(const std::string& name, const std::vector<int32_t>& args) {
+    auto it = functions.find(name);
+    if (it == functions.end()) throw std::runtime_error("找不到函数" + name);
+    const FunctionDef* func = it->second;
+    if (args.size() != func->params.size()) {
+        throw std::runtime_error("函数" + name + "需要" + std::to_string(func->params.size()) + "个实参");
+    }
+    if (depth >= maxDepth) throw std::runtime_error("栈溢出");
+    Scopes scopes(1);
+    for (size_t i = 0; i < args.size(); ++i) scopes[0][func->params[i].name] = args[i];
+    int32_t result = 0;
+    ++depth;
+    try {
+        exec(func->body, scopes, result);
+    } catch (...) {
+        --depth;
+        throw;
+    }
+    --depth;
+    return result;
+}
+
+int32_t& ASTInterpreter::variable(SymbolId name, Scopes& scopes) {
+    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+        auto found = it->find(name);
+        if (found != it->end()) return found->second;
+    }
+    throw std::runtime_error("解释器: 未声明的变量" + std::string(names.name(name)));
+}
+
+ASTInterpreter::Flow ASTInterpreter::exec(const ASTNode* node, Scopes& scopes, int32_t& result) {
+    if (!node) return Flow::Normal;
+    switch (node->kind) {
+        case NodeKind::Block: {
+            scopes.emplace_back();
+            Flow flow = Flow::Normal;
+            for (auto stmt : static_cast<const Block*>(node)->stmts) {
+                flow = exec(stmt, scopes, result);
+                if (flow != Flow::Normal) break;
+            }
+            scopes.pop_back();
+            return flow;
+        }
+        case NodeKind::VarDecl: {
+            auto decl = static_cast<const VarDecl*>(node);
+            int32_t value = decl->initExpr ? eval(decl->initExpr, scopes) : 0;
+            scopes.back()[decl->name] = value;
+            return Flow::Normal;
+        }
+        case NodeKind::Assign: {
+            auto assign = static_cast<const Assign*>(node);
+            int32_t value = eval(assign->expr, scopes);
+            variable(assign->name, scopes) = value;
+            return Flow::Normal;
+        }
+        case NodeKind::IfStmt: {
+            auto ifs = static_cast<const IfStmt*>(node);
+            if (eval(ifs->cond, scopes)) return exec(ifs->thenStmt, scopes, result);
+            return exec(ifs->elseStmt, scopes, result);
+        }
+        case NodeKind::WhileStmt: {
+            auto wh = static_cast<const WhileStmt*>(node);
+            while (eval(wh->cond, scopes)) {
+                Flow flow = exec(wh->body, scopes, result);
+                if (flow == Flow::Break) break;
+                if (flow == Flow::Return) return flow;
+            }
+            return Flow::Normal;
+        }
+        case NodeKind::BreakStmt:
+            return Flow::Break;
+        case NodeKind::ContinueStmt:
+            return Flow::Continue;
+        case NodeKind::ReturnStmt: {
+            auto ret = static_cast<const ReturnStmt*>(node);
+            result = ret->expr ? eval(ret->expr, scopes) : 0;
+            return Flow::Return;
+        }
+        case NodeKind::ExprStmt: {
+            auto expr = static_cast<const ExprStmt*>(node)->expr;
+            if (expr) eval(expr, scopes);
+            return Flow::Normal;
+        }
+        default:
+            return Flow::Normal;
+    }
+}
+
+int32_t ASTInterpreter::eval(const ASTNode* node, Scopes& scopes) {
+    switch (node->kind) {
+        case NodeKind::IntLiteral:
+            return static_cast<const IntLiteral*>(node)->value;
+        case NodeKind::VarRef:
+            return variable(static_cast<const VarRef*>(node)->name, scopes);
+        case NodeKind::UnaryExpr: {
+            auto un = static_cast<const UnaryExpr*>(node);
+            int32_t value = eval(un->expr, scopes);
+            if (un->op == UnOp::Neg) return static_cast<int32_t>(0u - static_cast<uint32_t>(value));
+            if (un->op == UnOp::Not) return value == 0;
+            return value;
+        }
+        case NodeKind::BinaryExpr: {
+            auto bin = static_cast<const BinaryExpr*>(node);
+            if (bin->op == BinOp::And) return eval(bin->lhs, scopes) && eval(bin->rhs, scopes);
+            if (bin->op == BinOp::Or) return eval(bin->lhs, scopes) || eval(bin->rhs, scopes);
+            uint32_t lhs = static_cast<uint32_t>(eval(bin->lhs, scopes));
+            uint32_t rhs = static_cast<uint32_t>(eval(bin->rhs, scopes));
+            int32_t l = static_cast<int32_t>(lhs), r = static_cast<int32_t>(rhs);
+            switch (bin->op) {
+                case BinOp::Add: return static_cast<int32_t>(lhs + rhs);
+                case BinOp::Sub: return static_cast<int32_t>(lhs - rhs);
+                case BinOp::Mul: return static_cast<int32_t>(lhs * rhs);
+                case BinOp::Div: return runtimeDiv(l, r);
+                case BinOp::Mod: return runtimeRem(l, r);
+                case BinOp::Lt: return l < r;
+                case BinOp::Le: return l <= r;
+                case BinOp::Gt: return l > r;
+                case BinOp::Ge: return l >= r;
+                case BinOp::Eq: return l == r;
+                case BinOp::Ne: return l != r;
+                default: return 0;
+            }
+        }
+        case NodeKind::FuncCall: {
+            auto call = static_cast<const FuncCall*>(node);
+            std::vector<int32_t> args;
+            for (auto arg : call->args) args.push_back(eval(arg, scopes));
+            return this->call(std::string(names.name(call->name)), args);
+        }
+        default:
+            throw std::runtime_error("解释器: 不是表达式");
+    }
+}
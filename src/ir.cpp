@@ -0,0 +1,307 @@
+#include "ir.h"
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
+
+const char* irOpName(IROp op) {
+    switch (op) {
+        case IROp::Const: return "const";
+        case IROp::Param: return "param";
+        case IROp::Add: return "add";
+        case IROp::Sub: return "sub";
+        case IROp::Mul: return "mul";
+        case IROp::Div: return "div";
+        case IROp::Rem: return "rem";
+        case IROp::Lt: return "lt";
+        case IROp::Le: return "le";
+        case IROp::Gt: return "gt";
+        case IROp::Ge: return "ge";
+        case IROp::Eq: return "eq";
+        case IROp::Ne: return "ne";
+        case IROp::Call: return "call";
+        case IROp::Phi: return "phi";
+        case IROp::Jump: return "jmp";
+        case IROp::Branch: return "br";
+        case IROp::Ret: return "ret";
+    }
+    return "?";
+}
+
+const std::vector<IRBlock*>& IRBlock::succs() const {
+    static const std::vector<IRBlock*> none;
+    IRInst* term = terminator();
+    return term ? term->targets : none;
+}
+
+IRBlock* IRFunction::createBlock() {
+    blockPool.push_back(std::make_unique<IRBlock>(nextBlock++));
+    return blockPool.back().get();
+}
+
+IRInst* IRFunction::createInst(IROp op) {
+    instPool.push_back(std::make_unique<IRInst>(op, nextValue++));
+    return instPool.back().get();
+}
+
+IRInst* IRFunction::constant(int value) {
+    auto& insts = entry()->insts;
+    for (IRInst* inst : insts) {
+        if (inst->op != IROp::Const) break;
+        if (inst->imm == value) return inst;
+    }
+    // 常量统一放在入口块开头，支配所有使用
+    IRInst* inst = createInst(IROp::Const);
+    inst->imm = value;
+    inst->block = entry();
+    insts.insert(insts.begin(), inst);
+    return inst;
+}
+
+void IRFunction::replaceUses(const std::unordered_map<IRInst*, IRInst*>& replacements) {
+    if (replacements.empty()) return;
+    auto resolve = [&](IRInst* value) {
+        for (auto it = replacements.find(value); it != replacements.end(); it = replacements.find(value)) {
+            value = it->second;
+        }
+        return value;
+    };
+    for (IRBlock* block : blocks) {
+        for (IRInst* inst : block->insts) {
+            for (auto& operand : inst->operands) operand = resolve(operand);
+        }
+    }
+}
+
+bool IRFunction::removeTrivialPhis() {
+    // 反复消除直到不动点：一个φ被替换后，引用它的φ可能也变成平凡的
+    std::unordered_map<IRInst*, IRInst*> replacements;
+    auto resolve = [&](IRInst* value) {
+        for (auto it = replacements.find(value); it != replacements.end(); it = replacements.find(value)) {
+            value = it->second;
+        }
+        return value;
+    };
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (IRBlock* block : blocks) {
+            auto& insts = block->insts;
+            for (size_t i = 0; i < insts.size() && insts[i]->op == IROp::Phi;) {
+                IRInst* phi = insts[i];
+                IRInst* same = nullptr;
+                bool trivial = true;
+                for (IRInst* operand : phi->operands) {
+                    operand = resolve(operand);
+                    if (operand == phi || operand == same) continue;
+                    if (same) {
+                        trivial = false;
+                        break;
+                    }
+                    same = operand;
+                }
+                if (!trivial) {
+                    ++i;
+                    continue;
+                }
+                replacements[phi] = same ? same : constant(0);
+                insts.erase(insts.begin() + i);
+                changed = true;
+            }
+        }
+    }
+    replaceUses(replacements);
+    return !replacements.empty();
+}
+
+void IRFunction::recomputePreds() {
+    for (IRBlock* block : blocks) block->preds.clear();
+    for (IRBlock* block : blocks) {
+        for (IRBlock* succ : block->succs()) succ->preds.push_back(block);
+    }
+}
+
+void IRFunction::removePhiIncoming(IRBlock* block, IRBlock* pred) {
+    for (IRInst* inst : block->insts) {
+        if (inst->op != IROp::Phi) break;
+        for (size_t i = inst->targets.size(); i-- > 0;) {
+            if (inst->targets[i] == pred) {
+                inst->targets.erase(inst->targets.begin() + i);
+                inst->operands.erase(inst->operands.begin() + i);
+            }
+        }
+    }
+}
+
+void IRFunction::verify(const StringInterner& names) const {
+    auto fail = [&](const std::string& msg) {
+        throw std::runtime_error("IR校验失败 (" + std::string(names.name(name)) + "): " + msg);
+    };
+    std::unordered_set<const IRBlock*> present(blocks.begin(), blocks.end());
+    std::unordered_set<const IRInst*> defined;
+    for (IRBlock* block : blocks) {
+        for (IRInst* inst : block->insts) defined.insert(inst);
+    }
+    for (IRBlock* block : blocks) {
+        std::string where = "bb" + std::to_string(block->id);
+        if (!block->terminator()) fail(where + " 没有终结指令");
+        bool phis = true;
+        for (size_t i = 0; i < block->insts.size(); ++i) {
+            IRInst* inst = block->insts[i];
+            if (inst->block != block) fail(where + " 中的%" + std::to_string(inst->id) + "所属块不一致");
+            if (isTerminator(inst->op) && i + 1 != block->insts.size()) fail(where + " 的终结指令不在末尾");
+            if (inst->op == IROp::Phi) {
+                if (!phis) fail(where + " 的φ节点不在块开头");
+                if (inst->targets.size() != block->preds.size()) fail(where + " 的φ节点入边数与前驱数不符");
+                for (IRBlock* pred : inst->targets) {
+                    if (std::find(block->preds.begin(), block->preds.end(), pred) == block->preds.end()) {
+                        fail(where + " 的φ节点引用了非前驱块");
+                    }
+                }
+            } else {
+                phis = false;
+            }
+            for (IRInst* operand : inst->operands) {
+                if (!defined.count(operand)) fail(where + " 使用了未定义的值");
+                if (!operand->hasValue) fail(where + " 使用了没有结果的指令");
+            }
+            if (isTerminator(inst->op)) {
+                for (IRBlock* target : inst->targets) {
+                    if (!present.count(target)) fail(where + " 跳转到已删除的块");
+                }
+            }
+        }
+    }
+}
+
+std::vector<IRBlock*> reversePostOrder(const IRFunction& func) {
+    std::vector<IRBlock*> order;
+    std::unordered_set<IRBlock*> visited;
+    // 显式栈的深度优先遍历：(块, 下一个要访问的后继下标)
+    std::vector<std::pair<IRBlock*, size_t>> stack;
+    stack.emplace_back(func.entry(), 0);
+    visited.insert(func.entry());
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        const auto& succs = top.first->succs();
+        if (top.second < succs.size()) {
+            IRBlock* succ = succs[top.second++];
+            if (visited.insert(succ).second) stack.emplace_back(succ, 0);
+        } else {
+            order.push_back(top.first);
+            stack.pop_back();
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+std::vector<IRBlock*> computeDominators(const IRFunction& func) {
+    // Cooper, Harvey, Kennedy: "A Simple, Fast Dominance Algorithm"
+    std::vector<IRBlock*> rpo = reversePostOrder(func);
+    int maxId = 0;
+    for (IRBlock* block : func.blocks) maxId = std::max(maxId, block->id);
+    std::vector<int> index(maxId + 1, -1);
+    for (size_t i = 0; i < rpo.size(); ++i) index[rpo[i]->id] = static_cast<int>(i);
+
+    std::vector<IRBlock*> idom(maxId + 1, nullptr);
+    idom[func.entry()->id] = func.entry();
+    auto intersect = [&](IRBlock* a, IRBlock* b) {
+        while (a != b) {
+            while (index[a->id] > index[b->id]) a = idom[a->id];
+            while (index[b->id] > index[a->id]) b = idom[b->id];
+        }
+        return a;
+    };
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < rpo.size(); ++i) {
+            IRBlock* block = rpo[i];
+            IRBlock* newIdom = nullptr;
+            for (IRBlock* pred : block->preds) {
+                if (index[pred->id] < 0 || !idom[pred->id]) continue;
+                newIdom = newIdom ? intersect(pred, newIdom) : pred;
+            }
+            if (newIdom && idom[block->id] != newIdom) {
+                idom[block->id] = newIdom;
+                changed = true;
+            }
+        }
+    }
+    return idom;
+}
+
+namespace {
+
+void printValue(std::ostream& out, const IRInst* value) {
+    if (value->op == IROp::Const) {
+        out << value->imm;
+    } else {
+        out << "%" << value->id;
+    }
+}
+
+} // namespace
+
+void printIR(std::ostream& out, const IRFunction& func, const StringInterner& names) {
+    out << "function " << names.name(func.name) << "(";
+    int printed = 0;
+    for (IRInst* inst : func.entry()->insts) {
+        if (inst->op != IROp::Param) continue;
+        out << (printed++ ? ", " : "") << "%" << inst->id;
+    }
+    out << ") -> " << (func.returnsValue ? "int" : "void") << " {\n";
+    for (IRBlock* block : func.blocks) {
+        out << "bb" << block->id << ":";
+        if (!block->preds.empty()) {
+            out << "    ; preds:";
+            for (IRBlock* pred : block->preds) out << " bb" << pred->id;
+        }
+        out << "\n";
+        for (IRInst* inst : block->insts) {
+            // 常量在使用处直接按值打印
+            if (inst->op == IROp::Const) continue;
+            out << "    ";
+            if (inst->hasValue) out << "%" << inst->id << " = ";
+            out << irOpName(inst->op);
+            switch (inst->op) {
+                case IROp::Param:
+                    out << " " << inst->imm;
+                    break;
+                case IROp::Call:
+                    out << " " << names.name(inst->callee) << "(";
+                    for (size_t i = 0; i < inst->operands.size(); ++i) {
+                        if (i) out << ", ";
+                        printValue(out, inst->operands[i]);
+                    }
+                    out << ")";
+                    break;
+                case IROp::Phi:
+                    for (size_t i = 0; i < inst->operands.size(); ++i) {
+                        out << (i ? ", [" : " [");
+                        printValue(out, inst->operands[i]);
+                        out << ", bb" << inst->targets[i]->id << "]";
+                    }
+                    break;
+                default:
+                    for (size_t i = 0; i < inst->operands.size(); ++i) {
+                        out << (i ? ", " : " ");
+                        printValue(out, inst->operands[i]);
+                    }
+                    for (size_t i = 0; i < inst->targets.size(); ++i) {
+                        out << (i || !inst->operands.empty() ? ", " : " ") << "bb" << inst->targets[i]->id;
+                    }
+                    break;
+            }
+            out << "\n";
+        }
+    }
+    out << "}\n";
+}
+
+void printIR(std::ostream& out, const IRModule& module, const StringInterner& names) {
+    for (size_t i = 0; i < module.functions.size(); ++i) {
+        if (i) out << "\n";
+        printIR(out, *module.functions[i], names);
+    }
+}
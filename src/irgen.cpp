@@ -0,0 +1,380 @@
+#include "irgen.h"
+#include <stdexcept>
+
+std::unique_ptr<IRModule> IRGenerator::generate(const ASTNodePtr& root) {
+    auto prog = as<Program>(root);
+    if (!prog) throw std::runtime_error("IR生成: AST根节点不是Program");
+
+    for (auto node : prog->functions) {
+        auto def = static_cast<const FunctionDef*>(node);
+        returnsValue[def->name] = def->retType == TypeKind::Int;
+    }
+
+    auto module = std::make_unique<IRModule>();
+    for (auto node : prog->functions) {
+        auto def = static_cast<const FunctionDef*>(node);
+        module->functions.push_back(std::make_unique<IRFunction>(
+            def->name, static_cast<int>(def->params.size()), def->retType == TypeKind::Int));
+        func = module->functions.back().get();
+        lowerFunction(def);
+    }
+    func = nullptr;
+    return module;
+}
+
+void IRGenerator::lowerFunction(const FunctionDef* node) {
+    scopes.clear();
+    varCount = 0;
+    currentDef.clear();
+    incompletePhis.clear();
+    sealed.clear();
+    loops.clear();
+
+    IRBlock* entry = newBlock();
+    startBlock(entry);
+    sealBlock(entry);
+
+    scopes.emplace_back();
+    for (size_t i = 0; i < node->params.size(); ++i) {
+        IRInst* param = append(IROp::Param);
+        param->imm = static_cast<int>(i);
+        writeVariable(declare(node->params[i].name), current, param);
+    }
+    lowerStmt(node->body);
+    scopes.pop_back();
+
+    // 函数末尾没有return：void函数正常返回，int函数（语义分析保证不可达）返回0
+    if (!terminated()) {
+        IRInst* ret = func->returnsValue ? append(IROp::Ret, {constant(0)}) : append(IROp::Ret);
+        ret->hasValue = false;
+    }
+    func->removeTrivialPhis();
+}
+
+void IRGenerator::lowerStmt(const ASTNode* node) {
+    if (!node) return;
+    switch (node->kind) {
+        case NodeKind::Block:
+            scopes.emplace_back();
+            for (auto stmt : static_cast<const Block*>(node)->stmts) {
+                // ToyC没有goto，同一块中跳转语句之后的代码都不可达
+                if (terminated()) break;
+                lowerStmt(stmt);
+            }
+            scopes.pop_back();
+            break;
+        case NodeKind::VarDecl: {
+            auto decl = static_cast<const VarDecl*>(node);
+            // 未初始化的变量取值未定义，这里统一视为0
+            IRInst* value = decl->initExpr ? lowerExpr(decl->initExpr) : constant(0);
+            writeVariable(declare(decl->name), current, value);
+            break;
+        }
+        case NodeKind::Assign: {
+            auto assign = static_cast<const Assign*>(node);
+            IRInst* value = lowerExpr(assign->expr);
+            writeVariable(resolve(assign->name), current, value);
+            break;
+        }
+        case NodeKind::ExprStmt:
+            if (auto expr = static_cast<const ExprStmt*>(node)->expr) lowerExpr(expr);
+            break;
+        case NodeKind::ReturnStmt: {
+            auto ret = static_cast<const ReturnStmt*>(node);
+            IRInst* inst = ret->expr ? append(IROp::Ret, {lowerExpr(ret->expr)}) : append(IROp::Ret);
+            inst->hasValue = false;
+            break;
+        }
+        case NodeKind::BreakStmt:
+            jump(loops.back().second);
+            break;
+        case NodeKind::ContinueStmt:
+            jump(loops.back().first);
+            break;
+        case NodeKind::IfStmt: {
+            auto ifs = static_cast<const IfStmt*>(node);
+            IRBlock* thenBlock = newBlock();
+            IRBlock* merge = newBlock();
+            IRBlock* elseBlock = ifs->elseStmt ? newBlock() : merge;
+            lowerCond(ifs->cond, thenBlock, elseBlock);
+
+            sealBlock(thenBlock);
+            if (!thenBlock->preds.empty()) {
+                startBlock(thenBlock);
+                lowerStmt(ifs->thenStmt);
+                if (!terminated()) jump(merge);
+            }
+            if (ifs->elseStmt) {
+                sealBlock(elseBlock);
+                if (!elseBlock->preds.empty()) {
+                    startBlock(elseBlock);
+                    lowerStmt(ifs->elseStmt);
+                    if (!terminated()) jump(merge);
+                }
+            }
+            // 两个分支都跳走时没有汇合点，后续语句不可达
+            sealBlock(merge);
+            if (!merge->preds.empty()) startBlock(merge);
+            break;
+        }
+        case NodeKind::WhileStmt: {
+            // 循环反转：进入前判断一次条件，之后在循环尾判断，每次迭代只有一个回边分支
+            auto wh = static_cast<const WhileStmt*>(node);
+            IRBlock* body = newBlock();
+            IRBlock* latch = newBlock();
+            IRBlock* exit = newBlock();
+            lowerCond(wh->cond, body, exit);
+
+            // 回边要等循环体生成完才知道，循环体的入口暂不封闭
+            if (!body->preds.empty()) {
+                startBlock(body);
+                loops.emplace_back(latch, exit);
+                lowerStmt(wh->body);
+                loops.pop_back();
+                if (!terminated()) jump(latch);
+                sealBlock(latch);
+                if (!latch->preds.empty()) {
+                    startBlock(latch);
+                    lowerCond(wh->cond, body, exit);
+                }
+            }
+            sealBlock(body);
+            sealBlock(exit);
+            if (!exit->preds.empty()) startBlock(exit);
+            break;
+        }
+        default:
+            lowerExpr(node);
+            break;
+    }
+}
+
+IRInst* IRGenerator::lowerExpr(const ASTNode* node) {
+    switch (node->kind) {
+        case NodeKind::IntLiteral:
+            return constant(static_cast<const IntLiteral*>(node)->value);
+        case NodeKind::VarRef:
+            return readVariable(resolve(static_cast<const VarRef*>(node)->name), current);
+        case NodeKind::UnaryExpr: {
+            auto un = static_cast<const UnaryExpr*>(node);
+            IRInst* value = lowerExpr(un->expr);
+            switch (un->op) {
+                case UnOp::Plus: return value;
+                case UnOp::Neg: return append(IROp::Sub, {constant(0), value});
+                case UnOp::Not: return append(IROp::Eq, {value, constant(0)});
+            }
+            return value;
+        }
+        case NodeKind::BinaryExpr: {
+            auto bin = static_cast<const BinaryExpr*>(node);
+            if (bin->op == BinOp::And || bin->op == BinOp::Or) {
+                // 短路求值：左操作数决定结果的路径直接跳到汇合点，
+                // 汇合点的φ从这些边取常量，从右操作数所在的边取右操作数的真值
+                bool isAnd = bin->op == BinOp::And;
+                IRBlock* rhsBlock = newBlock();
+                IRBlock* merge = newBlock();
+                if (isAnd) {
+                    lowerCond(bin->lhs, rhsBlock, merge);
+                } else {
+                    lowerCond(bin->lhs, merge, rhsBlock);
+                }
+                sealBlock(rhsBlock);
+                IRBlock* rhsEnd = nullptr;
+                IRInst* rhs = nullptr;
+                if (!rhsBlock->preds.empty()) {
+                    startBlock(rhsBlock);
+                    rhs = lowerExpr(bin->rhs);
+                    if (!isComparison(rhs->op)) rhs = append(IROp::Ne, {rhs, constant(0)});
+                    rhsEnd = current;
+                    jump(merge);
+                }
+                sealBlock(merge);
+                startBlock(merge);
+                IRInst* shortValue = constant(isAnd ? 0 : 1);
+                if (merge->preds.size() == 1) return merge->preds[0] == rhsEnd ? rhs : shortValue;
+                IRInst* phi = newPhi(merge);
+                for (IRBlock* pred : merge->preds) {
+                    phi->operands.push_back(pred == rhsEnd ? rhs : shortValue);
+                    phi->targets.push_back(pred);
+                }
+                return phi;
+            }
+            IRInst* lhs = lowerExpr(bin->lhs);
+            IRInst* rhs = lowerExpr(bin->rhs);
+            IROp op = IROp::Add;
+            switch (bin->op) {
+                case BinOp::Add: op = IROp::Add; break;
+                case BinOp::Sub: op = IROp::Sub; break;
+                case BinOp::Mul: op = IROp::Mul; break;
+                case BinOp::Div: op = IROp::Div; break;
+                case BinOp::Mod: op = IROp::Rem; break;
+                case BinOp::Lt: op = IROp::Lt; break;
+                case BinOp::Le: op = IROp::Le; break;
+                case BinOp::Gt: op = IROp::Gt; break;
+                case BinOp::Ge: op = IROp::Ge; break;
+                case BinOp::Eq: op = IROp::Eq; break;
+                case BinOp::Ne: op = IROp::Ne; break;
+                default: break;
+            }
+            return append(op, {lhs, rhs});
+        }
+        case NodeKind::FuncCall: {
+            auto call = static_cast<const FuncCall*>(node);
+            std::vector<IRInst*> args;
+            for (auto arg : call->args) args.push_back(lowerExpr(arg));
+            IRInst* inst = append(IROp::Call, std::move(args));
+            inst->callee = call->name;
+            inst->hasValue = returnsValue[call->name];
+            return inst;
+        }
+        default:
+            throw std::runtime_error("IR生成: 非法的表达式节点");
+    }
+}
+
+void IRGenerator::lowerCond(const ASTNode* node, IRBlock* trueBlock, IRBlock* falseBlock) {
+    if (auto bin = as<BinaryExpr>(node)) {
+        if (bin->op == BinOp::And || bin->op == BinOp::Or) {
+            IRBlock* rhsBlock = newBlock();
+            if (bin->op == BinOp::And) {
+                lowerCond(bin->lhs, rhsBlock, falseBlock);
+            } else {
+                lowerCond(bin->lhs, trueBlock, rhsBlock);
+            }
+            sealBlock(rhsBlock);
+            if (rhsBlock->preds.empty()) return;
+            startBlock(rhsBlock);
+            lowerCond(bin->rhs, trueBlock, falseBlock);
+            return;
+        }
+    }
+    if (auto un = as<UnaryExpr>(node)) {
+        if (un->op == UnOp::Not) {
+            lowerCond(un->expr, falseBlock, trueBlock);
+            return;
+        }
+    }
+    if (auto lit = as<IntLiteral>(node)) {
+        jump(lit->value ? trueBlock : falseBlock);
+        return;
+    }
+    branch(lowerExpr(node), trueBlock, falseBlock);
+}
+
+IRBlock* IRGenerator::newBlock() {
+    IRBlock* block = func->createBlock();
+    if (sealed.size() <= static_cast<size_t>(block->id)) sealed.resize(block->id + 1, false);
+    return block;
+}
+
+IRInst* IRGenerator::append(IROp op, std::vector<IRInst*> operands) {
+    IRInst* inst = func->createInst(op);
+    inst->operands = std::move(operands);
+    inst->block = current;
+    current->insts.push_back(inst);
+    return inst;
+}
+
+IRInst* IRGenerator::constant(int value) {
+    return func->constant(value);
+}
+
+void IRGenerator::jump(IRBlock* target) {
+    IRInst* inst = append(IROp::Jump);
+    inst->hasValue = false;
+    inst->targets.push_back(target);
+    target->preds.push_back(current);
+}
+
+void IRGenerator::branch(IRInst* cond, IRBlock* trueBlock, IRBlock* falseBlock) {
+    if (trueBlock == falseBlock) {
+        jump(trueBlock);
+        return;
+    }
+    IRInst* inst = append(IROp::Branch, {cond});
+    inst->hasValue = false;
+    inst->targets = {trueBlock, falseBlock};
+    trueBlock->preds.push_back(current);
+    falseBlock->preds.push_back(current);
+}
+
+void IRGenerator::startBlock(IRBlock* block) {
+    func->blocks.push_back(block);
+    current = block;
+}
+
+bool IRGenerator::terminated() const {
+    return current->terminator() != nullptr;
+}
+
+int IRGenerator::declare(SymbolId name) {
+    int var = varCount++;
+    scopes.back().emplace_back(name, var);
+    currentDef.emplace_back();
+    return var;
+}
+
+int IRGenerator::resolve(SymbolId name) const {
+    for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+        for (auto it = scope->rbegin(); it != scope->rend(); ++it) {
+            if (it->first == name) return it->second;
+        }
+    }
+    throw std::runtime_error("IR生成: 未声明的变量 " + std::string(names.name(name)));
+}
+
+void IRGenerator::writeVariable(int var, IRBlock* block, IRInst* value) {
+    currentDef[var][block] = value;
+}
+
+IRInst* IRGenerator::readVariable(int var, IRBlock* block) {
+    auto it = currentDef[var].find(block);
+    if (it != currentDef[var].end()) return it->second;
+    return readVariableRecursive(var, block);
+}
+
+IRInst* IRGenerator::readVariableRecursive(int var, IRBlock* block) {
+    IRInst* value;
+    if (!sealed[block->id]) {
+        // 前驱还不完整：先放一个待补全的φ
+        value = newPhi(block);
+        incompletePhis[block].emplace_back(var, value);
+    } else if (block->preds.empty()) {
+        value = constant(0);
+    } else if (block->preds.size() == 1) {
+        value = readVariable(var, block->preds[0]);
+    } else {
+        // 先记录φ再查询前驱，打断循环中的递归
+        IRInst* phi = newPhi(block);
+        writeVariable(var, block, phi);
+        addPhiOperands(var, phi);
+        value = phi;
+    }
+    writeVariable(var, block, value);
+    return value;
+}
+
+IRInst* IRGenerator::newPhi(IRBlock* block) {
+    IRInst* phi = func->createInst(IROp::Phi);
+    phi->block = block;
+    auto pos = block->insts.begin();
+    while (pos != block->insts.end() && (*pos)->op == IROp::Phi) ++pos;
+    block->insts.insert(pos, phi);
+    return phi;
+}
+
+void IRGenerator::addPhiOperands(int var, IRInst* phi) {
+    for (IRBlock* pred : phi->block->preds) {
+        phi->operands.push_back(readVariable(var, pred));
+        phi->targets.push_back(pred);
+    }
+}
+
+void IRGenerator::sealBlock(IRBlock* block) {
+    auto it = incompletePhis.find(block);
+    if (it != incompletePhis.end()) {
+        for (auto& [var, phi] : it->second) addPhiOperands(var, phi);
+        incompletePhis.erase(it);
+    }
+    sealed[block->id] = true;
+}
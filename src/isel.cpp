@@ -0,0 +1,773 @@
+#include "isel.h"
+#include "emitter.h"
+#include "fncache.h"
+#include "funcgen.h"
+#include "muldiv.h"
+#include "peephole.h"
+#include "regalloc.h"
+#include "scheduler.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <climits>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+// 可分配的寄存器；t4~t6保留给溢出值的装入、结果写回和并行传送破环
+const std::vector<Register> CALLER_SAVED = {
+    Register::T0, Register::T1, Register::T2, Register::T3,
+    Register::A0, Register::A1, Register::A2, Register::A3,
+    Register::A4, Register::A5, Register::A6, Register::A7
+};
+
+// 栈帧按sp寻址，不需要帧指针，s0也参与分配
+const std::vector<Register> CALLEE_SAVED = {
+    Register::S1, Register::S2, Register::S3, Register::S4, Register::S5, Register::S6,
+    Register::S7, Register::S8, Register::S9, Register::S10, Register::S11, Register::S0
+};
+
+const Register SCRATCH_LHS = Register::T4;
+const Register SCRATCH_RHS = Register::T5;
+const Register SCRATCH_MOVE = Register::T6;
+
+bool hasPhis(const IRBlock* block) {
+    return !block->insts.empty() && block->insts.front()->op == IROp::Phi;
+}
+
+// 按值编号索引的位集合
+class BitSet {
+public:
+    explicit BitSet(size_t size = 0) : words((size + 63) / 64, 0) {}
+    void set(size_t i) { words[i / 64] |= uint64_t(1) << (i % 64); }
+    bool test(size_t i) const { return words[i / 64] >> (i % 64) & 1; }
+
+    // this |= other & ~mask，返回是否有变化
+    bool unionWithout(const BitSet& other, const BitSet& mask) {
+        bool changed = false;
+        for (size_t i = 0; i < words.size(); ++i) {
+            uint64_t merged = words[i] | (other.words[i] & ~mask.words[i]);
+            changed |= merged != words[i];
+            words[i] = merged;
+        }
+        return changed;
+    }
+
+    template <typename F>
+    void forEach(F&& f) const {
+        for (size_t i = 0; i < words.size(); ++i) {
+            for (uint64_t word = words[i]; word; word &= word - 1) {
+                f(i * 64 + __builtin_ctzll(word));
+            }
+        }
+    }
+
+private:
+    std::vector<uint64_t> words;
+};
+
+} // namespace
+
+InstructionSelector::InstructionSelector(AsmEmitter& emitter, const StringInterner& names,
+                                         PeepholeOptimizer* peephole, ThreadPool* pool)
+    : emitter(emitter), names(names), peephole(peephole), pool(pool) {}
+
+void InstructionSelector::generate(IRModule& module) {
+    emitComment("RISC-V 32位汇编代码");
+    emitComment("由ToyC编译器生成");
+    emitDirective("");
+    emitDirective(".text");
+    emitDirective(".globl main");
+    emitDirective("");
+    flush();
+
+    // 各函数的IR和生成状态互不相干，并行处理。设置了缓存时按cached中的函数顺序输出，命中的函数没有IR
+    std::vector<IRFunction*> sources;
+    if (cached) {
+        std::unordered_map<SymbolId, IRFunction*> byName;
+        for (auto& function : module.functions) byName[function->name] = function.get();
+        for (size_t i = 0; i < cached->names.size(); ++i) {
+            sources.push_back(cached->hit[i] ? nullptr : byName.at(cached->names[i]));
+        }
+    } else {
+        for (auto& function : module.functions) sources.push_back(function.get());
+    }
+    auto generate = [&](InstructionSelector& worker, size_t i) { return worker.generateFunction(*sources[i]); };
+    generateFunctions<InstructionSelector>(sources.size(), emitter, names, peephole, pool, cached, scheduler,
+                                           constantMulDiv, generate);
+}
+
+std::vector<AsmInst> InstructionSelector::generateFunction(IRFunction& function) {
+    func = &function;
+    funcName = std::string(names.name(function.name));
+
+    splitCriticalEdges();
+    fuseBranches();
+    allocateRegisters();
+
+    emitDirective("");
+    emitComment("函数定义: " + funcName);
+    emitLabel(funcName);
+    emitPrologue();
+    for (size_t i = 0; i < func->blocks.size(); ++i) {
+        emitBlock(func->blocks[i], i + 1 < func->blocks.size() ? func->blocks[i + 1] : nullptr);
+    }
+    if (frameSize > 0) {
+        emitLabel(epilogueLabel());
+        emitEpilogue();
+    }
+    func = nullptr;
+    if (peephole) peephole->run(code);
+    if (scheduler) scheduler->run(code);
+    std::vector<AsmInst> result;
+    result.swap(code);
+    return result;
+}
+
+void InstructionSelector::splitCriticalEdges() {
+    // φ翻译成前驱末尾的传送；前驱有多个后继时，传送只能放在边上新插入的块里
+    std::vector<IRBlock*> layout;
+    for (IRBlock* block : func->blocks) {
+        layout.push_back(block);
+        IRInst* term = block->terminator();
+        if (term->targets.size() < 2) continue;
+        for (auto& target : term->targets) {
+            if (!hasPhis(target)) continue;
+            IRBlock* split = func->createBlock();
+            IRInst* jump = func->createInst(IROp::Jump);
+            jump->hasValue = false;
+            jump->block = split;
+            jump->targets.push_back(target);
+            split->insts.push_back(jump);
+            for (IRInst* phi : target->insts) {
+                if (phi->op != IROp::Phi) break;
+                std::replace(phi->targets.begin(), phi->targets.end(), block, split);
+            }
+            target = split;
+            layout.push_back(split);
+        }
+    }
+    func->blocks = std::move(layout);
+    func->recomputePreds();
+}
+
+void InstructionSelector::fuseBranches() {
+    // 比较紧挨在分支前面、结果只被这条分支使用时，直接生成比较跳转，不物化布尔值
+    std::vector<int> uses(func->valueCount(), 0);
+    for (IRBlock* block : func->blocks) {
+        for (IRInst* inst : block->insts) {
+            for (IRInst* operand : inst->operands) ++uses[operand->id];
+        }
+    }
+    fused.assign(func->valueCount(), false);
+    for (IRBlock* block : func->blocks) {
+        size_t size = block->insts.size();
+        IRInst* term = block->terminator();
+        if (term->op != IROp::Branch || size < 2) continue;
+        IRInst* cond = term->operands[0];
+        if (cond == block->insts[size - 2] && isComparison(cond->op) && uses[cond->id] == 1) {
+            fused[cond->id] = true;
+        }
+    }
+}
+
+void InstructionSelector::allocateRegisters() {
+    const size_t valueCount = func->valueCount();
+    int maxBlock = 0;
+    for (IRBlock* block : func->blocks) maxBlock = std::max(maxBlock, block->id);
+
+    // 线性化编号：每条指令占两个位置，偶数位置读操作数，奇数位置写结果，
+    // 这样操作数在本指令结束的区间可以和结果共用寄存器
+    std::vector<int> position(valueCount, 0);
+    std::vector<int> blockStart(maxBlock + 1), blockEnd(maxBlock + 1), movePosition(maxBlock + 1);
+    std::vector<int> calls;
+    int pos = 0;
+    for (IRBlock* block : func->blocks) {
+        blockStart[block->id] = pos;
+        pos += 2;
+        for (IRInst* inst : block->insts) {
+            if (inst->op == IROp::Const || inst->op == IROp::Phi) continue;
+            if (isTerminator(inst->op)) {
+                movePosition[block->id] = pos;
+                pos += 2;
+            }
+            position[inst->id] = pos;
+            if (inst->op == IROp::Call) calls.push_back(pos);
+            pos += 2;
+        }
+        blockEnd[block->id] = pos - 1;
+    }
+
+    // 活跃分析：φ的值在各前驱末尾的传送处定义
+    auto isValue = [&](const IRInst* value) { return value->op != IROp::Const && !fused[value->id]; };
+    size_t blockCount = maxBlock + 1;
+    std::vector<BitSet> use(blockCount, BitSet(valueCount)), def(blockCount, BitSet(valueCount));
+    std::vector<BitSet> liveIn(blockCount, BitSet(valueCount)), liveOut(blockCount, BitSet(valueCount));
+    auto phiSource = [](const IRInst* phi, const IRBlock* pred) {
+        auto it = std::find(phi->targets.begin(), phi->targets.end(), pred);
+        return phi->operands[it - phi->targets.begin()];
+    };
+    for (IRBlock* block : func->blocks) {
+        BitSet& u = use[block->id];
+        BitSet& d = def[block->id];
+        auto useValue = [&](const IRInst* value) {
+            if (isValue(value) && !d.test(value->id)) u.set(value->id);
+        };
+        for (IRInst* inst : block->insts) {
+            if (inst->op == IROp::Phi || isTerminator(inst->op)) continue;
+            for (IRInst* operand : inst->operands) useValue(operand);
+            if (inst->hasValue && isValue(inst)) d.set(inst->id);
+        }
+        for (IRBlock* succ : block->succs()) {
+            for (IRInst* phi : succ->insts) {
+                if (phi->op != IROp::Phi) break;
+                useValue(phiSource(phi, block));
+            }
+        }
+        for (IRBlock* succ : block->succs()) {
+            for (IRInst* phi : succ->insts) {
+                if (phi->op != IROp::Phi) break;
+                d.set(phi->id);
+            }
+        }
+        for (IRInst* operand : block->terminator()->operands) useValue(operand);
+    }
+    const BitSet empty(valueCount);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto it = func->blocks.rbegin(); it != func->blocks.rend(); ++it) {
+            IRBlock* block = *it;
+            for (IRBlock* succ : block->succs()) liveOut[block->id].unionWithout(liveIn[succ->id], empty);
+            changed |= liveIn[block->id].unionWithout(use[block->id], empty);
+            changed |= liveIn[block->id].unionWithout(liveOut[block->id], def[block->id]);
+        }
+    }
+
+    // 每个值一个覆盖其全部活跃位置的区间
+    std::vector<LiveInterval> intervals;
+    std::vector<int> intervalOf(valueCount, -1);
+    for (IRBlock* block : func->blocks) {
+        for (IRInst* inst : block->insts) {
+            if (!inst->hasValue || !isValue(inst)) continue;
+            intervalOf[inst->id] = static_cast<int>(intervals.size());
+            intervals.push_back(LiveInterval{inst->id, INT_MAX, -1});
+            if (inst->op == IROp::Param && inst->imm < 8) intervals.back().hint = argRegister(inst->imm);
+            if (inst->op == IROp::Call) intervals.back().hint = Register::A0;
+        }
+    }
+    auto extend = [&](size_t value, int at) {
+        LiveInterval& interval = intervals[intervalOf[value]];
+        interval.start = std::min(interval.start, at);
+        interval.end = std::max(interval.end, at);
+    };
+    for (IRBlock* block : func->blocks) {
+        liveIn[block->id].forEach([&](size_t value) { extend(value, blockStart[block->id]); });
+        liveOut[block->id].forEach([&](size_t value) { extend(value, blockEnd[block->id]); });
+        for (IRInst* inst : block->insts) {
+            if (inst->op == IROp::Const || inst->op == IROp::Phi) continue;
+            for (IRInst* operand : inst->operands) {
+                if (isValue(operand)) extend(operand->id, position[inst->id]);
+            }
+            if (inst->hasValue && isValue(inst)) extend(inst->id, position[inst->id] + 1);
+        }
+        for (IRBlock* succ : block->succs()) {
+            for (IRInst* phi : succ->insts) {
+                if (phi->op != IROp::Phi) break;
+                IRInst* source = phiSource(phi, block);
+                if (isValue(source)) extend(source->id, movePosition[block->id]);
+                extend(phi->id, movePosition[block->id] + 1);
+            }
+        }
+    }
+    intervals.erase(std::remove_if(intervals.begin(), intervals.end(),
+                                   [](const LiveInterval& interval) { return interval.end < 0; }),
+                    intervals.end());
+    for (auto& interval : intervals) {
+        auto call = std::upper_bound(calls.begin(), calls.end(), interval.start);
+        interval.crossesCall = call != calls.end() && *call < interval.end;
+    }
+
+    LinearScanAllocator allocator(CALLER_SAVED, CALLEE_SAVED);
+    allocator.allocate(intervals);
+    savedRegs = allocator.usedCalleeSaved();
+
+    // 栈帧布局（偏移相对进入函数时的sp）：有非尾调用时-4保存ra，然后是被调用者保存寄存器
+    // 和溢出槽；栈底0(sp)起是超过8个实参时的传参区。什么都不用保存的叶子函数不分配栈帧
+    int maxStackArgs = 0;
+    saveRA = false;
+    std::vector<const IRInst*> params(valueCount, nullptr);
+    for (IRBlock* block : func->blocks) {
+        for (IRInst* inst : block->insts) {
+            if (inst->op == IROp::Call) {
+                maxStackArgs = std::max(maxStackArgs, static_cast<int>(inst->operands.size()) - 8);
+                saveRA |= !isTailCall(block, inst);
+            }
+            if (inst->op == IROp::Param) params[inst->id] = inst;
+        }
+    }
+    locations.assign(valueCount, Location{});
+    int slotTop = (saveRA ? -4 : 0) - 4 * static_cast<int>(savedRegs.size());
+    for (const auto& interval : intervals) {
+        Location& loc = locations[interval.var];
+        if (interval.reg != Register::ZERO) {
+            loc = Location{Location::Reg, interval.reg, 0};
+        } else if (params[interval.var] && params[interval.var]->imm >= 8) {
+            // 第9个及以后的形参本来就在调用者的栈上
+            loc = Location{Location::Slot, Register::ZERO, (params[interval.var]->imm - 8) * 4};
+        } else {
+            slotTop -= 4;
+            loc = Location{Location::Slot, Register::ZERO, slotTop};
+        }
+    }
+    frameSize = (-slotTop + 4 * maxStackArgs + 15) & ~15;
+
+    // 分支一侧的边块里只有φ传送时，如果传送目标既不是分支条件读的位置，也不存放另一侧
+    // 活跃的值，就把传送提到分支之前，分支直接跳到φ所在的块。反转后的循环因此在回边上
+    // 只剩一条比较跳转。出口一侧的传送提前了反而每次迭代都要执行，只提回边
+    hoisted.assign(maxBlock + 1, false);
+    std::vector<int> order(maxBlock + 1);
+    for (size_t i = 0; i < func->blocks.size(); ++i) order[func->blocks[i]->id] = static_cast<int>(i);
+    for (IRBlock* block : func->blocks) {
+        IRInst* term = block->terminator();
+        if (term->op != IROp::Branch || term->targets[0] == term->targets[1]) continue;
+        std::vector<Location> reads;
+        IRInst* cond = term->operands[0];
+        if (fused[cond->id]) {
+            for (IRInst* operand : cond->operands) reads.push_back(locationOf(operand));
+        } else {
+            reads.push_back(locationOf(cond));
+        }
+        for (int side = 0; side < 2; ++side) {
+            IRBlock* edge = term->targets[side];
+            IRBlock* other = term->targets[1 - side];
+            if (edge->insts.size() != 1 || edge->insts[0]->op != IROp::Jump || edge->preds.size() != 1) continue;
+            IRBlock* target = edge->insts[0]->targets[0];
+            if (order[target->id] > order[block->id] || !hasPhis(target)) continue;
+            std::vector<Location> live = reads;
+            liveIn[other->id].forEach([&](size_t value) { live.push_back(locations[value]); });
+            bool conflict = false;
+            for (IRInst* phi : target->insts) {
+                if (phi->op != IROp::Phi) break;
+                conflict |= std::find(live.begin(), live.end(), locationOf(phi)) != live.end();
+            }
+            if (!conflict) {
+                hoisted[edge->id] = true;
+                break;
+            }
+        }
+    }
+    func->blocks.erase(std::remove_if(func->blocks.begin(), func->blocks.end(),
+                                      [&](IRBlock* block) { return hoisted[block->id]; }),
+                       func->blocks.end());
+}
+
+void InstructionSelector::emitPrologue() {
+    emitComment("函数序言");
+    if (frameSize > 0) emitAddImmediate(Register::SP, Register::SP, -frameSize);
+    if (saveRA) emitFrameMemory(AsmOp::Sw, Register::RA, -4);
+    for (size_t i = 0; i < savedRegs.size(); ++i) {
+        emitFrameMemory(AsmOp::Sw, savedRegs[i], savedRegSlot(i));
+    }
+
+    // 形参从a0~a7和调用者栈上移动到分配的位置
+    std::vector<Move> moves;
+    std::vector<const IRInst*> stackParams;
+    for (IRInst* inst : func->entry()->insts) {
+        if (inst->op != IROp::Param) continue;
+        if (inst->imm < 8) {
+            moves.emplace_back(locationOf(inst), Location{Location::Reg, argRegister(inst->imm), 0});
+        } else if (locationOf(inst).kind == Location::Reg) {
+            stackParams.push_back(inst);
+        }
+    }
+    emitParallelMove(moves);
+    for (const IRInst* param : stackParams) {
+        emitFrameMemory(AsmOp::Lw, locationOf(param).reg, (param->imm - 8) * 4);
+    }
+}
+
+void InstructionSelector::emitEpilogue() {
+    emitComment("函数尾声");
+    restoreFrame();
+    emit(AsmInst::ret());
+}
+
+void InstructionSelector::restoreFrame() {
+    for (size_t i = 0; i < savedRegs.size(); ++i) {
+        emitFrameMemory(AsmOp::Lw, savedRegs[i], savedRegSlot(i));
+    }
+    if (saveRA) emitFrameMemory(AsmOp::Lw, Register::RA, -4);
+    if (frameSize > 0) emitAddImmediate(Register::SP, Register::SP, frameSize);
+}
+
+int InstructionSelector::savedRegSlot(size_t index) const {
+    return (saveRA ? -8 : -4) - 4 * static_cast<int>(index);
+}
+
+void InstructionSelector::emitBlock(IRBlock* block, IRBlock* next) {
+    if (block != func->entry()) emitLabel(blockLabel(block));
+    for (IRInst* inst : block->insts) {
+        switch (inst->op) {
+            case IROp::Const:
+            case IROp::Param:
+            case IROp::Phi:
+                break;
+            case IROp::Call:
+                if (isTailCall(block, inst)) {
+                    emitTailCall(inst);
+                    return;
+                }
+                emitCall(inst);
+                break;
+            case IROp::Jump:
+                emitPhiMoves(block, inst->targets[0]);
+                if (inst->targets[0] != next) emit(AsmInst::jump(AsmOp::J, blockLabel(inst->targets[0])));
+                break;
+            case IROp::Branch:
+                emitBranch(inst, next);
+                break;
+            case IROp::Ret:
+                if (!inst->operands.empty()) {
+                    emitMove(Location{Location::Reg, Register::A0, 0}, locationOf(inst->operands[0]));
+                }
+                // 所有ret共用函数末尾的尾声；没有栈帧时尾声只有一条ret，直接返回
+                if (frameSize == 0) {
+                    emit(AsmInst::ret());
+                } else if (next) {
+                    emit(AsmInst::jump(AsmOp::J, epilogueLabel()));
+                }
+                break;
+            default:
+                // 与分支融合的比较在分支处一起生成
+                if (!fused[inst->id]) emitBinary(inst);
+                break;
+        }
+    }
+}
+
+void InstructionSelector::emitBranch(IRInst* inst, IRBlock* next) {
+    IRInst* cond = inst->operands[0];
+    IRBlock* ifTrue = inst->targets[0];
+    IRBlock* ifFalse = inst->targets[1];
+    // 提前的边上传送在比较之前完成，分支越过边块直接跳到目标
+    for (IRBlock** target : {&ifTrue, &ifFalse}) {
+        if (!hoisted[(*target)->id]) continue;
+        IRBlock* edge = *target;
+        *target = edge->insts[0]->targets[0];
+        emitPhiMoves(edge, *target);
+    }
+    // 真目标紧跟在后面时条件取反，跳到假目标
+    bool invert = ifTrue == next;
+    IRBlock* target = invert ? ifFalse : ifTrue;
+
+    if (fused[cond->id]) {
+        Register lhs = operand(cond->operands[0], SCRATCH_LHS);
+        Register rhs = operand(cond->operands[1], SCRATCH_RHS);
+        IROp op = cond->op;
+        if (invert) {
+            switch (op) {
+                case IROp::Lt: op = IROp::Ge; break;
+                case IROp::Ge: op = IROp::Lt; break;
+                case IROp::Gt: op = IROp::Le; break;
+                case IROp::Le: op = IROp::Gt; break;
+                case IROp::Eq: op = IROp::Ne; break;
+                default: op = IROp::Eq; break;
+            }
+        }
+        // >和<=交换操作数后用blt/bge
+        if (op == IROp::Gt || op == IROp::Le) std::swap(lhs, rhs);
+        AsmOp branch = op == IROp::Lt || op == IROp::Gt ? AsmOp::Blt :
+                       op == IROp::Ge || op == IROp::Le ? AsmOp::Bge :
+                       op == IROp::Eq ? AsmOp::Beq : AsmOp::Bne;
+        emit(AsmInst::branch(branch, lhs, rhs, blockLabel(target)));
+    } else {
+        Register reg = operand(cond, SCRATCH_LHS);
+        emit(AsmInst::branchZero(invert ? AsmOp::Beqz : AsmOp::Bnez, reg, blockLabel(target)));
+    }
+    if (!invert && ifFalse != next) emit(AsmInst::jump(AsmOp::J, blockLabel(ifFalse)));
+}
+
+void InstructionSelector::emitBinary(IRInst* inst) {
+    IRInst* lhs = inst->operands[0];
+    IRInst* rhs = inst->operands[1];
+    bool lhsConst = lhs->op == IROp::Const;
+    bool rhsConst = rhs->op == IROp::Const;
+    Register d = resultRegister(inst, SCRATCH_RHS);
+    auto rr = [&](AsmOp op) {
+        Register l = operand(lhs, SCRATCH_LHS);
+        emit(AsmInst::binary(op, d, l, operand(rhs, SCRATCH_RHS)));
+    };
+    auto ri = [&](AsmOp op, const IRInst* value, int imm) {
+        emit(AsmInst::immediate(op, d, operand(value, SCRATCH_LHS), imm));
+    };
+    // a > b 即 b < a
+    auto swappedSlt = [&]() {
+        Register r = operand(rhs, SCRATCH_RHS);
+        emit(AsmInst::binary(AsmOp::Slt, d, r, operand(lhs, SCRATCH_LHS)));
+    };
+
+    switch (inst->op) {
+        case IROp::Add:
+            if (rhsConst && fitsImm12(rhs->imm)) ri(AsmOp::Addi, lhs, rhs->imm);
+            else if (lhsConst && fitsImm12(lhs->imm)) ri(AsmOp::Addi, rhs, lhs->imm);
+            else rr(AsmOp::Add);
+            break;
+        case IROp::Sub:
+            if (rhsConst && fitsImm12(-static_cast<int64_t>(rhs->imm))) ri(AsmOp::Addi, lhs, -rhs->imm);
+            else rr(AsmOp::Sub);
+            break;
+        case IROp::Mul:
+            // 乘常量能用移位加减时不用mul；序列借用SCRATCH_MOVE
+            if (constantMulDiv && rhsConst && shiftMultiplyLength(rhs->imm)) {
+                lowerMultiply(code, d, operand(lhs, SCRATCH_LHS), rhs->imm, SCRATCH_MOVE);
+            } else if (constantMulDiv && lhsConst && shiftMultiplyLength(lhs->imm)) {
+                lowerMultiply(code, d, operand(rhs, SCRATCH_LHS), lhs->imm, SCRATCH_MOVE);
+            } else {
+                rr(AsmOp::Mul);
+            }
+            break;
+        case IROp::Div:
+        case IROp::Rem: {
+            AsmOp op = inst->op == IROp::Div ? AsmOp::Div : AsmOp::Rem;
+            // 除数是非零常量时用乘高位序列。d与被除数相同时d是分配的寄存器，SCRATCH_RHS空着
+            if (constantMulDiv && rhsConst && rhs->imm != 0) {
+                lowerDivide(code, op, d, operand(lhs, SCRATCH_LHS), rhs->imm, SCRATCH_MOVE, SCRATCH_RHS);
+            } else {
+                rr(op);
+            }
+            break;
+        }
+        case IROp::Lt:
+            if (rhsConst && fitsImm12(rhs->imm)) ri(AsmOp::Slti, lhs, rhs->imm);
+            else rr(AsmOp::Slt);
+            break;
+        case IROp::Gt:
+            if (lhsConst && fitsImm12(lhs->imm)) {
+                ri(AsmOp::Slti, rhs, lhs->imm);
+            } else {
+                swappedSlt();
+            }
+            break;
+        case IROp::Le:
+            // a <= c 即 a < c+1，否则 !(b < a)
+            if (rhsConst && rhs->imm != INT_MAX && fitsImm12(rhs->imm + 1)) {
+                ri(AsmOp::Slti, lhs, rhs->imm + 1);
+            } else {
+                swappedSlt();
+                emit(AsmInst::immediate(AsmOp::Xori, d, d, 1));
+            }
+            break;
+        case IROp::Ge:
+            if (rhsConst && fitsImm12(rhs->imm)) ri(AsmOp::Slti, lhs, rhs->imm);
+            else rr(AsmOp::Slt);
+            emit(AsmInst::immediate(AsmOp::Xori, d, d, 1));
+            break;
+        case IROp::Eq:
+        case IROp::Ne: {
+            AsmOp test = inst->op == IROp::Eq ? AsmOp::Seqz : AsmOp::Snez;
+            if (lhsConst && !rhsConst) std::swap(lhs, rhs);
+            if (rhs->op == IROp::Const && rhs->imm == 0) {
+                emit(AsmInst::unary(test, d, operand(lhs, SCRATCH_LHS)));
+                break;
+            }
+            if (rhs->op == IROp::Const && fitsImm12(-static_cast<int64_t>(rhs->imm))) {
+                ri(AsmOp::Addi, lhs, -rhs->imm);
+            } else {
+                rr(AsmOp::Xor);
+            }
+            emit(AsmInst::unary(test, d, d));
+            break;
+        }
+        default:
+            throw std::runtime_error("指令选择: 不支持的IR指令 " + std::string(irOpName(inst->op)));
+    }
+    storeResult(inst, resultRegister(inst, SCRATCH_RHS));
+}
+
+void InstructionSelector::emitCall(IRInst* inst) {
+    std::string callee(names.name(inst->callee));
+    emitComment("函数调用: " + callee);
+
+    // 第9个及以后的实参放到栈底的传参区，其余并行传送到a0~a7
+    std::vector<Move> moves;
+    for (size_t i = 0; i < inst->operands.size(); ++i) {
+        if (i >= 8) {
+            emitMemory(AsmOp::Sw, operand(inst->operands[i], SCRATCH_LHS), static_cast<int>(i - 8) * 4, Register::SP);
+        } else {
+            moves.emplace_back(Location{Location::Reg, argRegister(static_cast<int>(i)), 0},
+                               locationOf(inst->operands[i]));
+        }
+    }
+    emitParallelMove(moves);
+    emit(AsmInst::jump(AsmOp::Call, callee));
+    if (inst->hasValue) emitMove(locationOf(inst), Location{Location::Reg, Register::A0, 0});
+}
+
+bool InstructionSelector::isTailCall(const IRBlock* block, const IRInst* call) const {
+    // 栈上传参区属于调用者的栈帧，大小未必够用，只处理实参都在寄存器里的调用
+    size_t size = block->insts.size();
+    if (call->operands.size() > 8 || size < 2 || block->insts[size - 2] != call) return false;
+    const IRInst* ret = block->insts[size - 1];
+    return ret->op == IROp::Ret && (ret->operands.empty() || ret->operands[0] == call);
+}
+
+void InstructionSelector::emitTailCall(IRInst* inst) {
+    std::string callee(names.name(inst->callee));
+    emitComment("尾调用: " + callee);
+
+    std::vector<Move> moves;
+    for (size_t i = 0; i < inst->operands.size(); ++i) {
+        moves.emplace_back(Location{Location::Reg, argRegister(static_cast<int>(i)), 0},
+                           locationOf(inst->operands[i]));
+    }
+    emitParallelMove(moves);
+    // 先拆掉本函数的栈帧，被调函数直接返回到我们的调用者
+    restoreFrame();
+    emit(AsmInst::jump(AsmOp::Tail, callee));
+}
+
+void InstructionSelector::emitPhiMoves(IRBlock* from, IRBlock* to) {
+    std::vector<Move> moves;
+    for (IRInst* phi : to->insts) {
+        if (phi->op != IROp::Phi) break;
+        auto it = std::find(phi->targets.begin(), phi->targets.end(), from);
+        moves.emplace_back(locationOf(phi), locationOf(phi->operands[it - phi->targets.begin()]));
+    }
+    emitParallelMove(moves);
+}
+
+InstructionSelector::Location InstructionSelector::locationOf(const IRInst* value) const {
+    if (value->op == IROp::Const) return Location{Location::Imm, Register::ZERO, value->imm};
+    return locations[value->id];
+}
+
+Register InstructionSelector::operand(const IRInst* value, Register scratch) {
+    Location loc = locationOf(value);
+    switch (loc.kind) {
+        case Location::Reg:
+            return loc.reg;
+        case Location::Imm:
+            if (loc.value == 0) return Register::ZERO;
+            emit(AsmInst::loadImm(scratch, loc.value));
+            return scratch;
+        case Location::Slot:
+            emitFrameMemory(AsmOp::Lw, scratch, loc.value);
+            return scratch;
+    }
+    return scratch;
+}
+
+Register InstructionSelector::resultRegister(const IRInst* value, Register scratch) {
+    Location loc = locationOf(value);
+    return loc.kind == Location::Reg ? loc.reg : scratch;
+}
+
+void InstructionSelector::storeResult(const IRInst* value, Register reg) {
+    Location loc = locationOf(value);
+    if (loc.kind == Location::Slot) emitFrameMemory(AsmOp::Sw, reg, loc.value);
+}
+
+std::string InstructionSelector::blockLabel(const IRBlock* block) const {
+    return ".L" + funcName + "_" + std::to_string(block->id);
+}
+
+std::string InstructionSelector::epilogueLabel() const {
+    return ".L" + funcName + "_epilogue";
+}
+
+void InstructionSelector::emit(AsmInst inst) {
+    code.push_back(std::move(inst));
+}
+
+void InstructionSelector::emitLabel(const std::string& label) {
+    code.push_back(AsmInst::label(label));
+}
+
+void InstructionSelector::emitComment(const std::string& comment) {
+    if (emitter.wantsComments()) code.push_back(AsmInst::comment(comment));
+}
+
+void InstructionSelector::emitDirective(const std::string& directive) {
+    code.push_back(AsmInst::directive(directive));
+}
+
+void InstructionSelector::flush() {
+    if (peephole) peephole->run(code);
+    emitter.emit(code);
+    code.clear();
+}
+
+void InstructionSelector::emitMemory(AsmOp op, Register reg, int offset, Register base) {
+    if (fitsImm12(offset)) {
+        emit(AsmInst::memory(op, reg, offset, base));
+        return;
+    }
+    // 偏移超出12位立即数：装入时借用目标寄存器算地址，存储时借用一个不冲突的保留寄存器
+    Register addr = op == AsmOp::Lw ? reg : (reg == SCRATCH_LHS ? SCRATCH_RHS : SCRATCH_LHS);
+    emit(AsmInst::loadImm(addr, offset));
+    emit(AsmInst::binary(AsmOp::Add, addr, addr, base));
+    emit(AsmInst::memory(op, reg, 0, addr));
+}
+
+void InstructionSelector::emitFrameMemory(AsmOp op, Register reg, int offset) {
+    emitMemory(op, reg, frameSize + offset, Register::SP);
+}
+
+void InstructionSelector::emitAddImmediate(Register dst, Register src, int imm) {
+    if (fitsImm12(imm)) {
+        emit(AsmInst::immediate(AsmOp::Addi, dst, src, imm));
+        return;
+    }
+    emit(AsmInst::loadImm(SCRATCH_MOVE, imm));
+    emit(AsmInst::binary(AsmOp::Add, dst, src, SCRATCH_MOVE));
+}
+
+void InstructionSelector::emitMove(const Location& dst, const Location& src) {
+    if (dst == src) return;
+    if (dst.kind == Location::Reg) {
+        switch (src.kind) {
+            case Location::Reg: emit(AsmInst::unary(AsmOp::Mv, dst.reg, src.reg)); break;
+            case Location::Slot: emitFrameMemory(AsmOp::Lw, dst.reg, src.value); break;
+            case Location::Imm: emit(AsmInst::loadImm(dst.reg, src.value)); break;
+        }
+        return;
+    }
+    // 目标是栈槽
+    Register value = SCRATCH_RHS;
+    switch (src.kind) {
+        case Location::Reg: value = src.reg; break;
+        case Location::Slot: emitFrameMemory(AsmOp::Lw, value, src.value); break;
+        case Location::Imm:
+            if (src.value == 0) value = Register::ZERO;
+            else emit(AsmInst::loadImm(value, src.value));
+            break;
+    }
+    emitFrameMemory(AsmOp::Sw, value, dst.value);
+}
+
+void InstructionSelector::emitParallelMove(std::vector<Move> moves) {
+    moves.erase(std::remove_if(moves.begin(), moves.end(),
+                               [](const Move& move) { return move.first == move.second; }),
+                moves.end());
+    while (!moves.empty()) {
+        // 先发出目标不再被其他传送读取的传送
+        auto ready = std::find_if(moves.begin(), moves.end(), [&](const Move& move) {
+            return std::none_of(moves.begin(), moves.end(),
+                                [&](const Move& other) { return other.second == move.first; });
+        });
+        if (ready != moves.end()) {
+            emitMove(ready->first, ready->second);
+            moves.erase(ready);
+            continue;
+        }
+        // 剩下的传送都在环上：把一个源暂存到保留寄存器打破环
+        Location source = moves.front().second;
+        Location temp{Location::Reg, SCRATCH_MOVE, 0};
+        emitMove(temp, source);
+        for (auto& move : moves) {
+            if (move.second == source) move.second = temp;
+        }
+    }
+}
@@ -0,0 +1,445 @@
+#include "jit.h"
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#if defined(__x86_64__) && defined(__linux__)
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define TOYC_JIT_SUPPORTED 1
+#endif
+
+namespace {
+
+// x86-64机器码的写出。只用到eax、ecx、edx，栈帧以rbp为基址
+enum : uint8_t { EAX = 0, ECX = 1, EDX = 2, RBP = 5, RDI = 7 };
+
+// 条件码：jcc rel32为0F 80+cc，setcc为0F 90+cc
+enum : uint8_t { CondB = 0x2, CondE = 0x4, CondNE = 0x5, CondL = 0xC, CondGE = 0xD, CondLE = 0xE, CondG = 0xF };
+
+// 栈顶低于线程栈底加上这个余量时报栈溢出，留给溢出处理和惰性编译调用的C++代码
+constexpr uintptr_t StackMargin = 256 * 1024;
+
+class X86Writer {
+public:
+    explicit X86Writer(uint8_t* base) : base(base) {}
+
+    std::vector<uint8_t> bytes;
+
+    size_t size() const { return bytes.size(); }
+    uint8_t* address() const { return base + bytes.size(); }
+
+    void byte(uint8_t b) { bytes.push_back(b); }
+    void bytesOf(std::initializer_list<uint8_t> list) { bytes.insert(bytes.end(), list); }
+    void imm32(int32_t value) {
+        uint32_t v = static_cast<uint32_t>(value);
+        for (int i = 0; i < 4; ++i) byte(static_cast<uint8_t>(v >> (8 * i)));
+    }
+    void imm64(uint64_t value) {
+        for (int i = 0; i < 8; ++i) byte(static_cast<uint8_t>(value >> (8 * i)));
+    }
+    void patch32(size_t at, int32_t value) {
+        uint32_t v = static_cast<uint32_t>(value);
+        for (int i = 0; i < 4; ++i) bytes[at + i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+
+    // opcode reg, [base + disp]
+    void mem(std::initializer_list<uint8_t> opcode, uint8_t reg, uint8_t baseReg, int32_t disp) {
+        bytesOf(opcode);
+        if (disp >= -128 && disp <= 127) {
+            byte(static_cast<uint8_t>(0x40 | (reg << 3) | baseReg));
+            byte(static_cast<uint8_t>(disp));
+        } else {
+            byte(static_cast<uint8_t>(0x80 | (reg << 3) | baseReg));
+            imm32(disp);
+        }
+    }
+
+    void load(uint8_t reg, int32_t disp) { mem({0x8B}, reg, RBP, disp); }   // mov reg, [rbp+disp]
+    void store(int32_t disp, uint8_t reg) { mem({0x89}, reg, RBP, disp); }  // mov [rbp+disp], reg
+
+    // 相对跳转和调用的rel32，返回rel32的位置
+    size_t jump() { byte(0xE9); imm32(0); return size() - 4; }
+    size_t jumpIf(uint8_t cond) { bytesOf({0x0F, static_cast<uint8_t>(0x80 | cond)}); imm32(0); return size() - 4; }
+    void jumpIf(uint8_t cond, const uint8_t* target) {
+        bytesOf({0x0F, static_cast<uint8_t>(0x80 | cond)});
+        imm32(static_cast<int32_t>(target - (address() + 4)));
+    }
+    // rel8的短跳转，返回rel8的位置
+    size_t shortJump() { bytesOf({0xEB, 0}); return size() - 1; }
+    size_t shortJumpIf(uint8_t cond) { bytesOf({static_cast<uint8_t>(0x70 | cond), 0}); return size() - 1; }
+    void bindShort(size_t at) { bytes[at] = static_cast<uint8_t>(size() - (at + 1)); }
+
+    void call(const uint8_t* target) {
+        byte(0xE8);
+        imm32(static_cast<int32_t>(target - (address() + 4)));
+    }
+
+private:
+    uint8_t* base;
+};
+
+// 帧里的槽位：rbp-frame起依次存放寄存器0、1、2……，地址连续，实参窗口可以直接传指针。
+// 序言先检查新栈顶不低于*stackLimit，否则跳到overflow
+class FunctionLowering {
+public:
+    FunctionLowering(const BcFunction& function, X86Writer& out, const uintptr_t* stackLimit, const uint8_t* overflow)
+        : function(function), out(out), stackLimit(stackLimit), overflow(overflow),
+          frame((function.registers * 4 + 15) & ~15) {}
+
+    // calls记下每个调用点rel32的位置和被调函数
+    void lower(const std::vector<uint8_t*>& targets, std::vector<std::pair<size_t, int>>& calls) {
+        out.byte(0x55);                       // push rbp
+        out.bytesOf({0x48, 0x89, 0xE5});      // mov rbp, rsp
+        out.bytesOf({0x48, 0x8D, 0x84, 0x24}); // lea rax, [rsp-frame]
+        out.imm32(-frame);
+        out.bytesOf({0x48, 0xB9});            // movabs rcx, stackLimit
+        out.imm64(reinterpret_cast<uint64_t>(stackLimit));
+        out.bytesOf({0x48, 0x3B, 0x01});      // cmp rax, [rcx]
+        out.jumpIf(CondB, overflow);
+        if (frame > 0) {
+            out.bytesOf({0x48, 0x81, 0xEC});  // sub rsp, frame
+            out.imm32(frame);
+        }
+        for (int i = 0; i < function.params; ++i) {
+            out.mem({0x8B}, EAX, RDI, 4 * i); // mov eax, [rdi+4i]
+            out.store(slot(i), EAX);
+        }
+
+        std::vector<size_t> offsets(function.code.size());
+        std::vector<std::pair<size_t, int32_t>> jumps; // rel32的位置，目标字节码下标
+        for (size_t i = 0; i < function.code.size(); ++i) {
+            offsets[i] = out.size();
+            const BcInst& inst = function.code[i];
+            switch (inst.op) {
+                case BcOp::LoadK:
+                    out.mem({0xC7}, 0, RBP, slot(inst.a)); // mov dword [a], k
+                    out.imm32(inst.k);
+                    break;
+                case BcOp::Move:
+                    out.load(EAX, slot(inst.b));
+                    out.store(slot(inst.a), EAX);
+                    break;
+                case BcOp::Add: arithmetic({0x03}, inst); break;       // add eax, [c]
+                case BcOp::Sub: arithmetic({0x2B}, inst); break;       // sub eax, [c]
+                case BcOp::Mul: arithmetic({0x0F, 0xAF}, inst); break; // imul eax, [c]
+                case BcOp::Div: divide(inst, false); break;
+                case BcOp::Mod: divide(inst, true); break;
+                case BcOp::Lt: compare(inst, CondL); break;
+                case BcOp::Le: compare(inst, CondLE); break;
+                case BcOp::Eq: compare(inst, CondE); break;
+                case BcOp::Ne: compare(inst, CondNE); break;
+                case BcOp::AddK:
+                    out.load(EAX, slot(inst.b));
+                    out.byte(0x05); // add eax, k
+                    out.imm32(inst.k);
+                    out.store(slot(inst.a), EAX);
+                    break;
+                case BcOp::Neg:
+                    out.load(EAX, slot(inst.b));
+                    out.bytesOf({0xF7, 0xD8}); // neg eax
+                    out.store(slot(inst.a), EAX);
+                    break;
+                case BcOp::Not:
+                    out.load(EAX, slot(inst.b));
+                    out.bytesOf({0x85, 0xC0}); // test eax, eax
+                    setFlag(CondE);
+                    out.store(slot(inst.a), EAX);
+                    break;
+                case BcOp::Jump:
+                    jumps.emplace_back(out.jump(), inst.k);
+                    break;
+                case BcOp::JumpIfZero:
+                case BcOp::JumpIfNonZero:
+                    out.mem({0x83}, 7, RBP, slot(inst.a)); // cmp dword [a], 0
+                    out.byte(0);
+                    jumps.emplace_back(out.jumpIf(inst.op == BcOp::JumpIfZero ? CondE : CondNE), inst.k);
+                    break;
+                case BcOp::JumpIfLt: compareJump(inst, CondL, jumps); break;
+                case BcOp::JumpIfLe: compareJump(inst, CondLE, jumps); break;
+                case BcOp::JumpIfEq: compareJump(inst, CondE, jumps); break;
+                case BcOp::JumpIfNe: compareJump(inst, CondNE, jumps); break;
+                case BcOp::Call:
+                    out.mem({0x48, 0x8D}, RDI, RBP, slot(inst.b)); // lea rdi, [b]
+                    out.call(targets[inst.k]);
+                    calls.emplace_back(out.size() - 4, inst.k);
+                    out.store(slot(inst.a), EAX);
+                    break;
+                case BcOp::Return:
+                    out.load(EAX, slot(inst.a));
+                    out.bytesOf({0xC9, 0xC3}); // leave; ret
+                    break;
+                case BcOp::ReturnVoid:
+                    out.bytesOf({0x31, 0xC0, 0xC9, 0xC3}); // xor eax, eax; leave; ret
+                    break;
+            }
+        }
+        for (auto [at, target] : jumps) {
+            out.patch32(at, static_cast<int32_t>(offsets[target] - (at + 4)));
+        }
+    }
+
+private:
+    const BcFunction& function;
+    X86Writer& out;
+    const uintptr_t* stackLimit;
+    const uint8_t* overflow;
+    int32_t frame;
+
+    int32_t slot(uint16_t reg) const { return -frame + 4 * reg; }
+
+    void arithmetic(std::initializer_list<uint8_t> opcode, const BcInst& inst) {
+        out.load(EAX, slot(inst.b));
+        out.mem(opcode, EAX, RBP, slot(inst.c));
+        out.store(slot(inst.a), EAX);
+    }
+
+    // setcc al; movzx eax, al
+    void setFlag(uint8_t cond) {
+        out.bytesOf({0x0F, static_cast<uint8_t>(0x90 | cond), 0xC0, 0x0F, 0xB6, 0xC0});
+    }
+
+    void compare(const BcInst& inst, uint8_t cond) {
+        out.load(EAX, slot(inst.b));
+        out.mem({0x3B}, EAX, RBP, slot(inst.c)); // cmp eax, [c]
+        setFlag(cond);
+        out.store(slot(inst.a), EAX);
+    }
+
+    void compareJump(const BcInst& inst, uint8_t cond, std::vector<std::pair<size_t, int32_t>>& jumps) {
+        out.load(EAX, slot(inst.a));
+        out.mem({0x3B}, EAX, RBP, slot(inst.b));
+        jumps.emplace_back(out.jumpIf(cond), inst.k);
+    }
+
+    // idiv在除数为0和INT_MIN/-1时会触发异常，这两种情况按RV32IM的语义单独处理：
+    // 除以0时商为-1、余数为被除数；除以-1时商为取负（INT_MIN不变）、余数为0
+    void divide(const BcInst& inst, bool remainder) {
+        out.load(EAX, slot(inst.b));
+        out.load(ECX, slot(inst.c));
+        out.bytesOf({0x85, 0xC9}); // test ecx, ecx
+        size_t byZero = out.shortJumpIf(CondE);
+        out.bytesOf({0x83, 0xF9, 0xFF}); // cmp ecx, -1
+        size_t general = out.shortJumpIf(CondNE);
+        if (remainder) {
+            out.bytesOf({0x31, 0xC0}); // xor eax, eax
+        } else {
+            out.bytesOf({0xF7, 0xD8}); // neg eax
+        }
+        size_t done = out.shortJump();
+        out.bindShort(general);
+        out.bytesOf({0x99, 0xF7, 0xF9}); // cdq; idiv ecx
+        if (remainder) out.bytesOf({0x89, 0xD0}); // mov eax, edx
+        size_t done2 = out.shortJump();
+        out.bindShort(byZero);
+        if (!remainder) {
+            out.byte(0xB8); // mov eax, -1
+            out.imm32(-1);
+        }
+        out.bindShort(done);
+        out.bindShort(done2);
+        out.store(slot(inst.a), EAX);
+    }
+};
+
+} // namespace
+
+#ifdef TOYC_JIT_SUPPORTED
+
+namespace {
+
+// 本线程栈的最低可用地址加上余量。主线程的栈范围要读/proc/self/maps，每个线程只取一次
+uintptr_t currentStackLimit() {
+    thread_local uintptr_t limit = 0;
+    if (limit) return limit;
+    pthread_attr_t attr;
+    void* low = nullptr;
+    size_t size = 0;
+    bool known = pthread_getattr_np(pthread_self(), &attr) == 0;
+    if (known) {
+        known = pthread_attr_getstack(&attr, &low, &size) == 0;
+        pthread_attr_destroy(&attr);
+    }
+    if (!known) throw std::runtime_error("JIT: 无法取得线程栈的范围");
+    limit = reinterpret_cast<uintptr_t>(low) + StackMargin;
+    return limit;
+}
+
+} // namespace
+
+JIT::JIT(BcModule module, bool lazy, size_t codeBytes) : module(std::move(module)), capacity(codeBytes) {
+    // 代码区先可读写，写完桩再改成只读可执行；之后每次编译或回填只把涉及的页临时改回可读写
+    void* memory = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED) throw std::runtime_error("JIT: 无法分配可执行内存");
+    code = static_cast<uint8_t*>(memory);
+    pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    // 栈溢出的出口：对齐栈，调用stackOverflow(this)跳回call
+    X86Writer exit(code);
+    exit.bytesOf({0x48, 0x83, 0xE4, 0xF0});                  // and rsp, -16
+    exit.bytesOf({0x48, 0xBF});                              // movabs rdi, this
+    exit.imm64(reinterpret_cast<uint64_t>(this));
+    exit.bytesOf({0x48, 0xB8});                              // movabs rax, stackOverflow
+    exit.imm64(reinterpret_cast<uint64_t>(&JIT::stackOverflow));
+    exit.bytesOf({0xFF, 0xD0});                              // call rax
+    std::memcpy(code, exit.bytes.data(), exit.size());
+    overflowExit = code;
+    used = (exit.size() + 15) & ~size_t(15);
+
+    size_t count = this->module.functions.size();
+    entries.assign(count, nullptr);
+    callers.resize(count);
+    // 桩：保存args，调用lazyCompile(this, i)得到机器码地址，恢复args后跳过去
+    for (size_t i = 0; i < count; ++i) {
+        X86Writer stub(code + used);
+        stub.byte(0x57);                                         // push rdi
+        stub.bytesOf({0x48, 0xBF});                              // movabs rdi, this
+        stub.imm64(reinterpret_cast<uint64_t>(this));
+        stub.byte(0xBE);                                         // mov esi, i
+        stub.imm32(static_cast<int32_t>(i));
+        stub.bytesOf({0x48, 0xB8});                              // movabs rax, lazyCompile
+        stub.imm64(reinterpret_cast<uint64_t>(&JIT::lazyCompile));
+        stub.bytesOf({0xFF, 0xD0});                              // call rax
+        stub.byte(0x5F);                                         // pop rdi
+        stub.bytesOf({0xFF, 0xE0});                              // jmp rax
+        if (used + stub.size() > capacity) throw std::runtime_error("JIT: 代码区已满");
+        std::memcpy(code + used, stub.bytes.data(), stub.size());
+        stubs.push_back(code + used);
+        used += (stub.size() + 15) & ~size_t(15);
+    }
+    // 预先编译全部函数时代码区一直可读写，编完一起改成只读可执行
+    if (!lazy) {
+        for (size_t i = 0; i < count; ++i) compile(static_cast<int>(i));
+    }
+    setWritable(code, used, false);
+    writable = false;
+}
+
+JIT::~JIT() {
+    if (code) munmap(code, capacity);
+}
+
+void JIT::setWritable(uint8_t* at, size_t bytes, bool writable) {
+    uintptr_t begin = reinterpret_cast<uintptr_t>(at) & ~(pageSize - 1);
+    uintptr_t end = (reinterpret_cast<uintptr_t>(at) + bytes + pageSize - 1) & ~(pageSize - 1);
+    int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC;
+    if (mprotect(reinterpret_cast<void*>(begin), end - begin, prot) != 0) {
+        throw std::runtime_error("JIT: 无法修改代码区的访问权限");
+    }
+}
+
+void JIT::stackOverflow(JIT* jit) {
+    // JIT帧没有展开信息，不能抛异常，直接跳回call里setjmp的位置
+    std::longjmp(jit->overflow, 1);
+}
+
+uint8_t* JIT::lazyCompile(JIT* jit, int function) {
+    // 从机器码里调用，异常不能穿过没有展开信息的JIT帧
+    try {
+        return jit->compile(function);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "JIT: 编译函数%s失败: %s\n", jit->module.functions[function].name.c_str(), e.what());
+        std::abort();
+    }
+}
+
+uint8_t* JIT::compile(int function) {
+    if (entries[function]) return entries[function];
+    const BcFunction& bc = module.functions[function];
+    // 调用已经编译的函数时直接调用机器码，否则调用桩
+    std::vector<uint8_t*> targets(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) targets[i] = entries[i] ? entries[i] : stubs[i];
+
+    // 递归调用直接调用自己的入口，不经过桩
+    uint8_t* start = code + used;
+    targets[function] = start;
+    X86Writer out(start);
+    std::vector<std::pair<size_t, int>> calls;
+    FunctionLowering(bc, out, &stackLimit, overflowExit).lower(targets, calls);
+    if (used + out.size() > capacity) throw std::runtime_error("JIT: 代码区已满");
+    // 新代码、桩和指向桩的调用点所在的页一次改成可读写，写完再改回来
+    uint8_t* low = std::min(start, stubs[function]);
+    for (uint8_t* site : callers[function]) low = std::min(low, site);
+    size_t span = start + out.size() - low;
+    if (!writable) setWritable(low, span, true);
+    std::memcpy(start, out.bytes.data(), out.size());
+    used += (out.size() + 15) & ~size_t(15);
+    entries[function] = start;
+    ++compiled;
+
+    for (auto [at, callee] : calls) {
+        callSites.emplace_back(start + at, callee);
+        if (!entries[callee]) callers[callee].push_back(start + at);
+    }
+    // 以后经过桩的调用直接跳到机器码；已知的调用点改成直接调用
+    auto rel32 = [](uint8_t* at, const uint8_t* target) {
+        int32_t offset = static_cast<int32_t>(target - (at + 4));
+        std::memcpy(at, &offset, 4);
+    };
+    uint8_t* stub = stubs[function];
+    stub[0] = 0xE9;
+    rel32(stub + 1, start);
+    for (uint8_t* site : callers[function]) rel32(site, start);
+    if (!writable) setWritable(low, span, false);
+    callers[function].clear();
+    callers[function].shrink_to_fit();
+    return start;
+}
+
+size_t JIT::stubCallSites() const {
+    size_t count = 0;
+    for (auto [at, callee] : callSites) {
+        int32_t offset;
+        std::memcpy(&offset, at, 4);
+        if (at + 4 + offset == stubs[callee]) ++count;
+    }
+    return count;
+}
+
+#else
+
+JIT::JIT(BcModule module, bool, size_t) : module(std::move(module)) {
+    throw std::runtime_error("JIT只支持x86-64 Linux");
+}
+
+JIT::~JIT() {}
+
+uint8_t* JIT::lazyCompile(JIT*, int) { return nullptr; }
+
+uint8_t* JIT::compile(int) { return nullptr; }
+
+size_t JIT::stubCallSites() const { return 0; }
+
+#endif
+
+JIT::Function JIT::lookup(const std::string& name) const {
+    int index = module.find(name);
+    if (index < 0) return nullptr;
+    return reinterpret_cast<Function>(entries[index] ? entries[index] : stubs[index]);
+}
+
+int32_t JIT::call(const std::string& name, const std::vector<int32_t>& args) {
+    int index = module.find(name);
+    if (index < 0) throw std::runtime_error("找不到函数" + name);
+    const BcFunction& function = module.functions[index];
+    if (static_cast<int>(args.size()) != function.params) {
+        throw std::runtime_error("函数" + function.name + "需要" + std::to_string(function.params) + "个实参");
+    }
+    Function entry = lookup(name);
+#ifdef TOYC_JIT_SUPPORTED
+    // 机器码的序言发现栈不够时经stackOverflow跳回这里，与虚拟机一样报栈溢出
+    stackLimit = currentStackLimit();
+    if (setjmp(overflow)) {
+        stackLimit = 0;
+        throw std::runtime_error("栈溢出");
+    }
+    int32_t result = entry(args.data());
+    stackLimit = 0;
+    return result;
+#else
+    return entry(args.data());
+#endif
+}
@@ -0,0 +1,351 @@
+#include "lexer.h"
+#include <cctype>
+#include <unordered_map>
+
+namespace {
+
+// 字符分类表，避免<cctype>的locale开销
+enum : uint8_t { CH_SPACE = 1, CH_DIGIT = 2, CH_IDENT_START = 4, CH_IDENT = 8 };
+
+struct CharTable {
+    uint8_t flags[256] = {};
+    constexpr CharTable() {
+        flags[static_cast<uint8_t>(' ')] = flags[static_cast<uint8_t>('\t')] = CH_SPACE;
+        flags[static_cast<uint8_t>('\r')] = flags[static_cast<uint8_t>('\n')] = CH_SPACE;
+        for (int c = '0'; c <= '9'; ++c) flags[c] = CH_DIGIT | CH_IDENT;
+        for (int c = 'a'; c <= 'z'; ++c) flags[c] = CH_IDENT_START | CH_IDENT;
+        for (int c = 'A'; c <= 'Z'; ++c) flags[c] = CH_IDENT_START | CH_IDENT;
+        flags[static_cast<uint8_t>('_')] = CH_IDENT_START | CH_IDENT;
+    }
+};
+
+constexpr CharTable charTable;
+
+inline bool is(char c, uint8_t flag) {
+    return charTable.flags[static_cast<uint8_t>(c)] & flag;
+}
+
+} // namespace
+
+ViewLexer::ViewLexer(std::string_view source, StringInterner* interner)
+    : source(source), interner(interner), position(0), lineStart(0), line(1) {}
+
+void ViewLexer::skipWhitespace() {
+    const size_t size = source.size();
+    while (position < size) {
+        char c = source[position];
+        if (c == '\n') {
+            ++position;
+            ++line;
+            lineStart = position;
+        } else if (is(c, CH_SPACE)) {
+            ++position;
+        } else if (c == '/' && position + 1 < size && source[position + 1] == '/') {
+            // 单行注释
+            while (position < size && source[position] != '\n') ++position;
+        } else if (c == '/' && position + 1 < size && source[position + 1] == '*') {
+            // 多行注释
+            position += 2;
+            while (position < size && !(source[position] == '*' && position + 1 < size && source[position + 1] == '/')) {
+                if (source[position] == '\n') {
+                    ++line;
+                    lineStart = position + 1;
+                }
+                ++position;
+            }
+            position = position + 2 < size ? position + 2 : size;
+        } else {
+            break;
+        }
+    }
+}
+
+TokenView ViewLexer::makeToken(TokenType type, size_t start, size_t length) {
+    return TokenView{type, source.substr(start, length), static_cast<uint32_t>(start),
+                     line, static_cast<int>(start - lineStart + 1), InvalidSymbol};
+}
+
+TokenView ViewLexer::nextToken() {
+    skipWhitespace();
+    if (position >= source.size()) {
+        return makeToken(TokenType::END_OF_FILE, position, 0);
+    }
+    char c = source[position];
+    if (is(c, CH_DIGIT)) return readNumber();
+    if (is(c, CH_IDENT_START)) return readIdentifier();
+    return readOperator();
+}
+
+TokenView ViewLexer::peekToken() {
+    size_t savedPosition = position;
+    size_t savedLineStart = lineStart;
+    int savedLine = line;
+    TokenView token = nextToken();
+    position = savedPosition;
+    lineStart = savedLineStart;
+    line = savedLine;
+    return token;
+}
+
+void ViewLexer::reset() {
+    position = 0;
+    lineStart = 0;
+    line = 1;
+}
+
+TokenView ViewLexer::readNumber() {
+    size_t start = position;
+    while (position < source.size() && is(source[position], CH_DIGIT)) ++position;
+    return makeToken(TokenType::INT_LITERAL, start, position - start);
+}
+
+TokenView ViewLexer::readIdentifier() {
+    size_t start = position;
+    while (position < source.size() && is(source[position], CH_IDENT)) ++position;
+    TokenView token = makeToken(TokenType::IDENTIFIER, start, position - start);
+    token.type = keywordType(token.text);
+    if (token.type == TokenType::IDENTIFIER && interner) {
+        token.symbol = interner->intern(token.text);
+    }
+    return token;
+}
+
+TokenView ViewLexer::readOperator() {
+    size_t start = position;
+    char c = source[position];
+    char next = position + 1 < source.size() ? source[position + 1] : '\0';
+
+    // 双字符运算符
+    TokenType type = TokenType::ERROR;
+    if (next == '=') {
+        switch (c) {
+            case '=': type = TokenType::EQUAL; break;
+            case '!': type = TokenType::NOT_EQUAL; break;
+            case '<': type = TokenType::LESS_EQUAL; break;
+            case '>': type = TokenType::GREATER_EQUAL; break;
+            default: break;
+        }
+    } else if (c == '&' && next == '&') {
+        type = TokenType::AND;
+    } else if (c == '|' && next == '|') {
+        type = TokenType::OR;
+    }
+    if (type != TokenType::ERROR) {
+        position += 2;
+        return makeToken(type, start, 2);
+    }
+
+    // 单字符运算符和分隔符
+    switch (c) {
+        case '+': type = TokenType::PLUS; break;
+        case '-': type = TokenType::MINUS; break;
+        case '*': type = TokenType::MULTIPLY; break;
+        case '/': type = TokenType::DIVIDE; break;
+        case '%': type = TokenType::MODULO; break;
+        case '=': type = TokenType::ASSIGN; break;
+        case '<': type = TokenType::LESS; break;
+        case '>': type = TokenType::GREATER; break;
+        case '!': type = TokenType::NOT; break;
+        case '(': type = TokenType::LPAREN; break;
+        case ')': type = TokenType::RPAREN; break;
+        case '{': type = TokenType::LBRACE; break;
+        case '}': type = TokenType::RBRACE; break;
+        case ';': type = TokenType::SEMICOLON; break;
+        case ',': type = TokenType::COMMA; break;
+        default: type = TokenType::ERROR; break;
+    }
+    ++position;
+    return makeToken(type, start, 1);
+}
+
+TokenType ViewLexer::keywordType(std::string_view word) {
+    // 先按长度分派，避免对每个标识符做哈希查找
+    switch (word.size()) {
+        case 2:
+            if (word == "if") return TokenType::IF;
+            break;
+        case 3:
+            if (word == "int") return TokenType::INT;
+            break;
+        case 4:
+            if (word == "void") return TokenType::VOID;
+            if (word == "else") return TokenType::ELSE;
+            break;
+        case 5:
+            if (word == "while") return TokenType::WHILE;
+            if (word == "break") return TokenType::BREAK;
+            break;
+        case 6:
+            if (word == "return") return TokenType::RETURN;
+            break;
+        case 8:
+            if (word == "continue") return TokenType::CONTINUE;
+            break;
+        default:
+            break;
+    }
+    return TokenType::IDENTIFIER;
+}
+
+// 以下是原来的逐字符扫描器，保留作为lexer_bench的对照
+
+Lexer::Lexer(const std::string& source)
+    : source(source), position(0), line(1), column(1) {}
+
+char Lexer::currentChar() {
+    return position < source.size() ? source[position] : '\0';
+}
+
+char Lexer::peekChar() {
+    return position + 1 < source.size() ? source[position + 1] : '\0';
+}
+
+void Lexer::advance() {
+    if (position >= source.size()) return;
+    if (source[position] == '\n') {
+        ++line;
+        column = 1;
+    } else {
+        ++column;
+    }
+    ++position;
+}
+
+void Lexer::skipWhitespace() {
+    while (true) {
+        char c = currentChar();
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            advance();
+        } else if (c == '/' && (peekChar() == '/' || peekChar() == '*')) {
+            skipComment();
+        } else {
+            break;
+        }
+    }
+}
+
+void Lexer::skipComment() {
+    if (peekChar() == '/') {
+        // 单行注释
+        while (currentChar() != '\0' && currentChar() != '\n') advance();
+        return;
+    }
+    // 多行注释
+    advance();
+    advance();
+    while (currentChar() != '\0') {
+        if (currentChar() == '*' && peekChar() == '/') {
+            advance();
+            advance();
+            return;
+        }
+        advance();
+    }
+}
+
+Token Lexer::nextToken() {
+    skipWhitespace();
+    char c = currentChar();
+    if (c == '\0') {
+        return Token(TokenType::END_OF_FILE, "", line, column);
+    }
+    if (std::isdigit(static_cast<unsigned char>(c))) {
+        return readNumber();
+    }
+    if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+        return readIdentifier();
+    }
+    return readOperator();
+}
+
+Token Lexer::peekToken() {
+    size_t savedPosition = position;
+    size_t savedLine = line;
+    size_t savedColumn = column;
+    Token token = nextToken();
+    position = savedPosition;
+    line = savedLine;
+    column = savedColumn;
+    return token;
+}
+
+void Lexer::reset() {
+    position = 0;
+    line = 1;
+    column = 1;
+}
+
+Token Lexer::readNumber() {
+    int startLine = line, startColumn = column;
+    size_t start = position;
+    while (std::isdigit(static_cast<unsigned char>(currentChar()))) advance();
+    return Token(TokenType::INT_LITERAL, source.substr(start, position - start), startLine, startColumn);
+}
+
+Token Lexer::readIdentifier() {
+    int startLine = line, startColumn = column;
+    size_t start = position;
+    while (std::isalnum(static_cast<unsigned char>(currentChar())) || currentChar() == '_') advance();
+    std::string word = source.substr(start, position - start);
+    if (isKeyword(word)) {
+        return Token(getKeywordType(word), word, startLine, startColumn);
+    }
+    return Token(TokenType::IDENTIFIER, word, startLine, startColumn);
+}
+
+Token Lexer::readOperator() {
+    int startLine = line, startColumn = column;
+    char c = currentChar();
+    char next = peekChar();
+
+    // 双字符运算符
+    auto twoChar = [&](TokenType type, const char* text) {
+        advance();
+        advance();
+        return Token(type, text, startLine, startColumn);
+    };
+    if (c == '=' && next == '=') return twoChar(TokenType::EQUAL, "==");
+    if (c == '!' && next == '=') return twoChar(TokenType::NOT_EQUAL, "!=");
+    if (c == '<' && next == '=') return twoChar(TokenType::LESS_EQUAL, "<=");
+    if (c == '>' && next == '=') return twoChar(TokenType::GREATER_EQUAL, ">=");
+    if (c == '&' && next == '&') return twoChar(TokenType::AND, "&&");
+    if (c == '|' && next == '|') return twoChar(TokenType::OR, "||");
+
+    // 单字符运算符和分隔符
+    TokenType type;
+    switch (c) {
+        case '+': type = TokenType::PLUS; break;
+        case '-': type = TokenType::MINUS; break;
+        case '*': type = TokenType::MULTIPLY; break;
+        case '/': type = TokenType::DIVIDE; break;
+        case '%': type = TokenType::MODULO; break;
+        case '=': type = TokenType::ASSIGN; break;
+        case '<': type = TokenType::LESS; break;
+        case '>': type = TokenType::GREATER; break;
+        case '!': type = TokenType::NOT; break;
+        case '(': type = TokenType::LPAREN; break;
+        case ')': type = TokenType::RPAREN; break;
+        case '{': type = TokenType::LBRACE; break;
+        case '}': type = TokenType::RBRACE; break;
+        case ';': type = TokenType::SEMICOLON; break;
+        case ',': type = TokenType::COMMA; break;
+        default: type = TokenType::ERROR; break;
+    }
+    advance();
+    return Token(type, std::string(1, c), startLine, startColumn);
+}
+
+bool Lexer::isKeyword(const std::string& word) {
+    return word == "int" || word == "void" || word == "if" || word == "else" ||
+           word == "while" || word == "return" || word == "break" || word == "continue";
+}
+
+TokenType Lexer::getKeywordType(const std::string& word) {
+    static const std::unordered_map<std::string, TokenType> keywords = {
+        {"int", TokenType::INT}, {"void", TokenType::VOID},
+        {"if", TokenType::IF}, {"else", TokenType::ELSE},
+        {"while", TokenType::WHILE}, {"return", TokenType::RETURN},
+        {"break", TokenType::BREAK}, {"continue", TokenType::CONTINUE},
+    };
+    return keywords.at(word);
+}
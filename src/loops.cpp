@@ -0,0 +1,637 @@
+#include "loops.h"
+#include "muldiv.h"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+std::vector<std::unique_ptr<IRLoop>> findLoops(const IRFunction& func) {
+    std::vector<IRBlock*> idom = computeDominators(func);
+    // 支配树的先序和后序编号：a支配b当且仅当b的区间落在a的区间里，长函数里不用沿idom链往上走
+    std::vector<std::vector<IRBlock*>> children(idom.size());
+    for (IRBlock* block : func.blocks) {
+        IRBlock* parent = idom[block->id];
+        if (parent && parent != block) children[parent->id].push_back(block);
+    }
+    std::vector<int> enter(idom.size(), 0), leave(idom.size(), 0);
+    int clock = 0;
+    std::vector<std::pair<IRBlock*, size_t>> stack{{func.entry(), 0}};
+    enter[func.entry()->id] = clock++;
+    while (!stack.empty()) {
+        auto& [block, next] = stack.back();
+        if (next < children[block->id].size()) {
+            IRBlock* child = children[block->id][next++];
+            enter[child->id] = clock++;
+            stack.emplace_back(child, 0);
+        } else {
+            leave[block->id] = clock++;
+            stack.pop_back();
+        }
+    }
+    auto dominates = [&](const IRBlock* a, const IRBlock* b) {
+        return enter[a->id] <= enter[b->id] && leave[b->id] <= leave[a->id];
+    };
+
+    std::vector<std::unique_ptr<IRLoop>> loops;
+    std::unordered_map<IRBlock*, IRLoop*> byHeader;
+    for (IRBlock* block : func.blocks) {
+        if (!idom[block->id]) continue;
+        for (IRBlock* succ : block->succs()) {
+            if (!dominates(succ, block)) continue;
+            IRLoop*& loop = byHeader[succ];
+            if (!loop) {
+                loops.push_back(std::make_unique<IRLoop>());
+                loop = loops.back().get();
+                loop->header = succ;
+                loop->blocks.insert(succ);
+            }
+            if (std::find(loop->latches.begin(), loop->latches.end(), block) == loop->latches.end()) {
+                loop->latches.push_back(block);
+            }
+        }
+    }
+
+    // 从回边的源逆着前驱走，碰到循环头为止
+    for (auto& loop : loops) {
+        std::vector<IRBlock*> worklist;
+        for (IRBlock* latch : loop->latches) {
+            if (loop->blocks.insert(latch).second) worklist.push_back(latch);
+        }
+        while (!worklist.empty()) {
+            IRBlock* block = worklist.back();
+            worklist.pop_back();
+            for (IRBlock* pred : block->preds) {
+                if (idom[pred->id] && loop->blocks.insert(pred).second) worklist.push_back(pred);
+            }
+        }
+    }
+
+    // 循环头不同的两个自然循环要么嵌套要么不相交，按大小排序后第一个包含自己循环头的就是直接外层
+    std::stable_sort(loops.begin(), loops.end(), [](const auto& a, const auto& b) {
+        return a->blocks.size() < b->blocks.size();
+    });
+    for (size_t i = 0; i < loops.size(); ++i) {
+        for (size_t j = i + 1; j < loops.size(); ++j) {
+            if (loops[j]->contains(loops[i]->header)) {
+                loops[i]->parent = loops[j].get();
+                break;
+            }
+        }
+    }
+    return loops;
+}
+
+namespace {
+
+int wrappingMul(int a, int b) {
+    return static_cast<int>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b));
+}
+
+// 循环外进入循环头的前驱
+std::vector<IRBlock*> outsidePreds(const IRLoop& loop) {
+    std::vector<IRBlock*> preds;
+    for (IRBlock* pred : loop.header->preds) {
+        if (!loop.contains(pred) && std::find(preds.begin(), preds.end(), pred) == preds.end()) {
+            preds.push_back(pred);
+        }
+    }
+    return preds;
+}
+
+// 在block的终结指令前插入inst
+void insertBeforeTerminator(IRBlock* block, IRInst* inst) {
+    inst->block = block;
+    block->insts.insert(block->insts.end() - 1, inst);
+}
+
+IRInst* createBinary(IRFunction& func, IROp op, IRInst* lhs, IRInst* rhs) {
+    IRInst* inst = func.createInst(op);
+    inst->operands = {lhs, rhs};
+    return inst;
+}
+
+// 循环唯一的循环外前驱并且只跳到循环头时直接用它，否则在循环头前新建一个前置块，
+// 把循环外的入边都改到前置块，循环头φ中来自这些边的入值在前置块里汇合
+IRBlock* ensurePreheader(IRFunction& func, IRLoop& loop) {
+    IRBlock* header = loop.header;
+    std::vector<IRBlock*> outside = outsidePreds(loop);
+    if (outside.size() == 1 && outside[0]->succs().size() == 1) return outside[0];
+
+    IRBlock* preheader = func.createBlock();
+    IRInst* jump = func.createInst(IROp::Jump);
+    jump->hasValue = false;
+    jump->block = preheader;
+    jump->targets.push_back(header);
+    preheader->insts.push_back(jump);
+
+    std::vector<IRInst*> preheaderPhis;
+    for (IRInst* phi : header->insts) {
+        if (phi->op != IROp::Phi) break;
+        IRInst* merged = func.createInst(IROp::Phi);
+        merged->block = preheader;
+        for (size_t i = phi->targets.size(); i-- > 0;) {
+            if (loop.contains(phi->targets[i])) continue;
+            merged->operands.insert(merged->operands.begin(), phi->operands[i]);
+            merged->targets.insert(merged->targets.begin(), phi->targets[i]);
+            phi->operands.erase(phi->operands.begin() + i);
+            phi->targets.erase(phi->targets.begin() + i);
+        }
+        // 各条入边的值都相同时不需要φ
+        bool same = std::all_of(merged->operands.begin(), merged->operands.end(),
+                                [&](IRInst* value) { return value == merged->operands[0]; });
+        IRInst* incoming = merged->operands[0];
+        if (!same) {
+            preheaderPhis.push_back(merged);
+            incoming = merged;
+        }
+        phi->operands.push_back(incoming);
+        phi->targets.push_back(preheader);
+    }
+    preheader->insts.insert(preheader->insts.begin(), preheaderPhis.begin(), preheaderPhis.end());
+
+    for (IRBlock* pred : outside) {
+        IRInst* term = pred->terminator();
+        std::replace(term->targets.begin(), term->targets.end(), header, preheader);
+    }
+    func.blocks.insert(std::find(func.blocks.begin(), func.blocks.end(), header), preheader);
+    auto& preds = header->preds;
+    preds.erase(std::remove_if(preds.begin(), preds.end(), [&](IRBlock* pred) { return !loop.contains(pred); }),
+                preds.end());
+    preds.push_back(preheader);
+    preheader->preds = outside;
+    // 前置块在外层循环里
+    for (IRLoop* outer = loop.parent; outer; outer = outer->parent) outer->blocks.insert(preheader);
+    return preheader;
+}
+
+class LICM : public IRPass {
+public:
+    explicit LICM(const LoopOptions& options) : options(options) {}
+
+    const char* name() const override { return "licm"; }
+
+    bool run(IRFunction& func) override {
+        auto loops = findLoops(func);
+        if (loops.empty()) return false;
+        // 块的逆后序序号乘2，新建的前置块取循环头的序号减1；innermost是块所在的最内层循环。
+        // 两者都按块号索引，新建的块号更大，用到时再扩充
+        std::vector<IRBlock*> rpo = reversePostOrder(func);
+        size_t blockCount = 0;
+        for (IRBlock* block : func.blocks) blockCount = std::max(blockCount, static_cast<size_t>(block->id) + 1);
+        std::vector<int> order(blockCount, 0);
+        for (size_t i = 0; i < rpo.size(); ++i) order[rpo[i]->id] = 2 * static_cast<int>(i);
+        std::vector<IRLoop*> innermost(blockCount, nullptr);
+        for (auto& loop : loops) {
+            for (IRBlock* block : loop->blocks) {
+                if (!innermost[block->id]) innermost[block->id] = loop.get();
+            }
+        }
+        std::unordered_map<IRBlock*, int> pressures;
+        bool changed = false;
+        for (auto& loop : loops) {
+            if (loop->header == func.entry()) continue;
+            // 只看直接属于这个循环的块：内层循环里的不变量已经外提到内层的前置块，前置块属于这一层。
+            // 按逆后序找，操作数的定义先于使用，外提的指令的使用者也能随之外提
+            std::vector<IRBlock*> blocks;
+            for (IRBlock* block : loop->blocks) {
+                if (innermost[block->id] == loop.get()) blocks.push_back(block);
+            }
+            std::sort(blocks.begin(), blocks.end(),
+                      [&](IRBlock* a, IRBlock* b) { return order[a->id] < order[b->id]; });
+            std::vector<IRInst*> invariant;
+            std::unordered_set<IRInst*> hoisted;
+            for (IRBlock* block : blocks) {
+                for (IRInst* inst : block->insts) {
+                    if (!isBinary(inst->op)) continue;
+                    bool outside = std::all_of(inst->operands.begin(), inst->operands.end(), [&](IRInst* operand) {
+                        return !loop->contains(operand->block) || hoisted.count(operand);
+                    });
+                    if (!outside) continue;
+                    invariant.push_back(inst);
+                    hoisted.insert(inst);
+                }
+            }
+            if (invariant.empty()) continue;
+
+            // 外提的值在整个循环中活跃，加上原来就跨过循环的值超过上限时只外提前面一部分
+            // （后面的指令只依赖前面的，截断后仍然封闭）。活跃值只在第一次需要时统计
+            if (pressures.empty()) pressures = headerPressure(func, loops);
+            int room = std::max(0, options.maxLivePressure - pressures[loop->header]);
+            if (static_cast<int>(invariant.size()) > room) {
+                invariant.resize(room);
+                hoisted = std::unordered_set<IRInst*>(invariant.begin(), invariant.end());
+            }
+            if (invariant.empty()) continue;
+
+            IRBlock* preheader = ensurePreheader(func, *loop);
+            for (IRBlock* block : blocks) {
+                auto& insts = block->insts;
+                insts.erase(std::remove_if(insts.begin(), insts.end(),
+                                           [&](IRInst* inst) { return hoisted.count(inst) != 0; }),
+                            insts.end());
+            }
+            for (IRInst* inst : invariant) insertBeforeTerminator(preheader, inst);
+            // 新建的前置块排在循环头前面，属于外层循环，外层循环还能把其中的不变量继续外提
+            if (static_cast<size_t>(preheader->id) >= order.size()) {
+                order.resize(preheader->id + 1, 0);
+                innermost.resize(preheader->id + 1, nullptr);
+                order[preheader->id] = order[loop->header->id] - 1;
+                innermost[preheader->id] = loop->parent;
+            }
+            changed = true;
+        }
+        return changed;
+    }
+
+private:
+    LoopOptions options;
+
+    // 各循环头入口处活跃的值的个数（含循环头的φ）。指令选择按块的排列顺序给每个值分配一段连续的活跃区间，
+    // 这里也按排列顺序估计：定义在循环头之前、最后一次使用在循环头或之后的值跨过循环头入口；
+    // φ的入值算在对应前驱的末尾使用。用差分数组一遍算完，长函数里不用逐个值沿前驱回溯
+    static std::unordered_map<IRBlock*, int> headerPressure(const IRFunction& func,
+                                                            const std::vector<std::unique_ptr<IRLoop>>& loops) {
+        std::unordered_map<IRBlock*, int> position;
+        for (size_t i = 0; i < func.blocks.size(); ++i) position[func.blocks[i]] = static_cast<int>(i);
+        std::unordered_map<IRInst*, int> lastUse;
+        for (IRBlock* block : func.blocks) {
+            for (IRInst* inst : block->insts) {
+                for (size_t i = 0; i < inst->operands.size(); ++i) {
+                    IRInst* operand = inst->operands[i];
+                    if (operand->op == IROp::Const) continue;
+                    int use = position[inst->op == IROp::Phi ? inst->targets[i] : block];
+                    auto [it, inserted] = lastUse.emplace(operand, use);
+                    if (!inserted) it->second = std::max(it->second, use);
+                }
+            }
+        }
+        std::vector<int> live(func.blocks.size() + 1, 0);
+        for (auto& [value, use] : lastUse) {
+            int def = position[value->block];
+            if (use <= def) continue;
+            ++live[def + 1];
+            --live[use + 1];
+        }
+        for (size_t i = 1; i < live.size(); ++i) live[i] += live[i - 1];
+        std::unordered_map<IRBlock*, int> pressure;
+        for (auto& loop : loops) {
+            int phis = 0;
+            for (IRInst* inst : loop->header->insts) {
+                if (inst->op != IROp::Phi) break;
+                ++phis;
+            }
+            pressure[loop->header] = live[position[loop->header]] + phis;
+        }
+        return pressure;
+    }
+};
+
+class StrengthReduction : public IRPass {
+public:
+    explicit StrengthReduction(const LoopOptions& options) : options(options) {}
+
+    const char* name() const override { return "strength-reduce"; }
+
+    bool run(IRFunction& func) override {
+        auto loops = findLoops(func);
+        if (loops.empty()) return false;
+        std::vector<IRBlock*> idom = computeDominators(func);
+        // 各循环的替换攒到最后一起做，长函数里有很多循环时只遍历一遍
+        std::unordered_map<IRInst*, IRInst*> replacements;
+        for (auto& loop : loops) {
+            if (loop->header == func.entry()) continue;
+            reduce(func, *loop, idom, replacements);
+        }
+        func.replaceUses(replacements);
+        return !replacements.empty();
+    }
+
+private:
+    LoopOptions options;
+
+    // 基本归纳变量：phi在每条回边上的入值都是next = phi ± step
+    struct Induction {
+        IRInst* phi;
+        IRInst* next;
+        IROp op;
+        int step;
+    };
+
+    static bool findInduction(const IRLoop& loop, IRInst* phi, Induction& iv) {
+        IRInst* next = nullptr;
+        for (size_t i = 0; i < phi->targets.size(); ++i) {
+            if (!loop.contains(phi->targets[i])) continue;
+            if (next && phi->operands[i] != next) return false;
+            next = phi->operands[i];
+        }
+        if (!next || !loop.contains(next->block)) return false;
+        IRInst* lhs = next->operands.size() == 2 ? next->operands[0] : nullptr;
+        IRInst* rhs = next->operands.size() == 2 ? next->operands[1] : nullptr;
+        if (next->op == IROp::Add && lhs == phi && rhs->op == IROp::Const) {
+            iv = {phi, next, IROp::Add, rhs->imm};
+        } else if (next->op == IROp::Add && rhs == phi && lhs->op == IROp::Const) {
+            iv = {phi, next, IROp::Add, lhs->imm};
+        } else if (next->op == IROp::Sub && lhs == phi && rhs->op == IROp::Const) {
+            iv = {phi, next, IROp::Sub, rhs->imm};
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // 支配所有回边的源的块，也就是每次回到循环头之前都执行过的块：各回边的源在支配树上到循环头的路径的交集
+    static std::unordered_set<IRBlock*> everyIteration(const IRLoop& loop, const std::vector<IRBlock*>& idom) {
+        std::unordered_map<IRBlock*, size_t> count;
+        for (IRBlock* latch : loop.latches) {
+            for (IRBlock* block = latch;; block = idom[block->id]) {
+                ++count[block];
+                if (block == loop.header) break;
+            }
+        }
+        std::unordered_set<IRBlock*> blocks;
+        for (auto& [block, n] : count) {
+            if (n == loop.latches.size()) blocks.insert(block);
+        }
+        return blocks;
+    }
+
+    void reduce(IRFunction& func, IRLoop& loop, const std::vector<IRBlock*>& idom,
+                std::unordered_map<IRInst*, IRInst*>& replacements) {
+        std::vector<Induction> inductions;
+        for (IRInst* phi : loop.header->insts) {
+            if (phi->op != IROp::Phi) break;
+            Induction iv;
+            if (findInduction(loop, phi, iv)) inductions.push_back(iv);
+        }
+        if (inductions.empty()) return;
+
+        // 按（归纳变量，因子）分组：同一组只建一个新的归纳变量
+        struct Group {
+            const Induction* iv;
+            IRInst* factor;
+            std::vector<IRInst*> muls;
+            int cost = 0;
+        };
+        std::map<std::pair<int, int>, Group> groups;
+        // 新的归纳变量每次迭代都要加一次步长，只替换每次迭代都会执行的乘法，条件分支中的乘法不动
+        for (IRBlock* block : everyIteration(loop, idom)) {
+            for (IRInst* inst : block->insts) {
+                if (inst->op != IROp::Mul) continue;
+                for (int side = 0; side < 2; ++side) {
+                    IRInst* factor = inst->operands[1 - side];
+                    if (factor->op != IROp::Const && loop.contains(factor->block)) continue;
+                    IRInst* counter = inst->operands[side];
+                    auto iv = std::find_if(inductions.begin(), inductions.end(), [&](const Induction& iv) {
+                        return iv.phi == counter || iv.next == counter;
+                    });
+                    if (iv == inductions.end()) continue;
+                    Group& group = groups[{iv->phi->id, factor->id}];
+                    group.iv = &*iv;
+                    group.factor = factor;
+                    group.muls.push_back(inst);
+                    // 乘常量要先把常量装进寄存器；后端会改成移位加减时按序列的长度算
+                    if (factor->op != IROp::Const) {
+                        group.cost += 1;
+                    } else {
+                        group.cost += options.constantMultiply ? multiplyCost(factor->imm) : 2;
+                    }
+                    break;
+                }
+            }
+        }
+
+        // 新的归纳变量每次迭代要一条加法，回边上通常还要一条传送，省下的乘法不少于两条指令才替换
+        bool changed = false;
+        for (auto& [key, group] : groups) {
+            if (group.cost < 2) continue;
+            auto [phi, next] = derive(func, loop, *group.iv, group.factor);
+            for (IRInst* mul : group.muls) {
+                replacements[mul] = mul->operands[0] == group.iv->next || mul->operands[1] == group.iv->next ? next : phi;
+            }
+            changed = true;
+        }
+        if (!changed) return;
+        for (IRBlock* block : loop.blocks) {
+            auto& insts = block->insts;
+            insts.erase(std::remove_if(insts.begin(), insts.end(),
+                                       [&](IRInst* inst) { return replacements.count(inst) != 0; }),
+                        insts.end());
+        }
+    }
+
+    // 新的归纳变量j = iv.phi * factor：入值为初值乘factor，回边上为j ± step*factor，
+    // 加减紧跟在iv.next后面，因此next能用到的地方也能用j的下一个值
+    static std::pair<IRInst*, IRInst*> derive(IRFunction& func, const IRLoop& loop, const Induction& iv,
+                                              IRInst* factor) {
+        IRInst* step;
+        if (factor->op == IROp::Const) {
+            step = func.constant(wrappingMul(factor->imm, iv.step));
+        } else if (iv.step == 1) {
+            step = factor;
+        } else {
+            // 放在factor的定义之后，支配整个循环
+            step = createBinary(func, IROp::Mul, factor, func.constant(iv.step));
+            step->block = factor->block;
+            auto& insts = factor->block->insts;
+            auto pos = std::find(insts.begin(), insts.end(), factor) + 1;
+            while (pos != insts.end() &&
+                   ((*pos)->op == IROp::Phi || (*pos)->op == IROp::Const || (*pos)->op == IROp::Param)) {
+                ++pos;
+            }
+            insts.insert(pos, step);
+        }
+
+        IRInst* phi = func.createInst(IROp::Phi);
+        phi->block = loop.header;
+        loop.header->insts.insert(loop.header->insts.begin(), phi);
+        IRInst* next = createBinary(func, iv.op, phi, step);
+        next->block = iv.next->block;
+        auto& insts = iv.next->block->insts;
+        insts.insert(std::find(insts.begin(), insts.end(), iv.next) + 1, next);
+
+        for (size_t i = 0; i < iv.phi->targets.size(); ++i) {
+            IRBlock* pred = iv.phi->targets[i];
+            IRInst* incoming;
+            if (loop.contains(pred)) {
+                incoming = next;
+            } else {
+                IRInst* init = iv.phi->operands[i];
+                if (init->op == IROp::Const && factor->op == IROp::Const) {
+                    incoming = func.constant(wrappingMul(init->imm, factor->imm));
+                } else {
+                    incoming = createBinary(func, IROp::Mul, init, factor);
+                    insertBeforeTerminator(pred, incoming);
+                }
+            }
+            phi->operands.push_back(incoming);
+            phi->targets.push_back(pred);
+        }
+        return {phi, next};
+    }
+};
+
+class LoopUnroll : public IRPass {
+public:
+    explicit LoopUnroll(const LoopOptions& options) : options(options) {}
+
+    const char* name() const override { return "loop-unroll"; }
+
+    bool run(IRFunction& func) override {
+        auto loops = findLoops(func);
+        std::unordered_map<IRInst*, IRInst*> replacements;
+        bool changed = false;
+        for (auto& loop : loops) {
+            if (loop->blocks.size() != 1 || loop->header == func.entry()) continue;
+            changed |= unroll(func, *loop, replacements);
+        }
+        if (!changed) return false;
+        func.replaceUses(replacements);
+        func.recomputePreds();
+        return true;
+    }
+
+private:
+    LoopOptions options;
+
+    // 循环头以外唯一的前驱进入后迭代的次数（执行循环头的次数），算不出或超过上限时返回0
+    int tripCount(const IRLoop& loop, IRBlock* preheader) const {
+        IRBlock* header = loop.header;
+        IRInst* term = header->terminator();
+        std::unordered_map<IRInst*, int> values;
+        for (IRInst* phi : header->insts) {
+            if (phi->op != IROp::Phi) break;
+            auto it = std::find(phi->targets.begin(), phi->targets.end(), preheader);
+            IRInst* init = phi->operands[it - phi->targets.begin()];
+            if (init->op == IROp::Const) values[phi] = init->imm;
+        }
+        auto valueOf = [&](IRInst* value, int& out) {
+            if (value->op == IROp::Const) {
+                out = value->imm;
+                return true;
+            }
+            auto it = values.find(value);
+            if (it == values.end()) return false;
+            out = it->second;
+            return true;
+        };
+        // 按常量初值逐次模拟循环头，直到条件分支离开循环
+        for (int trips = 1; trips <= options.maxUnrollTrips; ++trips) {
+            for (IRInst* inst : header->insts) {
+                if (!isBinary(inst->op)) continue;
+                int lhs, rhs, result;
+                if (valueOf(inst->operands[0], lhs) && valueOf(inst->operands[1], rhs) &&
+                    evaluateIROp(inst->op, lhs, rhs, result)) {
+                    values[inst] = result;
+                } else {
+                    values.erase(inst);
+                }
+            }
+            int cond;
+            if (!valueOf(term->operands[0], cond)) return 0;
+            if (term->targets[cond ? 0 : 1] != header) return trips;
+            // φ同时取回边上的入值
+            std::unordered_map<IRInst*, int> next;
+            for (IRInst* phi : header->insts) {
+                if (phi->op != IROp::Phi) break;
+                auto it = std::find(phi->targets.begin(), phi->targets.end(), header);
+                int value;
+                if (valueOf(phi->operands[it - phi->targets.begin()], value)) next[phi] = value;
+            }
+            for (IRInst* phi : header->insts) {
+                if (phi->op != IROp::Phi) break;
+                auto it = next.find(phi);
+                if (it != next.end()) {
+                    values[phi] = it->second;
+                } else {
+                    values.erase(phi);
+                }
+            }
+        }
+        return 0;
+    }
+
+    // 循环外对循环中值的使用记到replacements里，由调用者统一替换
+    bool unroll(IRFunction& func, IRLoop& loop, std::unordered_map<IRInst*, IRInst*>& replacements) {
+        IRBlock* header = loop.header;
+        IRInst* term = header->terminator();
+        if (term->op != IROp::Branch) return false;
+        std::vector<IRBlock*> outside = outsidePreds(loop);
+        if (outside.size() != 1) return false;
+        IRBlock* exit = term->targets[0] == header ? term->targets[1] : term->targets[0];
+
+        std::vector<IRInst*> phis, body;
+        for (IRInst* inst : header->insts) {
+            if (inst->op == IROp::Phi) {
+                phis.push_back(inst);
+            } else if (inst != term) {
+                body.push_back(inst);
+            }
+        }
+        int trips = tripCount(loop, outside[0]);
+        if (trips == 0 || static_cast<size_t>(trips) * body.size() > static_cast<size_t>(options.maxUnrolledSize)) {
+            return false;
+        }
+
+        // 每次迭代复制一遍循环体；current为原指令在本次迭代中对应的值
+        std::unordered_map<IRInst*, IRInst*> current;
+        for (IRInst* phi : phis) {
+            auto it = std::find(phi->targets.begin(), phi->targets.end(), outside[0]);
+            current[phi] = phi->operands[it - phi->targets.begin()];
+        }
+        auto map = [&](IRInst* value) {
+            auto it = current.find(value);
+            return it != current.end() ? it->second : value;
+        };
+        std::vector<IRInst*> unrolled;
+        for (int trip = 0; trip < trips; ++trip) {
+            if (trip > 0) {
+                std::unordered_map<IRInst*, IRInst*> next;
+                for (IRInst* phi : phis) {
+                    auto it = std::find(phi->targets.begin(), phi->targets.end(), header);
+                    next[phi] = map(phi->operands[it - phi->targets.begin()]);
+                }
+                for (auto& [phi, value] : next) current[phi] = value;
+            }
+            for (IRInst* inst : body) {
+                IRInst* copy = func.createInst(inst->op);
+                copy->block = header;
+                copy->imm = inst->imm;
+                copy->callee = inst->callee;
+                copy->hasValue = inst->hasValue;
+                for (IRInst* operand : inst->operands) copy->operands.push_back(map(operand));
+                unrolled.push_back(copy);
+                current[inst] = copy;
+            }
+        }
+
+        // 最后一次迭代之后离开循环，循环外对循环中值的使用取最后一次迭代的值
+        term->op = IROp::Jump;
+        term->operands.clear();
+        term->targets = {exit};
+        unrolled.push_back(term);
+        header->insts = std::move(unrolled);
+        for (IRInst* phi : phis) replacements[phi] = current[phi];
+        for (IRInst* inst : body) replacements[inst] = current[inst];
+        return true;
+    }
+};
+
+} // namespace
+
+std::unique_ptr<IRPass> createLICMPass(const LoopOptions& options) {
+    return std::make_unique<LICM>(options);
+}
+
+std::unique_ptr<IRPass> createStrengthReductionPass(const LoopOptions& options) {
+    return std::make_unique<StrengthReduction>(options);
+}
+
+std::unique_ptr<IRPass> createLoopUnrollPass(const LoopOptions& options) {
+    return std::make_unique<LoopUnroll>(options);
+}
+
+void addLoopPasses(PassManager& manager, const LoopOptions& options) {
+    if (options.licm) manager.add(createLICMPass(options));
+    if (options.unroll) manager.add(createLoopUnrollPass(options));
+    if (options.strengthReduce) manager.add(createStrengthReductionPass(options));
+}
@@ -1,79 +1,295 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <string>
 #include <filesystem>
-#include "lexer.h"
-#include "parser.h"
-#include "codegen.h"
-#include "semantic.h"
+#include "driver.h"
+#include "fncache.h"
+#include "peephole.h"
+#include "pipeline.h"
+#include "stats.h"
+#include "threadpool.h"
+#include <cctype>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <vector>
 
-std::string readFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("无法打开文件: " + filename);
+void printUsage(const char* programName) {
+    std::cout << "用法: " << programName << " [选项] <输入文件>... [@响应文件]" << std::endl;
+    std::cout << "选项:" << std::endl;
+    std::cout << "  -O0         直接从AST生成代码，不做优化" << std::endl;
+    std::cout << "  -O1         经SSA中间表示优化后生成代码（默认）" << std::endl;
+    std::cout << "  --dump-ir   把优化后的IR写到同名.ir文件（仅-O1）" << std::endl;
+    std::cout << "  --dump-cfg  把各函数的控制流图（含支配者、死存储）以Graphviz格式写到同名.dot文件" << std::endl;
+    std::cout << "  --verify-ir 每个优化pass之后检查IR结构" << std::endl;
+    std::cout << "  --no-inline 不做函数内联" << std::endl;
+    std::cout << "  --no-licm   不做循环不变量外提" << std::endl;
+    std::cout << "  --no-strength-reduce  不把循环中归纳变量的乘法改成加法" << std::endl;
+    std::cout << "  --no-unroll 不完全展开迭代次数已知的小循环" << std::endl;
+    std::cout << "  --no-const-muldiv  乘、除以常量和对常量取余照常用mul/div/rem，不改成移位和乘高位序列" << std::endl;
+    std::cout << "  --no-peephole    不做窥孔优化" << std::endl;
+    std::cout << "  --peephole-stats 输出各条窥孔规则的命中次数和删掉的指令数" << std::endl;
+    std::cout << "  --no-schedule    不做基本块内的指令调度" << std::endl;
+    std::cout << "  --core <名字>    指令调度按该核的延迟表（默认generic）:" << std::endl;
+    for (const CoreModel& core : coreModels()) {
+        std::cout << "                     " << std::left << std::setw(10) << core.name << core.description << std::endl;
     }
-    
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
-}
-
-std::string getOutputFilename(const std::string& inputFile) {
-    std::filesystem::path path(inputFile);
-    std::string stem = path.stem().string();
-    return stem + ".s";
+    std::cout << "  -c, --emit-obj   直接输出ELF可重定位目标文件(.o)，不经过汇编器" << std::endl;
+    std::cout << "  --verify-obj     输出目标文件时把每条指令反汇编回来核对编码" << std::endl;
+    std::cout << "  --no-comments    汇编文件中不输出注释" << std::endl;
+    std::cout << "  --fused-frontend 解析的同时做语义检查，不再单独遍历AST（报错相同）" << std::endl;
+    std::cout << "  --cache-dir <目录>  函数粒度的增量编译缓存：没有改动的函数直接取缓存的代码" << std::endl;
+    std::cout << "  --cache-size <MB>   缓存大小上限，超出时淘汰最久未用的函数（默认64）" << std::endl;
+    std::cout << "  --cache-stats       输出缓存的命中、写入和淘汰统计" << std::endl;
+    std::cout << "  -ftime-report    输出各阶段的墙钟时间、CPU时间和峰值内存" << std::endl;
+    std::cout << "  -fstats          输出词法单元、AST节点、指令、写出字节等计数" << std::endl;
+    std::cout << "  -fstats-format=<text|json>  上面两项的输出格式（默认text）" << std::endl;
+    std::cout << "  -fstats-output=<文件>       上面两项写到文件而不是标准输出" << std::endl;
+    std::cout << "  -j <N>           编译线程数（默认为硬件线程数，输出与线程数无关）" << std::endl;
+    std::cout << "  -o <目录>        输出文件放到该目录" << std::endl;
+    std::cout << "  @<文件>          从响应文件读入参数（以空白分隔，可用双引号）" << std::endl;
+    std::cout << "示例: " << programName << " test/example.toyc" << std::endl;
+    std::cout << "输出: 生成对应的RISC-V汇编文件 (.s后缀)，-c时生成目标文件 (.o后缀)；" << std::endl;
+    std::cout << "      一个输入文件时输出到当前目录，多个时输出到各自输入文件旁边" << std::endl;
 }
 
-void printUsage(const char* programName) {
-    std::cout << "用法: " << programName << " <输入文件>" << std::endl;
-    std::cout << "示例: " << programName << " test/example.toyc" << std::endl;
-    std::cout << "输出: 生成对应的RISC-V汇编文件 (.s后缀)" << std::endl;
+// 展开@响应文件：内容按空白分隔成参数，双引号内的空白不分隔；响应文件里还可以引用响应文件
+void expandArgument(const std::string& arg, std::vector<std::string>& args, int depth = 0) {
+    if (arg.size() < 2 || arg[0] != '@') {
+        args.push_back(arg);
+        return;
+    }
+    std::string path = arg.substr(1);
+    if (depth >= 16) throw std::runtime_error("响应文件嵌套过深: " + path);
+    std::ifstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("无法打开响应文件: " + path);
+    std::string current;
+    bool inQuotes = false, pending = false;
+    for (char c; file.get(c);) {
+        if (c == '"') {
+            inQuotes = !inQuotes;
+            pending = true;
+        } else if (!inQuotes && std::isspace(static_cast<unsigned char>(c))) {
+            if (pending) expandArgument(current, args, depth + 1);
+            current.clear();
+            pending = false;
+        } else {
+            current += c;
+            pending = true;
+        }
+    }
+    if (pending) expandArgument(current, args, depth + 1);
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        printUsage(argv[0]);
+    std::vector<std::string> args;
+    try {
+        for (int i = 1; i < argc; ++i) expandArgument(argv[i], args);
+    } catch (const std::exception& e) {
+        std::cerr << "错误: " << e.what() << std::endl;
         return 1;
     }
-    
-    std::string inputFile = argv[1];
-    std::string outputFile = getOutputFilename(inputFile);
-    
-    try {
-        // 读取源文件
-        std::string source = readFile(inputFile);
-        std::cout << "正在编译文件: " << inputFile << std::endl;
-        
-        // 词法分析
-        Lexer lexer(source);
-        std::cout << "词法分析完成" << std::endl;
-        
-        // 语法分析
-        Parser parser(source);
-        auto ast = parser.parse();
-        if (!ast) {
-            std::cerr << "语法分析失败" << std::endl;
+
+    std::vector<std::string> inputFiles;
+    CompileOptions options;
+    bool peepholeStats = false;
+    unsigned jobs = 0;
+    std::string outputDir;
+    std::string cacheDir;
+    uint64_t cacheMegabytes = 64;
+    bool cacheStats = false;
+    bool timeReport = false, compileStats = false, statsJSON = false;
+    std::string statsOutput;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        if (arg == "-O0") {
+            options.optLevel = 0;
+        } else if (arg == "-O1") {
+            options.optLevel = 1;
+        } else if (arg == "--dump-ir") {
+            options.dumpIR = true;
+        } else if (arg == "--dump-cfg") {
+            options.dumpCFG = true;
+        } else if (arg == "--verify-ir") {
+            options.verifyIR = true;
+        } else if (arg == "--no-inline") {
+            options.inlineCalls = false;
+        } else if (arg == "--no-licm") {
+            options.licm = false;
+        } else if (arg == "--no-strength-reduce") {
+            options.strengthReduce = false;
+        } else if (arg == "--no-unroll") {
+            options.unrollLoops = false;
+        } else if (arg == "--no-const-muldiv") {
+            options.constantMulDiv = false;
+        } else if (arg == "--no-peephole") {
+            options.peephole = false;
+        } else if (arg == "--peephole-stats") {
+            peepholeStats = true;
+        } else if (arg == "--no-schedule") {
+            options.schedule = false;
+        } else if (arg == "--core" && i + 1 < args.size()) {
+            options.core = args[++i];
+            try {
+                findCoreModel(options.core);
+            } catch (const std::exception& e) {
+                std::cerr << "错误: " << e.what() << std::endl;
+                return 1;
+            }
+        } else if (arg == "-c" || arg == "--emit-obj") {
+            options.emitObject = true;
+        } else if (arg == "--verify-obj") {
+            options.verifyObject = true;
+        } else if (arg == "--no-comments") {
+            options.comments = false;
+        } else if (arg == "--fused-frontend") {
+            options.fusedFrontend = true;
+        } else if (arg == "--cache-dir" && i + 1 < args.size()) {
+            cacheDir = args[++i];
+        } else if (arg == "--cache-size" && i + 1 < args.size()) {
+            const std::string& size = args[++i];
+            if (size.empty() || size.find_first_not_of("0123456789") != std::string::npos) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            cacheMegabytes = std::stoull(size);
+        } else if (arg == "--cache-stats") {
+            cacheStats = true;
+        } else if (arg == "-ftime-report") {
+            timeReport = true;
+        } else if (arg == "-fstats") {
+            compileStats = true;
+        } else if (arg == "-fstats-format=text" || arg == "-fstats-format=json") {
+            statsJSON = arg == "-fstats-format=json";
+        } else if (arg.compare(0, 15, "-fstats-output=") == 0 && arg.size() > 15) {
+            statsOutput = arg.substr(15);
+        } else if (arg.compare(0, 2, "-j") == 0) {
+            // -j N 或 -jN
+            std::string count = arg.size() > 2 ? arg.substr(2) : (i + 1 < args.size() ? args[++i] : "");
+            if (count.empty() || count.find_first_not_of("0123456789") != std::string::npos) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            jobs = static_cast<unsigned>(std::stoul(count));
+        } else if (arg == "-o" && i + 1 < args.size()) {
+            outputDir = args[++i];
+        } else if (!arg.empty() && arg[0] != '-') {
+            inputFiles.push_back(arg);
+        } else {
+            printUsage(argv[0]);
             return 1;
         }
-        std::cout << "语法分析完成" << std::endl;
-        
-        // 语义分析
-        SemanticAnalyzer semanticAnalyzer;
-        semanticAnalyzer.analyze(ast);
-        std::cout << "语义分析完成" << std::endl;
-        
-        // 代码生成
-        CodeGenerator codegen(outputFile);
-        codegen.generate(ast);
-        std::cout << "代码生成完成" << std::endl;
-        
-        std::cout << "编译成功！输出文件: " << outputFile << std::endl;
-        
-    } catch (const std::exception& e) {
-        std::cerr << "编译错误: " << e.what() << std::endl;
+    }
+    if (inputFiles.empty()) {
+        printUsage(argv[0]);
         return 1;
     }
-    
-    return 0;
-} 
\ No newline at end of file
+
+    // 多个输入时各自输出到输入文件旁边，不同输入不能写到同一个输出文件
+    bool batch = inputFiles.size() > 1;
+    std::vector<std::string> outputFiles;
+    std::map<std::string, std::string> outputOwners;
+    for (const std::string& input : inputFiles) {
+        outputFiles.push_back(outputPathFor(input, options, outputDir, batch));
+        auto [owner, inserted] = outputOwners.emplace(outputFiles.back(), input);
+        if (!inserted) {
+            std::cerr << "错误: " << owner->second << "和" << input << "的输出文件都是" << owner->first << std::endl;
+            return 1;
+        }
+    }
+    if (!outputDir.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(outputDir, error);
+        if (error) {
+            std::cerr << "错误: 无法创建输出目录" << outputDir << ": " << error.message() << std::endl;
+            return 1;
+        }
+    }
+
+    std::unique_ptr<FunctionCache> cache;
+    if (!cacheDir.empty()) {
+        try {
+            cache = std::make_unique<FunctionCache>(cacheDir, cacheMegabytes << 20);
+        } catch (const std::exception& e) {
+            std::cerr << "错误: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    // 全部编译完后再淘汰，本次用到的条目都是最新的
+    auto finishCache = [&] {
+        if (!cache) return;
+        cache->evict();
+        if (cacheStats) cache->printStats(std::cout);
+    };
+
+    // 编译统计：批量编译时各文件分别记录，最后按输入顺序合并
+    bool wantStats = timeReport || compileStats;
+    std::vector<CompileStats> fileStats(wantStats ? inputFiles.size() : 0);
+    auto statsFor = [&](size_t i) { return wantStats ? &fileStats[i] : nullptr; };
+    auto reportStats = [&] {
+        if (!wantStats) return true;
+        CompileStats totals;
+        totals.add("files", inputFiles.size());
+        for (const CompileStats& stats : fileStats) totals.merge(stats);
+        std::ofstream file;
+        if (!statsOutput.empty()) {
+            file.open(statsOutput);
+            if (!file) {
+                std::cerr << "错误: 无法创建统计输出文件: " << statsOutput << std::endl;
+                return false;
+            }
+        }
+        std::ostream& out = statsOutput.empty() ? std::cout : file;
+        if (statsJSON) {
+            totals.printJSON(out, timeReport, compileStats);
+        } else {
+            if (timeReport) totals.printTimeReport(out);
+            if (compileStats) totals.printCounters(out);
+        }
+        return true;
+    };
+
+    // 文件分给工作窃取线程池并行编译，每个文件内部再按函数并行
+    ThreadPool pool(jobs);
+    PeepholeOptimizer peepholeTotals;
+    if (!batch) {
+        try {
+            compileFile(inputFiles[0], outputFiles[0], options, std::cout, &peepholeTotals, &pool, cache.get(),
+                        statsFor(0));
+            finishCache();
+            if (options.peephole && peepholeStats) peepholeTotals.printStats(std::cout);
+            if (!reportStats()) return 1;
+            std::cout << "编译成功！输出文件: " << outputFiles[0] << std::endl;
+        } catch (const std::exception& e) {
+            finishCache();
+            std::cerr << "编译错误: " << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // 批量模式不输出各阶段的进度；某个文件出错不影响其他文件，最后按输入顺序报告
+    std::vector<std::string> errors(inputFiles.size());
+    std::vector<PeepholeOptimizer> peepholes(inputFiles.size());
+    pool.parallelFor(inputFiles.size(), [&](size_t i, unsigned) {
+        std::ostream quiet(nullptr);
+        try {
+            compileFile(inputFiles[i], outputFiles[i], options, quiet, &peepholes[i], &pool, cache.get(), statsFor(i));
+        } catch (const std::exception& e) {
+            errors[i] = e.what();
+        }
+    });
+    size_t failed = 0;
+    for (size_t i = 0; i < inputFiles.size(); ++i) {
+        peepholeTotals.merge(peepholes[i]);
+        if (errors[i].empty()) continue;
+        ++failed;
+        std::cerr << inputFiles[i] << ": 编译错误: " << errors[i] << std::endl;
+    }
+    finishCache();
+    if (options.peephole && peepholeStats) peepholeTotals.printStats(std::cout);
+    if (!reportStats()) return 1;
+    std::cout << "批量编译完成: " << inputFiles.size() - failed << "个文件成功, " << failed << "个失败" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+#include "muldiv.h"
+#include "encoder.h"
+
+namespace {
+
+// 绝对值按无符号算，INT_MIN对应2^31
+uint32_t magnitude(int32_t value) {
+    return value < 0 ? 0u - static_cast<uint32_t>(value) : static_cast<uint32_t>(value);
+}
+
+bool isPowerOfTwo(uint32_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+int log2Of(uint32_t value) {
+    int bits = 0;
+    while (value >>= 1) ++bits;
+    return bits;
+}
+
+// 移位加减序列的形状：|factor| = 2^high ± 2^low，negative表示结果还要取反（或者减法反过来做）
+struct ShiftPlan {
+    int length = 0; // 0表示没有不超过3条的序列
+    int high = 0, low = 0;
+    bool subtract = false;
+    bool negate = false;
+};
+
+ShiftPlan planMultiply(int32_t factor) {
+    ShiftPlan plan;
+    uint32_t u = magnitude(factor);
+    bool negative = factor < 0;
+    if (u == 0 || u == 1) {
+        plan.length = 1; // li dst, 0 / mv / neg
+        return plan;
+    }
+    if (isPowerOfTwo(u)) {
+        plan.high = log2Of(u);
+        plan.negate = negative;
+        plan.length = negative ? 2 : 1;
+        return plan;
+    }
+    // u = 2^high + 2^low：低位的1单独拿出来
+    uint32_t lowBit = u & (0u - u);
+    if (isPowerOfTwo(u - lowBit)) {
+        plan.high = log2Of(u - lowBit);
+        plan.low = log2Of(lowBit);
+        plan.negate = negative;
+        plan.length = (plan.low == 0 ? 2 : 3) + (negative ? 1 : 0);
+        return plan;
+    }
+    // u = 2^high - 2^low：加上最低位的1后只剩一位（u不会超过2^31，high不超过31）
+    uint64_t sum = static_cast<uint64_t>(u) + lowBit;
+    if (sum < (1ull << 32) && isPowerOfTwo(static_cast<uint32_t>(sum))) {
+        plan.high = log2Of(static_cast<uint32_t>(sum));
+        plan.low = log2Of(lowBit);
+        plan.subtract = true;
+        plan.negate = negative; // 取反时减法反过来做，不多一条指令
+        plan.length = plan.low == 0 ? 2 : 3;
+        return plan;
+    }
+    return plan;
+}
+
+int loadImmLength(int32_t value) {
+    return encodedSize(AsmInst::loadImm(Register::ZERO, value), false) / 4;
+}
+
+// 商的符号修正前的部分：scratch = mulh(src, M) ± src，再算术右移
+void emitMagicQuotient(std::vector<AsmInst>& out, Register dst, Register src, int32_t divisor, Register scratch) {
+    DivisionMagic magic = divisionMagic(divisor);
+    out.push_back(AsmInst::loadImm(scratch, magic.multiplier));
+    out.push_back(AsmInst::binary(AsmOp::Mulh, scratch, src, scratch));
+    if (divisor > 0 && magic.multiplier < 0) out.push_back(AsmInst::binary(AsmOp::Add, scratch, scratch, src));
+    if (divisor < 0 && magic.multiplier > 0) out.push_back(AsmInst::binary(AsmOp::Sub, scratch, scratch, src));
+    if (magic.shift > 0) out.push_back(AsmInst::immediate(AsmOp::Srai, scratch, scratch, magic.shift));
+    // 结果为负时加1，向零取整。src此后不再使用，dst与src相同也没关系
+    out.push_back(AsmInst::immediate(AsmOp::Srli, dst, scratch, 31));
+    out.push_back(AsmInst::binary(AsmOp::Add, dst, scratch, dst));
+}
+
+// 除以2^k向零取整前的偏置：被除数为负时加上2^k-1
+void emitBias(std::vector<AsmInst>& out, Register src, int k, Register scratch) {
+    if (k == 1) {
+        out.push_back(AsmInst::immediate(AsmOp::Srli, scratch, src, 31));
+    } else {
+        out.push_back(AsmInst::immediate(AsmOp::Srai, scratch, src, 31));
+        out.push_back(AsmInst::immediate(AsmOp::Srli, scratch, scratch, 32 - k));
+    }
+    out.push_back(AsmInst::binary(AsmOp::Add, scratch, scratch, src));
+}
+
+} // namespace
+
+DivisionMagic divisionMagic(int32_t divisor) {
+    // Hacker's Delight 10-1：找最小的p使2^p / anc足够精确，乘数为ceil(2^p / |d|)
+    const uint32_t two31 = 0x80000000u;
+    uint32_t ad = magnitude(divisor);
+    uint32_t t = two31 + (static_cast<uint32_t>(divisor) >> 31);
+    uint32_t anc = t - 1 - t % ad;
+    int p = 31;
+    uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / ad, r2 = two31 - q2 * ad;
+    uint32_t delta;
+    do {
+        ++p;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc) {
+            ++q1;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad) {
+            ++q2;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    uint32_t multiplier = q2 + 1;
+    if (divisor < 0) multiplier = 0u - multiplier;
+    return DivisionMagic{static_cast<int32_t>(multiplier), p - 32};
+}
+
+int shiftMultiplyLength(int32_t factor) {
+    ShiftPlan plan = planMultiply(factor);
+    // 与li加mul一样长时也用移位：单周期指令，不用等乘法器
+    if (plan.length == 0 || plan.length > loadImmLength(factor) + 1) return 0;
+    return plan.length;
+}
+
+int multiplyCost(int32_t factor) {
+    int length = shiftMultiplyLength(factor);
+    return length ? length : loadImmLength(factor) + 1;
+}
+
+bool lowerMultiply(std::vector<AsmInst>& out, Register dst, Register src, int32_t factor, Register scratch) {
+    if (!shiftMultiplyLength(factor)) return false;
+    ShiftPlan plan = planMultiply(factor);
+    uint32_t u = magnitude(factor);
+    if (u == 0) {
+        out.push_back(AsmInst::loadImm(dst, 0));
+    } else if (u == 1) {
+        out.push_back(AsmInst::unary(factor < 0 ? AsmOp::Neg : AsmOp::Mv, dst, src));
+    } else if (isPowerOfTwo(u)) {
+        out.push_back(AsmInst::immediate(AsmOp::Slli, dst, src, plan.high));
+        if (plan.negate) out.push_back(AsmInst::unary(AsmOp::Neg, dst, dst));
+    } else {
+        // scratch = src << high，dst = src << low（low为0时直接用src），再相加或相减
+        out.push_back(AsmInst::immediate(AsmOp::Slli, scratch, src, plan.high));
+        Register low = src;
+        if (plan.low > 0) {
+            out.push_back(AsmInst::immediate(AsmOp::Slli, dst, src, plan.low));
+            low = dst;
+        }
+        if (!plan.subtract) {
+            out.push_back(AsmInst::binary(AsmOp::Add, dst, scratch, low));
+            if (plan.negate) out.push_back(AsmInst::unary(AsmOp::Neg, dst, dst));
+        } else if (plan.negate) {
+            out.push_back(AsmInst::binary(AsmOp::Sub, dst, low, scratch));
+        } else {
+            out.push_back(AsmInst::binary(AsmOp::Sub, dst, scratch, low));
+        }
+    }
+    return true;
+}
+
+bool lowerDivide(std::vector<AsmInst>& out, AsmOp op, Register dst, Register src, int32_t divisor,
+                 Register scratch, Register spare) {
+    if (divisor == 0) return false;
+    uint32_t u = magnitude(divisor);
+    if (op == AsmOp::Div) {
+        if (u == 1) {
+            out.push_back(AsmInst::unary(divisor < 0 ? AsmOp::Neg : AsmOp::Mv, dst, src));
+        } else if (isPowerOfTwo(u)) {
+            int k = log2Of(u);
+            emitBias(out, src, k, scratch);
+            out.push_back(AsmInst::immediate(AsmOp::Srai, dst, scratch, k));
+            if (divisor < 0) out.push_back(AsmInst::unary(AsmOp::Neg, dst, dst));
+        } else {
+            emitMagicQuotient(out, dst, src, divisor, scratch);
+        }
+        return true;
+    }
+
+    // 余数 = src - 商 * divisor，符号与被除数相同，与除数的符号无关
+    if (u == 1) {
+        out.push_back(AsmInst::loadImm(dst, 0));
+    } else if (isPowerOfTwo(u)) {
+        // 商 * 2^k 就是加过偏置的被除数清掉低k位
+        int k = log2Of(u);
+        emitBias(out, src, k, scratch);
+        if (k <= 11) {
+            out.push_back(AsmInst::immediate(AsmOp::Andi, scratch, scratch, -static_cast<int32_t>(u)));
+        } else {
+            out.push_back(AsmInst::immediate(AsmOp::Srai, scratch, scratch, k));
+            out.push_back(AsmInst::immediate(AsmOp::Slli, scratch, scratch, k));
+        }
+        out.push_back(AsmInst::binary(AsmOp::Sub, dst, src, scratch));
+    } else {
+        Register quotient = dst != src ? dst : spare;
+        emitMagicQuotient(out, quotient, src, divisor, scratch);
+        if (!lowerMultiply(out, quotient, quotient, divisor, scratch)) {
+            out.push_back(AsmInst::loadImm(scratch, divisor));
+            out.push_back(AsmInst::binary(AsmOp::Mul, quotient, quotient, scratch));
+        }
+        out.push_back(AsmInst::binary(AsmOp::Sub, dst, src, quotient));
+    }
+    return true;
+}
@@ -0,0 +1,338 @@
+#include "parser.h"
+#include "cfg.h"
+#include "semantic.h"
+#include <stdexcept>
+
+Parser::Parser(std::string_view source, ASTContext& context, FrontendChecker* checker)
+    : lexer(source, &context.names), currentToken(), context(context), checker(checker) {
+    advance();
+}
+
+ASTNodePtr Parser::parse() {
+    return parseProgram();
+}
+
+void Parser::advance() {
+    currentToken = lexer.nextToken();
+    if (currentToken.type == TokenType::ERROR) {
+        throw std::runtime_error("词法错误 (行 " + std::to_string(currentToken.line) + ", 列 " +
+                                 std::to_string(currentToken.column) + "): 非法字符 '" +
+                                 std::string(currentToken.text) + "'");
+    }
+}
+
+bool Parser::match(TokenType type) {
+    if (!check(type)) return false;
+    advance();
+    return true;
+}
+
+bool Parser::check(TokenType type) {
+    return currentToken.type == type;
+}
+
+void Parser::expect(TokenType type, const std::string& message) {
+    if (!check(type)) {
+        throw std::runtime_error("语法错误 (行 " + std::to_string(currentToken.line) + ", 列 " +
+                                 std::to_string(currentToken.column) + "): " + message);
+    }
+    advance();
+}
+
+TypeKind Parser::parseType() {
+    if (match(TokenType::INT)) return TypeKind::Int;
+    expect(TokenType::VOID, "期望类型int或void");
+    return TypeKind::Void;
+}
+
+SymbolId Parser::parseIdentifier(const std::string& message) {
+    SymbolId name = currentToken.symbol;
+    expect(TokenType::IDENTIFIER, message);
+    return name;
+}
+
+ASTNodePtr Parser::parseProgram() {
+    std::vector<ASTNodePtr> functions;
+    while (!check(TokenType::END_OF_FILE)) {
+        functions.push_back(parseFunctionDef());
+    }
+    if (checker) checker->finish();
+    return context.create<Program>(context.list(functions));
+}
+
+ASTNodePtr Parser::parseFunctionDef() {
+    TypeKind retType = parseType();
+    SymbolId name = parseIdentifier("期望函数名");
+    expect(TokenType::LPAREN, "函数名后期望'('");
+    std::vector<Param> params = parseParams();
+    expect(TokenType::RPAREN, "形参列表后期望')'");
+    if (checker) checker->beginFunction(retType, name, params);
+    reachable = true;
+    ASTNodePtr body = parseBlock();
+    auto func = context.create<FunctionDef>(retType, name, context.list(params), body);
+    if (checker) func->varCount = checker->endFunction(reachable);
+    return func;
+}
+
+std::vector<Param> Parser::parseParams() {
+    std::vector<Param> params;
+    if (check(TokenType::RPAREN)) return params;
+    do {
+        expect(TokenType::INT, "形参类型必须为int");
+        params.push_back(Param{TypeKind::Int, parseIdentifier("期望形参名")});
+    } while (match(TokenType::COMMA));
+    return params;
+}
+
+ASTNodePtr Parser::parseBlock() {
+    expect(TokenType::LBRACE, "期望'{'");
+    if (checker) checker->enterScope();
+    std::vector<ASTNodePtr> stmts;
+    while (!check(TokenType::RBRACE) && !check(TokenType::END_OF_FILE)) {
+        stmts.push_back(parseStatement());
+    }
+    expect(TokenType::RBRACE, "期望'}'");
+    if (checker) checker->leaveScope();
+    return context.create<Block>(context.list(stmts));
+}
+
+ASTNodePtr Parser::parseStatement() {
+    switch (currentToken.type) {
+        case TokenType::LBRACE: return parseBlock();
+        case TokenType::INT: return parseVarDecl();
+        case TokenType::IF: return parseIfStmt();
+        case TokenType::WHILE: return parseWhileStmt();
+        case TokenType::RETURN: return parseReturnStmt();
+        case TokenType::BREAK: return parseBreakStmt();
+        case TokenType::CONTINUE: return parseContinueStmt();
+        case TokenType::SEMICOLON:
+            advance();
+            return context.create<ExprStmt>(nullptr);
+        case TokenType::IDENTIFIER:
+            if (lexer.peekToken().type == TokenType::ASSIGN) return parseAssignment();
+            return parseExprStmt();
+        default:
+            return parseExprStmt();
+    }
+}
+
+ASTNodePtr Parser::parseVarDecl() {
+    expect(TokenType::INT, "变量类型必须为int");
+    SymbolId name = parseIdentifier("期望变量名");
+    if (checker) checker->checkRedeclaration(name);
+    ASTNodePtr init = nullptr;
+    if (match(TokenType::ASSIGN)) init = parseExpression();
+    expect(TokenType::SEMICOLON, "变量声明后期望';'");
+    auto decl = context.create<VarDecl>(TypeKind::Int, name, init);
+    // 初值中的同名变量指外层的变量，解析完初值再声明
+    if (checker) decl->var = checker->declareVar(name);
+    return decl;
+}
+
+ASTNodePtr Parser::parseAssignment() {
+    SymbolId name = parseIdentifier("期望变量名");
+    uint32_t var = checker ? checker->resolveVar(name) : NoVar;
+    expect(TokenType::ASSIGN, "期望'='");
+    ASTNodePtr expr = parseExpression();
+    expect(TokenType::SEMICOLON, "赋值语句后期望';'");
+    auto assign = context.create<Assign>(name, expr);
+    assign->var = var;
+    return assign;
+}
+
+ASTNodePtr Parser::parseIfStmt() {
+    expect(TokenType::IF, "期望if");
+    expect(TokenType::LPAREN, "if后期望'('");
+    ASTNodePtr cond = parseExpression();
+    expect(TokenType::RPAREN, "条件后期望')'");
+    int value = 0;
+    bool constant = constantCondition(cond, value);
+    bool before = reachable;
+    reachable = before && (!constant || value);
+    ASTNodePtr thenStmt = parseStatement();
+    bool thenCompletes = reachable;
+    reachable = before && (!constant || !value);
+    ASTNodePtr elseStmt = nullptr;
+    if (match(TokenType::ELSE)) elseStmt = parseStatement();
+    reachable = thenCompletes || reachable;
+    return context.create<IfStmt>(cond, thenStmt, elseStmt);
+}
+
+ASTNodePtr Parser::parseWhileStmt() {
+    expect(TokenType::WHILE, "期望while");
+    expect(TokenType::LPAREN, "while后期望'('");
+    ASTNodePtr cond = parseExpression();
+    expect(TokenType::RPAREN, "条件后期望')'");
+    int value = 0;
+    bool constant = constantCondition(cond, value);
+    bool before = reachable;
+    reachable = before && (!constant || value);
+    loopBreaks.push_back(false);
+    if (checker) checker->enterLoop();
+    ASTNodePtr body = parseStatement();
+    if (checker) checker->leaveLoop();
+    // 条件为假或者break时离开循环
+    reachable = (before && (!constant || !value)) || loopBreaks.back();
+    loopBreaks.pop_back();
+    return context.create<WhileStmt>(cond, body);
+}
+
+ASTNodePtr Parser::parseReturnStmt() {
+    expect(TokenType::RETURN, "期望return");
+    ASTNodePtr expr = nullptr;
+    if (checker) checker->checkReturn(!check(TokenType::SEMICOLON));
+    if (!check(TokenType::SEMICOLON)) expr = parseExpression();
+    expect(TokenType::SEMICOLON, "return语句后期望';'");
+    reachable = false;
+    return context.create<ReturnStmt>(expr);
+}
+
+ASTNodePtr Parser::parseBreakStmt() {
+    expect(TokenType::BREAK, "期望break");
+    expect(TokenType::SEMICOLON, "break后期望';'");
+    if (checker) checker->checkBreak();
+    if (reachable && !loopBreaks.empty()) loopBreaks.back() = true;
+    reachable = false;
+    return context.create<BreakStmt>();
+}
+
+ASTNodePtr Parser::parseContinueStmt() {
+    expect(TokenType::CONTINUE, "期望continue");
+    expect(TokenType::SEMICOLON, "continue后期望';'");
+    if (checker) checker->checkBreak();
+    reachable = false;
+    return context.create<ContinueStmt>();
+}
+
+ASTNodePtr Parser::parseExprStmt() {
+    ASTNodePtr expr = parseExpression();
+    expect(TokenType::SEMICOLON, "表达式后期望';'");
+    // 只有整条表达式语句本身是调用时才允许调用void函数
+    if (checker && expr == lastCall) checker->allowVoidCall(lastCallPending);
+    return context.create<ExprStmt>(expr);
+}
+
+ASTNodePtr Parser::parseExpression() {
+    return parseLogicalOr();
+}
+
+ASTNodePtr Parser::parseLogicalOr() {
+    ASTNodePtr lhs = parseLogicalAnd();
+    while (match(TokenType::OR)) {
+        lhs = context.create<BinaryExpr>(BinOp::Or, lhs, parseLogicalAnd());
+    }
+    return lhs;
+}
+
+ASTNodePtr Parser::parseLogicalAnd() {
+    ASTNodePtr lhs = parseEquality();
+    while (match(TokenType::AND)) {
+        lhs = context.create<BinaryExpr>(BinOp::And, lhs, parseEquality());
+    }
+    return lhs;
+}
+
+ASTNodePtr Parser::parseEquality() {
+    ASTNodePtr lhs = parseComparison();
+    while (true) {
+        BinOp op;
+        if (match(TokenType::EQUAL)) op = BinOp::Eq;
+        else if (match(TokenType::NOT_EQUAL)) op = BinOp::Ne;
+        else break;
+        lhs = context.create<BinaryExpr>(op, lhs, parseComparison());
+    }
+    return lhs;
+}
+
+ASTNodePtr Parser::parseComparison() {
+    ASTNodePtr lhs = parseAdditive();
+    while (true) {
+        BinOp op;
+        if (match(TokenType::LESS)) op = BinOp::Lt;
+        else if (match(TokenType::LESS_EQUAL)) op = BinOp::Le;
+        else if (match(TokenType::GREATER)) op = BinOp::Gt;
+        else if (match(TokenType::GREATER_EQUAL)) op = BinOp::Ge;
+        else break;
+        lhs = context.create<BinaryExpr>(op, lhs, parseAdditive());
+    }
+    return lhs;
+}
+
+ASTNodePtr Parser::parseAdditive() {
+    ASTNodePtr lhs = parseMultiplicative();
+    while (true) {
+        BinOp op;
+        if (match(TokenType::PLUS)) op = BinOp::Add;
+        else if (match(TokenType::MINUS)) op = BinOp::Sub;
+        else break;
+        lhs = context.create<BinaryExpr>(op, lhs, parseMultiplicative());
+    }
+    return lhs;
+}
+
+ASTNodePtr Parser::parseMultiplicative() {
+    ASTNodePtr lhs = parseUnary();
+    while (true) {
+        BinOp op;
+        if (match(TokenType::MULTIPLY)) op = BinOp::Mul;
+        else if (match(TokenType::DIVIDE)) op = BinOp::Div;
+        else if (match(TokenType::MODULO)) op = BinOp::Mod;
+        else break;
+        auto bin = context.create<BinaryExpr>(op, lhs, parseUnary());
+        if (checker) checker->checkDivisor(bin);
+        lhs = bin;
+    }
+    return lhs;
+}
+
+ASTNodePtr Parser::parseUnary() {
+    if (match(TokenType::PLUS)) return context.create<UnaryExpr>(UnOp::Plus, parseUnary());
+    if (match(TokenType::MINUS)) return context.create<UnaryExpr>(UnOp::Neg, parseUnary());
+    if (match(TokenType::NOT)) return context.create<UnaryExpr>(UnOp::Not, parseUnary());
+    return parsePrimary();
+}
+
+ASTNodePtr Parser::parsePrimary() {
+    if (check(TokenType::INT_LITERAL)) {
+        // 按32位补码截断，-2147483648写作-(2147483648)
+        uint64_t value = 0;
+        for (char c : currentToken.text) value = value * 10 + (c - '0');
+        advance();
+        return context.create<IntLiteral>(static_cast<int>(static_cast<uint32_t>(value)));
+    }
+    if (check(TokenType::IDENTIFIER)) {
+        if (lexer.peekToken().type == TokenType::LPAREN) return parseFuncCall();
+        auto ref = context.create<VarRef>(parseIdentifier("期望标识符"));
+        if (checker) ref->var = checker->resolveVar(ref->name);
+        return ref;
+    }
+    if (match(TokenType::LPAREN)) {
+        ASTNodePtr expr = parseExpression();
+        expect(TokenType::RPAREN, "期望')'");
+        return expr;
+    }
+    throw std::runtime_error("语法错误 (行 " + std::to_string(currentToken.line) + ", 列 " +
+                             std::to_string(currentToken.column) + "): 期望表达式");
+}
+
+ASTNodePtr Parser::parseFuncCall() {
+    SymbolId name = parseIdentifier("期望函数名");
+    int pending = checker ? checker->checkCall(name) : -1;
+    expect(TokenType::LPAREN, "函数名后期望'('");
+    std::vector<ASTNodePtr> args = parseArgs();
+    expect(TokenType::RPAREN, "实参列表后期望')'");
+    if (checker) checker->checkArgumentCount(name, args.size());
+    auto call = context.create<FuncCall>(name, context.list(args));
+    lastCall = call;
+    lastCallPending = pending;
+    return call;
+}
+
+std::vector<ASTNodePtr> Parser::parseArgs() {
+    std::vector<ASTNodePtr> args;
+    if (check(TokenType::RPAREN)) return args;
+    do {
+        args.push_back(parseExpression());
+    } while (match(TokenType::COMMA));
+    return args;
+}
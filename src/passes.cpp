@@ -0,0 +1,505 @@
+#include "passes.h"
+#include "constfold.h"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+BinOp toBinOp(IROp op) {
+    switch (op) {
+        case IROp::Add: return BinOp::Add;
+        case IROp::Sub: return BinOp::Sub;
+        case IROp::Mul: return BinOp::Mul;
+        case IROp::Div: return BinOp::Div;
+        case IROp::Rem: return BinOp::Mod;
+        case IROp::Lt: return BinOp::Lt;
+        case IROp::Le: return BinOp::Le;
+        case IROp::Gt: return BinOp::Gt;
+        case IROp::Ge: return BinOp::Ge;
+        case IROp::Eq: return BinOp::Eq;
+        case IROp::Ne: return BinOp::Ne;
+        default: return BinOp::Add;
+    }
+}
+
+// 删除块中被替换掉的指令
+void eraseReplaced(IRFunction& func, const std::unordered_map<IRInst*, IRInst*>& replacements) {
+    if (replacements.empty()) return;
+    for (IRBlock* block : func.blocks) {
+        auto& insts = block->insts;
+        insts.erase(std::remove_if(insts.begin(), insts.end(),
+                                   [&](IRInst* inst) { return replacements.count(inst) != 0; }),
+                    insts.end());
+    }
+    func.replaceUses(replacements);
+}
+
+class SimplifyCFG : public IRPass {
+public:
+    const char* name() const override { return "simplify-cfg"; }
+
+    bool run(IRFunction& func) override {
+        bool changed = foldBranches(func);
+        changed |= removeUnreachable(func);
+        changed |= func.removeTrivialPhis();
+        changed |= mergeBlocks(func);
+        changed |= forwardEmptyBlocks(func);
+        return changed;
+    }
+
+private:
+    // 条件为常量、或两个目标相同的分支改为无条件跳转
+    static bool foldBranches(IRFunction& func) {
+        bool changed = false;
+        for (IRBlock* block : func.blocks) {
+            IRInst* term = block->terminator();
+            if (!term || term->op != IROp::Branch) continue;
+            IRBlock* taken;
+            if (term->targets[0] == term->targets[1]) {
+                taken = term->targets[0];
+                // 同一个前驱的两条边在φ里只保留一个入值
+                for (IRInst* phi : taken->insts) {
+                    if (phi->op != IROp::Phi) break;
+                    auto it = std::find(phi->targets.begin(), phi->targets.end(), block);
+                    phi->operands.erase(phi->operands.begin() + (it - phi->targets.begin()));
+                    phi->targets.erase(it);
+                }
+            } else if (term->operands[0]->op == IROp::Const) {
+                taken = term->targets[term->operands[0]->imm ? 0 : 1];
+                IRFunction::removePhiIncoming(term->targets[term->operands[0]->imm ? 1 : 0], block);
+            } else {
+                continue;
+            }
+            term->op = IROp::Jump;
+            term->operands.clear();
+            term->targets = {taken};
+            changed = true;
+        }
+        if (changed) func.recomputePreds();
+        return changed;
+    }
+
+    static bool removeUnreachable(IRFunction& func) {
+        std::vector<IRBlock*> rpo = reversePostOrder(func);
+        if (rpo.size() == func.blocks.size()) return false;
+        std::unordered_set<IRBlock*> reachable(rpo.begin(), rpo.end());
+        for (IRBlock* block : func.blocks) {
+            if (reachable.count(block)) continue;
+            for (IRBlock* succ : block->succs()) IRFunction::removePhiIncoming(succ, block);
+        }
+        // 保持原有布局顺序
+        func.blocks.erase(std::remove_if(func.blocks.begin(), func.blocks.end(),
+                                         [&](IRBlock* block) { return !reachable.count(block); }),
+                          func.blocks.end());
+        func.recomputePreds();
+        return true;
+    }
+
+    // 块B唯一的后继S只有B一个前驱时，把S并入B
+    static bool mergeBlocks(IRFunction& func) {
+        bool changed = false;
+        std::unordered_set<IRBlock*> removed;
+        for (IRBlock* block : func.blocks) {
+            if (removed.count(block)) continue;
+            while (true) {
+                IRInst* term = block->terminator();
+                if (term->op != IROp::Jump) break;
+                IRBlock* succ = term->targets[0];
+                if (succ == block || succ == func.entry() || succ->preds.size() != 1) break;
+
+                std::unordered_map<IRInst*, IRInst*> replacements;
+                block->insts.pop_back();
+                for (IRInst* inst : succ->insts) {
+                    if (inst->op == IROp::Phi) {
+                        replacements[inst] = inst->operands[0];
+                        continue;
+                    }
+                    inst->block = block;
+                    block->insts.push_back(inst);
+                }
+                for (IRBlock* next : block->succs()) {
+                    std::replace(next->preds.begin(), next->preds.end(), succ, block);
+                    for (IRInst* phi : next->insts) {
+                        if (phi->op != IROp::Phi) break;
+                        std::replace(phi->targets.begin(), phi->targets.end(), succ, block);
+                    }
+                }
+                func.replaceUses(replacements);
+                removed.insert(succ);
+                changed = true;
+            }
+        }
+        if (!changed) return false;
+        func.blocks.erase(std::remove_if(func.blocks.begin(), func.blocks.end(),
+                                         [&](IRBlock* block) { return removed.count(block) != 0; }),
+                          func.blocks.end());
+        return true;
+    }
+
+    // 只有一条跳转的空块：让前驱直接跳到它的目标
+    static bool forwardEmptyBlocks(IRFunction& func) {
+        bool changed = false;
+        std::unordered_set<IRBlock*> removed;
+        for (IRBlock* block : func.blocks) {
+            if (block == func.entry() || block->insts.size() != 1 || block->preds.empty()) continue;
+            IRInst* term = block->insts[0];
+            if (term->op != IROp::Jump) continue;
+            IRBlock* target = term->targets[0];
+            if (target == block) continue;
+
+            bool hasPhis = !target->insts.empty() && target->insts[0]->op == IROp::Phi;
+            if (hasPhis) {
+                // 前驱已经直接连到目标时，两条边在φ中的入值可能不同，不能合并
+                bool conflict = std::any_of(block->preds.begin(), block->preds.end(), [&](IRBlock* pred) {
+                    return std::find(target->preds.begin(), target->preds.end(), pred) != target->preds.end();
+                });
+                if (conflict) continue;
+                for (IRInst* phi : target->insts) {
+                    if (phi->op != IROp::Phi) break;
+                    auto it = std::find(phi->targets.begin(), phi->targets.end(), block);
+                    IRInst* value = phi->operands[it - phi->targets.begin()];
+                    phi->operands.erase(phi->operands.begin() + (it - phi->targets.begin()));
+                    phi->targets.erase(it);
+                    for (IRBlock* pred : block->preds) {
+                        phi->operands.push_back(value);
+                        phi->targets.push_back(pred);
+                    }
+                }
+            }
+            for (IRBlock* pred : block->preds) {
+                IRInst* predTerm = pred->terminator();
+                std::replace(predTerm->targets.begin(), predTerm->targets.end(), block, target);
+            }
+            target->preds.erase(std::find(target->preds.begin(), target->preds.end(), block));
+            target->preds.insert(target->preds.end(), block->preds.begin(), block->preds.end());
+            block->preds.clear();
+            removed.insert(block);
+            changed = true;
+        }
+        if (!changed) return false;
+        func.blocks.erase(std::remove_if(func.blocks.begin(), func.blocks.end(),
+                                         [&](IRBlock* block) { return removed.count(block) != 0; }),
+                          func.blocks.end());
+        func.recomputePreds();
+        // 转发后可能出现两个目标相同的分支
+        foldBranches(func);
+        return true;
+    }
+};
+
+class ConstantFold : public IRPass {
+public:
+    const char* name() const override { return "constant-fold"; }
+
+    bool run(IRFunction& func) override {
+        std::unordered_map<IRInst*, IRInst*> replacements;
+        auto resolve = [&](IRInst* value) {
+            for (auto it = replacements.find(value); it != replacements.end(); it = replacements.find(value)) {
+                value = it->second;
+            }
+            return value;
+        };
+        for (IRBlock* block : func.blocks) {
+            // 新建常量会插入入口块，遍历副本
+            std::vector<IRInst*> insts = block->insts;
+            for (IRInst* inst : insts) {
+                for (auto& operand : inst->operands) operand = resolve(operand);
+                if (!isBinary(inst->op)) continue;
+                if (IRInst* value = simplify(func, inst)) replacements[inst] = value;
+            }
+        }
+        eraseReplaced(func, replacements);
+        return !replacements.empty();
+    }
+
+private:
+    // 返回可以替换inst的值，不能化简时返回nullptr
+    static IRInst* simplify(IRFunction& func, IRInst* inst) {
+        IRInst* lhs = inst->operands[0];
+        IRInst* rhs = inst->operands[1];
+        bool lhsConst = lhs->op == IROp::Const;
+        bool rhsConst = rhs->op == IROp::Const;
+        int result;
+        if (lhsConst && rhsConst && evaluateIROp(inst->op, lhs->imm, rhs->imm, result)) {
+            return func.constant(result);
+        }
+        switch (inst->op) {
+            case IROp::Add:
+                if (rhsConst && rhs->imm == 0) return lhs;
+                if (lhsConst && lhs->imm == 0) return rhs;
+                break;
+            case IROp::Sub:
+                if (rhsConst && rhs->imm == 0) return lhs;
+                if (lhs == rhs) return func.constant(0);
+                break;
+            case IROp::Mul:
+                if (rhsConst && rhs->imm == 1) return lhs;
+                if (lhsConst && lhs->imm == 1) return rhs;
+                if ((rhsConst && rhs->imm == 0) || (lhsConst && lhs->imm == 0)) return func.constant(0);
+                break;
+            case IROp::Div:
+                if (rhsConst && rhs->imm == 1) return lhs;
+                break;
+            case IROp::Rem:
+                if (rhsConst && (rhs->imm == 1 || rhs->imm == -1)) return func.constant(0);
+                break;
+            case IROp::Eq: case IROp::Le: case IROp::Ge:
+                if (lhs == rhs) return func.constant(1);
+                break;
+            case IROp::Ne: case IROp::Lt: case IROp::Gt:
+                if (lhs == rhs) return func.constant(0);
+                break;
+            default:
+                break;
+        }
+        return nullptr;
+    }
+};
+
+class CSE : public IRPass {
+public:
+    const char* name() const override { return "cse"; }
+
+    bool run(IRFunction& func) override {
+        std::vector<IRBlock*> idom = computeDominators(func);
+        std::unordered_map<IRBlock*, std::vector<IRBlock*>> children;
+        for (IRBlock* block : func.blocks) {
+            IRBlock* parent = idom[block->id];
+            if (parent && parent != block) children[parent].push_back(block);
+        }
+
+        // 沿支配树深度优先遍历，表中只保留支配当前块的表达式
+        std::unordered_map<Key, IRInst*, KeyHash> available;
+        std::vector<Key> undo;
+        std::unordered_map<IRInst*, IRInst*> replacements;
+        std::vector<std::pair<IRBlock*, size_t>> stack; // (块, 进入时的undo长度)
+        std::vector<IRBlock*> worklist{func.entry()};
+        while (!worklist.empty()) {
+            IRBlock* block = worklist.back();
+            worklist.pop_back();
+            if (!block) {
+                // 离开子树：撤销它加入的表达式
+                for (size_t n = stack.back().second; undo.size() > n; undo.pop_back()) available.erase(undo.back());
+                stack.pop_back();
+                continue;
+            }
+            stack.emplace_back(block, undo.size());
+            for (IRInst* inst : block->insts) {
+                for (auto& operand : inst->operands) {
+                    auto it = replacements.find(operand);
+                    if (it != replacements.end()) operand = it->second;
+                }
+                if (!isBinary(inst->op)) continue;
+                Key key = makeKey(inst);
+                auto found = available.find(key);
+                if (found != available.end()) {
+                    replacements[inst] = found->second;
+                } else {
+                    available.emplace(key, inst);
+                    undo.push_back(key);
+                }
+            }
+            worklist.push_back(nullptr);
+            for (IRBlock* child : children[block]) worklist.push_back(child);
+        }
+        eraseReplaced(func, replacements);
+        return !replacements.empty();
+    }
+
+private:
+    struct Key {
+        IROp op;
+        int lhs, rhs;
+        bool operator==(const Key& other) const {
+            return op == other.op && lhs == other.lhs && rhs == other.rhs;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return (static_cast<size_t>(key.op) * 1000003u ^ static_cast<size_t>(key.lhs)) * 1000003u ^
+                   static_cast<size_t>(key.rhs);
+        }
+    };
+
+    static Key makeKey(const IRInst* inst) {
+        int lhs = inst->operands[0]->id;
+        int rhs = inst->operands[1]->id;
+        IROp op = inst->op;
+        // 可交换运算按操作数编号排序；a > b 与 b < a 等价
+        if ((op == IROp::Add || op == IROp::Mul || op == IROp::Eq || op == IROp::Ne) && lhs > rhs) std::swap(lhs, rhs);
+        if (op == IROp::Gt || op == IROp::Ge) {
+            op = op == IROp::Gt ? IROp::Lt : IROp::Le;
+            std::swap(lhs, rhs);
+        }
+        return Key{op, lhs, rhs};
+    }
+};
+
+class DCE : public IRPass {
+public:
+    const char* name() const override { return "dce"; }
+
+    bool run(IRFunction& func) override {
+        // 从有副作用的指令出发标记所有用到的值
+        std::unordered_set<IRInst*> live;
+        std::vector<IRInst*> worklist;
+        for (IRBlock* block : func.blocks) {
+            for (IRInst* inst : block->insts) {
+                if (inst->op == IROp::Call || isTerminator(inst->op)) {
+                    live.insert(inst);
+                    worklist.push_back(inst);
+                }
+            }
+        }
+        while (!worklist.empty()) {
+            IRInst* inst = worklist.back();
+            worklist.pop_back();
+            for (IRInst* operand : inst->operands) {
+                if (live.insert(operand).second) worklist.push_back(operand);
+            }
+        }
+        bool changed = false;
+        for (IRBlock* block : func.blocks) {
+            auto& insts = block->insts;
+            size_t before = insts.size();
+            insts.erase(std::remove_if(insts.begin(), insts.end(),
+                                       [&](IRInst* inst) { return !live.count(inst); }),
+                        insts.end());
+            changed |= insts.size() != before;
+        }
+        return changed;
+    }
+};
+
+class TailRecursion : public IRPass {
+public:
+    const char* name() const override { return "tail-recursion"; }
+
+    bool run(IRFunction& func) override {
+        std::vector<IRBlock*> sites;
+        for (IRBlock* block : func.blocks) {
+            if (isSelfTailCall(func, block)) sites.push_back(block);
+        }
+        if (sites.empty()) return false;
+
+        // 原入口块变成循环头：常量和形参移到新的入口块，形参经φ进入循环头
+        IRBlock* header = func.entry();
+        IRBlock* entry = func.createBlock();
+        auto& insts = header->insts;
+        auto body = std::stable_partition(insts.begin(), insts.end(), [](IRInst* inst) {
+            return inst->op == IROp::Const || inst->op == IROp::Param;
+        });
+        for (auto it = insts.begin(); it != body; ++it) {
+            (*it)->block = entry;
+            entry->insts.push_back(*it);
+        }
+        insts.erase(insts.begin(), body);
+        IRInst* jump = func.createInst(IROp::Jump);
+        jump->hasValue = false;
+        jump->block = entry;
+        jump->targets.push_back(header);
+        entry->insts.push_back(jump);
+        func.blocks.insert(func.blocks.begin(), entry);
+
+        std::unordered_map<IRInst*, IRInst*> replacements;
+        std::vector<IRInst*> phis(func.paramCount, nullptr);
+        for (IRInst* param : entry->insts) {
+            if (param->op != IROp::Param) continue;
+            IRInst* phi = func.createInst(IROp::Phi);
+            phi->block = header;
+            replacements[param] = phi;
+            phis[param->imm] = phi;
+        }
+        func.replaceUses(replacements);
+        for (auto& [param, phi] : replacements) {
+            phi->operands.push_back(param);
+            phi->targets.push_back(entry);
+        }
+        std::vector<IRInst*> headerPhis;
+        for (IRInst* phi : phis) {
+            if (phi) headerPhis.push_back(phi);
+        }
+        insts.insert(insts.begin(), headerPhis.begin(), headerPhis.end());
+
+        // call+ret换成带新实参跳回循环头；被DCE删掉的形参没有用处，对应实参直接丢弃
+        for (IRBlock* block : sites) {
+            IRInst* call = block->insts[block->insts.size() - 2];
+            for (size_t i = 0; i < phis.size(); ++i) {
+                if (!phis[i]) continue;
+                phis[i]->operands.push_back(call->operands[i]);
+                phis[i]->targets.push_back(block);
+            }
+            block->insts.resize(block->insts.size() - 2);
+            IRInst* back = func.createInst(IROp::Jump);
+            back->hasValue = false;
+            back->block = block;
+            back->targets.push_back(header);
+            block->insts.push_back(back);
+        }
+        func.recomputePreds();
+        return true;
+    }
+
+private:
+    // 块以“调用自身，然后直接返回调用结果”结尾
+    static bool isSelfTailCall(const IRFunction& func, const IRBlock* block) {
+        size_t size = block->insts.size();
+        if (size < 2) return false;
+        const IRInst* ret = block->insts[size - 1];
+        const IRInst* call = block->insts[size - 2];
+        if (ret->op != IROp::Ret || call->op != IROp::Call || call->callee != func.name) return false;
+        return ret->operands.empty() || ret->operands[0] == call;
+    }
+};
+
+} // namespace
+
+bool evaluateIROp(IROp op, int lhs, int rhs, int& result) {
+    return evaluateBinOp(toBinOp(op), lhs, rhs, result);
+}
+
+void PassManager::add(std::unique_ptr<IRPass> pass) {
+    passes.push_back(std::move(pass));
+}
+
+void PassManager::run(IRModule& module) {
+    for (auto& func : module.functions) {
+        for (int round = 0; round < maxRounds; ++round) {
+            bool changed = false;
+            for (auto& pass : passes) {
+                changed |= pass->run(*func);
+                if (verify) func->verify(names);
+            }
+            if (!changed) break;
+        }
+    }
+}
+
+std::unique_ptr<IRPass> createSimplifyCFGPass() {
+    return std::make_unique<SimplifyCFG>();
+}
+
+std::unique_ptr<IRPass> createConstantFoldPass() {
+    return std::make_unique<ConstantFold>();
+}
+
+std::unique_ptr<IRPass> createCSEPass() {
+    return std::make_unique<CSE>();
+}
+
+std::unique_ptr<IRPass> createDCEPass() {
+    return std::make_unique<DCE>();
+}
+
+std::unique_ptr<IRPass> createTailRecursionPass() {
+    return std::make_unique<TailRecursion>();
+}
+
+void addDefaultPasses(PassManager& manager) {
+    manager.add(createTailRecursionPass());
+    manager.add(createSimplifyCFGPass());
+    manager.add(createConstantFoldPass());
+    manager.add(createCSEPass());
+    manager.add(createDCEPass());
+}
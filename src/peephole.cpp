@@ -0,0 +1,384 @@
+#include "peephole.h"
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+const size_t NONE = SIZE_MAX;
+
+// 不改变控制流的普通指令
+bool isStraightLine(const AsmInst& inst) {
+    switch (asmFormat(inst.op)) {
+        case AsmFormat::R:
+        case AsmFormat::I:
+        case AsmFormat::Load:
+        case AsmFormat::Store:
+        case AsmFormat::LoadImm:
+        case AsmFormat::Unary:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool isLocalJump(AsmOp op) {
+    return op == AsmOp::J || isBranch(op);
+}
+
+// 一遍扫描中规则共享的状态：指令表、标签位置和引用计数，以及当前规则删掉的指令数。
+// 删除只把行标成Nop，下标在一遍扫描内保持不变，扫描结束后统一压缩
+class Window {
+public:
+    Window(std::vector<AsmInst>& code, int size) : code(code), size(size) {
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (code[i].op == AsmOp::Label) {
+                if (entry == NONE) entry = i;
+                labels[code[i].text] = i;
+            } else if (isLocalJump(code[i].op)) {
+                ++refs[code[i].text];
+            }
+        }
+    }
+
+    std::vector<AsmInst>& code;
+    int size;
+    size_t entry = NONE; // 函数入口标签
+    int removed = 0;
+
+    // i之后的下一行，跳过注释和已删除的行
+    size_t next(size_t i) const {
+        for (++i; i < code.size(); ++i) {
+            if (code[i].op != AsmOp::Comment && code[i].op != AsmOp::Nop) return i;
+        }
+        return NONE;
+    }
+
+    void remove(size_t i) {
+        if (isInstruction(code[i])) ++removed;
+        if (isLocalJump(code[i].op)) --refs[code[i].text];
+        code[i].op = AsmOp::Nop;
+    }
+
+    void retarget(size_t i, const std::string& target) {
+        --refs[code[i].text];
+        ++refs[target];
+        code[i].text = target;
+    }
+
+    void replace(size_t i, AsmInst inst) {
+        if (isLocalJump(code[i].op)) --refs[code[i].text];
+        if (isLocalJump(inst.op)) ++refs[inst.text];
+        code[i] = std::move(inst);
+    }
+
+    // 把指令i换成mv dst, src；dst就是src时直接删掉
+    void replaceWithMove(size_t i, Register dst, Register src) {
+        if (dst == src) {
+            remove(i);
+        } else {
+            replace(i, AsmInst::unary(AsmOp::Mv, dst, src));
+        }
+    }
+
+    int references(const std::string& label) const {
+        auto it = refs.find(label);
+        return it == refs.end() ? 0 : it->second;
+    }
+
+    // 标签后面的第一条指令
+    size_t targetOf(const std::string& label) const {
+        auto it = labels.find(label);
+        if (it == labels.end()) return NONE;
+        for (size_t i = it->second; i < code.size(); ++i) {
+            AsmOp op = code[i].op;
+            if (op == AsmOp::Label || op == AsmOp::Comment || op == AsmOp::Nop) continue;
+            return isInstruction(code[i]) ? i : NONE;
+        }
+        return NONE;
+    }
+
+    // 从i往后在窗口内找第一条访问offset(base)的lw/sw。途中reg或base被改写、出现别的基址的store
+    // （可能指向同一个栈槽）、或者到了基本块的边界都找不到
+    size_t findAccess(size_t i, Register reg, Register base, int32_t offset) const {
+        uint32_t watched = regMask(reg) | regMask(base);
+        size_t j = i;
+        for (int n = 0; n < size; ++n) {
+            j = next(j);
+            if (j == NONE || !isStraightLine(code[j])) return NONE;
+            const AsmInst& inst = code[j];
+            if ((inst.op == AsmOp::Lw || inst.op == AsmOp::Sw) && inst.rs1 == base && inst.imm == offset) return j;
+            if (inst.op == AsmOp::Sw && inst.rs1 != base) return NONE;
+            if (regsWritten(inst) & watched) return NONE;
+        }
+        return NONE;
+    }
+
+    // 指令i之后reg的值是否不再被读：窗口内先遇到写就是死的，先遇到读、标签、
+    // 跳转或窗口走完都按活跃处理；ret和tail之后按调用约定判断
+    bool deadAfter(size_t i, Register reg) const {
+        uint32_t mask = regMask(reg);
+        size_t j = i;
+        for (int n = 0; n < size; ++n) {
+            j = next(j);
+            if (j == NONE || !isInstruction(code[j])) return false;
+            const AsmInst& inst = code[j];
+            if (regsRead(inst) & mask) return false;
+            if (regsWritten(inst) & mask) return true;
+            if (inst.op == AsmOp::Ret || inst.op == AsmOp::Tail) return true;
+            if (isLocalJump(inst.op)) return false;
+        }
+        return false;
+    }
+
+private:
+    std::unordered_map<std::string, size_t> labels;
+    std::unordered_map<std::string, int> refs; // 标签被j和分支引用的次数
+};
+
+// mv x, x / addi x, x, 0
+bool selfMove(Window& w, size_t i) {
+    const AsmInst& inst = w.code[i];
+    bool noop = (inst.op == AsmOp::Mv && inst.rd == inst.rs1) ||
+                (inst.op == AsmOp::Addi && inst.rd == inst.rs1 && inst.imm == 0);
+    if (!noop) return false;
+    w.remove(i);
+    return true;
+}
+
+// sw r, X; ...; lw d, X  =>  lw改成mv d, r
+bool storeLoad(Window& w, size_t i) {
+    const AsmInst& store = w.code[i];
+    if (store.op != AsmOp::Sw) return false;
+    size_t j = w.findAccess(i, store.rs2, store.rs1, store.imm);
+    if (j == NONE || w.code[j].op != AsmOp::Lw) return false;
+    w.replaceWithMove(j, w.code[j].rd, store.rs2);
+    return true;
+}
+
+// lw r, X; ...; lw d, X  =>  第二条改成mv d, r
+bool loadLoad(Window& w, size_t i) {
+    const AsmInst& load = w.code[i];
+    if (load.op != AsmOp::Lw || load.rd == load.rs1) return false;
+    size_t j = w.findAccess(i, load.rd, load.rs1, load.imm);
+    if (j == NONE || w.code[j].op != AsmOp::Lw) return false;
+    w.replaceWithMove(j, w.code[j].rd, load.rd);
+    return true;
+}
+
+// lw r, X; ...; sw r, X  =>  删掉sw
+bool loadStore(Window& w, size_t i) {
+    const AsmInst& load = w.code[i];
+    if (load.op != AsmOp::Lw || load.rd == load.rs1) return false;
+    size_t j = w.findAccess(i, load.rd, load.rs1, load.imm);
+    if (j == NONE || w.code[j].op != AsmOp::Sw || w.code[j].rs2 != load.rd) return false;
+    w.remove(j);
+    return true;
+}
+
+// mv x, y; ...; mv y, x  =>  删掉第二条
+bool moveBack(Window& w, size_t i) {
+    const AsmInst& move = w.code[i];
+    if (move.op != AsmOp::Mv || move.rd == move.rs1) return false;
+    uint32_t watched = regMask(move.rd) | regMask(move.rs1);
+    size_t j = i;
+    for (int n = 0; n < w.size; ++n) {
+        j = w.next(j);
+        if (j == NONE || !isStraightLine(w.code[j])) return false;
+        const AsmInst& inst = w.code[j];
+        if (inst.op == AsmOp::Mv && inst.rd == move.rs1 && inst.rs1 == move.rd) {
+            w.remove(j);
+            return true;
+        }
+        if (regsWritten(inst) & watched) return false;
+    }
+    return false;
+}
+
+// t = ...; ...; mv d, t（t之后不再使用，中间的指令不碰t和d） =>  直接算进d
+bool foldMove(Window& w, size_t i) {
+    AsmInst& def = w.code[i];
+    uint32_t between = 0; // 中间的指令读写过的寄存器
+    size_t j = i;
+    for (int n = 0; n < w.size; ++n) {
+        j = w.next(j);
+        if (j == NONE || !isStraightLine(w.code[j])) return false;
+        const AsmInst& inst = w.code[j];
+        if (inst.op == AsmOp::Mv && inst.rs1 == def.rd) {
+            if (inst.rd == def.rd || (between & regMask(inst.rd)) || !w.deadAfter(j, def.rd)) return false;
+            def.rd = inst.rd;
+            w.remove(j);
+            return true;
+        }
+        uint32_t touched = regsRead(inst) | regsWritten(inst);
+        if (touched & regMask(def.rd)) return false;
+        between |= touched;
+    }
+    return false;
+}
+
+bool loadImmMove(Window& w, size_t i) {
+    return w.code[i].op == AsmOp::Li && foldMove(w, i);
+}
+
+bool defMove(Window& w, size_t i) {
+    const AsmInst& inst = w.code[i];
+    if (inst.op == AsmOp::Li || !isStraightLine(inst) || inst.op == AsmOp::Sw || inst.rd == Register::ZERO) {
+        return false;
+    }
+    return foldMove(w, i);
+}
+
+// 跳到紧跟着的标签
+bool jumpNext(Window& w, size_t i) {
+    const AsmInst& jump = w.code[i];
+    if (!isLocalJump(jump.op)) return false;
+    for (size_t k = i + 1; k < w.code.size(); ++k) {
+        AsmOp op = w.code[k].op;
+        if (op == AsmOp::Label && w.code[k].text == jump.text) {
+            w.remove(i);
+            return true;
+        }
+        if (op != AsmOp::Label && op != AsmOp::Comment && op != AsmOp::Nop) break;
+    }
+    return false;
+}
+
+// 跳到一条j：直接跳到它的目标，沿途最多追几跳，成环时不动
+bool jumpThread(Window& w, size_t i) {
+    const AsmInst& jump = w.code[i];
+    if (!isLocalJump(jump.op)) return false;
+    std::unordered_set<std::string> seen{jump.text};
+    std::string target = jump.text;
+    for (int hop = 0; hop < w.size; ++hop) {
+        size_t q = w.targetOf(target);
+        if (q == NONE || w.code[q].op != AsmOp::J) break;
+        if (!seen.insert(w.code[q].text).second) return false;
+        target = w.code[q].text;
+    }
+    if (target == jump.text) return false;
+    w.retarget(i, target);
+    return true;
+}
+
+// j到一条ret：就地返回
+bool jumpToRet(Window& w, size_t i) {
+    if (w.code[i].op != AsmOp::J) return false;
+    size_t q = w.targetOf(w.code[i].text);
+    if (q == NONE || w.code[q].op != AsmOp::Ret) return false;
+    w.replace(i, AsmInst::ret());
+    return true;
+}
+
+// b<cc> L1; j L2; L1:  =>  b<!cc> L2; L1:
+bool branchOverJump(Window& w, size_t i) {
+    const AsmInst& branch = w.code[i];
+    if (!isBranch(branch.op)) return false;
+    size_t j = w.next(i);
+    if (j == NONE || w.code[j].op != AsmOp::J) return false;
+    for (size_t k = j + 1; k < w.code.size(); ++k) {
+        AsmOp op = w.code[k].op;
+        if (op == AsmOp::Label && w.code[k].text == branch.text) {
+            std::string target = w.code[j].text;
+            w.code[i].op = invertBranch(branch.op);
+            w.retarget(i, target);
+            w.remove(j);
+            return true;
+        }
+        if (op != AsmOp::Label && op != AsmOp::Comment && op != AsmOp::Nop) break;
+    }
+    return false;
+}
+
+// 无条件转移之后、下一个标签之前的指令执行不到
+bool unreachable(Window& w, size_t i) {
+    AsmOp op = w.code[i].op;
+    if (op != AsmOp::J && op != AsmOp::Tail && op != AsmOp::Ret) return false;
+    bool changed = false;
+    for (size_t k = i + 1; k < w.code.size() && w.code[k].op != AsmOp::Label; ++k) {
+        if (!isInstruction(w.code[k])) continue;
+        w.remove(k);
+        changed = true;
+    }
+    return changed;
+}
+
+// 没有跳转引用的局部标签，删掉后前后的指令可以合在一个窗口里匹配
+bool deadLabel(Window& w, size_t i) {
+    const AsmInst& label = w.code[i];
+    if (label.op != AsmOp::Label || i == w.entry || w.references(label.text) > 0) return false;
+    w.remove(i);
+    return true;
+}
+
+struct Rule {
+    const char* name;
+    bool (*apply)(Window& w, size_t i);
+};
+
+const Rule RULES[] = {
+    {"self-move", selfMove},
+    {"store-load", storeLoad},
+    {"load-load", loadLoad},
+    {"load-store", loadStore},
+    {"move-back", moveBack},
+    {"li-mv", loadImmMove},
+    {"def-mv", defMove},
+    {"jump-next", jumpNext},
+    {"jump-thread", jumpThread},
+    {"jump-to-ret", jumpToRet},
+    {"branch-over-jump", branchOverJump},
+    {"unreachable", unreachable},
+    {"dead-label", deadLabel},
+};
+
+const size_t RULE_COUNT = std::size(RULES);
+
+} // namespace
+
+PeepholeOptimizer::PeepholeOptimizer(PeepholeOptions options)
+    : options(options), hits(RULE_COUNT, 0), removed(RULE_COUNT, 0) {}
+
+void PeepholeOptimizer::run(std::vector<AsmInst>& code) {
+    for (int pass = 0; pass < options.maxPasses; ++pass) {
+        Window window(code, options.window);
+        bool changed = false;
+        for (size_t i = 0; i < code.size(); ++i) {
+            for (size_t r = 0; r < RULE_COUNT && code[i].op != AsmOp::Nop; ++r) {
+                window.removed = 0;
+                if (!RULES[r].apply(window, i)) continue;
+                ++hits[r];
+                removed[r] += window.removed;
+                changed = true;
+            }
+        }
+        code.erase(std::remove_if(code.begin(), code.end(),
+                                  [](const AsmInst& inst) { return inst.op == AsmOp::Nop; }),
+                   code.end());
+        if (!changed) break;
+    }
+}
+
+void PeepholeOptimizer::merge(const PeepholeOptimizer& other) {
+    for (size_t r = 0; r < RULE_COUNT; ++r) {
+        hits[r] += other.hits[r];
+        removed[r] += other.removed[r];
+    }
+}
+
+void PeepholeOptimizer::printStats(std::ostream& out) const {
+    int totalHits = 0, totalRemoved = 0;
+    out << "窥孔优化统计（窗口 " << options.window << "）:\n";
+    out << "  规则                  命中  删除指令\n";
+    for (size_t r = 0; r < RULE_COUNT; ++r) {
+        out << "  " << std::left << std::setw(18) << RULES[r].name << std::right << std::setw(8) << hits[r]
+            << std::setw(10) << removed[r] << "\n";
+        totalHits += hits[r];
+        totalRemoved += removed[r];
+    }
+    out << "  合计              " << std::right << std::setw(8) << totalHits
+        << std::setw(10) << totalRemoved << "\n";
+}
@@ -0,0 +1,23 @@
+#include "pipeline.h"
+#include <stdexcept>
+
+// 各核的数值取自公开的微架构资料，是按这里的模型折算的近似值：
+// 模型只区分load、乘法、除法三类长延迟指令，其余指令一个周期出结果
+const std::vector<CoreModel>& coreModels() {
+    static const std::vector<CoreModel> cores = {
+        {"generic", "通用的5级顺序流水线（toysim的默认模型）", {2, 3, 34, 2}},
+        {"e31", "SiFive E31一类的核：load-use 3周期，乘法较快", {3, 2, 33, 3}},
+        {"rocket", "Rocket一类的核：load-use 3周期，乘法4周期", {3, 4, 33, 3}},
+        {"slow-mem", "片外SRAM取数据的小核：load-use延迟长", {5, 3, 34, 2}},
+    };
+    return cores;
+}
+
+const PipelineModel& findCoreModel(const std::string& name) {
+    for (const CoreModel& core : coreModels()) {
+        if (name == core.name) return core.model;
+    }
+    std::string names;
+    for (const CoreModel& core : coreModels()) names += std::string(names.empty() ? "" : "、") + core.name;
+    throw std::runtime_error("未知的核: " + name + "（可选" + names + "）");
+}
@@ -0,0 +1,238 @@
+#include "progen.h"
+#include <algorithm>
+
+namespace {
+
+// 生成器自带的xorshift32，保证同一个seed在任何平台上生成同样的程序
+class Random {
+public:
+    explicit Random(uint32_t seed) : state(seed ? seed : 0x9e3779b9u) {}
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    int below(int n) { return static_cast<int>(next() % static_cast<uint32_t>(n)); }
+    bool chance(int percent) { return below(100) < percent; }
+
+private:
+    uint32_t state;
+};
+
+constexpr int LocalCount = 4;
+
+class ProgramWriter {
+public:
+    explicit ProgramWriter(const GeneratorOptions& options) : options(options), rng(options.seed) {}
+
+    std::string run() {
+        int count = std::max(options.functions, 0);
+        for (int i = 0; i < count; ++i) {
+            isVoid.push_back(i % 6 == 5);
+            writeFunction(i);
+        }
+        writeMain(count);
+        return std::move(out);
+    }
+
+private:
+    const GeneratorOptions& options;
+    Random rng;
+    std::string out;
+    std::string indent;
+    int depth = 0;
+    std::vector<bool> isVoid;
+    int loopCounters = 0; // 当前函数已声明的循环计数变量
+
+    void line(const std::string& text) {
+        out += indent;
+        out += text;
+        out += '\n';
+    }
+    // 缩进最多12层，深层嵌套时文件大小仍与语句数成正比
+    void open(const std::string& text) {
+        line(text);
+        nest(1);
+    }
+    void close(const std::string& text = "}") {
+        nest(-1);
+        line(text);
+    }
+    void nest(int delta) {
+        depth += delta;
+        indent.assign(std::min(depth, 12) * 4, ' ');
+    }
+
+    std::string local() { return "v" + std::to_string(rng.below(LocalCount)); }
+
+    std::string leaf() {
+        switch (rng.below(4)) {
+            case 0: return std::to_string(rng.below(100));
+            case 1: return std::string(1, static_cast<char>('a' + rng.below(3)));
+            default: return local();
+        }
+    }
+
+    // 恒为正的除数：x % 5在-4~4之间
+    std::string divisor(const std::string& value) {
+        return "(" + value + " % 5 + 6)";
+    }
+
+    // 深度为depth的表达式：每层一对括号，一侧继续嵌套、另一侧是叶子，大小与深度成正比
+    std::string expr(int depth) {
+        if (depth <= 0) return leaf();
+        std::string deep = expr(depth - 1);
+        switch (rng.below(16)) {
+            case 0: return "-(" + deep + ")";
+            case 1: return "!(" + deep + ")";
+            case 2: return "(" + deep + " / " + std::to_string(2 + rng.below(8)) + ")";
+            case 3: return "(" + leaf() + " / " + divisor(deep) + ")";
+            case 4: return "(" + deep + " % " + std::to_string(2 + rng.below(8)) + ")";
+            case 5: return "(" + leaf() + " % " + divisor(deep) + ")";
+            case 6: return "(" + deep + " * " + leaf() + ")";
+            case 7: return "(" + deep + " < " + leaf() + ")";
+            case 8: return "(" + leaf() + " == " + deep + ")";
+            case 9: return "(" + deep + " && " + leaf() + ")";
+            case 10: return "(" + leaf() + " || " + deep + ")";
+            case 11: return "(" + leaf() + " - " + deep + ")";
+            default: return rng.chance(50) ? "(" + deep + " + " + leaf() + ")" : "(" + leaf() + " - " + deep + ")";
+        }
+    }
+
+    std::string condition() {
+        static const char* const relations[] = {"<", "<=", ">", ">=", "==", "!="};
+        std::string cond = expr(options.exprDepth) + " " + relations[rng.below(6)] + " " + leaf();
+        if (rng.chance(25)) {
+            cond += rng.chance(50) ? " && " : " || ";
+            cond += leaf() + " != " + leaf();
+        }
+        return cond;
+    }
+
+    void assignment() { line(local() + " = " + expr(options.exprDepth) + ";"); }
+
+    void ifStatement() {
+        open("if (" + condition() + ") {");
+        assignment();
+        if (rng.chance(60)) {
+            nest(-1);
+            open("} else {");
+            assignment();
+        }
+        close();
+    }
+
+    // 第level层while；所有循环共用fuel，嵌套多深总迭代次数都有上限
+    void loop(int level) {
+        std::string counter = "i" + std::to_string(loopCounters++);
+        line("int " + counter + " = 0;");
+        open("while (" + counter + " < " + std::to_string(2 + rng.below(3)) + " && fuel > 0) {");
+        line("fuel = fuel - 1;");
+        assignment();
+        if (level < options.loopDepth) loop(level + 1);
+        if (rng.chance(20)) {
+            open("if (" + condition() + ") {");
+            line(rng.chance(50) ? "break;" : "continue;");
+            close();
+        }
+        line(counter + " = " + counter + " + 1;");
+        close();
+    }
+
+    void call(int index) {
+        int callee = rng.below(index);
+        std::string args = expr(1) + ", " + leaf() + ", " + leaf();
+        std::string name = "f" + std::to_string(callee);
+        if (isVoid[callee]) {
+            line(name + "(" + args + ");");
+        } else {
+            line(local() + " = " + name + "(" + args + ");");
+        }
+    }
+
+    void writeFunction(int index) {
+        loopCounters = 0;
+        open(std::string(isVoid[index] ? "void" : "int") + " f" + std::to_string(index) + "(int a, int b, int c) {");
+        line("int fuel = 48;");
+        for (int i = 0; i < LocalCount; ++i) {
+            line("int v" + std::to_string(i) + " = " + std::string(1, static_cast<char>('a' + i % 3)) + " + " +
+                 std::to_string(i) + ";");
+        }
+        // 每个函数只在顶层调用一次前面的函数，调用总次数与函数个数成正比
+        for (int i = 0; i < options.loopNests; ++i) loop(1);
+        int callAt = index > 0 && options.statements > 0 ? rng.below(options.statements) : -1;
+        for (int i = 0; i < options.statements; ++i) {
+            if (i == callAt) {
+                call(index);
+                continue;
+            }
+            int kind = rng.below(options.loopDepth > 0 ? 8 : 6);
+            if (kind < 3) {
+                assignment();
+            } else if (kind < 5) {
+                ifStatement();
+            } else if (kind == 5) {
+                line(expr(options.exprDepth) + ";");
+            } else {
+                loop(1);
+            }
+        }
+        if (callAt < 0 && index > 0) call(index);
+        line(isVoid[index] ? "return;" : "return " + expr(options.exprDepth) + ";");
+        close();
+        line("");
+    }
+
+    // main调用最后几个int函数，把结果加起来作为退出值
+    void writeMain(int count) {
+        open("int main() {");
+        line("int r = 0;");
+        int called = 0;
+        for (int i = count - 1; i >= 0 && called < 4; --i) {
+            if (isVoid[i]) continue;
+            line("r = r + f" + std::to_string(i) + "(" + std::to_string(i % 7 + 1) + ", " + std::to_string(called + 2) +
+                 ", r);");
+            ++called;
+        }
+        line("return r;");
+        close();
+    }
+};
+
+} // namespace
+
+const std::vector<std::string>& shapeNames() {
+    static const std::vector<std::string> names = {"functions", "expr", "block", "loops"};
+    return names;
+}
+
+bool shapeOptions(const std::string& shape, int size, GeneratorOptions& options) {
+    options = GeneratorOptions();
+    if (shape == "functions") {
+        options.functions = size;
+        options.statements = 8;
+    } else if (shape == "expr") {
+        options.functions = 4;
+        options.statements = 8;
+        options.exprDepth = size;
+        options.loopDepth = 0;
+    } else if (shape == "block") {
+        options.functions = 4;
+        options.statements = size;
+    } else if (shape == "loops") {
+        options.functions = 4;
+        options.statements = 0;
+        options.loopNests = 4;
+        options.exprDepth = 2;
+        options.loopDepth = size;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string generateProgram(const GeneratorOptions& options) {
+    return ProgramWriter(options).run();
+}
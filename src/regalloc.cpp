@@ -0,0 +1,75 @@
+#include "regalloc.h"
+#include <algorithm>
+
+LinearScanAllocator::LinearScanAllocator(std::vector<Register> callerSaved, std::vector<Register> calleeSaved)
+    : callerSaved(std::move(callerSaved)), calleeSaved(std::move(calleeSaved)) {}
+
+void LinearScanAllocator::allocate(std::vector<LiveInterval>& intervals) {
+    usedCallee.clear();
+    spills = 0;
+
+    std::vector<LiveInterval*> order;
+    for (auto& interval : intervals) order.push_back(&interval);
+    std::sort(order.begin(), order.end(), [](const LiveInterval* a, const LiveInterval* b) {
+        return a->start != b->start ? a->start < b->start : a->var < b->var;
+    });
+
+    // 空闲寄存器栈，按声明顺序优先使用靠前的寄存器
+    std::vector<Register> freeCaller(callerSaved.rbegin(), callerSaved.rend());
+    std::vector<Register> freeCallee(calleeSaved.rbegin(), calleeSaved.rend());
+    std::vector<LiveInterval*> active; // 按end升序
+
+    auto release = [&](Register reg) {
+        (isCalleeSaved(reg) ? freeCallee : freeCaller).push_back(reg);
+    };
+    auto activate = [&](LiveInterval* interval) {
+        auto pos = std::upper_bound(active.begin(), active.end(), interval,
+                                    [](const LiveInterval* a, const LiveInterval* b) { return a->end < b->end; });
+        active.insert(pos, interval);
+        if (isCalleeSaved(interval->reg) &&
+            std::find(usedCallee.begin(), usedCallee.end(), interval->reg) == usedCallee.end()) {
+            usedCallee.push_back(interval->reg);
+        }
+    };
+
+    for (LiveInterval* cur : order) {
+        // 回收已经结束的区间
+        while (!active.empty() && active.front()->end < cur->start) {
+            release(active.front()->reg);
+            active.erase(active.begin());
+        }
+
+        // 偏好寄存器空闲时优先使用
+        std::vector<Register>& pool = cur->crossesCall ? freeCallee : freeCaller;
+        auto hinted = std::find(pool.begin(), pool.end(), cur->hint);
+        if (cur->hint != Register::ZERO && hinted != pool.end()) {
+            cur->reg = *hinted;
+            pool.erase(hinted);
+        } else if (!cur->crossesCall && !freeCaller.empty()) {
+            cur->reg = freeCaller.back();
+            freeCaller.pop_back();
+        } else if (!freeCallee.empty()) {
+            cur->reg = freeCallee.back();
+            freeCallee.pop_back();
+        } else {
+            // 寄存器不足：从结束最晚且寄存器类别兼容的活跃区间里找牺牲者
+            LiveInterval* victim = nullptr;
+            for (auto it = active.rbegin(); it != active.rend(); ++it) {
+                if (!cur->crossesCall || isCalleeSaved((*it)->reg)) {
+                    victim = *it;
+                    break;
+                }
+            }
+            ++spills;
+            if (victim && victim->end > cur->end) {
+                cur->reg = victim->reg;
+                victim->reg = Register::ZERO;
+                active.erase(std::find(active.begin(), active.end(), victim));
+            } else {
+                cur->reg = Register::ZERO;
+                continue;
+            }
+        }
+        activate(cur);
+    }
+}
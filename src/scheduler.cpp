@@ -0,0 +1,223 @@
+#include "scheduler.h"
+#include "encoder.h"
+#include <algorithm>
+
+namespace {
+
+// 可以在基本块内重排的指令：不改变控制流，也不是调用
+bool isSchedulable(const AsmInst& inst) {
+    switch (asmFormat(inst.op)) {
+        case AsmFormat::R:
+        case AsmFormat::I:
+        case AsmFormat::Load:
+        case AsmFormat::Store:
+        case AsmFormat::LoadImm:
+        case AsmFormat::Unary:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool isMemory(AsmOp op) {
+    return op == AsmOp::Lw || op == AsmOp::Sw;
+}
+
+bool isDivide(AsmOp op) {
+    return op == AsmOp::Div || op == AsmOp::Rem;
+}
+
+// 依赖图的结点：一条指令和紧挨在它前面的注释。区域末尾的边界指令（分支、调用、返回等）
+// 也作为最后一个结点参与估计，但固定在最后、不由调度输出
+struct Node {
+    AsmInst* inst;
+    std::vector<AsmInst*> comments;
+    int slots = 1;   // 占用的发射周期，li的大立即数展开成两条
+    int latency = 1; // 发射后第几个周期结果可用
+    bool divide = false;
+    std::vector<std::pair<int, int>> succs; // (后继, 后继最早在本结点发射后第几个周期发射)
+    int preds = 0;
+    int priority = 0; // 到区域末尾的最长延迟路径
+};
+
+class Region {
+public:
+    Region(const PipelineModel& model, std::vector<Node>& nodes, bool hasBoundary)
+        : model(model), nodes(nodes), hasBoundary(hasBoundary) {}
+
+    // 建依赖图并算优先级；n条指令两两比较，区域的长度有上限
+    void build() {
+        int n = static_cast<int>(nodes.size());
+        for (Node& node : nodes) {
+            AsmOp op = node.inst->op;
+            if (op == AsmOp::Li) node.slots = node.latency = encodedSize(*node.inst, false) / 4;
+            if (op == AsmOp::Lw) node.latency = model.loadLatency;
+            if (op == AsmOp::Mul || op == AsmOp::Mulh) node.latency = model.mulLatency;
+            if (isDivide(op)) {
+                node.latency = model.divLatency;
+                node.divide = true;
+            }
+        }
+        for (int j = 1; j < n; ++j) {
+            const AsmInst& later = *nodes[j].inst;
+            uint32_t reads = regsRead(later), writes = regsWritten(later);
+            uint32_t between = 0; // i与j之间的指令写的寄存器
+            for (int i = j - 1; i >= 0; --i) {
+                const AsmInst& earlier = *nodes[i].inst;
+                uint32_t earlierWrites = regsWritten(earlier);
+                int delay = -1;
+                if (earlierWrites & reads) delay = nodes[i].latency;
+                // 读后写、写后写只要求先后，边界指令也必须在所有指令之后
+                else if ((regsRead(earlier) & writes) || (earlierWrites & writes) ||
+                         (hasBoundary && j == n - 1) || memoryConflict(earlier, later, between)) {
+                    delay = 0;
+                }
+                if (delay >= 0) {
+                    nodes[i].succs.emplace_back(j, delay);
+                    ++nodes[j].preds;
+                }
+                between |= earlierWrites;
+            }
+        }
+        for (int i = n - 1; i >= 0; --i) {
+            Node& node = nodes[i];
+            node.priority = node.latency;
+            for (auto [succ, delay] : node.succs) {
+                node.priority = std::max(node.priority, std::max(delay, 1) + nodes[succ].priority);
+            }
+        }
+    }
+
+    // 按原顺序发射需要的周期数
+    int originalCycles() const {
+        std::vector<int> order(nodes.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<int>(i);
+        return cycles(order);
+    }
+
+    // 表调度：每次从前驱都已发射的结点里选最早能发射的，同时能发射的选优先级高的，再选原来靠前的
+    std::vector<int> schedule() const {
+        int n = static_cast<int>(nodes.size());
+        std::vector<int> preds(n), earliest(n, 0), order;
+        for (int i = 0; i < n; ++i) preds[i] = nodes[i].preds;
+        std::vector<bool> done(n, false);
+        int now = 0, divFree = 0;
+        while (static_cast<int>(order.size()) < n) {
+            int best = -1, bestStart = 0;
+            for (int i = 0; i < n; ++i) {
+                if (done[i] || preds[i] > 0) continue;
+                int start = std::max(now, earliest[i]);
+                if (nodes[i].divide) start = std::max(start, divFree);
+                if (best < 0 || start < bestStart ||
+                    (start == bestStart && nodes[i].priority > nodes[best].priority)) {
+                    best = i;
+                    bestStart = start;
+                }
+            }
+            done[best] = true;
+            order.push_back(best);
+            now = bestStart + nodes[best].slots;
+            if (nodes[best].divide) divFree = bestStart + nodes[best].latency;
+            for (auto [succ, delay] : nodes[best].succs) {
+                earliest[succ] = std::max(earliest[succ], bestStart + delay);
+                --preds[succ];
+            }
+        }
+        return order;
+    }
+
+    // 按order发射需要的周期数，与模拟器的记分板一致：读的寄存器没就绪或除法器忙时停顿
+    int cycles(const std::vector<int>& order) const {
+        int ready[32] = {};
+        int now = 0, divFree = 0;
+        for (int i : order) {
+            const Node& node = nodes[i];
+            int issue = now;
+            uint32_t reads = regsRead(*node.inst);
+            for (int r = 1; r < 32; ++r) {
+                if (reads & (1u << r)) issue = std::max(issue, ready[r]);
+            }
+            if (node.divide) {
+                issue = std::max(issue, divFree);
+                divFree = issue + node.latency;
+            }
+            uint32_t writes = regsWritten(*node.inst);
+            for (int r = 1; r < 32; ++r) {
+                if (writes & (1u << r)) ready[r] = issue + node.latency;
+            }
+            now = issue + node.slots;
+        }
+        return now;
+    }
+
+private:
+    const PipelineModel& model;
+    std::vector<Node>& nodes;
+    bool hasBoundary;
+
+    // 两条访存之间至少有一条store时可能冲突，除非基址相同、期间没被改写并且偏移不同
+    static bool memoryConflict(const AsmInst& a, const AsmInst& b, uint32_t between) {
+        if (!isMemory(a.op) || !isMemory(b.op)) return false;
+        if (a.op == AsmOp::Lw && b.op == AsmOp::Lw) return false;
+        bool sameBase = a.rs1 == b.rs1 && !(between & regMask(a.rs1));
+        return !sameBase || a.imm == b.imm;
+    }
+};
+
+} // namespace
+
+InstructionScheduler::InstructionScheduler(PipelineModel model, SchedulerOptions options)
+    : model(model), options(options) {}
+
+void InstructionScheduler::run(std::vector<AsmInst>& code) const {
+    std::vector<AsmInst> result;
+    result.reserve(code.size());
+    std::vector<Node> nodes;
+    std::vector<AsmInst*> comments;
+
+    // 调度攒下的区域；boundary是紧跟在区域后面、结束区域的指令（没有时为空）
+    auto flush = [&](AsmInst* boundary) {
+        size_t count = nodes.size();
+        bool reorder = count >= 2;
+        std::vector<int> order(count);
+        for (size_t i = 0; i < count; ++i) order[i] = static_cast<int>(i);
+        if (reorder) {
+            if (boundary) {
+                nodes.emplace_back();
+                nodes.back().inst = boundary;
+            }
+            Region region(model, nodes, boundary != nullptr);
+            region.build();
+            std::vector<int> scheduled = region.schedule();
+            if (region.cycles(scheduled) < region.originalCycles()) {
+                scheduled.resize(count); // 边界指令总在最后
+                order = scheduled;
+            }
+        }
+        for (int i : order) {
+            for (AsmInst* comment : nodes[i].comments) result.push_back(std::move(*comment));
+            result.push_back(std::move(*nodes[i].inst));
+        }
+        for (AsmInst* comment : comments) result.push_back(std::move(*comment));
+        nodes.clear();
+        comments.clear();
+    };
+
+    for (AsmInst& inst : code) {
+        if (inst.op == AsmOp::Comment || inst.op == AsmOp::Nop) {
+            comments.push_back(&inst);
+            continue;
+        }
+        if (!isSchedulable(inst)) {
+            flush(isInstruction(inst) ? &inst : nullptr);
+            result.push_back(std::move(inst));
+            continue;
+        }
+        if (static_cast<int>(nodes.size()) == options.maxRegion) flush(nullptr);
+        nodes.emplace_back();
+        nodes.back().inst = &inst;
+        nodes.back().comments.swap(comments);
+    }
+    flush(nullptr);
+    code.swap(result);
+}
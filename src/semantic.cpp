@@ -1,76 +1,90 @@
 //C://ToyC_Int//User//Antelope693//3112989263@qq.com
 #include "semantic.h"
-#include <unordered_map>
-#include <unordered_set>
+#include "cfg.h"
+#include <stdexcept>
 #include <string>
 #include <vector>
-#include <memory>
+
+[[noreturn]] static void error(const std::string& msg) {
+    throw std::runtime_error("语义错误: " + msg);
+}
 
 class SemanticContext {
 public:
-    std::unordered_map<std::string, std::string> funcRetType; // 函数名->返回类型
-    std::unordered_map<std::string, int> funcDeclaredOrder; // 函数名->声明顺序
-    std::vector<std::unordered_map<std::string, bool>> varScopes; // 变量作用域栈
-    std::unordered_set<std::string> funcNames;
-    int funcOrder = 0;
+    SemanticContext(const StringInterner& names, const Program* program) : names(names), program(program) {
+        symbols.reset(names.size());
+    }
+    const StringInterner& names;
+    const Program* program;
+    ScopedSymbolTable symbols; // 变量作用域和函数表
     bool inLoop = false;
-    std::string curFunc;
-    std::string curFuncRetType;
+    FunctionDef* curFunc = nullptr;
+    int curFuncOrder = 0;
     bool hasReturn = false;
-    void enterScope() { varScopes.push_back({}); }
-    void leaveScope() { varScopes.pop_back(); }
-    void declareVar(const std::string& name) { varScopes.back()[name] = true; }
-    bool isVarDeclared(const std::string& name) {
-        for (int i = varScopes.size() - 1; i >= 0; --i) {
-            if (varScopes[i].count(name)) return true;
-        }
-        return false;
+    // 当前语句是否可达、各层循环是否有可达的break：规则与控制流图相同（常量条件只走一边），
+    // 检查完函数体时可达说明落出了函数体末尾
+    bool reachable = true;
+    std::vector<bool> loopBreaks;
+    std::string str(SymbolId id) const { return std::string(names.name(id)); }
+    // 在当前作用域声明变量，编号写进var；当前作用域已有同名变量时返回false
+    bool declareVar(SymbolId name, uint32_t& var) {
+        if (!symbols.declareVar(name, curFunc->varCount)) return false;
+        var = curFunc->varCount++;
+        return true;
+    }
+    const FunctionDef* function(SymbolId name) const {
+        int order = symbols.lookupFunction(name);
+        return order < 0 ? nullptr : static_cast<const FunctionDef*>(program->functions[order]);
     }
 };
 
-void checkFuncDef(const std::shared_ptr<FunctionDef>& func, SemanticContext& ctx, int order);
 void checkStmt(const ASTNodePtr& node, SemanticContext& ctx);
 void checkExpr(const ASTNodePtr& node, SemanticContext& ctx, bool allowVoidCall = false);
-bool checkAllPathsReturn(const ASTNodePtr& node);
 
-void SemanticAnalyzer::analyze(const ASTNodePtr& root) {
-    auto prog = std::dynamic_pointer_cast<Program>(root);
+void SemanticAnalyzer::analyze(const ASTNodePtr& root, const std::vector<bool>* skipBodies) {
+    auto prog = as<Program>(root);
     if (!prog) error("AST根节点不是Program");
-    SemanticContext ctx;
+    SemanticContext ctx(names, prog);
+    SymbolId mainName = names.find("main");
     // 1. 函数名唯一、不能嵌套、不能作为值，main唯一、参数为空、返回int
     int mainCount = 0;
     int order = 0;
-    for (auto& f : prog->functions) {
-        auto func = std::dynamic_pointer_cast<FunctionDef>(f);
+    for (auto f : prog->functions) {
+        auto func = as<FunctionDef>(f);
         if (!func) continue;
-        if (ctx.funcNames.count(func->name)) error("函数名重复: " + func->name);
-        ctx.funcNames.insert(func->name);
-        ctx.funcRetType[func->name] = func->retType;
-        ctx.funcDeclaredOrder[func->name] = order++;
-        if (func->name == "main") {
+        SymbolId name = func->name;
+        if (!ctx.symbols.declareFunction(name, order++)) error("函数名重复: " + ctx.str(name));
+        if (name == mainName) {
             ++mainCount;
-            if (func->retType != "int") error("main函数必须返回int");
+            if (func->retType != TypeKind::Int) error("main函数必须返回int");
             if (!func->params.empty()) error("main函数参数必须为空");
         }
     }
     if (mainCount != 1) error("必须有且只有一个main函数");
     // 2. 检查所有函数体
     order = 0;
-    for (auto& f : prog->functions) {
-        auto func = std::dynamic_pointer_cast<FunctionDef>(f);
-        ctx.curFunc = func->name;
-        ctx.curFuncRetType = func->retType;
+    for (auto f : prog->functions) {
+        auto func = as<FunctionDef>(f);
+        if (skipBodies && (*skipBodies)[order]) {
+            ++order;
+            continue;
+        }
+        ctx.curFunc = func;
+        ctx.curFuncOrder = order;
         ctx.hasReturn = false;
-        ctx.enterScope();
-        // 形参声明
+        ctx.reachable = true;
+        func->varCount = 0;
+        ctx.symbols.enterScope();
+        // 形参声明，编号为0~n-1
         for (auto& p : func->params) {
-            if (ctx.isVarDeclared(p.second)) error("形参名与局部变量冲突: " + p.second);
-            ctx.declareVar(p.second);
+            uint32_t var;
+            if (!ctx.declareVar(p.name, var)) error("形参名与局部变量冲突: " + ctx.str(p.name));
         }
         checkStmt(func->body, ctx);
-        ctx.leaveScope();
+        ctx.symbols.leaveScope();
         // int函数所有路径必须return int
-        if (func->retType == "int" && !checkAllPathsReturn(func->body)) error("int函数所有路径必须return int: " + func->name);
+        // 函数体末尾是否可达与ControlFlowGraph::fallsOffEnd一致，检查语句时顺带算出，不再另外建图
+        if (func->retType == TypeKind::Int && ctx.reachable) error("int函数所有路径必须return int: " + ctx.str(func->name));
         // void函数不能return带值
         // 已在checkStmt中处理
         ++order;
@@ -79,83 +93,231 @@ void SemanticAnalyzer::analyze(const ASTNodePtr& root) {
 
 void checkStmt(const ASTNodePtr& node, SemanticContext& ctx) {
     if (!node) return;
-    if (auto block = std::dynamic_pointer_cast<Block>(node)) {
-        ctx.enterScope();
-        for (auto& stmt : block->stmts) checkStmt(stmt, ctx);
-        ctx.leaveScope();
-    } else if (auto decl = std::dynamic_pointer_cast<VarDecl>(node)) {
-        if (ctx.varScopes.back().count(decl->name)) error("变量重复声明: " + decl->name);
-        checkExpr(decl->initExpr, ctx);
-        ctx.declareVar(decl->name);
-    } else if (auto assign = std::dynamic_pointer_cast<Assign>(node)) {
-        if (!ctx.isVarDeclared(assign->name)) error("变量未声明: " + assign->name);
-        checkExpr(assign->expr, ctx);
-    } else if (auto ret = std::dynamic_pointer_cast<ReturnStmt>(node)) {
-        ctx.hasReturn = true;
-        if (ctx.curFuncRetType == "void" && ret->expr) error("void函数不能return带值: " + ctx.curFunc);
-        if (ctx.curFuncRetType == "int" && !ret->expr) error("int函数return必须带值: " + ctx.curFunc);
-        if (ret->expr) checkExpr(ret->expr, ctx);
-    } else if (auto exprStmt = std::dynamic_pointer_cast<ExprStmt>(node)) {
-        checkExpr(exprStmt->expr, ctx, true);
-    } else if (auto ifs = std::dynamic_pointer_cast<IfStmt>(node)) {
-        checkExpr(ifs->cond, ctx);
-        checkStmt(ifs->thenStmt, ctx);
-        if (ifs->elseStmt) checkStmt(ifs->elseStmt, ctx);
-    } else if (auto wh = std::dynamic_pointer_cast<WhileStmt>(node)) {
-        checkExpr(wh->cond, ctx);
-        bool oldInLoop = ctx.inLoop;
-        ctx.inLoop = true;
-        checkStmt(wh->body, ctx);
-        ctx.inLoop = oldInLoop;
-    } else if (std::dynamic_pointer_cast<BreakStmt>(node) || std::dynamic_pointer_cast<ContinueStmt>(node)) {
-        if (!ctx.inLoop) error("break/continue只能出现在循环中");
+    switch (node->kind) {
+        case NodeKind::Block: {
+            auto block = static_cast<Block*>(node);
+            ctx.symbols.enterScope();
+            for (auto stmt : block->stmts) checkStmt(stmt, ctx);
+            ctx.symbols.leaveScope();
+            break;
+        }
+        case NodeKind::VarDecl: {
+            auto decl = static_cast<VarDecl*>(node);
+            if (ctx.symbols.declaredInCurrentScope(decl->name)) error("变量重复声明: " + ctx.str(decl->name));
+            // 初值中的同名变量指外层的变量，先检查初值再声明
+            checkExpr(decl->initExpr, ctx);
+            ctx.declareVar(decl->name, decl->var);
+            break;
+        }
+        case NodeKind::Assign: {
+            auto assign = static_cast<Assign*>(node);
+            assign->var = ctx.symbols.lookupVar(assign->name);
+            if (assign->var == NoVar) error("变量未声明: " + ctx.str(assign->name));
+            checkExpr(assign->expr, ctx);
+            break;
+        }
+        case NodeKind::ReturnStmt: {
+            auto ret = static_cast<ReturnStmt*>(node);
+            ctx.hasReturn = true;
+            if (ctx.curFunc->retType == TypeKind::Void && ret->expr) error("void函数不能return带值: " + ctx.str(ctx.curFunc->name));
+            if (ctx.curFunc->retType == TypeKind::Int && !ret->expr) error("int函数return必须带值: " + ctx.str(ctx.curFunc->name));
+            if (ret->expr) checkExpr(ret->expr, ctx);
+            ctx.reachable = false;
+            break;
+        }
+        case NodeKind::ExprStmt:
+            checkExpr(static_cast<ExprStmt*>(node)->expr, ctx, true);
+            break;
+        case NodeKind::IfStmt: {
+            auto ifs = static_cast<IfStmt*>(node);
+            checkExpr(ifs->cond, ctx);
+            int value = 0;
+            bool constant = constantCondition(ifs->cond, value);
+            bool before = ctx.reachable;
+            ctx.reachable = before && (!constant || value);
+            checkStmt(ifs->thenStmt, ctx);
+            bool thenCompletes = ctx.reachable;
+            ctx.reachable = before && (!constant || !value);
+            if (ifs->elseStmt) checkStmt(ifs->elseStmt, ctx);
+            ctx.reachable = thenCompletes || ctx.reachable;
+            break;
+        }
+        case NodeKind::WhileStmt: {
+            auto wh = static_cast<WhileStmt*>(node);
+            checkExpr(wh->cond, ctx);
+            int value = 0;
+            bool constant = constantCondition(wh->cond, value);
+            bool before = ctx.reachable;
+            ctx.reachable = before && (!constant || value);
+            ctx.loopBreaks.push_back(false);
+            bool oldInLoop = ctx.inLoop;
+            ctx.inLoop = true;
+            checkStmt(wh->body, ctx);
+            ctx.inLoop = oldInLoop;
+            // 条件为假或者break时离开循环
+            ctx.reachable = (before && (!constant || !value)) || ctx.loopBreaks.back();
+            ctx.loopBreaks.pop_back();
+            break;
+        }
+        case NodeKind::BreakStmt:
+        case NodeKind::ContinueStmt:
+            if (!ctx.inLoop) error("break/continue只能出现在循环中");
+            if (node->kind == NodeKind::BreakStmt && ctx.reachable) ctx.loopBreaks.back() = true;
+            ctx.reachable = false;
+            break;
+        default:
+            break;
     }
 }
 
 void checkExpr(const ASTNodePtr& node, SemanticContext& ctx, bool allowVoidCall) {
     if (!node) return;
-    if (auto lit = std::dynamic_pointer_cast<IntLiteral>(node)) {
-        // ok
-    } else if (auto var = std::dynamic_pointer_cast<VarRef>(node)) {
-        if (!ctx.isVarDeclared(var->name)) error("变量未声明: " + var->name);
-    } else if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(node)) {
-        checkExpr(bin->lhs, ctx);
-        checkExpr(bin->rhs, ctx);
-        if (bin->op == "/" || bin->op == "%") {
-            if (auto rhs = std::dynamic_pointer_cast<IntLiteral>(bin->rhs)) {
-                if (rhs->value == 0) error("除数不能为零");
+    switch (node->kind) {
+        case NodeKind::IntLiteral:
+            // ok
+            break;
+        case NodeKind::VarRef: {
+            auto ref = static_cast<VarRef*>(node);
+            ref->var = ctx.symbols.lookupVar(ref->name);
+            if (ref->var == NoVar) error("变量未声明: " + ctx.str(ref->name));
+            break;
+        }
+        case NodeKind::BinaryExpr: {
+            auto bin = static_cast<BinaryExpr*>(node);
+            checkExpr(bin->lhs, ctx);
+            checkExpr(bin->rhs, ctx);
+            if (bin->op == BinOp::Div || bin->op == BinOp::Mod) {
+                if (auto rhs = as<IntLiteral>(bin->rhs)) {
+                    if (rhs->value == 0) error("除数不能为零");
+                }
             }
+            break;
+        }
+        case NodeKind::UnaryExpr:
+            checkExpr(static_cast<UnaryExpr*>(node)->expr, ctx);
+            break;
+        case NodeKind::FuncCall: {
+            auto call = static_cast<FuncCall*>(node);
+            SymbolId name = call->name;
+            int order = ctx.symbols.lookupFunction(name);
+            if (order < 0) error("函数未声明: " + ctx.str(name));
+            if (order > ctx.curFuncOrder) error("函数调用必须在声明后: " + ctx.str(name));
+            if (ctx.function(name)->retType == TypeKind::Void && !allowVoidCall) error("void函数调用不能作为条件或右值: " + ctx.str(name));
+            for (auto arg : call->args) checkExpr(arg, ctx);
+            if (call->args.size() != ctx.function(name)->params.size()) error("实参个数与形参个数不一致: " + ctx.str(name));
+            break;
         }
-    } else if (auto un = std::dynamic_pointer_cast<UnaryExpr>(node)) {
-        checkExpr(un->expr, ctx);
-    } else if (auto call = std::dynamic_pointer_cast<FuncCall>(node)) {
-        if (!ctx.funcRetType.count(call->name)) error("函数未声明: " + call->name);
-        if (ctx.funcDeclaredOrder[call->name] > ctx.funcDeclaredOrder[ctx.curFunc]) error("函数调用必须在声明后: " + call->name);
-        if (ctx.funcRetType[call->name] == "void" && !allowVoidCall) error("void函数调用不能作为条件或右值: " + call->name);
-        for (auto& arg : call->args) checkExpr(arg, ctx);
+        default:
+            break;
     }
 }
 
-bool checkAllPathsReturn(const ASTNodePtr& node) {
-    if (!node) return false;
-    if (std::dynamic_pointer_cast<ReturnStmt>(node)) return true;
-    if (auto block = std::dynamic_pointer_cast<Block>(node)) {
-        for (auto& stmt : block->stmts) {
-            if (checkAllPathsReturn(stmt)) return true;
+int FrontendChecker::report(const std::string& message, SymbolId unknownCall, bool pending) {
+    if (confirmed) return -1;
+    diagnostics.push_back(Diagnostic{message, unknownCall});
+    if (!pending) confirmed = true;
+    return static_cast<int>(diagnostics.size() - 1);
+}
+
+void FrontendChecker::beginFunction(TypeKind retType, SymbolId name, const std::vector<Param>& params) {
+    symbols.ensure(name);
+    if (!symbols.declareFunction(name, static_cast<int>(functionTypes.size())) && signatureError.empty()) {
+        signatureError = "函数名重复: " + str(name);
+    }
+    functionTypes.push_back(retType);
+    paramCounts.push_back(params.size());
+    if (names.name(name) == "main") {
+        ++mainCount;
+        if (retType != TypeKind::Int && signatureError.empty()) signatureError = "main函数必须返回int";
+        if (!params.empty() && signatureError.empty()) signatureError = "main函数参数必须为空";
+    }
+    curFunc = name;
+    curRetType = retType;
+    varCount = 0;
+    loopDepth = 0;
+    symbols.enterScope();
+    for (auto& p : params) {
+        symbols.ensure(p.name);
+        if (symbols.declareVar(p.name, varCount)) {
+            ++varCount;
+        } else {
+            report("形参名与局部变量冲突: " + str(p.name));
         }
-        return false;
     }
-    if (auto ifs = std::dynamic_pointer_cast<IfStmt>(node)) {
-        if (!ifs->elseStmt) return false;
-        return checkAllPathsReturn(ifs->thenStmt) && checkAllPathsReturn(ifs->elseStmt);
+}
+
+uint32_t FrontendChecker::endFunction(bool fallsOffEnd) {
+    symbols.leaveScope();
+    if (curRetType == TypeKind::Int && fallsOffEnd) report("int函数所有路径必须return int: " + str(curFunc));
+    return varCount;
+}
+
+void FrontendChecker::checkRedeclaration(SymbolId name) {
+    symbols.ensure(name);
+    if (symbols.declaredInCurrentScope(name)) report("变量重复声明: " + str(name));
+}
+
+uint32_t FrontendChecker::declareVar(SymbolId name) {
+    if (!symbols.declareVar(name, varCount)) return NoVar;
+    return varCount++;
+}
+
+uint32_t FrontendChecker::resolveVar(SymbolId name) {
+    symbols.ensure(name);
+    uint32_t var = symbols.lookupVar(name);
+    if (var == NoVar) report("变量未声明: " + str(name));
+    return var;
+}
+
+void FrontendChecker::checkReturn(bool hasValue) {
+    if (curRetType == TypeKind::Void && hasValue) report("void函数不能return带值: " + str(curFunc));
+    if (curRetType == TypeKind::Int && !hasValue) report("int函数return必须带值: " + str(curFunc));
+}
+
+void FrontendChecker::checkBreak() {
+    if (loopDepth == 0) report("break/continue只能出现在循环中");
+}
+
+void FrontendChecker::checkDivisor(const BinaryExpr* node) {
+    if (node->op != BinOp::Div && node->op != BinOp::Mod) return;
+    auto rhs = as<IntLiteral>(node->rhs);
+    if (rhs && rhs->value == 0) report("除数不能为零");
+}
+
+int FrontendChecker::checkCall(SymbolId name) {
+    symbols.ensure(name);
+    int order = symbols.lookupFunction(name);
+    if (order < 0) {
+        report("", name);
+        return -1;
     }
-    if (auto wh = std::dynamic_pointer_cast<WhileStmt>(node)) {
-        // conservatively assume while may not execute
-        return false;
+    if (functionTypes[order] == TypeKind::Void) {
+        return report("void函数调用不能作为条件或右值: " + str(name), InvalidSymbol, true);
     }
-    return false;
+    return -1;
+}
+
+void FrontendChecker::checkArgumentCount(SymbolId name, size_t count) {
+    int order = symbols.lookupFunction(name);
+    if (order >= 0 && paramCounts[order] != count) report("实参个数与形参个数不一致: " + str(name));
+}
+
+void FrontendChecker::allowVoidCall(int pending) {
+    if (pending < 0) return;
+    diagnostics[pending].withdrawn = true;
+    while (!diagnostics.empty() && diagnostics.back().withdrawn) diagnostics.pop_back();
 }
 
-void SemanticAnalyzer::visit(const ASTNodePtr& node) {
-    // 简单演示，实际应递归遍历AST并检查
-} 
\ No newline at end of file
+void FrontendChecker::finish() {
+    if (!signatureError.empty()) error(signatureError);
+    if (mainCount != 1) error("必须有且只有一个main函数");
+    for (const Diagnostic& diagnostic : diagnostics) {
+        if (diagnostic.withdrawn) continue;
+        if (diagnostic.unknownCall == InvalidSymbol) error(diagnostic.message);
+        // 后面声明了的是调用顺序错误，否则是未声明
+        if (symbols.lookupFunction(diagnostic.unknownCall) >= 0) {
+            error("函数调用必须在声明后: " + str(diagnostic.unknownCall));
+        }
+        error("函数未声明: " + str(diagnostic.unknownCall));
+    }
+}
@@ -0,0 +1,312 @@
+#include "sim.h"
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+[[noreturn]] void fail(const std::string& message) {
+    throw std::runtime_error("模拟器: " + message);
+}
+
+// 小端读取，越界时抛出异常
+class ByteReader {
+public:
+    explicit ByteReader(std::string_view bytes) : bytes(bytes) {}
+
+    uint32_t u8(size_t at) const { return static_cast<uint8_t>(range(at, 1)[0]); }
+    uint32_t u16(size_t at) const { return u8(at) | u8(at + 1) << 8; }
+    uint32_t u32(size_t at) const { return u16(at) | u16(at + 2) << 16; }
+    std::string_view range(size_t at, size_t size) const {
+        if (at > bytes.size() || bytes.size() - at < size) fail("目标文件被截断");
+        return bytes.substr(at, size);
+    }
+    std::string_view cstring(size_t at) const {
+        std::string_view rest = bytes.substr(std::min(at, bytes.size()));
+        size_t end = rest.find('\0');
+        if (end == std::string_view::npos) fail("目标文件的字符串表没有结尾");
+        return rest.substr(0, end);
+    }
+
+private:
+    std::string_view bytes;
+};
+
+constexpr uint32_t SHT_PROGBITS = 1, SHT_SYMTAB = 2;
+constexpr uint32_t STT_FUNC = 2;
+
+std::string hex(uint32_t value) {
+    std::ostringstream out;
+    out << "0x" << std::hex << value;
+    return out.str();
+}
+
+bool isDivide(RvOp op) {
+    return op == RvOp::Div || op == RvOp::Rem;
+}
+
+} // namespace
+
+CodeImage assembleImage(std::string_view assembly) {
+    std::vector<AsmInst> code = parseAsm(assembly);
+    CodeLayout layout = layoutCode(code);
+    CodeImage image;
+    std::vector<MachineInst> machine;
+    for (size_t i = 0; i < code.size(); ++i) {
+        const AsmInst& inst = code[i];
+        if (inst.op == AsmOp::Label) {
+            // 以.L开头的是函数内部的标签
+            if (inst.text.compare(0, 2, ".L") != 0) image.symbols[inst.text] = layout.offsets[i];
+            continue;
+        }
+        if (!isInstruction(inst)) continue;
+        int32_t offset = 0;
+        if (inst.op == AsmOp::Call || inst.op == AsmOp::Tail || isBranch(inst.op) || inst.op == AsmOp::J) {
+            offset = static_cast<int32_t>(layout.target(inst) - layout.offsets[i]);
+        }
+        machine.clear();
+        lowerAsmInst(inst, offset, layout.longBranch[i], machine);
+        for (const MachineInst& m : machine) image.text.push_back(encode(m));
+    }
+    return image;
+}
+
+CodeImage readObjectImage(std::string_view bytes) {
+    ByteReader elf(bytes);
+    if (elf.range(0, 4) != std::string_view("\x7f" "ELF", 4) || elf.u8(4) != 1 || elf.u8(5) != 1) {
+        fail("不是32位小端的ELF文件");
+    }
+    if (elf.u16(18) != 243) fail("不是RISC-V目标文件");
+    uint32_t sectionHeaders = elf.u32(32);
+    uint32_t headerSize = elf.u16(46);
+    uint32_t sectionCount = elf.u16(48);
+    uint32_t namesIndex = elf.u16(50);
+    auto field = [&](uint32_t section, uint32_t offset) {
+        if (section >= sectionCount) fail("节下标超出范围");
+        return elf.u32(sectionHeaders + section * headerSize + offset);
+    };
+    auto contents = [&](uint32_t section) { return elf.range(field(section, 16), field(section, 20)); };
+    std::string_view sectionNames = contents(namesIndex);
+
+    uint32_t textIndex = 0, symtabIndex = 0;
+    for (uint32_t s = 1; s < sectionCount; ++s) {
+        uint32_t type = field(s, 4);
+        if (type == SHT_PROGBITS && ByteReader(sectionNames).cstring(field(s, 0)) == ".text") textIndex = s;
+        if (type == SHT_SYMTAB) symtabIndex = s;
+    }
+    if (textIndex == 0 || symtabIndex == 0) fail("目标文件缺少.text或符号表");
+
+    CodeImage image;
+    ByteReader text(contents(textIndex));
+    uint32_t textSize = field(textIndex, 20);
+    if (textSize % 4) fail(".text的长度不是4的倍数");
+    for (uint32_t at = 0; at < textSize; at += 4) image.text.push_back(text.u32(at));
+
+    ByteReader symtab(contents(symtabIndex));
+    ByteReader strtab(contents(field(symtabIndex, 24)));
+    uint32_t symbolCount = field(symtabIndex, 20) / 16;
+    for (uint32_t i = 1; i < symbolCount; ++i) {
+        std::string_view name = strtab.cstring(symtab.u32(i * 16));
+        uint32_t value = symtab.u32(i * 16 + 4);
+        uint32_t info = symtab.u8(i * 16 + 12);
+        uint32_t section = symtab.u16(i * 16 + 14);
+        // 文件内的调用已经填好偏移；调用别的文件里的函数需要链接
+        if (section == 0 && !name.empty()) fail("引用了未定义的函数 " + std::string(name));
+        if ((info & 0xf) == STT_FUNC && section == textIndex) image.symbols[std::string(name)] = value;
+    }
+    return image;
+}
+
+CodeImage loadImage(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) fail("无法打开文件: " + path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string bytes = buffer.str();
+    if (bytes.compare(0, 4, "\x7f" "ELF") == 0) return readObjectImage(bytes);
+    return assembleImage(bytes);
+}
+
+Simulator::Simulator(const CodeImage& image, PipelineModel model, uint32_t stackBytes)
+    : image(image), model(model), decoded(image.text.size()), valid(image.text.size()),
+      stack(stackBytes / 4), stackBase(StackTop - stackBytes / 4 * 4) {
+    for (size_t i = 0; i < image.text.size(); ++i) valid[i] = decode(image.text[i], decoded[i]);
+}
+
+uint32_t& Simulator::word(uint32_t address) {
+    if (address & 3) fail("不对齐的访问 " + hex(address));
+    if (address < stackBase || address >= StackTop) {
+        fail("访问栈以外的地址 " + hex(address));
+    }
+    return stack[(address - stackBase) / 4];
+}
+
+int32_t Simulator::call(const std::string& entry, const std::vector<int32_t>& args, uint64_t maxInstructions) {
+    auto found = image.symbols.find(entry);
+    if (found == image.symbols.end()) fail("找不到函数 " + entry);
+    if (args.size() > 8) fail("实参超过8个");
+
+    uint32_t x[32] = {};
+    x[static_cast<int>(Register::SP)] = StackTop;
+    for (size_t i = 0; i < args.size(); ++i) x[static_cast<int>(argRegister(static_cast<int>(i)))] = args[i];
+    uint32_t pc = TextBase + found->second;
+
+    // 记分板：各寄存器的值在哪个周期可用，以及是不是load的结果
+    uint64_t now = counters.cycles;
+    uint64_t ready[32];
+    bool fromLoad[32] = {};
+    for (uint64_t& cycle : ready) cycle = now;
+    uint64_t divFree = now;
+    uint64_t limit = counters.instructions + maxInstructions;
+
+    while (pc != 0) {
+        uint32_t index = (pc - TextBase) / 4;
+        if (pc < TextBase || (pc & 3) || index >= decoded.size()) {
+            fail("跳到代码以外的地址 " + hex(pc));
+        }
+        if (!valid[index]) fail("不认识的指令 " + hex(image.text[index]));
+        if (counters.instructions >= limit) fail("执行超过" + std::to_string(maxInstructions) + "条指令");
+        const MachineInst& inst = decoded[index];
+        ++counters.instructions;
+
+        int rd = static_cast<int>(inst.rd), rs1 = static_cast<int>(inst.rs1), rs2 = static_cast<int>(inst.rs2);
+        uint64_t issue = now;
+        auto wait = [&](int r) {
+            if (r == 0 || ready[r] <= issue) return;
+            (fromLoad[r] ? counters.loadUseStalls : counters.mulDivStalls) += ready[r] - issue;
+            issue = ready[r];
+        };
+        switch (inst.op) {
+            case RvOp::Lui: case RvOp::Auipc: case RvOp::Jal:
+                break;
+            case RvOp::Addi: case RvOp::Andi: case RvOp::Xori: case RvOp::Slti: case RvOp::Sltiu:
+            case RvOp::Slli: case RvOp::Srli: case RvOp::Srai: case RvOp::Lw: case RvOp::Jalr:
+                wait(rs1);
+                break;
+            default:
+                wait(rs1);
+                wait(rs2);
+                break;
+        }
+        if (isDivide(inst.op) && divFree > issue) {
+            counters.mulDivStalls += divFree - issue;
+            issue = divFree;
+        }
+
+        uint32_t a = x[rs1], b = x[rs2];
+        auto imm = static_cast<uint32_t>(inst.imm);
+        uint32_t result = 0, next = pc + 4;
+        int latency = 1;
+        bool writes = true, load = false, taken = false;
+        switch (inst.op) {
+            case RvOp::Add: result = a + b; break;
+            case RvOp::Sub: result = a - b; break;
+            case RvOp::Mul:
+                result = a * b;
+                latency = model.mulLatency;
+                ++counters.muls;
+                break;
+            case RvOp::Mulh:
+                result = static_cast<uint32_t>(static_cast<uint64_t>(
+                    static_cast<int64_t>(static_cast<int32_t>(a)) * static_cast<int32_t>(b)) >> 32);
+                latency = model.mulLatency;
+                ++counters.muls;
+                break;
+            case RvOp::Div:
+            case RvOp::Rem: {
+                auto sa = static_cast<int32_t>(a), sb = static_cast<int32_t>(b);
+                // RISC-V的约定：除以0商为-1、余数为被除数；INT_MIN/-1商为INT_MIN、余数为0
+                if (sb == 0) {
+                    result = inst.op == RvOp::Div ? ~0u : a;
+                } else if (sa == INT32_MIN && sb == -1) {
+                    result = inst.op == RvOp::Div ? a : 0;
+                } else {
+                    result = static_cast<uint32_t>(inst.op == RvOp::Div ? sa / sb : sa % sb);
+                }
+                latency = model.divLatency;
+                divFree = issue + model.divLatency;
+                ++counters.divs;
+                break;
+            }
+            case RvOp::Xor: result = a ^ b; break;
+            case RvOp::Slt: result = static_cast<int32_t>(a) < static_cast<int32_t>(b); break;
+            case RvOp::Sltu: result = a < b; break;
+            case RvOp::Addi: result = a + imm; break;
+            case RvOp::Andi: result = a & imm; break;
+            case RvOp::Xori: result = a ^ imm; break;
+            case RvOp::Slti: result = static_cast<int32_t>(a) < inst.imm; break;
+            case RvOp::Sltiu: result = a < imm; break;
+            case RvOp::Slli: result = a << (imm & 31); break;
+            case RvOp::Srli: result = a >> (imm & 31); break;
+            case RvOp::Srai: result = static_cast<uint32_t>(static_cast<int32_t>(a) >> (imm & 31)); break;
+            case RvOp::Lw:
+                result = word(a + imm);
+                latency = model.loadLatency;
+                load = true;
+                ++counters.loads;
+                break;
+            case RvOp::Sw:
+                word(a + imm) = b;
+                writes = false;
+                ++counters.stores;
+                break;
+            case RvOp::Beq: case RvOp::Bne: case RvOp::Blt: case RvOp::Bge:
+                switch (inst.op) {
+                    case RvOp::Beq: taken = a == b; break;
+                    case RvOp::Bne: taken = a != b; break;
+                    case RvOp::Blt: taken = static_cast<int32_t>(a) < static_cast<int32_t>(b); break;
+                    default: taken = static_cast<int32_t>(a) >= static_cast<int32_t>(b); break;
+                }
+                if (taken) {
+                    next = pc + imm;
+                    ++counters.takenBranches;
+                }
+                writes = false;
+                ++counters.branches;
+                break;
+            case RvOp::Lui: result = imm << 12; break;
+            case RvOp::Auipc: result = pc + (imm << 12); break;
+            case RvOp::Jal:
+            case RvOp::Jalr:
+                result = pc + 4;
+                next = inst.op == RvOp::Jal ? pc + imm : (a + imm) & ~1u;
+                taken = true;
+                ++counters.jumps;
+                if (inst.rd == Register::RA) ++counters.calls;
+                break;
+        }
+
+        now = issue + 1;
+        if (writes && rd != 0) {
+            x[rd] = result;
+            ready[rd] = issue + latency;
+            fromLoad[rd] = load;
+        }
+        if (taken) {
+            now += model.branchPenalty;
+            counters.flushCycles += model.branchPenalty;
+        }
+        pc = next;
+    }
+    counters.cycles = now;
+    return static_cast<int32_t>(x[static_cast<int>(Register::A0)]);
+}
+
+void SimStats::print(std::ostream& out) const {
+    const std::pair<const char*, uint64_t> rows[] = {
+        {"instructions", instructions}, {"loads", loads}, {"stores", stores},
+        {"branches", branches}, {"taken_branches", takenBranches}, {"jumps", jumps},
+        {"calls", calls}, {"muls", muls}, {"divs", divs}, {"cycles", cycles},
+        {"load_use_stalls", loadUseStalls}, {"muldiv_stalls", mulDivStalls}, {"flush_cycles", flushCycles},
+    };
+    out << "模拟统计:\n";
+    for (const auto& [name, value] : rows) {
+        out << "  " << std::left << std::setw(24) << name << std::right << std::setw(12) << value << "\n";
+    }
+    out << "  " << std::left << std::setw(24) << "cpi" << std::right << std::setw(12) << std::fixed
+        << std::setprecision(3) << (instructions ? static_cast<double>(cycles) / instructions : 0.0) << "\n";
+    out << std::defaultfloat;
+}
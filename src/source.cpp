@@ -0,0 +1,43 @@
+#include "source.h"
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SourceFile::SourceFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("无法打开文件: " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            data = static_cast<const char*>(addr);
+            length = st.st_size;
+            mapped = true;
+            ::madvise(addr, length, MADV_SEQUENTIAL);
+        }
+    }
+    ::close(fd);
+    if (mapped) return;
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("无法打开文件: " + path);
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    fallback = buffer.str();
+    data = fallback.data();
+    length = fallback.size();
+}
+
+SourceFile::~SourceFile() {
+    if (mapped) {
+        ::munmap(const_cast<char*>(data), length);
+    }
+}
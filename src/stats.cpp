@@ -0,0 +1,177 @@
+#include "stats.h"
+#include <algorithm>
+#include <iomanip>
+#include <sys/resource.h>
+
+namespace {
+
+constexpr size_t NODE_KIND_COUNT = static_cast<size_t>(NodeKind::FuncCall) + 1;
+
+void countNode(const ASTNode* node, uint64_t* counts) {
+    if (!node) return;
+    ++counts[static_cast<size_t>(node->kind)];
+    switch (node->kind) {
+        case NodeKind::Program:
+            for (auto func : static_cast<const Program*>(node)->functions) countNode(func, counts);
+            break;
+        case NodeKind::FunctionDef: countNode(static_cast<const FunctionDef*>(node)->body, counts); break;
+        case NodeKind::Block:
+            for (auto stmt : static_cast<const Block*>(node)->stmts) countNode(stmt, counts);
+            break;
+        case NodeKind::VarDecl: countNode(static_cast<const VarDecl*>(node)->initExpr, counts); break;
+        case NodeKind::Assign: countNode(static_cast<const Assign*>(node)->expr, counts); break;
+        case NodeKind::IfStmt: {
+            auto stmt = static_cast<const IfStmt*>(node);
+            countNode(stmt->cond, counts);
+            countNode(stmt->thenStmt, counts);
+            countNode(stmt->elseStmt, counts);
+            break;
+        }
+        case NodeKind::WhileStmt: {
+            auto stmt = static_cast<const WhileStmt*>(node);
+            countNode(stmt->cond, counts);
+            countNode(stmt->body, counts);
+            break;
+        }
+        case NodeKind::ReturnStmt: countNode(static_cast<const ReturnStmt*>(node)->expr, counts); break;
+        case NodeKind::ExprStmt: countNode(static_cast<const ExprStmt*>(node)->expr, counts); break;
+        case NodeKind::BinaryExpr: {
+            auto expr = static_cast<const BinaryExpr*>(node);
+            countNode(expr->lhs, counts);
+            countNode(expr->rhs, counts);
+            break;
+        }
+        case NodeKind::UnaryExpr: countNode(static_cast<const UnaryExpr*>(node)->expr, counts); break;
+        case NodeKind::FuncCall:
+            for (auto arg : static_cast<const FuncCall*>(node)->args) countNode(arg, counts);
+            break;
+        default: break;
+    }
+}
+
+// 整个进程（所有线程）的用户态加内核态CPU时间，毫秒
+double processCpuMs(long* peakRssKb = nullptr) {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    if (peakRssKb) *peakRssKb = usage.ru_maxrss;
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+}
+
+} // namespace
+
+void CompileStats::addPhase(const std::string& name, double wallMs, double cpuMs, long peakRssKb) {
+    auto it = std::find_if(phaseList.begin(), phaseList.end(), [&](const Phase& p) { return p.name == name; });
+    if (it == phaseList.end()) {
+        phaseList.push_back({name, wallMs, cpuMs, peakRssKb});
+        return;
+    }
+    it->wallMs += wallMs;
+    it->cpuMs += cpuMs;
+    it->peakRssKb = std::max(it->peakRssKb, peakRssKb);
+}
+
+void CompileStats::add(const std::string& counter, uint64_t value) {
+    auto it = std::find_if(counterList.begin(), counterList.end(), [&](const auto& c) { return c.first == counter; });
+    if (it == counterList.end()) {
+        counterList.emplace_back(counter, value);
+    } else {
+        it->second += value;
+    }
+}
+
+void CompileStats::merge(const CompileStats& other) {
+    for (const Phase& phase : other.phaseList) addPhase(phase.name, phase.wallMs, phase.cpuMs, phase.peakRssKb);
+    for (const auto& [name, value] : other.counterList) add(name, value);
+}
+
+void CompileStats::countNodes(const ASTNode* root) {
+    uint64_t counts[NODE_KIND_COUNT] = {};
+    countNode(root, counts);
+    for (size_t k = 0; k < NODE_KIND_COUNT; ++k) {
+        add(std::string("ast.") + nodeKindName(static_cast<NodeKind>(k)), counts[k]);
+    }
+}
+
+uint64_t CompileStats::counter(const std::string& name) const {
+    for (const auto& [key, value] : counterList) {
+        if (key == name) return value;
+    }
+    return 0;
+}
+
+void CompileStats::printTimeReport(std::ostream& out) const {
+    double totalWall = 0, totalCpu = 0;
+    long peak = 0;
+    for (const Phase& phase : phaseList) {
+        totalWall += phase.wallMs;
+        totalCpu += phase.cpuMs;
+        peak = std::max(peak, phase.peakRssKb);
+    }
+    out << "各阶段耗时:\n";
+    out << "  阶段          墙钟(ms)   占比   CPU(ms)  峰值RSS(KB)\n";
+    out << std::fixed << std::setprecision(3);
+    for (const Phase& phase : phaseList) {
+        out << "  " << std::left << std::setw(12) << phase.name << std::right << std::setw(10) << phase.wallMs
+            << std::setw(6) << std::setprecision(1) << (totalWall > 0 ? 100 * phase.wallMs / totalWall : 0.0) << "%"
+            << std::setprecision(3) << std::setw(10) << phase.cpuMs << std::setw(13) << phase.peakRssKb << "\n";
+    }
+    out << "  合计        " << std::setw(10) << totalWall << " 100.0%" << std::setw(10) << totalCpu
+        << std::setw(13) << peak << "\n";
+    out << std::defaultfloat;
+}
+
+void CompileStats::printCounters(std::ostream& out) const {
+    out << "编译统计:\n";
+    for (const auto& [name, value] : counterList) {
+        out << "  " << std::left << std::setw(24) << name << std::right << std::setw(12) << value << "\n";
+    }
+}
+
+void CompileStats::printJSON(std::ostream& out, bool times, bool counters) const {
+    // 阶段名和计数名都是ASCII标识符，不需要转义
+    out << "{";
+    if (times) {
+        out << "\n  \"phases\": [";
+        out << std::fixed << std::setprecision(3);
+        for (size_t i = 0; i < phaseList.size(); ++i) {
+            const Phase& phase = phaseList[i];
+            out << (i ? "," : "") << "\n    {\"name\": \"" << phase.name << "\", \"wall_ms\": " << phase.wallMs
+                << ", \"cpu_ms\": " << phase.cpuMs << ", \"peak_rss_kb\": " << phase.peakRssKb << "}";
+        }
+        out << std::defaultfloat << "\n  ]";
+    }
+    if (counters) {
+        out << (times ? "," : "") << "\n  \"counters\": {";
+        for (size_t i = 0; i < counterList.size(); ++i) {
+            out << (i ? "," : "") << "\n    \"" << counterList[i].first << "\": " << counterList[i].second;
+        }
+        out << "\n  }";
+    }
+    out << "\n}\n";
+}
+
+PhaseTimer::PhaseTimer(CompileStats* stats, const char* first) : stats(stats) {
+    start(first);
+}
+
+void PhaseTimer::start(const char* name) {
+    if (!stats) return;
+    current = name;
+    wallStart = std::chrono::steady_clock::now();
+    cpuStart = processCpuMs();
+}
+
+void PhaseTimer::next(const char* name) {
+    stop();
+    start(name);
+}
+
+void PhaseTimer::stop() {
+    if (!stats || !current) return;
+    long peakRssKb = 0;
+    double cpuMs = processCpuMs(&peakRssKb) - cpuStart;
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+    stats->addPhase(current, wallMs, cpuMs, peakRssKb);
+    current = nullptr;
+}
@@ -0,0 +1,33 @@
+#include "symtab.h"
+
+void ScopedSymbolTable::reset(size_t symbolCount) {
+    entries.assign(symbolCount, Entry());
+    log.clear();
+    marks.clear();
+}
+
+void ScopedSymbolTable::leaveScope() {
+    size_t mark = marks.back();
+    marks.pop_back();
+    while (log.size() > mark) {
+        const Undo& undo = log.back();
+        entries[undo.name].var = undo.var;
+        entries[undo.name].depth = undo.depth;
+        log.pop_back();
+    }
+}
+
+bool ScopedSymbolTable::declareVar(SymbolId name, uint32_t var) {
+    if (declaredInCurrentScope(name)) return false;
+    Entry& entry = entries[name];
+    log.push_back({name, entry.var, entry.depth});
+    entry.var = var;
+    entry.depth = static_cast<uint32_t>(marks.size());
+    return true;
+}
+
+bool ScopedSymbolTable::declareFunction(SymbolId name, int order) {
+    if (entries[name].function >= 0) return false;
+    entries[name].function = order;
+    return true;
+}
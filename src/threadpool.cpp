@@ -0,0 +1,105 @@
+#include "threadpool.h"
+#include <algorithm>
+
+namespace {
+
+// 当前线程所属的线程池和编号
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local unsigned currentIndex = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < threads; ++i) queues.push_back(std::make_unique<Queue>());
+    for (unsigned i = 1; i < threads; ++i) {
+        this->threads.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads) thread.join();
+}
+
+unsigned ThreadPool::currentWorker() const {
+    return currentPool == this ? currentIndex : 0;
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t, unsigned)>& task) {
+    unsigned self = currentWorker();
+    // 只有一个线程或一个任务时直接在调用线程上按顺序执行
+    if (threads.empty() || count <= 1) {
+        for (size_t i = 0; i < count; ++i) task(i, self);
+        return;
+    }
+
+    Batch batch{&task, {count}, {}, count, nullptr};
+    {
+        // 倒序放入，自己从尾部取时按编号顺序执行，被偷走的是编号大的
+        std::lock_guard<std::mutex> lock(queues[self]->mutex);
+        for (size_t i = count; i-- > 0;) queues[self]->tasks.push_back({&batch, i});
+    }
+    queued.fetch_add(count);
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_all();
+
+    // 等待期间帮着执行任务（可能是别的批次的），被偷走的任务还没做完时让出时间片
+    while (batch.remaining.load(std::memory_order_acquire) > 0) {
+        if (!runOne(self)) std::this_thread::yield();
+    }
+    if (batch.error) std::rethrow_exception(batch.error);
+}
+
+bool ThreadPool::runOne(unsigned worker) {
+    Task task{nullptr, 0};
+    {
+        Queue& own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+        }
+    }
+    for (unsigned k = 1; !task.batch && k < queues.size(); ++k) {
+        Queue& victim = *queues[(worker + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+        }
+    }
+    if (!task.batch) return false;
+    queued.fetch_sub(1);
+
+    Batch& batch = *task.batch;
+    try {
+        (*batch.task)(task.index, worker);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(batch.mutex);
+        if (task.index < batch.errorIndex) {
+            batch.errorIndex = task.index;
+            batch.error = std::current_exception();
+        }
+    }
+    // 计数归零后调用线程可能立刻返回并销毁batch，之后不能再访问它
+    batch.remaining.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+}
+
+void ThreadPool::workerLoop(unsigned worker) {
+    currentPool = this;
+    currentIndex = worker;
+    for (;;) {
+        if (runOne(worker)) continue;
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) return;
+    }
+}
@@ -0,0 +1,132 @@
+#include "vm.h"
+#include <stdexcept>
+
+// 定义TOYC_NO_COMPUTED_GOTO可强制使用switch分派
+#if defined(__GNUC__) && !defined(TOYC_NO_COMPUTED_GOTO)
+#define TOYC_COMPUTED_GOTO 1
+#endif
+
+VM::VM(const BcModule& module, size_t stackRegisters, size_t maxFrames)
+    : module(module), registers(stackRegisters), maxFrames(maxFrames) {
+    frames.reserve(1024);
+}
+
+int32_t VM::call(const std::string& name, const std::vector<int32_t>& args) {
+    int index = module.find(name);
+    if (index < 0) throw std::runtime_error("找不到函数" + name);
+    return call(index, args);
+}
+
+int32_t VM::call(int function, const std::vector<int32_t>& args) {
+    const BcFunction* functions = module.functions.data();
+    const BcFunction& entry = functions[function];
+    if (static_cast<int>(args.size()) != entry.params) {
+        throw std::runtime_error("函数" + entry.name + "需要" + std::to_string(entry.params) + "个实参");
+    }
+    int32_t* const limit = registers.data() + registers.size();
+    int32_t* regs = registers.data();
+    if (regs + entry.registers > limit) throw std::runtime_error("栈溢出");
+    for (size_t i = 0; i < args.size(); ++i) regs[i] = args[i];
+    frames.clear();
+
+    const BcInst* code = entry.code.data();
+    const BcInst* pc = code;
+    const BcInst* inst;
+    uint64_t count = 0;
+    int32_t result;
+
+// 加减乘和取负按32位补码回绕
+#define U(reg) static_cast<uint32_t>(regs[reg])
+#define WRAP(expr) static_cast<int32_t>(expr)
+#define JUMP_IF(cond) \
+    if (cond) pc = code + inst->k; \
+    NEXT()
+
+#ifdef TOYC_COMPUTED_GOTO
+    // 顺序与BcOp一致
+    static const void* const dispatch[] = {
+        &&op_LoadK, &&op_Move, &&op_Add, &&op_Sub, &&op_Mul, &&op_Div, &&op_Mod, &&op_Lt, &&op_Le, &&op_Eq,
+        &&op_Ne, &&op_AddK, &&op_Neg, &&op_Not, &&op_Jump, &&op_JumpIfZero, &&op_JumpIfNonZero, &&op_JumpIfLt,
+        &&op_JumpIfLe, &&op_JumpIfEq, &&op_JumpIfNe, &&op_Call, &&op_Return, &&op_ReturnVoid,
+    };
+#define OP(name) op_##name:
+#define NEXT()                                      \
+    do {                                            \
+        inst = pc++;                                \
+        ++count;                                    \
+        goto *dispatch[static_cast<int>(inst->op)]; \
+    } while (0)
+    NEXT();
+#else
+#define OP(name) case BcOp::name:
+#define NEXT() continue
+    for (;;) {
+        inst = pc++;
+        ++count;
+        switch (inst->op) {
+#endif
+
+    OP(LoadK) regs[inst->a] = inst->k; NEXT();
+    OP(Move) regs[inst->a] = regs[inst->b]; NEXT();
+    OP(Add) regs[inst->a] = WRAP(U(inst->b) + U(inst->c)); NEXT();
+    OP(Sub) regs[inst->a] = WRAP(U(inst->b) - U(inst->c)); NEXT();
+    OP(Mul) regs[inst->a] = WRAP(U(inst->b) * U(inst->c)); NEXT();
+    OP(Div) regs[inst->a] = runtimeDiv(regs[inst->b], regs[inst->c]); NEXT();
+    OP(Mod) regs[inst->a] = runtimeRem(regs[inst->b], regs[inst->c]); NEXT();
+    OP(Lt) regs[inst->a] = regs[inst->b] < regs[inst->c]; NEXT();
+    OP(Le) regs[inst->a] = regs[inst->b] <= regs[inst->c]; NEXT();
+    OP(Eq) regs[inst->a] = regs[inst->b] == regs[inst->c]; NEXT();
+    OP(Ne) regs[inst->a] = regs[inst->b] != regs[inst->c]; NEXT();
+    OP(AddK) regs[inst->a] = WRAP(U(inst->b) + static_cast<uint32_t>(inst->k)); NEXT();
+    OP(Neg) regs[inst->a] = WRAP(0u - U(inst->b)); NEXT();
+    OP(Not) regs[inst->a] = regs[inst->b] == 0; NEXT();
+    OP(Jump) pc = code + inst->k; NEXT();
+    OP(JumpIfZero) JUMP_IF(regs[inst->a] == 0);
+    OP(JumpIfNonZero) JUMP_IF(regs[inst->a] != 0);
+    OP(JumpIfLt) JUMP_IF(regs[inst->a] < regs[inst->b]);
+    OP(JumpIfLe) JUMP_IF(regs[inst->a] <= regs[inst->b]);
+    OP(JumpIfEq) JUMP_IF(regs[inst->a] == regs[inst->b]);
+    OP(JumpIfNe) JUMP_IF(regs[inst->a] != regs[inst->b]);
+    OP(Call) {
+        const BcFunction& callee = functions[inst->k];
+        int32_t* base = regs + inst->b;
+        if (base + callee.registers > limit || frames.size() >= maxFrames) {
+            executed += count;
+            throw std::runtime_error("栈溢出");
+        }
+        frames.push_back({code, pc, regs, inst->a});
+        regs = base;
+        code = callee.code.data();
+        pc = code;
+        NEXT();
+    }
+    OP(Return) {
+        result = regs[inst->a];
+        goto leave;
+    }
+    OP(ReturnVoid) {
+        result = 0;
+    leave:
+        if (frames.empty()) {
+            executed += count;
+            return result;
+        }
+        const Frame& frame = frames.back();
+        code = frame.code;
+        pc = frame.returnPc;
+        regs = frame.base;
+        regs[frame.dest] = result;
+        frames.pop_back();
+        NEXT();
+    }
+
+#ifndef TOYC_COMPUTED_GOTO
+        }
+    }
+#endif
+#undef OP
+#undef NEXT
+#undef JUMP_IF
+#undef WRAP
+#undef U
+}
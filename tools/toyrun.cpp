@@ -0,0 +1,158 @@
+// 字节码解释执行：不生成汇编，把ToyC程序编译成寄存器字节码在虚拟机上执行main（或指定的函数），
+// 输出返回值。也可以只输出字节码，或者改用x86-64 JIT、直接遍历AST的解释器执行。进程退出码为返回值的低8位，
+// 或者按--expect给出是否与期望值相同
+#include "bytecode.h"
+#include "constfold.h"
+#include "interp.h"
+#include "jit.h"
+#include "parser.h"
+#include "semantic.h"
+#include "source.h"
+#include "vm.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+
+namespace {
+
+void printUsage(const char* programName) {
+    std::cout << "用法: " << programName << " [选项] <文件.toyc>" << std::endl;
+    std::cout << "选项:" << std::endl;
+    std::cout << "  -O0                 不做常量折叠" << std::endl;
+    std::cout << "  --entry <函数>      从该函数开始执行（默认main）" << std::endl;
+    std::cout << "  --args <a,b,...>    传给该函数的int实参" << std::endl;
+    std::cout << "  --dump              输出字节码，不执行" << std::endl;
+    std::cout << "  --ast               用直接遍历AST的解释器执行" << std::endl;
+    std::cout << "  --jit               编译成x86-64机器码执行，函数在第一次被调用时编译" << std::endl;
+    std::cout << "  --eager             与--jit一起使用，执行前编译全部函数" << std::endl;
+    std::cout << "  --stats             输出执行的字节码指令数和用时" << std::endl;
+    std::cout << "  --expect <N>        返回值等于N时退出码为0，否则为1（不指定时退出码为返回值的低8位）" << std::endl;
+}
+
+bool parseArgs(const std::string& text, std::vector<int32_t>& args) {
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = text.find(',', start);
+        std::string item = text.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        size_t used = 0;
+        try {
+            args.push_back(static_cast<int32_t>(std::stoll(item, &used, 0)));
+        } catch (const std::exception&) {
+            return false;
+        }
+        if (used != item.size()) return false;
+        if (comma == std::string::npos) break;
+        start = comma + 1;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string input, entry = "main";
+    std::vector<int32_t> args, expected;
+    bool fold = true, dump = false, walkAst = false, jit = false, eager = false, stats = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        bool ok = true;
+        if (arg == "-O0") {
+            fold = false;
+        } else if (arg == "--entry" && hasValue) {
+            entry = argv[++i];
+        } else if (arg == "--args" && hasValue) {
+            ok = parseArgs(argv[++i], args);
+        } else if (arg == "--expect" && hasValue) {
+            expected.clear();
+            ok = parseArgs(argv[++i], expected) && expected.size() == 1;
+        } else if (arg == "--dump") {
+            dump = true;
+        } else if (arg == "--ast") {
+            walkAst = true;
+        } else if (arg == "--jit") {
+            jit = true;
+        } else if (arg == "--eager") {
+            eager = true;
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (!arg.empty() && arg[0] != '-' && input.empty()) {
+            input = arg;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (input.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        SourceFile source(input);
+        ASTContext context;
+        Parser parser(source.text(), context);
+        auto ast = parser.parse();
+        if (!ast) throw std::runtime_error("语法分析失败");
+        SemanticAnalyzer semantic(context.names);
+        semantic.analyze(ast);
+        if (fold) {
+            ConstantFolder folder(context);
+            folder.optimize(ast);
+        }
+
+        // 只计执行时间，不计编译字节码和分配寄存器栈（JIT计入编译机器码的时间）
+        int32_t result;
+        uint64_t executed = 0;
+        size_t functions = 0, jitFunctions = 0, jitBytes = 0, stubSites = 0;
+        std::chrono::steady_clock::time_point start;
+        if (walkAst) {
+            ASTInterpreter interpreter(ast, context.names);
+            start = std::chrono::steady_clock::now();
+            result = interpreter.call(entry, args);
+        } else {
+            BcModule module = compileBytecode(ast, context.names);
+            if (dump) {
+                printBytecode(std::cout, module);
+                return 0;
+            }
+            if (jit) {
+                functions = module.functions.size();
+                start = std::chrono::steady_clock::now();
+                JIT compiler(std::move(module), !eager);
+                result = compiler.call(entry, args);
+                jitFunctions = compiler.compiledFunctions();
+                jitBytes = compiler.codeSize();
+                stubSites = compiler.stubCallSites();
+            } else {
+                VM vm(module);
+                start = std::chrono::steady_clock::now();
+                result = vm.call(entry, args);
+                executed = vm.instructions();
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << entry << "返回: " << result << std::endl;
+        if (stats) {
+            if (jit) {
+                std::cout << "JIT编译: " << jitFunctions << "/" << functions << "个函数, " << jitBytes << "字节, "
+                          << stubSites << "个调用点经过桩" << std::endl;
+            } else if (!walkAst) {
+                std::cout << "字节码指令: " << executed << std::endl;
+            }
+            std::cout << "用时: " << seconds * 1000 << " ms" << std::endl;
+        }
+        if (!expected.empty()) {
+            if (result == expected[0]) return 0;
+            std::cerr << "错误: 期望返回" << expected[0] << std::endl;
+            return 1;
+        }
+        return result & 0xff;
+    } catch (const std::exception& e) {
+        std::cerr << "错误: " << e.what() << std::endl;
+        return 255;
+    }
+}
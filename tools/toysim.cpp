@@ -0,0 +1,129 @@
+// RV32IM指令集模拟器：读入toycc输出的汇编文本或目标文件，执行main（或指定的函数），
+// 输出返回值和动态指令数、访存、分支、流水线周期估计等统计。进程退出码为返回值的低8位，
+// 或者按--expect给出是否与期望值相同
+#include "sim.h"
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace {
+
+void printUsage(const char* programName) {
+    std::cout << "用法: " << programName << " [选项] <文件.s|文件.o>" << std::endl;
+    std::cout << "选项:" << std::endl;
+    std::cout << "  --entry <函数>      从该函数开始执行（默认main）" << std::endl;
+    std::cout << "  --args <a,b,...>    传给该函数的int实参（最多8个）" << std::endl;
+    std::cout << "  --stats             输出指令、访存、分支和周期统计" << std::endl;
+    std::cout << "  --expect <N>        返回值等于N时退出码为0，否则为1（不指定时退出码为返回值的低8位）" << std::endl;
+    std::cout << "  --max-insts <N>     最多执行的指令数（默认10亿）" << std::endl;
+    std::cout << "  --core <名字>       按该核的延迟表估计周期（默认generic），后面的延迟选项在它的基础上修改:" << std::endl;
+    for (const CoreModel& core : coreModels()) {
+        std::cout << "                        " << std::left << std::setw(10) << core.name << core.description << std::endl;
+    }
+    std::cout << "  --load-latency <N>  load结果可用的周期数（默认2）" << std::endl;
+    std::cout << "  --mul-latency <N>   乘法结果可用的周期数（默认3）" << std::endl;
+    std::cout << "  --div-latency <N>   除法、取余的周期数，除法器不流水（默认34）" << std::endl;
+    std::cout << "  --branch-penalty <N> 跳转成功的分支和jal/jalr冲刷的周期数（默认2）" << std::endl;
+}
+
+bool parseCount(const std::string& text, uint64_t& value) {
+    if (text.empty() || text.size() > 18 || text.find_first_not_of("0123456789") != std::string::npos) return false;
+    value = std::stoull(text);
+    return true;
+}
+
+bool parseArgs(const std::string& text, std::vector<int32_t>& args) {
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = text.find(',', start);
+        std::string item = text.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        size_t used = 0;
+        try {
+            args.push_back(static_cast<int32_t>(std::stoll(item, &used, 0)));
+        } catch (const std::exception&) {
+            return false;
+        }
+        if (used != item.size()) return false;
+        if (comma == std::string::npos) break;
+        start = comma + 1;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string input, entry = "main";
+    std::vector<int32_t> args;
+    bool stats = false;
+    std::vector<int32_t> expected;
+    uint64_t maxInstructions = 1000000000;
+    PipelineModel model;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        uint64_t value = 0;
+        auto latency = [&](int& field) {
+            if (!hasValue || !parseCount(argv[++i], value) || value > 1000) return false;
+            field = static_cast<int>(value);
+            return true;
+        };
+        bool ok = true;
+        if (arg == "--entry" && hasValue) {
+            entry = argv[++i];
+        } else if (arg == "--args" && hasValue) {
+            ok = parseArgs(argv[++i], args) && args.size() <= 8;
+        } else if (arg == "--expect" && hasValue) {
+            expected.clear();
+            ok = parseArgs(argv[++i], expected) && expected.size() == 1;
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg == "--max-insts") {
+            ok = hasValue && parseCount(argv[++i], maxInstructions);
+        } else if (arg == "--core" && hasValue) {
+            try {
+                model = findCoreModel(argv[++i]);
+            } catch (const std::exception& e) {
+                std::cerr << "错误: " << e.what() << std::endl;
+                return 1;
+            }
+        } else if (arg == "--load-latency") {
+            ok = latency(model.loadLatency);
+        } else if (arg == "--mul-latency") {
+            ok = latency(model.mulLatency);
+        } else if (arg == "--div-latency") {
+            ok = latency(model.divLatency);
+        } else if (arg == "--branch-penalty") {
+            ok = latency(model.branchPenalty);
+        } else if (!arg.empty() && arg[0] != '-' && input.empty()) {
+            input = arg;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (input.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        CodeImage image = loadImage(input);
+        Simulator simulator(image, model);
+        int32_t result = simulator.call(entry, args, maxInstructions);
+        std::cout << entry << "返回: " << result << std::endl;
+        if (stats) simulator.stats().print(std::cout);
+        if (!expected.empty()) {
+            if (result == expected[0]) return 0;
+            std::cerr << "错误: 期望返回" << expected[0] << std::endl;
+            return 1;
+        }
+        return result & 0xff;
+    } catch (const std::exception& e) {
+        std::cerr << "错误: " << e.what() << std::endl;
+        return 255;
+    }
+}